@@ -75,6 +75,7 @@ const GLsizei fbo_h = 256;
 static const char arg_normal[] = "normal_map";
 static const char arg_albedo[] = "albedo_map";
 static const char arg_tile[] = "tile";
+static const char arg_albedo_format[] = "albedo_format";
 
 static char g_normal_filename[FILENAME_MAX + 1] = "rockwall_NH.raw";
 static unsigned g_normal_w = 64;
@@ -84,6 +85,25 @@ static char g_albedo_filename[FILENAME_MAX + 1] = "rockwall.raw";
 static unsigned g_albedo_w = 256;
 static unsigned g_albedo_h = 256;
 
+static util::tex_format_t g_albedo_format = util::TEX_FORMAT_RGB888;
+
+static const struct
+{
+	const char* name;
+	util::tex_format_t format;
+}
+format_option[] =
+{
+	{ "rgb888",				util::TEX_FORMAT_RGB888 },
+	{ "rgba8888",			util::TEX_FORMAT_RGBA8888 },
+	{ "rgb565",				util::TEX_FORMAT_RGB565 },
+	{ "rgb565_dither",		util::TEX_FORMAT_RGB565_DITHER },
+	{ "rgba4444",			util::TEX_FORMAT_RGBA4444 },
+	{ "rgba4444_dither",	util::TEX_FORMAT_RGBA4444_DITHER },
+	{ "etc1",				util::TEX_FORMAT_ETC1 },
+	{ "etc2",				util::TEX_FORMAT_ETC2 }
+};
+
 static float g_tile = 2.f;
 
 #if !defined(PLATFORM_GLX)
@@ -178,7 +198,9 @@ hook::get_num_drawcalls()
 
 
 bool
-hook::requires_depth()
+hook::requires_depth(
+	const unsigned,
+	const char* const *)
 {
 	return false;
 }
@@ -222,6 +244,23 @@ parse_cli(
 						continue;
 					}
 
+				if (!strcmp(option, arg_albedo_format))
+				{
+					char name[OPTION_IDENTIFIER_MAX + 1];
+					unsigned j = 0;
+
+					if (1 == sscanf(argv[i] + opt_arg_start, "%" XQUOTE(OPTION_IDENTIFIER_MAX) "s", name))
+						for (; j < sizeof(format_option) / sizeof(format_option[0]); ++j)
+							if (!strcmp(name, format_option[j].name))
+							{
+								g_albedo_format = format_option[j].format;
+								break;
+							}
+
+					if (j < sizeof(format_option) / sizeof(format_option[0]))
+						continue;
+				}
+
 				if (!strcmp(option, arg_tile))
 					if (1 == sscanf(argv[i] + opt_arg_start, "%f", &g_tile) && 0.f < g_tile)
 					{
@@ -240,6 +279,9 @@ parse_cli(
 			" <filename> <width> <height>\t: use specified raw file and dimensions as source of normal map\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_albedo <<
 			" <filename> <width> <height>\t: use specified raw file and dimensions as source of albedo map\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_albedo_format <<
+			" <rgb888|rgba8888|rgb565[_dither]|rgba4444[_dither]|etc1|etc2>\t: store the albedo map as specified,"
+			" converting or compressing it at load time, or fetching it from the compressed-texture cache\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_tile <<
 			" <n>\t\t\t\t\t: tile texture maps the specified number of times along U, half as much along V\n" << std::endl;
 	}
@@ -294,13 +336,13 @@ createIndexedPolarSphere(
 		{
 			assert(ai < sizeof(arr) / sizeof(arr[0]));
 
-			const rend::matx3& azim =
+			const rend::matx3 azim =
 				rend::matx3().rotate((j * 2) * M_PI / (cols - 1), 0.f, 1.f, 0.f);
 
-			const rend::matx3& decl =
+			const rend::matx3 decl =
 				rend::matx3().rotate(- M_PI_2 + M_PI * i / (rows - 1), 1.f, 0.f, 0.f);
 
-			const rend::matx3& azim_decl = rend::matx3().mul(azim, decl);
+			const rend::matx3 azim_decl = rend::matx3().mul(azim, decl);
 
 			arr[ai].pos[0] = azim_decl[0][2] * r;
 			arr[ai].pos[1] = azim_decl[1][2] * r;
@@ -442,7 +484,7 @@ createIndexedGridQuad(
 			arr[ai].pos[1] =  1.f - i * (2.f / (rows - 1));
 			arr[ai].pos[2] = 0.f;
 			arr[ai].txc[0] = tile * j / (cols - 1);
-			arr[ai].txc[1] = tile * i / (rows - 1);
+			arr[ai].txc[1] = tile * (rows - 1 - i) / (rows - 1);
 
 			++ai;
 		}
@@ -677,7 +719,8 @@ hook::init_resources(
 		return false;
 	}
 
-	if (!util::setupTexture2D(g_tex[TEX_ALBEDO], g_albedo_filename, g_albedo_w, g_albedo_h))
+	if (!util::setupTexture2D(g_tex[TEX_ALBEDO], g_albedo_filename, g_albedo_w, g_albedo_h,
+			util::TEX_MIP_GL, g_albedo_format))
 	{
 		std::cerr << __FUNCTION__ << " failed at setupTexture2D" << std::endl;
 		return false;
@@ -890,8 +933,6 @@ hook::render_frame()
 
 	DEBUG_GL_ERR()
 
-	glFrontFace(GL_CW);
-
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	/////////////////////////////////////////////////////////////////
@@ -899,18 +940,21 @@ hook::render_frame()
 	static GLfloat angle = 0.f;
 	const GLfloat angleStep = 3.f / 40.f;
 
-	const rend::matx3& r0 = rend::matx3().rotate(angle, 1.f, 0.f, 0.f);
-	const rend::matx3& r1 = rend::matx3().rotate(angle, 0.f, 1.f, 0.f);
-	const rend::matx3& r2 = rend::matx3().rotate(angle, 0.f, 0.f, 1.f);
+	const rend::matx3 r0 = rend::matx3().rotate(angle, 1.f, 0.f, 0.f);
+	const rend::matx3 r1 = rend::matx3().rotate(angle, 0.f, 1.f, 0.f);
+	const rend::matx3 r2 = rend::matx3().rotate(angle, 0.f, 0.f, 1.f);
 
-	const rend::matx3& p0 = rend::matx3().mul(r1, r0);
-	const rend::matx3& p1 = rend::matx3().mul(r2, p0);
+	const rend::matx3 p0 = rend::matx3().mul(r1, r0);
+	const rend::matx3 p1 = rend::matx3().mul(r2, p0);
 
-	const GLfloat mvp[4][4] = // transpose and expand to 4x4, sign-inverting z in all original columns (for GL screen space)
+	// transpose and expand to 4x4, sign-inverting z in all original columns (for GL screen space); the fbo is
+	// not mirrored along y, as that would flip the tangent frames derived from screen-space derivatives, so the
+	// quads sampling it flip their texcoords instead
+	const GLfloat mvp[4][4] =
 	{
-		{ p1[0][0], -p1[1][0], -p1[2][0], 0.f },
-		{ p1[0][1], -p1[1][1], -p1[2][1], 0.f },
-		{ p1[0][2], -p1[1][2], -p1[2][2], 0.f },
+		{ p1[0][0], p1[1][0], -p1[2][0], 0.f },
+		{ p1[0][1], p1[1][1], -p1[2][1], 0.f },
+		{ p1[0][2], p1[1][2], -p1[2][2], 0.f },
 		{ 0.f,		0.f,	  0.f,		 1.f }
 	};
 
@@ -1012,8 +1056,6 @@ hook::render_frame()
 
 	DEBUG_GL_ERR()
 
-	glFrontFace(GL_CCW);
-
 	glUseProgram(g_shader_prog[PROG_FBO]);
 
 	DEBUG_GL_ERR()
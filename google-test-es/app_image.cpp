@@ -139,7 +139,9 @@ hook::get_num_drawcalls()
 
 
 bool
-hook::requires_depth()
+hook::requires_depth(
+	const unsigned,
+	const char* const *)
 {
 	return false;
 }
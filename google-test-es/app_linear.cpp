@@ -51,12 +51,28 @@ namespace testbed
 
 static const char arg_albedo[]	= "albedo_map";
 static const char arg_nearest[] = "nearest";
+static const char arg_mip[]		= "mip";
 
 static char g_albedo_filename[FILENAME_MAX + 1] = "graph_paper.raw";
 static unsigned g_albedo_w = 512;
 static unsigned g_albedo_h = 512;
 
 static bool g_nearest;
+static util::tex_mip_t g_mip = util::TEX_MIP_GL;
+
+static const struct
+{
+	const char* name;
+	util::tex_mip_t mip;
+}
+mip_option[] =
+{
+	{ "gl",				util::TEX_MIP_GL },
+	{ "box",			util::TEX_MIP_BOX },
+	{ "box_srgb",		util::TEX_MIP_BOX_SRGB },
+	{ "kaiser",			util::TEX_MIP_KAISER },
+	{ "kaiser_srgb",	util::TEX_MIP_KAISER_SRGB }
+};
 
 #if !defined(PLATFORM_GLX)
 
@@ -138,7 +154,9 @@ hook::get_num_drawcalls()
 
 
 bool
-hook::requires_depth()
+hook::requires_depth(
+	const unsigned,
+	const char* const *)
 {
 	return false;
 }
@@ -180,6 +198,23 @@ parse_cli(
 					g_nearest = true;
 					continue;
 				}
+
+				if (!strcmp(option, arg_mip))
+				{
+					char name[OPTION_IDENTIFIER_MAX + 1];
+					unsigned j = 0;
+
+					if (1 == sscanf(argv[i] + opt_arg_start, "%" XQUOTE(OPTION_IDENTIFIER_MAX) "s", name))
+						for (; j < sizeof(mip_option) / sizeof(mip_option[0]); ++j)
+							if (!strcmp(name, mip_option[j].name))
+							{
+								g_mip = mip_option[j].mip;
+								break;
+							}
+
+					if (j < sizeof(mip_option) / sizeof(mip_option[0]))
+						continue;
+				}
 			}
 		}
 
@@ -192,7 +227,10 @@ parse_cli(
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_albedo <<
 			" <filename> <width> <height>\t: use specified raw file and dimensions as source of albedo map\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_nearest <<
-			"\t\t\t\t\t: use nearest filtering with the albedo map sampler\n" << std::endl;
+			"\t\t\t\t\t: use nearest filtering with the albedo map sampler\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_mip <<
+			" <gl|box|box_srgb|kaiser|kaiser_srgb>\t: generate the albedo mipmap by the GL, or on the CPU by the specified filter,"
+			" optionally in linear light\n" << std::endl;
 	}
 
 	return !cli_err;
@@ -415,7 +453,7 @@ hook::init_resources(
 	for (unsigned i = 0; i < sizeof(g_tex) / sizeof(g_tex[0]); ++i)
 		assert(g_tex[i]);
 
-	if (!util::setupTexture2D(g_tex[TEX_ALBEDO], g_albedo_filename, g_albedo_w, g_albedo_h))
+	if (!util::setupTexture2D(g_tex[TEX_ALBEDO], g_albedo_filename, g_albedo_w, g_albedo_h, g_mip))
 	{
 		std::cerr << __FUNCTION__ << " failed at setupTexture2D" << std::endl;
 		return false;
@@ -19,10 +19,13 @@
 #include <assert.h>
 #include <math.h>
 #include <string>
+#include <vector>
 #include <iostream>
 
 #include "rendVect.hpp"
 #include "rendIndexedTrilist.hpp"
+#include "rendMeshlet.hpp"
+#include "rendSimplify.hpp"
 #include "utilTex.hpp"
 #include "testbed.hpp"
 
@@ -79,6 +82,9 @@ static const char arg_invert_cull[]	= "invert_cull";
 static const char arg_cam_extent[]	= "cam_extent";
 static const char arg_cam_ortho[]	= "cam_ortho";
 static const char arg_anim_step[]	= "anim_step";
+static const char arg_cluster_cull[]	= "cluster_cull";
+static const char arg_mesh_lod[]	= "mesh_lod";
+static const char arg_weld_eps[]	= "weld_epsilon";
 
 static char g_albedo_filename[FILENAME_MAX + 1] = "graph_paper.raw";
 static unsigned g_albedo_w = 512;
@@ -107,6 +113,26 @@ static float g_persp_extent = .5f;
 static float g_ortho_extent = 2.f;
 static float g_angle_step = 1.f / 40.f;
 
+static bool g_cluster_cull;
+static unsigned g_meshlet_faces = rend::MESHLET_DEFAULT_FACES;
+static std::vector< rend::Meshlet > g_meshlets;
+static std::vector< unsigned > g_meshlet_range;
+
+static struct {
+	uint64_t frames;
+	uint64_t meshlets;
+	uint64_t faces;
+	uint64_t drawcalls;
+} g_meshlet_stats;
+
+static bool g_mesh_lod;
+static float g_lod_max_error = 1.f;
+static std::vector< rend::MeshLod > g_lods;
+static uint64_t g_lod_frames[rend::MESH_LOD_MAX];
+static GLint g_vport[4];
+
+static float g_weld_epsilon;
+
 #if !defined(PLATFORM_GLX)
 
 static EGLDisplay g_display = EGL_NO_DISPLAY;
@@ -192,7 +218,9 @@ hook::get_num_drawcalls()
 
 
 bool
-hook::requires_depth()
+hook::requires_depth(
+	const unsigned,
+	const char* const *)
 {
 	return true;
 }
@@ -221,6 +249,8 @@ parse_cli(
 			int opt_arg_start;
 			unsigned rx, ry, rz;
 			unsigned rotated = 0;
+			unsigned meshlet_faces = 0;
+			float lod_max_error = 0.f;
 			float cam_extent;
 
 			if (1 == sscanf(argv[i], "%" XQUOTE(OPTION_IDENTIFIER_MAX) "s %n", option, &opt_arg_start))
@@ -286,6 +316,47 @@ parse_cli(
 					{
 						continue;
 					}
+
+				if (!strcmp(option, arg_cluster_cull))
+				{
+					if (1 == sscanf(argv[i] + opt_arg_start, "%u", &meshlet_faces))
+					{
+						if (rend::MESHLET_MIN_FACES > meshlet_faces ||
+							rend::MESHLET_MAX_FACES < meshlet_faces)
+						{
+							cli_err = true;
+							continue;
+						}
+
+						g_meshlet_faces = meshlet_faces;
+					}
+
+					g_cluster_cull = true;
+					continue;
+				}
+
+				if (!strcmp(option, arg_weld_eps))
+					if (1 == sscanf(argv[i] + opt_arg_start, "%f", &g_weld_epsilon) && 0.f <= g_weld_epsilon)
+					{
+						continue;
+					}
+
+				if (!strcmp(option, arg_mesh_lod))
+				{
+					if (1 == sscanf(argv[i] + opt_arg_start, "%f", &lod_max_error))
+					{
+						if (0.f >= lod_max_error)
+						{
+							cli_err = true;
+							continue;
+						}
+
+						g_lod_max_error = lod_max_error;
+					}
+
+					g_mesh_lod = true;
+					continue;
+				}
 			}
 		}
 
@@ -310,7 +381,15 @@ parse_cli(
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_cam_ortho <<
 			"\t\t\t\t\t: use orthographic camera; default is perspective\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_anim_step <<
-			" <step>\t\t\t\t: use specified rotation step\n" << std::endl;
+			" <step>\t\t\t\t: use specified rotation step\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_cluster_cull <<
+			" [<max_faces>]\t\t: split custom mesh into meshlets and cull those on the CPU; default max_faces is " <<
+			unsigned(rend::MESHLET_DEFAULT_FACES) << "\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_mesh_lod <<
+			" [<max_error_px>]\t\t: build LOD chain for custom mesh and select LOD by projected size; default max_error_px is " <<
+			g_lod_max_error << "\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_weld_eps <<
+			" <epsilon>\t\t: weld custom-mesh vertices differing by no more than specified epsilon in any attribute; default is bit-identical only\n" << std::endl;
 	}
 
 	return !cli_err;
@@ -366,13 +445,13 @@ createIndexedPolarSphere(
 		{
 			assert(ai < sizeof(arr) / sizeof(arr[0]));
 
-			const rend::matx3& azim =
+			const rend::matx3 azim =
 				rend::matx3().rotate((j * 2) * M_PI / (cols - 1), 0.f, 1.f, 0.f);
 
-			const rend::matx3& decl =
+			const rend::matx3 decl =
 				rend::matx3().rotate(- M_PI_2 + M_PI * i / (rows - 1), 1.f, 0.f, 0.f);
 
-			const rend::matx3& azim_decl = rend::matx3().mul(azim, decl);
+			const rend::matx3 azim_decl = rend::matx3().mul(azim, decl);
 
 			arr[ai].pos[0] = azim_decl[0][2] * r;
 			arr[ai].pos[1] = azim_decl[1][2] * r;
@@ -526,6 +605,28 @@ hook::deinit_resources()
 	if (!check_context(__FUNCTION__))
 		return false;
 
+	if (g_meshlet_stats.frames)
+	{
+		const double frames = double(g_meshlet_stats.frames);
+
+		std::cout << "meshlets visible per frame: " << (g_meshlet_stats.meshlets / frames) <<
+			" of " << g_meshlets.size() <<
+			"\nfaces drawn per frame: " << (g_meshlet_stats.faces / frames) <<
+			" of " << g_num_faces[MESH_MAIN] <<
+			"\nmeshlet drawcalls per frame: " << (g_meshlet_stats.drawcalls / frames) << std::endl;
+	}
+
+	g_meshlets.clear();
+	g_meshlet_range.clear();
+	memset(&g_meshlet_stats, 0, sizeof(g_meshlet_stats));
+
+	for (unsigned i = 0; i < g_lods.size(); ++i)
+		std::cout << "LOD" << i << " (" << g_lods[i].num_faces << " faces) drawn in " <<
+			g_lod_frames[i] << " frames" << std::endl;
+
+	g_lods.clear();
+	memset(g_lod_frames, 0, sizeof(g_lod_frames));
+
 	for (unsigned i = 0; i < sizeof(g_shader_prog) / sizeof(g_shader_prog[0]); ++i)
 	{
 		glDeleteProgram(g_shader_prog[i]);
@@ -611,6 +712,8 @@ hook::init_resources(
 
 	/////////////////////////////////////////////////////////////////
 
+	glGetIntegerv(GL_VIEWPORT, g_vport);
+
 	glEnable(GL_CULL_FACE);
 	glEnable(GL_DEPTH_TEST);
 
@@ -720,7 +823,11 @@ hook::init_resources(
 				g_vbo[VBO_MAIN_IDX],
 				g_num_faces[MESH_MAIN],
 				g_index_type,
-				g_mesh_rotated))
+				g_mesh_rotated,
+				g_cluster_cull ? &g_meshlets : 0,
+				g_meshlet_faces,
+				g_mesh_lod ? &g_lods : 0,
+				g_weld_epsilon))
 		{
 			g_custom_mesh = CUSTOM_MESH_NONE;
 		}
@@ -732,7 +839,11 @@ hook::init_resources(
 				g_vbo[VBO_MAIN_IDX],
 				g_num_faces[MESH_MAIN],
 				g_index_type,
-				g_mesh_rotated))
+				g_mesh_rotated,
+				g_cluster_cull ? &g_meshlets : 0,
+				g_meshlet_faces,
+				g_mesh_lod ? &g_lods : 0,
+				g_weld_epsilon))
 		{
 			g_custom_mesh = CUSTOM_MESH_NONE;
 		}
@@ -741,6 +852,9 @@ hook::init_resources(
 
 	if (CUSTOM_MESH_NONE == g_custom_mesh)
 	{
+		g_meshlets.clear();
+		g_lods.clear();
+
 		createIndexedPolarSphere(
 			g_vbo[VBO_MAIN_VTX],
 			g_vbo[VBO_MAIN_IDX],
@@ -749,6 +863,8 @@ hook::init_resources(
 		g_index_type = GL_UNSIGNED_SHORT;
 	}
 
+	g_meshlet_range.resize(g_meshlets.size() * 2);
+
 #if defined(PLATFORM_GLX)
 
 	glBindVertexArray(g_vao[PROG_MAIN]);
@@ -778,14 +894,14 @@ hook::render_frame()
 
 	static GLfloat angle = 0.f;
 
-	const rend::matx3& r0 = rend::matx3().rotate((g_axis.x ? angle : 0.f), 1.f, 0.f, 0.f);
-	const rend::matx3& r1 = rend::matx3().rotate((g_axis.y ? angle : 0.f), 0.f, 1.f, 0.f);
-	const rend::matx3& r2 = rend::matx3().rotate((g_axis.z ? angle : 0.f), 0.f, 0.f, 1.f);
+	const rend::matx3 r0 = rend::matx3().rotate((g_axis.x ? angle : 0.f), 1.f, 0.f, 0.f);
+	const rend::matx3 r1 = rend::matx3().rotate((g_axis.y ? angle : 0.f), 0.f, 1.f, 0.f);
+	const rend::matx3 r2 = rend::matx3().rotate((g_axis.z ? angle : 0.f), 0.f, 0.f, 1.f);
 
 	angle = fmodf(angle + g_angle_step, 2.f * M_PI);
 
-	const rend::matx3& p0 = rend::matx3().mul(r1, r0);
-	const rend::matx3& p1 = rend::matx3().mul(r2, p0);
+	const rend::matx3 p0 = rend::matx3().mul(r1, r0);
+	const rend::matx3 p1 = rend::matx3().mul(r2, p0);
 
 	const rend::vect3 lp_obj = rend::vect3(
 		p1[0][0] + p1[1][0] + p1[2][0],
@@ -861,7 +977,66 @@ hook::render_frame()
 
 	DEBUG_GL_ERR()
 
-	glDrawElements(GL_TRIANGLES, g_num_faces[MESH_MAIN] * 3, g_index_type, 0);
+	const rend::matx4 mvp = rend::matx4().mul(g_proj_cam, mv_fg);
+	unsigned lod = 0;
+
+	if (!g_lods.empty())
+	{
+		// loader normalizes custom meshes into [-1, 1]^3, so their bounding-sphere radius is at most sqrt(3)
+		const float radius = 1.7320508f;
+		const float radius_px = radius * g_proj_cam[1][1] * g_vport[3] * .5f / mvp[3][3];
+
+		lod = rend::select_lod(&g_lods.front(), g_lods.size(), radius_px, g_lod_max_error);
+		g_lod_frames[lod] += 1;
+	}
+
+	if (0 != lod)
+	{
+		const size_t sizeof_face = (GL_UNSIGNED_SHORT == g_index_type ? sizeof(uint16_t) : sizeof(uint32_t)) * 3;
+
+		glDrawElements(GL_TRIANGLES, g_lods[lod].num_faces * 3, g_index_type,
+			reinterpret_cast< const GLvoid* >(g_lods[lod].first_face * sizeof_face));
+	}
+	else
+	if (!g_meshlets.empty())
+	{
+		// viewer in object space: eye position for perspective, direction toward the eye for ortho
+		const float viewer[4] =
+		{
+			p1[2][0] * (g_perspective_cam ? 2.f : 1.f),
+			p1[2][1] * (g_perspective_cam ? 2.f : 1.f),
+			p1[2][2] * (g_perspective_cam ? 2.f : 1.f),
+			g_perspective_cam ? 1.f : 0.f
+		};
+
+		unsigned (* const range)[2] = reinterpret_cast< unsigned (*)[2] >(&g_meshlet_range.front());
+		unsigned num_visible = 0;
+
+		const unsigned num_range = rend::cull_meshlets(
+			&g_meshlets.front(),
+			g_meshlets.size(),
+			mvp,
+			viewer,
+			g_face_front,
+			range,
+			&num_visible);
+
+		const size_t sizeof_face = (GL_UNSIGNED_SHORT == g_index_type ? sizeof(uint16_t) : sizeof(uint32_t)) * 3;
+
+		for (unsigned i = 0; i < num_range; ++i)
+		{
+			glDrawElements(GL_TRIANGLES, range[i][1] * 3, g_index_type,
+				reinterpret_cast< const GLvoid* >(range[i][0] * sizeof_face));
+
+			g_meshlet_stats.faces += range[i][1];
+		}
+
+		g_meshlet_stats.frames += 1;
+		g_meshlet_stats.meshlets += num_visible;
+		g_meshlet_stats.drawcalls += num_range;
+	}
+	else
+		glDrawElements(GL_TRIANGLES, g_num_faces[MESH_MAIN] * 3, g_index_type, 0);
 
 	DEBUG_GL_ERR()
 
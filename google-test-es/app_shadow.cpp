@@ -38,7 +38,9 @@
 #include "rendVect.hpp"
 #include "rendIndexedTrilist.hpp"
 #include "utilTex.hpp"
+#include "utilLoader.hpp"
 #include "testbed.hpp"
+#include "gpu_timer.hpp"
 
 #include "rendVertAttr.hpp"
 
@@ -107,6 +109,7 @@ namespace testbed
 #define OPTION_IDENTIFIER_MAX	64
 
 static const char arg_albedo[]		= "albedo_map";
+static const char arg_albedo_format[]	= "albedo_format";
 static const char arg_shadow_res[]	= "shadow_res";
 static const char arg_mesh_pn[]		= "mesh_pn";
 static const char arg_mesh_pn2[]	= "mesh_pn2";
@@ -121,6 +124,25 @@ static char g_albedo_filename[FILENAME_MAX + 1] = "graph_paper.raw";
 static unsigned g_albedo_w = 512;
 static unsigned g_albedo_h = 512;
 
+static util::tex_format_t g_albedo_format = util::TEX_FORMAT_RGB888;
+
+static const struct
+{
+	const char* name;
+	util::tex_format_t format;
+}
+format_option[] =
+{
+	{ "rgb888",				util::TEX_FORMAT_RGB888 },
+	{ "rgba8888",			util::TEX_FORMAT_RGBA8888 },
+	{ "rgb565",				util::TEX_FORMAT_RGB565 },
+	{ "rgb565_dither",		util::TEX_FORMAT_RGB565_DITHER },
+	{ "rgba4444",			util::TEX_FORMAT_RGBA4444 },
+	{ "rgba4444_dither",	util::TEX_FORMAT_RGBA4444_DITHER },
+	{ "etc1",				util::TEX_FORMAT_ETC1 },
+	{ "etc2",				util::TEX_FORMAT_ETC2 }
+};
+
 static char g_mesh_filename[FILENAME_MAX + 1];
 static enum {
 	CUSTOM_MESH_NONE,
@@ -245,7 +267,9 @@ hook::get_num_drawcalls()
 
 
 bool
-hook::requires_depth()
+hook::requires_depth(
+	const unsigned,
+	const char* const *)
 {
 	return true;
 }
@@ -284,6 +308,23 @@ parse_cli(
 						continue;
 					}
 
+				if (!strcmp(option, arg_albedo_format))
+				{
+					char name[OPTION_IDENTIFIER_MAX + 1];
+					unsigned j = 0;
+
+					if (1 == sscanf(argv[i] + opt_arg_start, "%" XQUOTE(OPTION_IDENTIFIER_MAX) "s", name))
+						for (; j < sizeof(format_option) / sizeof(format_option[0]); ++j)
+							if (!strcmp(name, format_option[j].name))
+							{
+								g_albedo_format = format_option[j].format;
+								break;
+							}
+
+					if (j < sizeof(format_option) / sizeof(format_option[0]))
+						continue;
+				}
+
 				if (!strcmp(option, arg_shadow_res))
 					if (1 == sscanf(argv[i] + opt_arg_start, "%u", &g_fbo_res) &&
 						0 == (g_fbo_res & g_fbo_res - 1))
@@ -362,6 +403,9 @@ parse_cli(
 		std::cerr << "app options (multiple args to an option must constitute a single string, eg. -foo \"a b c\"):\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_albedo <<
 			" <filename> <width> <height>\t: use specified raw file and dimensions as source of albedo map\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_albedo_format <<
+			" <rgb888|rgba8888|rgb565[_dither]|rgba4444[_dither]|etc1|etc2>\t: store the albedo map as specified,"
+			" converting or compressing it at load time, or fetching it from the compressed-texture cache\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_mesh_pn <<
 			" <filename> [<flag_rotated>]\t: use specified .mesh file as source of object (position and normal)\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_mesh_pn2 <<
@@ -435,13 +479,13 @@ createIndexedPolarSphere(
 		{
 			assert(ai < sizeof(arr) / sizeof(arr[0]));
 
-			const rend::matx3& azim =
+			const rend::matx3 azim =
 				rend::matx3().rotate((j * 2) * M_PI / (cols - 1), 0.f, 1.f, 0.f);
 
-			const rend::matx3& decl =
+			const rend::matx3 decl =
 				rend::matx3().rotate(- M_PI_2 + M_PI * i / (rows - 1), 1.f, 0.f, 0.f);
 
-			const rend::matx3& azim_decl = rend::matx3().mul(azim, decl);
+			const rend::matx3 azim_decl = rend::matx3().mul(azim, decl);
 
 			arr[ai].pos[0] = azim_decl[0][2] * r;
 			arr[ai].pos[1] = azim_decl[1][2] * r;
@@ -761,6 +805,30 @@ hook::deinit_resources()
 }
 
 
+struct mesh_job_t
+{
+	util::indexed_trilist_t trilist;
+};
+
+
+static bool
+load_mesh(
+	void* arg)
+{
+	mesh_job_t& job = *reinterpret_cast< mesh_job_t* >(arg);
+
+	switch (g_custom_mesh)
+	{
+	case CUSTOM_MESH_POSITION_NORMAL:
+		return util::load_indexed_trilist_from_file_PN(g_mesh_filename, g_mesh_rotated, job.trilist);
+	case CUSTOM_MESH_POSITION_NORMAL_TEXCOORD:
+		return util::load_indexed_trilist_from_file_PN2(g_mesh_filename, g_mesh_rotated, job.trilist);
+	}
+
+	return false;
+}
+
+
 bool
 hook::init_resources(
 	const unsigned argc,
@@ -812,6 +880,39 @@ hook::init_resources(
 		patch_res[1].str()
 	};
 
+	/////////////////////////////////////////////////////////////////
+	// kick off reading and decoding of all resources on the loader's workers; the GL thread
+	// waits on each one right before its upload; the loader is declared after the jobs so that
+	// its workers get joined before the jobs go out of scope
+	/////////////////////////////////////////////////////////////////
+
+	util::texture_bitmap_t albedo_bitmap;
+	util::texture_bitmap_job_t albedo_job(albedo_bitmap, g_albedo_filename, g_albedo_w, g_albedo_h);
+
+	util::shader_source_t main_fg_vert("phong_shadow.glslv");
+	util::shader_source_t main_bg_vert("mvp_texture_proj.glslv");
+	util::shader_source_t main_bg_frag("texture_proj.glslf");
+	util::shader_source_t shadow_vert("mvp.glslv");
+	util::shader_source_t shadow_frag("depth.glslf");
+	util::shader_source_t inspector_vert("texture.glslv");
+	util::shader_source_t inspector_frag("texture.glslf");
+
+	mesh_job_t mesh_job;
+
+	util::loader_t loader;
+
+	const unsigned ticket_mesh = CUSTOM_MESH_NONE != g_custom_mesh
+		? loader.submit(load_mesh, &mesh_job)
+		: 0;
+	const unsigned ticket_albedo			= loader.submit(util::loadTextureBitmapJob, &albedo_job);
+	const unsigned ticket_main_fg_vert		= loader.submit(util::loadShaderSourceJob, &main_fg_vert);
+	const unsigned ticket_main_bg_vert		= loader.submit(util::loadShaderSourceJob, &main_bg_vert);
+	const unsigned ticket_main_bg_frag		= loader.submit(util::loadShaderSourceJob, &main_bg_frag);
+	const unsigned ticket_shadow_vert		= loader.submit(util::loadShaderSourceJob, &shadow_vert);
+	const unsigned ticket_shadow_frag		= loader.submit(util::loadShaderSourceJob, &shadow_frag);
+	const unsigned ticket_inspector_vert	= loader.submit(util::loadShaderSourceJob, &inspector_vert);
+	const unsigned ticket_inspector_frag	= loader.submit(util::loadShaderSourceJob, &inspector_frag);
+
 	/////////////////////////////////////////////////////////////////
 
 	glEnable(GL_CULL_FACE);
@@ -841,7 +942,8 @@ hook::init_resources(
 	for (unsigned i = 0; i < sizeof(g_tex) / sizeof(g_tex[0]); ++i)
 		assert(g_tex[i]);
 
-	if (!util::setupTexture2D(g_tex[TEX_ALBEDO], g_albedo_filename, g_albedo_w, g_albedo_h))
+	if (!loader.wait(ticket_albedo) ||
+		!util::setupTexture2D(g_tex[TEX_ALBEDO], albedo_bitmap, util::TEX_MIP_GL, g_albedo_format))
 	{
 		std::cerr << __FUNCTION__ << " failed at setupTexture2D" << std::endl;
 		return false;
@@ -860,9 +962,10 @@ hook::init_resources(
 	g_shader_vert[PROG_MAIN_FG] = glCreateShader(GL_VERTEX_SHADER);
 	assert(g_shader_vert[PROG_MAIN_FG]);
 
-	if (!util::setupShader(g_shader_vert[PROG_MAIN_FG], "phong_shadow.glslv"))
+	if (!loader.wait(ticket_main_fg_vert) ||
+		!util::setupShaderFromString(g_shader_vert[PROG_MAIN_FG], main_fg_vert.source, main_fg_vert.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
@@ -917,18 +1020,20 @@ hook::init_resources(
 	g_shader_vert[PROG_MAIN_BG] = glCreateShader(GL_VERTEX_SHADER);
 	assert(g_shader_vert[PROG_MAIN_BG]);
 
-	if (!util::setupShader(g_shader_vert[PROG_MAIN_BG], "mvp_texture_proj.glslv"))
+	if (!loader.wait(ticket_main_bg_vert) ||
+		!util::setupShaderFromString(g_shader_vert[PROG_MAIN_BG], main_bg_vert.source, main_bg_vert.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
 	g_shader_frag[PROG_MAIN_BG] = glCreateShader(GL_FRAGMENT_SHADER);
 	assert(g_shader_frag[PROG_MAIN_BG]);
 
-	if (!util::setupShader(g_shader_frag[PROG_MAIN_BG], "texture_proj.glslf"))
+	if (!loader.wait(ticket_main_bg_frag) ||
+		!util::setupShaderFromString(g_shader_frag[PROG_MAIN_BG], main_bg_frag.source, main_bg_frag.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
@@ -962,18 +1067,20 @@ hook::init_resources(
 	g_shader_vert[PROG_SHADOW] = glCreateShader(GL_VERTEX_SHADER);
 	assert(g_shader_vert[PROG_SHADOW]);
 
-	if (!util::setupShader(g_shader_vert[PROG_SHADOW], "mvp.glslv"))
+	if (!loader.wait(ticket_shadow_vert) ||
+		!util::setupShaderFromString(g_shader_vert[PROG_SHADOW], shadow_vert.source, shadow_vert.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
 	g_shader_frag[PROG_SHADOW] = glCreateShader(GL_FRAGMENT_SHADER);
 	assert(g_shader_frag[PROG_SHADOW]);
 
-	if (!util::setupShader(g_shader_frag[PROG_SHADOW], "depth.glslf"))
+	if (!loader.wait(ticket_shadow_frag) ||
+		!util::setupShaderFromString(g_shader_frag[PROG_SHADOW], shadow_frag.source, shadow_frag.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
@@ -1006,18 +1113,20 @@ hook::init_resources(
 	g_shader_vert[PROG_INSPECTOR] = glCreateShader(GL_VERTEX_SHADER);
 	assert(g_shader_vert[PROG_INSPECTOR]);
 
-	if (!util::setupShader(g_shader_vert[PROG_INSPECTOR], "texture.glslv"))
+	if (!loader.wait(ticket_inspector_vert) ||
+		!util::setupShaderFromString(g_shader_vert[PROG_INSPECTOR], inspector_vert.source, inspector_vert.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
 	g_shader_frag[PROG_INSPECTOR] = glCreateShader(GL_FRAGMENT_SHADER);
 	assert(g_shader_frag[PROG_INSPECTOR]);
 
-	if (!util::setupShader(g_shader_frag[PROG_INSPECTOR], "texture.glslf"))
+	if (!loader.wait(ticket_inspector_frag) ||
+		!util::setupShaderFromString(g_shader_frag[PROG_INSPECTOR], inspector_frag.source, inspector_frag.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
@@ -1057,32 +1166,19 @@ hook::init_resources(
 	for (unsigned i = 0; i < sizeof(g_vbo) / sizeof(g_vbo[0]); ++i)
 		assert(g_vbo[i]);
 
-	switch (g_custom_mesh)
+	if (CUSTOM_MESH_NONE != g_custom_mesh)
 	{
-	case CUSTOM_MESH_POSITION_NORMAL:
-		if (!util::fill_indexed_trilist_from_file_PN(
-				g_mesh_filename,
+		if (loader.wait(ticket_mesh) &&
+			util::upload_indexed_trilist(
+				mesh_job.trilist,
 				g_vbo[VBO_MAIN_VTX],
-				g_vbo[VBO_MAIN_IDX],
-				g_num_faces[MESH_MAIN],
-				g_index_type,
-				g_mesh_rotated))
+				g_vbo[VBO_MAIN_IDX]))
 		{
-			g_custom_mesh = CUSTOM_MESH_NONE;
+			g_num_faces[MESH_MAIN] = mesh_job.trilist.num_faces;
+			g_index_type = mesh_job.trilist.index_type;
 		}
-		break;
-	case CUSTOM_MESH_POSITION_NORMAL_TEXCOORD:
-		if (!util::fill_indexed_trilist_from_file_PN2(
-				g_mesh_filename,
-				g_vbo[VBO_MAIN_VTX],
-				g_vbo[VBO_MAIN_IDX],
-				g_num_faces[MESH_MAIN],
-				g_index_type,
-				g_mesh_rotated))
-		{
+		else
 			g_custom_mesh = CUSTOM_MESH_NONE;
-		}
-		break;
 	}
 
 	if (CUSTOM_MESH_NONE == g_custom_mesh)
@@ -1286,14 +1382,14 @@ hook::render_frame()
 
 	static GLfloat angle = 0.f;
 
-	const rend::matx3& r0 = rend::matx3().rotate((g_axis.x ? angle : 0.f), 1.f, 0.f, 0.f);
-	const rend::matx3& r1 = rend::matx3().rotate((g_axis.y ? angle : 0.f), 0.f, 1.f, 0.f);
-	const rend::matx3& r2 = rend::matx3().rotate((g_axis.z ? angle : 0.f), 0.f, 0.f, 1.f);
+	const rend::matx3 r0 = rend::matx3().rotate((g_axis.x ? angle : 0.f), 1.f, 0.f, 0.f);
+	const rend::matx3 r1 = rend::matx3().rotate((g_axis.y ? angle : 0.f), 0.f, 1.f, 0.f);
+	const rend::matx3 r2 = rend::matx3().rotate((g_axis.z ? angle : 0.f), 0.f, 0.f, 1.f);
 
 	angle = fmodf(angle + g_angle_step, 2.f * M_PI);
 
-	const rend::matx3& p0 = rend::matx3().mul(r1, r0);
-	const rend::matx3& p1 = rend::matx3().mul(r2, p0);
+	const rend::matx3 p0 = rend::matx3().mul(r1, r0);
+	const rend::matx3 p1 = rend::matx3().mul(r2, p0);
 
 	const rend::vect3 lp_obj = rend::vect3(
 		p1[0][0] + p1[1][0] + p1[2][0],
@@ -1332,6 +1428,8 @@ hook::render_frame()
 
 	/////////////////////////////////////////////////////////////////
 
+	gpu_timer::begin_pass("shadow");
+
 	glBindFramebuffer(GL_FRAMEBUFFER, g_fbo);
 	glViewport(0, 0, g_fbo_res, g_fbo_res);
 
@@ -1401,6 +1499,8 @@ hook::render_frame()
 
 	DEBUG_GL_ERR()
 
+	gpu_timer::end_pass();
+
 	/////////////////////////////////////////////////////////////////
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -1466,6 +1566,8 @@ hook::render_frame()
 
 #endif // INSPECT_SHADOW
 
+	gpu_timer::begin_pass("main");
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	glUseProgram(g_shader_prog[PROG_MAIN_FG]);
@@ -1622,6 +1724,8 @@ hook::render_frame()
 
 	DEBUG_GL_ERR()
 
+	gpu_timer::end_pass();
+
 	return true;
 }
 
@@ -25,6 +25,7 @@
 #include "rendIndexedTrilist.hpp"
 #include "rendSkeleton.hpp"
 #include "utilTex.hpp"
+#include "utilLoader.hpp"
 #include "testbed.hpp"
 
 #include "rendVertAttr.hpp"
@@ -199,7 +200,9 @@ hook::get_num_drawcalls()
 
 
 bool
-hook::requires_depth()
+hook::requires_depth(
+	const unsigned,
+	const char* const *)
 {
 	return true;
 }
@@ -388,6 +391,43 @@ hook::deinit_resources()
 }
 
 
+struct mesh_job_t
+{
+	const char* filename;
+	const uintptr_t (&semantics_offset)[4];
+	util::indexed_trilist_t trilist;
+
+	mesh_job_t(
+		const char* const filename,
+		const uintptr_t (&semantics_offset)[4])
+	: filename(filename)
+	, semantics_offset(semantics_offset)
+	{}
+};
+
+
+static bool
+load_mesh(
+	void* arg)
+{
+	mesh_job_t& job = *reinterpret_cast< mesh_job_t* >(arg);
+
+	return util::load_indexed_trilist_from_file_AGE(job.filename, job.semantics_offset, job.trilist);
+}
+
+
+static const char skeleton_filename[] = "mesh/Ahmed_GEO.skeleton";
+
+static bool
+load_skeleton(
+	void*)
+{
+	g_bone_count = BONE_CAPACITY;
+
+	return rend::loadSkeletonAnimationAge(skeleton_filename, &g_bone_count, g_bone_mat, g_bone, g_animations);
+}
+
+
 bool
 hook::init_resources(
 	const unsigned argc,
@@ -418,6 +458,48 @@ hook::init_resources(
 
 	scoped_ptr< deinit_resources_t, scoped_functor > on_error(deinit_resources);
 
+	/////////////////////////////////////////////////////////////////
+	// kick off reading and decoding of all resources on the loader's workers; the GL thread
+	// waits on each one right before its upload; the loader is declared after the jobs so that
+	// its workers get joined before the jobs go out of scope
+	/////////////////////////////////////////////////////////////////
+
+	const GLfloat (sk::Vertex::* const soff_pos)[3] = &sk::Vertex::pos;
+	const GLfloat (sk::Vertex::* const soff_bon)[4] = &sk::Vertex::bon;
+	const GLfloat (sk::Vertex::* const soff_nrm)[3] = &sk::Vertex::nrm;
+	const GLfloat (sk::Vertex::* const soff_txc)[2] = &sk::Vertex::txc;
+
+	const uintptr_t semantics_offset[4] =
+	{
+		uintptr_t(*reinterpret_cast< const void* const* >(&soff_pos)),
+		uintptr_t(*reinterpret_cast< const void* const* >(&soff_bon)),
+		uintptr_t(*reinterpret_cast< const void* const* >(&soff_nrm)),
+		uintptr_t(*reinterpret_cast< const void* const* >(&soff_txc))
+	};
+
+	util::texture_bitmap_t normal_bitmap;
+	util::texture_bitmap_t albedo_bitmap;
+	util::texture_bitmap_job_t normal_job(normal_bitmap, g_normal_filename, g_normal_w, g_normal_h);
+	util::texture_bitmap_job_t albedo_job(albedo_bitmap, g_albedo_filename, g_albedo_w, g_albedo_h);
+
+	util::shader_source_t skin_vert("phong_skinning_matsum.glslv");
+	util::shader_source_t skin_frag("phong.glslf");
+	util::shader_source_t skel_vert("mvp.glslv");
+	util::shader_source_t skel_frag("basic.glslf");
+
+	mesh_job_t mesh_job(g_mesh_filename, semantics_offset);
+
+	util::loader_t loader;
+
+	const unsigned ticket_mesh		= loader.submit(load_mesh, &mesh_job);
+	const unsigned ticket_skeleton	= loader.submit(load_skeleton, 0);
+	const unsigned ticket_normal	= loader.submit(util::loadTextureBitmapJob, &normal_job);
+	const unsigned ticket_albedo	= loader.submit(util::loadTextureBitmapJob, &albedo_job);
+	const unsigned ticket_skin_vert	= loader.submit(util::loadShaderSourceJob, &skin_vert);
+	const unsigned ticket_skin_frag	= loader.submit(util::loadShaderSourceJob, &skin_frag);
+	const unsigned ticket_skel_vert	= loader.submit(util::loadShaderSourceJob, &skel_vert);
+	const unsigned ticket_skel_frag	= loader.submit(util::loadShaderSourceJob, &skel_frag);
+
 	/////////////////////////////////////////////////////////////////
 
 	glEnable(GL_CULL_FACE);
@@ -442,13 +524,15 @@ hook::init_resources(
 	for (unsigned i = 0; i < sizeof(g_tex) / sizeof(g_tex[0]); ++i)
 		assert(g_tex[i]);
 
-	if (!util::setupTexture2D(g_tex[TEX_NORMAL], g_normal_filename, g_normal_w, g_normal_h))
+	if (!loader.wait(ticket_normal) ||
+		!util::setupTexture2D(g_tex[TEX_NORMAL], normal_bitmap))
 	{
 		std::cerr << __FUNCTION__ << " failed at setupTexture2D" << std::endl;
 		return false;
 	}
 
-	if (!util::setupTexture2D(g_tex[TEX_ALBEDO], g_albedo_filename, g_albedo_w, g_albedo_h))
+	if (!loader.wait(ticket_albedo) ||
+		!util::setupTexture2D(g_tex[TEX_ALBEDO], albedo_bitmap))
 	{
 		std::cerr << __FUNCTION__ << " failed at setupTexture2D" << std::endl;
 		return false;
@@ -465,18 +549,20 @@ hook::init_resources(
 	g_shader_vert[PROG_SKIN] = glCreateShader(GL_VERTEX_SHADER);
 	assert(g_shader_vert[PROG_SKIN]);
 
-	if (!util::setupShader(g_shader_vert[PROG_SKIN], "phong_skinning_matsum.glslv"))
+	if (!loader.wait(ticket_skin_vert) ||
+		!util::setupShaderFromString(g_shader_vert[PROG_SKIN], skin_vert.source, skin_vert.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
 	g_shader_frag[PROG_SKIN] = glCreateShader(GL_FRAGMENT_SHADER);
 	assert(g_shader_frag[PROG_SKIN]);
 
-	if (!util::setupShader(g_shader_frag[PROG_SKIN], "phong.glslf"))
+	if (!loader.wait(ticket_skin_frag) ||
+		!util::setupShaderFromString(g_shader_frag[PROG_SKIN], skin_frag.source, skin_frag.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
@@ -514,18 +600,20 @@ hook::init_resources(
 	g_shader_vert[PROG_SKEL] = glCreateShader(GL_VERTEX_SHADER);
 	assert(g_shader_vert[PROG_SKEL]);
 
-	if (!util::setupShader(g_shader_vert[PROG_SKEL], "mvp.glslv"))
+	if (!loader.wait(ticket_skel_vert) ||
+		!util::setupShaderFromString(g_shader_vert[PROG_SKEL], skel_vert.source, skel_vert.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
 	g_shader_frag[PROG_SKEL] = glCreateShader(GL_FRAGMENT_SHADER);
 	assert(g_shader_frag[PROG_SKEL]);
 
-	if (!util::setupShader(g_shader_frag[PROG_SKEL], "basic.glslf"))
+	if (!loader.wait(ticket_skel_frag) ||
+		!util::setupShaderFromString(g_shader_frag[PROG_SKEL], skel_frag.source, skel_frag.length))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderFromString" << std::endl;
 		return false;
 	}
 
@@ -548,12 +636,9 @@ hook::init_resources(
 		glGetAttribLocation(g_shader_prog[PROG_SKEL], "at_Vertex"));
 
 	/////////////////////////////////////////////////////////////////
-	const char* const skeleton_name = "mesh/Ahmed_GEO.skeleton";
-	g_bone_count = BONE_CAPACITY;
-
-	if (!rend::loadSkeletonAnimationAge(skeleton_name, &g_bone_count, g_bone_mat, g_bone, g_animations))
+	if (!loader.wait(ticket_skeleton))
 	{
-		std::cerr << __FUNCTION__ << " failed to load skeleton file " << skeleton_name << std::endl;
+		std::cerr << __FUNCTION__ << " failed to load skeleton file " << skeleton_filename << std::endl;
 		return false;
 	}
 
@@ -573,36 +658,22 @@ hook::init_resources(
 	for (unsigned i = 0; i < sizeof(g_vbo) / sizeof(g_vbo[0]); ++i)
 		assert(g_vbo[i]);
 
-	float bbox_min[3];
-	float bbox_max[3];
-
-	const GLfloat (sk::Vertex::* const soff_pos)[3] = &sk::Vertex::pos;
-	const GLfloat (sk::Vertex::* const soff_bon)[4] = &sk::Vertex::bon;
-	const GLfloat (sk::Vertex::* const soff_nrm)[3] = &sk::Vertex::nrm;
-	const GLfloat (sk::Vertex::* const soff_txc)[2] = &sk::Vertex::txc;
-
-	const uintptr_t semantics_offset[4] =
-	{
-		uintptr_t(*reinterpret_cast< const void* const* >(&soff_pos)),
-		uintptr_t(*reinterpret_cast< const void* const* >(&soff_bon)),
-		uintptr_t(*reinterpret_cast< const void* const* >(&soff_nrm)),
-		uintptr_t(*reinterpret_cast< const void* const* >(&soff_txc))
-	};
-
-	if (!util::fill_indexed_trilist_from_file_AGE(
-			g_mesh_filename,
+	if (!loader.wait(ticket_mesh) ||
+		!util::upload_indexed_trilist(
+			mesh_job.trilist,
 			g_vbo[VBO_SKIN_VTX],
-			g_vbo[VBO_SKIN_IDX],
-			semantics_offset,
-			g_num_faces[MESH_SKIN],
-			g_index_type,
-			bbox_min,
-			bbox_max))
-	{
-		std::cerr << __FUNCTION__ << " failed at fill_indexed_trilist_from_file_AGE" << std::endl;
+			g_vbo[VBO_SKIN_IDX]))
+	{
+		std::cerr << __FUNCTION__ << " failed at load_indexed_trilist_from_file_AGE" << std::endl;
 		return false;
 	}
 
+	g_num_faces[MESH_SKIN] = mesh_job.trilist.num_faces;
+	g_index_type = mesh_job.trilist.index_type;
+
+	const float (&bbox_min)[3] = mesh_job.trilist.bmin;
+	const float (&bbox_max)[3] = mesh_job.trilist.bmax;
+
 	const float centre[3] =
 	{
 		(bbox_min[0] + bbox_max[0]) * .5f,
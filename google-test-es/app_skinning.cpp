@@ -13,6 +13,7 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
@@ -22,12 +23,13 @@
 #include <iostream>
 
 #include "rendSkeleton.hpp"
+#include "rendTangent.hpp"
 #include "utilTex.hpp"
 #include "testbed.hpp"
 
 #include "rendVertAttr.hpp"
 
-namespace
+namespace sk
 {
 
 #define SETUP_VERTEX_ATTR_POINTERS_MASK	(			\
@@ -47,7 +49,31 @@ struct Vertex
 	GLfloat txc[2];
 };
 
-} // namespace
+} // namespace sk
+
+namespace tg
+{
+
+#define SETUP_VERTEX_ATTR_POINTERS_MASK	(			\
+		SETUP_VERTEX_ATTR_POINTERS_MASK_vertex |	\
+		SETUP_VERTEX_ATTR_POINTERS_MASK_normal |	\
+		SETUP_VERTEX_ATTR_POINTERS_MASK_blendw |	\
+		SETUP_VERTEX_ATTR_POINTERS_MASK_tcoord |	\
+		SETUP_VERTEX_ATTR_POINTERS_MASK_tangent)
+
+#include "rendVertAttr_setupVertAttrPointers.hpp"
+#undef SETUP_VERTEX_ATTR_POINTERS_MASK
+
+struct Vertex
+{
+	GLfloat pos[3];
+	GLfloat nrm[3];
+	GLfloat	bon[4];
+	GLfloat txc[2];
+	GLfloat tan[4];
+};
+
+} // namespace tg
 
 namespace testbed
 {
@@ -58,6 +84,7 @@ static const char arg_normal[] = "normal_map";
 static const char arg_albedo[] = "albedo_map";
 static const char arg_alt_anim[] = "alt_anim";
 static const char arg_anim_step[] = "anim_step";
+static const char arg_vertex_tangent[] = "vertex_tangent";
 
 static char g_normal_filename[FILENAME_MAX + 1] = "rockwall_NH.raw";
 static unsigned g_normal_w = 64;
@@ -74,6 +101,7 @@ static rend::matx4 g_bone_mat[bone_count];
 static std::vector< rend::Track > g_skeletal_animation;
 static bool g_alt_anim;
 static float g_anim_step = .125f * .125f * .125f;
+static bool g_vertex_tangent;
 
 #if !defined(PLATFORM_GLX)
 
@@ -160,7 +188,9 @@ hook::get_num_drawcalls()
 
 
 bool
-hook::requires_depth()
+hook::requires_depth(
+	const unsigned,
+	const char* const *)
 {
 	return true;
 }
@@ -215,6 +245,12 @@ parse_cli(
 					{
 						continue;
 					}
+
+				if (!strcmp(option, arg_vertex_tangent))
+				{
+					g_vertex_tangent = true;
+					continue;
+				}
 			}
 		}
 
@@ -231,7 +267,9 @@ parse_cli(
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_alt_anim <<
 			"\t\t\t\t\t: use alternative skeleton animation\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_anim_step <<
-			" <step>\t\t\t\t: use specified animation step; entire animation is 1.0\n" << std::endl;
+			" <step>\t\t\t\t: use specified animation step; entire animation is 1.0\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_vertex_tangent <<
+			"\t\t\t\t\t: use per-vertex tangent frames, generated at load time, rather than screen-space derivatives\n" << std::endl;
 	}
 
 	return !cli_err;
@@ -559,18 +597,30 @@ hook::init_resources(
 	g_shader_vert[PROG_SKIN] = glCreateShader(GL_VERTEX_SHADER);
 	assert(g_shader_vert[PROG_SKIN]);
 
-	if (!util::setupShader(g_shader_vert[PROG_SKIN], "phong_skinning_bump_tang_workaround.glslv"))
+	const std::string patch[] =
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		"#define VERTEX_TANGENT 0",
+		g_vertex_tangent
+			? "#define VERTEX_TANGENT 1"
+			: "#define VERTEX_TANGENT 0"
+	};
+
+	if (!util::setupShaderWithPatch(g_shader_vert[PROG_SKIN], "phong_skinning_bump_tang_workaround.glslv",
+			sizeof(patch) / sizeof(patch[0]) / 2,
+			patch))
+	{
+		std::cerr << __FUNCTION__ << " failed at setupShaderWithPatch" << std::endl;
 		return false;
 	}
 
 	g_shader_frag[PROG_SKIN] = glCreateShader(GL_FRAGMENT_SHADER);
 	assert(g_shader_frag[PROG_SKIN]);
 
-	if (!util::setupShader(g_shader_frag[PROG_SKIN], "phong_bump_tang.glslf"))
+	if (!util::setupShaderWithPatch(g_shader_frag[PROG_SKIN], "phong_bump_tang.glslf",
+			sizeof(patch) / sizeof(patch[0]) / 2,
+			patch))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderWithPatch" << std::endl;
 		return false;
 	}
 
@@ -602,6 +652,8 @@ hook::init_resources(
 		glGetAttribLocation(g_shader_prog[PROG_SKIN], "at_Weight"));
 	g_active_attr_semantics[PROG_SKIN].registerTCoordAttr(
 		glGetAttribLocation(g_shader_prog[PROG_SKIN], "at_MultiTexCoord0"));
+	g_active_attr_semantics[PROG_SKIN].registerTangentAttr(
+		glGetAttribLocation(g_shader_prog[PROG_SKIN], "at_Tangent"));
 
 	/////////////////////////////////////////////////////////////////
 
@@ -685,7 +737,7 @@ hook::init_resources(
 
 	/////////////////////////////////////////////////////////////////
 
-	static const Vertex arr[] =
+	static sk::Vertex arr[] =
 	{
 		{ { 0.f, 0.f, 0.f },			{ 0.f, 0.f, 1.f },	{ 1.f, 0.f, 0.f, 0.f },	{ .5f, .5f } },
 
@@ -753,6 +805,34 @@ hook::init_resources(
 	std::cout << "number of vertices: " << num_verts <<
 		"\nnumber of indices: " << num_indes << std::endl;
 
+	static tg::Vertex arr_tan[sizeof(arr) / sizeof(arr[0])];
+
+	if (g_vertex_tangent)
+	{
+		for (unsigned i = 0; i < num_verts; ++i)
+		{
+			memcpy(arr_tan[i].pos, arr[i].pos, sizeof(arr[i].pos));
+			memcpy(arr_tan[i].nrm, arr[i].nrm, sizeof(arr[i].nrm));
+			memcpy(arr_tan[i].bon, arr[i].bon, sizeof(arr[i].bon));
+			memcpy(arr_tan[i].txc, arr[i].txc, sizeof(arr[i].txc));
+		}
+
+		if (!rend::build_tangents(
+				reinterpret_cast< const GLfloat* >(arr),
+				sizeof(sk::Vertex) / sizeof(GLfloat),
+				offsetof(sk::Vertex, nrm) / sizeof(GLfloat),
+				offsetof(sk::Vertex, txc) / sizeof(GLfloat),
+				num_verts,
+				idx[0],
+				g_num_faces[MESH_SKIN],
+				reinterpret_cast< GLfloat* >(arr_tan) + offsetof(tg::Vertex, tan) / sizeof(GLfloat),
+				sizeof(tg::Vertex) / sizeof(GLfloat)))
+		{
+			std::cerr << __FUNCTION__ << " failed at build_tangents" << std::endl;
+			return false;
+		}
+	}
+
 #if defined(PLATFORM_GLX)
 
 	glGenVertexArrays(sizeof(g_vao) / sizeof(g_vao[0]), g_vao);
@@ -774,7 +854,11 @@ hook::init_resources(
 #endif
 
 	glBindBuffer(GL_ARRAY_BUFFER, g_vbo[VBO_SKIN_VTX]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(arr), arr, GL_STATIC_DRAW);
+
+	if (g_vertex_tangent)
+		glBufferData(GL_ARRAY_BUFFER, sizeof(arr_tan), arr_tan, GL_STATIC_DRAW);
+	else
+		glBufferData(GL_ARRAY_BUFFER, sizeof(arr), arr, GL_STATIC_DRAW);
 
 	if (util::reportGLError())
 	{
@@ -793,7 +877,9 @@ hook::init_resources(
 		return false;
 	}
 
-	if (!setupVertexAttrPointers< Vertex >(g_active_attr_semantics[PROG_SKIN])
+	if (!(g_vertex_tangent
+			? tg::setupVertexAttrPointers< tg::Vertex >(g_active_attr_semantics[PROG_SKIN])
+			: sk::setupVertexAttrPointers< sk::Vertex >(g_active_attr_semantics[PROG_SKIN]))
 #if !defined(DEBUG)
 		|| util::reportGLError()
 #endif
@@ -12,6 +12,7 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
@@ -21,12 +22,14 @@
 #include <iostream>
 
 #include "rendVect.hpp"
+#include "rendTangent.hpp"
+#include "rendIndexedTrilist.hpp"
 #include "utilTex.hpp"
 #include "testbed.hpp"
 
 #include "rendVertAttr.hpp"
 
-namespace
+namespace sp
 {
 
 #define SETUP_VERTEX_ATTR_POINTERS_MASK	(			\
@@ -44,7 +47,29 @@ struct Vertex
 	GLfloat txc[2];
 };
 
-} // namespace
+} // namespace sp
+
+namespace tg
+{
+
+#define SETUP_VERTEX_ATTR_POINTERS_MASK	(			\
+		SETUP_VERTEX_ATTR_POINTERS_MASK_vertex |	\
+		SETUP_VERTEX_ATTR_POINTERS_MASK_normal |	\
+		SETUP_VERTEX_ATTR_POINTERS_MASK_tcoord |	\
+		SETUP_VERTEX_ATTR_POINTERS_MASK_tangent)
+
+#include "rendVertAttr_setupVertAttrPointers.hpp"
+#undef SETUP_VERTEX_ATTR_POINTERS_MASK
+
+struct Vertex
+{
+	GLfloat pos[3];
+	GLfloat nrm[3];
+	GLfloat txc[2];
+	GLfloat tan[4];
+};
+
+} // namespace tg
 
 namespace testbed
 {
@@ -55,6 +80,8 @@ static const char arg_normal[] = "normal_map";
 static const char arg_albedo[] = "albedo_map";
 static const char arg_tile[] = "tile";
 static const char arg_anim_step[] = "anim_step";
+static const char arg_vertex_tangent[] = "vertex_tangent";
+static const char arg_mesh[] = "mesh";
 
 static char g_normal_filename[FILENAME_MAX + 1] = "rockwall_NH.raw";
 static unsigned g_normal_w = 64;
@@ -67,6 +94,9 @@ static unsigned g_albedo_h = 256;
 static float g_tile = 2.f;
 static float g_angle_step = 3.f / 40.f;
 
+static bool g_vertex_tangent;
+static char g_mesh_filename[FILENAME_MAX + 1];
+
 #if !defined(PLATFORM_GLX)
 
 static EGLDisplay g_display = EGL_NO_DISPLAY;
@@ -131,6 +161,7 @@ static GLuint g_shader_frag[PROG_COUNT];
 static GLuint g_shader_prog[PROG_COUNT];
 
 static unsigned g_num_faces[MESH_COUNT];
+static GLenum g_index_type[MESH_COUNT];
 
 static rend::ActiveAttrSemantics g_active_attr_semantics[PROG_COUNT];
 
@@ -151,8 +182,27 @@ hook::get_num_drawcalls()
 
 
 bool
-hook::requires_depth()
+hook::requires_depth(
+	const unsigned argc,
+	const char* const * argv)
 {
+	// only arbitrary meshes use depth, and the context is made before the app options get parsed
+	const unsigned prefix_len = strlen(arg_prefix);
+
+	for (unsigned i = 1; i + 1 < argc; ++i)
+	{
+		if (strncmp(argv[i], arg_prefix, prefix_len) ||
+			strcmp(argv[i] + prefix_len, arg_app))
+		{
+			continue;
+		}
+
+		char option[OPTION_IDENTIFIER_MAX + 1];
+
+		if (1 == sscanf(argv[++i], "%" XQUOTE(OPTION_IDENTIFIER_MAX) "s", option) && !strcmp(option, arg_mesh))
+			return true;
+	}
+
 	return false;
 }
 
@@ -206,6 +256,18 @@ parse_cli(
 					{
 						continue;
 					}
+
+				if (!strcmp(option, arg_vertex_tangent))
+				{
+					g_vertex_tangent = true;
+					continue;
+				}
+
+				if (!strcmp(option, arg_mesh))
+					if (1 == sscanf(argv[i] + opt_arg_start, "%" XQUOTE(FILENAME_MAX) "s", g_mesh_filename))
+					{
+						continue;
+					}
 			}
 		}
 
@@ -222,7 +284,11 @@ parse_cli(
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_tile <<
 			" <n>\t\t\t\t\t: tile texture maps the specified number of times along U, half as much along V\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_anim_step <<
-			" <step>\t\t\t\t: use specified rotation step\n" << std::endl;
+			" <step>\t\t\t\t: use specified rotation step\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_vertex_tangent <<
+			"\t\t\t\t\t: use per-vertex tangent frames, generated at load time, rather than screen-space derivatives\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_mesh <<
+			" <filename>\t\t\t\t: draw the specified PN2 mesh rather than a sphere\n" << std::endl;
 	}
 
 	return !cli_err;
@@ -244,7 +310,7 @@ createIndexedPolarSphere(
 	assert(rows > 2);
 	assert(cols > 3);
 
-	static Vertex arr[(rows - 2) * cols + 2 * (cols - 1)];
+	static sp::Vertex arr[(rows - 2) * cols + 2 * (cols - 1)];
 	unsigned ai = 0;
 
 	num_faces = ((rows - 3) * 2 + 2) * (cols - 1);
@@ -275,13 +341,13 @@ createIndexedPolarSphere(
 		{
 			assert(ai < sizeof(arr) / sizeof(arr[0]));
 
-			const rend::matx3& azim =
+			const rend::matx3 azim =
 				rend::matx3().rotate((j * 2) * M_PI / (cols - 1), 0.f, 1.f, 0.f);
 
-			const rend::matx3& decl =
+			const rend::matx3 decl =
 				rend::matx3().rotate(- M_PI_2 + M_PI * i / (rows - 1), 1.f, 0.f, 0.f);
 
-			const rend::matx3& azim_decl = rend::matx3().mul(azim, decl);
+			const rend::matx3 azim_decl = rend::matx3().mul(azim, decl);
 
 			arr[ai].pos[0] = azim_decl[0][2] * r;
 			arr[ai].pos[1] = azim_decl[1][2] * r;
@@ -366,7 +432,40 @@ createIndexedPolarSphere(
 		"\nnumber of indices: " << num_indes << std::endl;
 
 	glBindBuffer(GL_ARRAY_BUFFER, vbo_arr);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(arr), arr, GL_STATIC_DRAW);
+
+	if (g_vertex_tangent)
+	{
+		static tg::Vertex arr_tan[sizeof(arr) / sizeof(arr[0])];
+
+		for (unsigned i = 0; i < num_verts; ++i)
+		{
+			memcpy(arr_tan[i].pos, arr[i].pos, sizeof(arr[i].pos));
+			memcpy(arr_tan[i].nrm, arr[i].nrm, sizeof(arr[i].nrm));
+			memcpy(arr_tan[i].txc, arr[i].txc, sizeof(arr[i].txc));
+		}
+
+		if (!rend::build_tangents(
+				reinterpret_cast< const GLfloat* >(arr),
+				sizeof(sp::Vertex) / sizeof(GLfloat),
+				offsetof(sp::Vertex, nrm) / sizeof(GLfloat),
+				offsetof(sp::Vertex, txc) / sizeof(GLfloat),
+				num_verts,
+				idx[0],
+				num_faces,
+				reinterpret_cast< GLfloat* >(arr_tan) + offsetof(tg::Vertex, tan) / sizeof(GLfloat),
+				sizeof(tg::Vertex) / sizeof(GLfloat)))
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			std::cerr << __FUNCTION__ << " failed at build_tangents" << std::endl;
+			return false;
+		}
+
+		glBufferData(GL_ARRAY_BUFFER, sizeof(arr_tan), arr_tan, GL_STATIC_DRAW);
+	}
+	else
+		glBufferData(GL_ARRAY_BUFFER, sizeof(arr), arr, GL_STATIC_DRAW);
+
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	if (util::reportGLError())
@@ -542,18 +641,30 @@ hook::init_resources(
 	g_shader_vert[PROG_SPHERE] = glCreateShader(GL_VERTEX_SHADER);
 	assert(g_shader_vert[PROG_SPHERE]);
 
-	if (!util::setupShader(g_shader_vert[PROG_SPHERE], "phong_bump_tang.glslv"))
+	const std::string patch[] =
+	{
+		"#define VERTEX_TANGENT 0",
+		g_vertex_tangent
+			? "#define VERTEX_TANGENT 1"
+			: "#define VERTEX_TANGENT 0"
+	};
+
+	if (!util::setupShaderWithPatch(g_shader_vert[PROG_SPHERE], "phong_bump_tang.glslv",
+			sizeof(patch) / sizeof(patch[0]) / 2,
+			patch))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderWithPatch" << std::endl;
 		return false;
 	}
 
 	g_shader_frag[PROG_SPHERE] = glCreateShader(GL_FRAGMENT_SHADER);
 	assert(g_shader_frag[PROG_SPHERE]);
 
-	if (!util::setupShader(g_shader_frag[PROG_SPHERE], "phong_bump_tang.glslf"))
+	if (!util::setupShaderWithPatch(g_shader_frag[PROG_SPHERE], "phong_bump_tang.glslf",
+			sizeof(patch) / sizeof(patch[0]) / 2,
+			patch))
 	{
-		std::cerr << __FUNCTION__ << " failed at setupShader" << std::endl;
+		std::cerr << __FUNCTION__ << " failed at setupShaderWithPatch" << std::endl;
 		return false;
 	}
 
@@ -582,6 +693,8 @@ hook::init_resources(
 		glGetAttribLocation(g_shader_prog[PROG_SPHERE], "at_Normal"));
 	g_active_attr_semantics[PROG_SPHERE].registerTCoordAttr(
 		glGetAttribLocation(g_shader_prog[PROG_SPHERE], "at_MultiTexCoord0"));
+	g_active_attr_semantics[PROG_SPHERE].registerTangentAttr(
+		glGetAttribLocation(g_shader_prog[PROG_SPHERE], "at_Tangent"));
 
 	/////////////////////////////////////////////////////////////////
 
@@ -599,13 +712,40 @@ hook::init_resources(
 	for (unsigned i = 0; i < sizeof(g_vbo) / sizeof(g_vbo[0]); ++i)
 		assert(g_vbo[i]);
 
-	if (!createIndexedPolarSphere(
-			g_vbo[VBO_SPHERE_VTX],
-			g_vbo[VBO_SPHERE_IDX],
-			g_num_faces[MESH_SPHERE]))
+	if ('\0' != g_mesh_filename[0])
 	{
-		std::cerr << __FUNCTION__ << " failed at createIndexedPolarSphere" << std::endl;
-		return false;
+		// mesh vertices get tangents appended if asked, matching the layout of tg::Vertex
+		if (!util::fill_indexed_trilist_from_file_PN2(
+				g_mesh_filename,
+				g_vbo[VBO_SPHERE_VTX],
+				g_vbo[VBO_SPHERE_IDX],
+				g_num_faces[MESH_SPHERE],
+				g_index_type[MESH_SPHERE],
+				false,
+				0,
+				rend::MESHLET_DEFAULT_FACES,
+				0,
+				0.f,
+				g_vertex_tangent))
+		{
+			std::cerr << __FUNCTION__ << " failed at fill_indexed_trilist_from_file_PN2" << std::endl;
+			return false;
+		}
+
+		glEnable(GL_DEPTH_TEST);
+	}
+	else
+	{
+		if (!createIndexedPolarSphere(
+				g_vbo[VBO_SPHERE_VTX],
+				g_vbo[VBO_SPHERE_IDX],
+				g_num_faces[MESH_SPHERE]))
+		{
+			std::cerr << __FUNCTION__ << " failed at createIndexedPolarSphere" << std::endl;
+			return false;
+		}
+
+		g_index_type[MESH_SPHERE] = GL_UNSIGNED_SHORT;
 	}
 
 #if defined(PLATFORM_GLX)
@@ -617,7 +757,9 @@ hook::init_resources(
 	glBindBuffer(GL_ARRAY_BUFFER, g_vbo[VBO_SPHERE_VTX]);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_vbo[VBO_SPHERE_IDX]);
 
-	if (!setupVertexAttrPointers< Vertex >(g_active_attr_semantics[PROG_SPHERE])
+	if (!(g_vertex_tangent
+			? tg::setupVertexAttrPointers< tg::Vertex >(g_active_attr_semantics[PROG_SPHERE])
+			: sp::setupVertexAttrPointers< sp::Vertex >(g_active_attr_semantics[PROG_SPHERE]))
 #if !defined(DEBUG)
 		|| util::reportGLError()
 #endif
@@ -639,18 +781,18 @@ hook::render_frame()
 	if (!check_context(__FUNCTION__))
 		return false;
 
-	glClear(GL_COLOR_BUFFER_BIT);
+	glClear('\0' != g_mesh_filename[0] ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT);
 
 	/////////////////////////////////////////////////////////////////
 
 	static GLfloat angle = 0.f;
 
-	const rend::matx3& r0 = rend::matx3().rotate(angle, 1.f, 0.f, 0.f);
-	const rend::matx3& r1 = rend::matx3().rotate(angle, 0.f, 1.f, 0.f);
-	const rend::matx3& r2 = rend::matx3().rotate(angle, 0.f, 0.f, 1.f);
+	const rend::matx3 r0 = rend::matx3().rotate(angle, 1.f, 0.f, 0.f);
+	const rend::matx3 r1 = rend::matx3().rotate(angle, 0.f, 1.f, 0.f);
+	const rend::matx3 r2 = rend::matx3().rotate(angle, 0.f, 0.f, 1.f);
 
-	const rend::matx3& p0 = rend::matx3().mul(r1, r0);
-	const rend::matx3& p1 = rend::matx3().mul(r2, p0);
+	const rend::matx3 p0 = rend::matx3().mul(r1, r0);
+	const rend::matx3 p1 = rend::matx3().mul(r2, p0);
 
 	// transpose and expand to 4x4, sign-inverting z
 	// in all original columns (for GL screen space)
@@ -733,7 +875,7 @@ hook::render_frame()
 
 	DEBUG_GL_ERR()
 
-	glDrawElements(GL_TRIANGLES, g_num_faces[MESH_SPHERE] * 3, GL_UNSIGNED_SHORT, 0);
+	glDrawElements(GL_TRIANGLES, g_num_faces[MESH_SPHERE] * 3, g_index_type[MESH_SPHERE], 0);
 
 	DEBUG_GL_ERR()
 
@@ -11,14 +11,17 @@
 #endif
 
 #include <unistd.h>
+#include <time.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <string>
+#include <vector>
 #include <iostream>
 
+#include "utilPix.hpp"
 #include "utilTex.hpp"
 #include "testbed.hpp"
 
@@ -48,11 +51,25 @@ namespace testbed
 #define OPTION_IDENTIFIER_MAX	64
 
 static const char arg_albedo[] = "albedo_map";
+static const char arg_csc_cpu[] = "csc_cpu";
+static const char arg_csc_threads[] = "csc_threads";
+static const char arg_stream[] = "stream";
 
 static char g_albedo_filename[FILENAME_MAX + 1] = "rockwall.raw";
 static unsigned g_albedo_w = 256;
 static unsigned g_albedo_h = 256;
 
+static bool g_csc_cpu;
+static unsigned g_csc_threads;
+static bool g_stream;
+
+// client-side YUV420 planes and their RGB conversion, for CPU-side CSC and streaming
+static std::vector< uint8_t > g_yuv;
+static std::vector< uint8_t > g_rgb;
+
+static uint64_t g_csc_nsec;
+static unsigned g_csc_count;
+
 #if !defined(PLATFORM_GLX)
 
 static EGLDisplay g_display = EGL_NO_DISPLAY;
@@ -66,11 +83,15 @@ enum {
 	TEX_ALBEDO_V,
 
 	TEX_COUNT,
-	TEX_FORCE_UINT = -1U
+	TEX_FORCE_UINT = -1U,
+
+	// CPU-side CSC needs just the one texture
+	TEX_ALBEDO_RGB = TEX_ALBEDO_Y
 };
 
 enum {
 	PROG_TEX_YUV,
+	PROG_TEX_RGB,
 
 	PROG_COUNT,
 	PROG_FORCE_UINT = -1U
@@ -80,6 +101,7 @@ enum {
 	UNI_SAMPLER_ALBEDO_Y,
 	UNI_SAMPLER_ALBEDO_U,
 	UNI_SAMPLER_ALBEDO_V,
+	UNI_SAMPLER_ALBEDO_RGB,
 
 	UNI_COUNT,
 	UNI_FORCE_UINT = -1U
@@ -138,7 +160,9 @@ hook::get_num_drawcalls()
 
 
 bool
-hook::requires_depth()
+hook::requires_depth(
+	const unsigned,
+	const char* const *)
 {
 	return false;
 }
@@ -174,6 +198,24 @@ parse_cli(
 					{
 						continue;
 					}
+
+				if (!strcmp(option, arg_csc_cpu))
+				{
+					g_csc_cpu = true;
+					continue;
+				}
+
+				if (!strcmp(option, arg_csc_threads))
+					if (1 == sscanf(argv[i] + opt_arg_start, "%u", &g_csc_threads))
+					{
+						continue;
+					}
+
+				if (!strcmp(option, arg_stream))
+				{
+					g_stream = true;
+					continue;
+				}
 			}
 		}
 
@@ -184,7 +226,13 @@ parse_cli(
 	{
 		std::cerr << "app options (multiple args to an option must constitute a single string, eg. -foo \"a b c\"):\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_albedo <<
-			" <filename> <width> <height>\t: use specified raw file and dimensions as source of albedo map\n" << std::endl;
+			" <filename> <width> <height>\t: use specified raw file and dimensions as source of albedo map\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_csc_cpu <<
+			"\t\t\t\t: convert YUV420 to RGB on the CPU and upload that, rather than convert in the fragment shader\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_csc_threads <<
+			" <n>\t\t\t\t: use up to the specified number of threads for CPU-side CSC; zero means one per online CPU\n"
+			"\t" << testbed::arg_prefix << testbed::arg_app << " " << arg_stream <<
+			"\t\t\t\t\t: re-upload the texture every frame, as video decoding would; with CPU-side CSC, convert every frame\n" << std::endl;
 	}
 
 	return !cli_err;
@@ -280,6 +328,169 @@ createIndexedGridQuad(
 }
 
 
+static uint64_t
+timer_nsec()
+{
+#if defined(CLOCK_MONOTONIC_RAW)
+	const clockid_t clockid = CLOCK_MONOTONIC_RAW;
+#else
+	const clockid_t clockid = CLOCK_MONOTONIC;
+#endif
+
+	timespec t;
+	clock_gettime(clockid, &t);
+
+	return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+
+static bool
+setupTextureLuminance(
+	const GLuint tex_name,
+	const uint8_t* const tex_src,
+	const unsigned tex_w,
+	const unsigned tex_h)
+{
+	glBindTexture(GL_TEXTURE_2D, tex_name);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, tex_w, tex_h, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, tex_src);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return !util::reportGLError();
+}
+
+
+// convert the YUV420 planes to RGB; the time spent is accounted for in the CPU-side CSC stats
+static void
+convert_yuv_planes()
+{
+	const unsigned w = g_albedo_w;
+	const unsigned h = g_albedo_h;
+	const uint8_t* const y_src = &g_yuv.front();
+	const uint8_t* const u_src = y_src + w * h;
+	const uint8_t* const v_src = u_src + w / 2 * (h / 2);
+
+	const uint64_t t0 = timer_nsec();
+
+	util::fill_RGB_from_YUV420(
+		&g_rgb.front(), w * 3, 3,
+		y_src, u_src, v_src,
+		w, w / 2, w / 2,
+		w, h,
+		util::YUV_MATRIX_BT601,
+		util::YUV_RANGE_FULL,
+		g_csc_threads);
+
+	g_csc_nsec += timer_nsec() - t0;
+	++g_csc_count;
+}
+
+
+// produce client-side YUV420 planes from the albedo source, as a video decoder would, and set up the
+// textures to receive them unmipmapped: three luminance ones for shader-side CSC, or a single RGB one
+static bool
+setupTexturesFromYUVPlanes()
+{
+	const unsigned w = g_albedo_w;
+	const unsigned h = g_albedo_h;
+
+	if (w & 1 || h & 1)
+	{
+		std::cerr << __FUNCTION__ << " requires even texture dimensions" << std::endl;
+		return false;
+	}
+
+	std::vector< util::pix > src(w * h);
+
+	if (util::fill_from_file(&src.front(), w * sizeof(util::pix), w, h, g_albedo_filename))
+		std::cout << "texture bitmap '" << g_albedo_filename << "' ";
+	else
+	{
+		util::fill_with_checker(&src.front(), w * sizeof(util::pix), w, h);
+
+		std::cout << "checker texture ";
+	}
+
+	std::cout << w << " x " << h << " converted to YUV420 planes" << std::endl;
+
+	g_yuv.resize(w * h * 3 / 2);
+
+	uint8_t* const y_src = &g_yuv.front();
+	uint8_t* const u_src = y_src + w * h;
+	uint8_t* const v_src = u_src + w / 2 * (h / 2);
+
+	util::fill_YUV420_from_RGB(
+		y_src, u_src, v_src,
+		w, w / 2, w / 2,
+		&src.front(), w * sizeof(util::pix),
+		w, h);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (!g_csc_cpu)
+	{
+		return
+			setupTextureLuminance(g_tex[TEX_ALBEDO_Y], y_src, w, h) &&
+			setupTextureLuminance(g_tex[TEX_ALBEDO_U], u_src, w / 2, h / 2) &&
+			setupTextureLuminance(g_tex[TEX_ALBEDO_V], v_src, w / 2, h / 2);
+	}
+
+	g_rgb.resize(w * h * 3);
+
+	convert_yuv_planes();
+
+	glBindTexture(GL_TEXTURE_2D, g_tex[TEX_ALBEDO_RGB]);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, &g_rgb.front());
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return !util::reportGLError();
+}
+
+
+// re-upload the frame's texture data; with CPU-side CSC that includes converting it anew
+static void
+streamFrame()
+{
+	const unsigned w = g_albedo_w;
+	const unsigned h = g_albedo_h;
+
+	if (g_csc_cpu)
+	{
+		convert_yuv_planes();
+
+		glBindTexture(GL_TEXTURE_2D, g_tex[TEX_ALBEDO_RGB]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, &g_rgb.front());
+		return;
+	}
+
+	const uint8_t* const y_src = &g_yuv.front();
+	const uint8_t* const u_src = y_src + w * h;
+	const uint8_t* const v_src = u_src + w / 2 * (h / 2);
+
+	glBindTexture(GL_TEXTURE_2D, g_tex[TEX_ALBEDO_Y]);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_LUMINANCE, GL_UNSIGNED_BYTE, y_src);
+
+	glBindTexture(GL_TEXTURE_2D, g_tex[TEX_ALBEDO_U]);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w / 2, h / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE, u_src);
+
+	glBindTexture(GL_TEXTURE_2D, g_tex[TEX_ALBEDO_V]);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w / 2, h / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE, v_src);
+}
+
+
 static bool
 check_context(
 	const char* prefix)
@@ -345,6 +556,17 @@ hook::deinit_resources()
 	glDeleteBuffers(sizeof(g_vbo) / sizeof(g_vbo[0]), g_vbo);
 	memset(g_vbo, 0, sizeof(g_vbo));
 
+	if (g_csc_count)
+	{
+		std::cout << "CPU-side CSC: " << g_csc_count << " conversions, average " <<
+			double(g_csc_nsec) / g_csc_count * 1e-6 << " ms" << std::endl;
+	}
+
+	std::vector< uint8_t >().swap(g_yuv);
+	std::vector< uint8_t >().swap(g_rgb);
+	g_csc_nsec = 0;
+	g_csc_count = 0;
+
 #if !defined(PLATFORM_GLX)
 
 	g_display = EGL_NO_DISPLAY;
@@ -397,7 +619,15 @@ hook::init_resources(
 	for (unsigned i = 0; i < sizeof(g_tex) / sizeof(g_tex[0]); ++i)
 		assert(g_tex[i]);
 
-	if (!util::setupTextureYUV420(g_tex, g_albedo_filename, g_albedo_w, g_albedo_h))
+	if (g_csc_cpu || g_stream)
+	{
+		if (!setupTexturesFromYUVPlanes())
+		{
+			std::cerr << __FUNCTION__ << " at setupTexturesFromYUVPlanes" << std::endl;
+			return false;
+		}
+	}
+	else if (!util::setupTextureYUV420(g_tex, g_albedo_filename, g_albedo_w, g_albedo_h))
 	{
 		std::cerr << __FUNCTION__ << " at setupTextureYUV420" << std::endl;
 		return false;
@@ -411,42 +641,52 @@ hook::init_resources(
 
 	/////////////////////////////////////////////////////////////////
 
-	g_shader_vert[PROG_TEX_YUV] = glCreateShader(GL_VERTEX_SHADER);
-	assert(g_shader_vert[PROG_TEX_YUV]);
+	// CPU-side CSC samples a plain RGB texture
+	const unsigned prog = g_csc_cpu ? PROG_TEX_RGB : PROG_TEX_YUV;
+
+	g_shader_vert[prog] = glCreateShader(GL_VERTEX_SHADER);
+	assert(g_shader_vert[prog]);
 
-	if (!util::setupShader(g_shader_vert[PROG_TEX_YUV], "texture.glslv"))
+	if (!util::setupShader(g_shader_vert[prog], "texture.glslv"))
 	{
 		std::cerr << __FUNCTION__ << " at setupShader" << std::endl;
 		return false;
 	}
 
-	g_shader_frag[PROG_TEX_YUV] = glCreateShader(GL_FRAGMENT_SHADER);
-	assert(g_shader_frag[PROG_TEX_YUV]);
+	g_shader_frag[prog] = glCreateShader(GL_FRAGMENT_SHADER);
+	assert(g_shader_frag[prog]);
 
-	if (!util::setupShader(g_shader_frag[PROG_TEX_YUV], "texture_yuv420.glslf"))
+	if (!util::setupShader(g_shader_frag[prog], PROG_TEX_RGB == prog ? "texture.glslf" : "texture_yuv420.glslf"))
 	{
 		std::cerr << __FUNCTION__ << " at setupShader" << std::endl;
 		return false;
 	}
 
-	g_shader_prog[PROG_TEX_YUV] = glCreateProgram();
-	assert(g_shader_prog[PROG_TEX_YUV]);
+	g_shader_prog[prog] = glCreateProgram();
+	assert(g_shader_prog[prog]);
 
 	if (!util::setupProgram(
-			g_shader_prog[PROG_TEX_YUV],
-			g_shader_vert[PROG_TEX_YUV],
-			g_shader_frag[PROG_TEX_YUV]))
+			g_shader_prog[prog],
+			g_shader_vert[prog],
+			g_shader_frag[prog]))
 	{
 		std::cerr << __FUNCTION__ << " at setupProgram" << std::endl;
 		return false;
 	}
 
-	g_uni[PROG_TEX_YUV][UNI_SAMPLER_ALBEDO_Y] = glGetUniformLocation(g_shader_prog[PROG_TEX_YUV], "y_map");
-	g_uni[PROG_TEX_YUV][UNI_SAMPLER_ALBEDO_U] = glGetUniformLocation(g_shader_prog[PROG_TEX_YUV], "u_map");
-	g_uni[PROG_TEX_YUV][UNI_SAMPLER_ALBEDO_V] = glGetUniformLocation(g_shader_prog[PROG_TEX_YUV], "v_map");
+	if (PROG_TEX_RGB == prog)
+	{
+		g_uni[prog][UNI_SAMPLER_ALBEDO_RGB] = glGetUniformLocation(g_shader_prog[prog], "albedo_map");
+	}
+	else
+	{
+		g_uni[prog][UNI_SAMPLER_ALBEDO_Y] = glGetUniformLocation(g_shader_prog[prog], "y_map");
+		g_uni[prog][UNI_SAMPLER_ALBEDO_U] = glGetUniformLocation(g_shader_prog[prog], "u_map");
+		g_uni[prog][UNI_SAMPLER_ALBEDO_V] = glGetUniformLocation(g_shader_prog[prog], "v_map");
+	}
 
-	g_active_attr_semantics[PROG_TEX_YUV].registerVertexAttr(glGetAttribLocation(g_shader_prog[PROG_TEX_YUV], "at_Vertex"));
-	g_active_attr_semantics[PROG_TEX_YUV].registerTCoordAttr(glGetAttribLocation(g_shader_prog[PROG_TEX_YUV], "at_MultiTexCoord0"));
+	g_active_attr_semantics[prog].registerVertexAttr(glGetAttribLocation(g_shader_prog[prog], "at_Vertex"));
+	g_active_attr_semantics[prog].registerTCoordAttr(glGetAttribLocation(g_shader_prog[prog], "at_MultiTexCoord0"));
 
 	/////////////////////////////////////////////////////////////////
 
@@ -475,14 +715,14 @@ hook::init_resources(
 
 #if defined(PLATFORM_GLX)
 
-	glBindVertexArray(g_vao[PROG_TEX_YUV]);
+	glBindVertexArray(g_vao[prog]);
 
 #endif
 
 	glBindBuffer(GL_ARRAY_BUFFER, g_vbo[VBO_QUAD_VTX]);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_vbo[VBO_QUAD_IDX]);
 
-	if (!setupVertexAttrPointers< Vertex >(g_active_attr_semantics[PROG_TEX_YUV])
+	if (!setupVertexAttrPointers< Vertex >(g_active_attr_semantics[prog])
 #if !defined(DEBUG)
 		|| util::reportGLError()
 #endif
@@ -504,42 +744,61 @@ hook::render_frame()
 	if (!check_context(__FUNCTION__))
 		return false;
 
-	glUseProgram(g_shader_prog[PROG_TEX_YUV]);
+	if (g_stream)
+	{
+		streamFrame();
+
+		DEBUG_GL_ERR()
+	}
+
+	const unsigned prog = g_csc_cpu ? PROG_TEX_RGB : PROG_TEX_YUV;
+
+	glUseProgram(g_shader_prog[prog]);
+
+	DEBUG_GL_ERR()
+
+	if (g_tex[TEX_ALBEDO_RGB] && -1 != g_uni[prog][UNI_SAMPLER_ALBEDO_RGB])
+	{
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, g_tex[TEX_ALBEDO_RGB]);
+
+		glUniform1i(g_uni[prog][UNI_SAMPLER_ALBEDO_RGB], 0);
+	}
 
 	DEBUG_GL_ERR()
 
-	if (g_tex[TEX_ALBEDO_Y] && -1 != g_uni[PROG_TEX_YUV][UNI_SAMPLER_ALBEDO_Y])
+	if (g_tex[TEX_ALBEDO_Y] && -1 != g_uni[prog][UNI_SAMPLER_ALBEDO_Y])
 	{
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, g_tex[TEX_ALBEDO_Y]);
 
-		glUniform1i(g_uni[PROG_TEX_YUV][UNI_SAMPLER_ALBEDO_Y], 0);
+		glUniform1i(g_uni[prog][UNI_SAMPLER_ALBEDO_Y], 0);
 	}
 
 	DEBUG_GL_ERR()
 
-	if (g_tex[TEX_ALBEDO_U] && -1 != g_uni[PROG_TEX_YUV][UNI_SAMPLER_ALBEDO_U])
+	if (g_tex[TEX_ALBEDO_U] && -1 != g_uni[prog][UNI_SAMPLER_ALBEDO_U])
 	{
 		glActiveTexture(GL_TEXTURE1);
 		glBindTexture(GL_TEXTURE_2D, g_tex[TEX_ALBEDO_U]);
 
-		glUniform1i(g_uni[PROG_TEX_YUV][UNI_SAMPLER_ALBEDO_U], 1);
+		glUniform1i(g_uni[prog][UNI_SAMPLER_ALBEDO_U], 1);
 	}
 
 	DEBUG_GL_ERR()
 
-	if (g_tex[TEX_ALBEDO_V] && -1 != g_uni[PROG_TEX_YUV][UNI_SAMPLER_ALBEDO_V])
+	if (g_tex[TEX_ALBEDO_V] && -1 != g_uni[prog][UNI_SAMPLER_ALBEDO_V])
 	{
 		glActiveTexture(GL_TEXTURE2);
 		glBindTexture(GL_TEXTURE_2D, g_tex[TEX_ALBEDO_V]);
 
-		glUniform1i(g_uni[PROG_TEX_YUV][UNI_SAMPLER_ALBEDO_V], 2);
+		glUniform1i(g_uni[prog][UNI_SAMPLER_ALBEDO_V], 2);
 	}
 
 	DEBUG_GL_ERR()
 
-	for (unsigned i = 0; i < g_active_attr_semantics[PROG_TEX_YUV].num_active_attr; ++i)
-		glEnableVertexAttribArray(g_active_attr_semantics[PROG_TEX_YUV].active_attr[i]);
+	for (unsigned i = 0; i < g_active_attr_semantics[prog].num_active_attr; ++i)
+		glEnableVertexAttribArray(g_active_attr_semantics[prog].active_attr[i]);
 
 	DEBUG_GL_ERR()
 
@@ -548,8 +807,8 @@ hook::render_frame()
 
 	DEBUG_GL_ERR()
 
-	for (unsigned i = 0; i < g_active_attr_semantics[PROG_TEX_YUV].num_active_attr; ++i)
-		glDisableVertexAttribArray(g_active_attr_semantics[PROG_TEX_YUV].active_attr[i]);
+	for (unsigned i = 0; i < g_active_attr_semantics[prog].num_active_attr; ++i)
+		glDisableVertexAttribArray(g_active_attr_semantics[prog].active_attr[i]);
 
 	DEBUG_GL_ERR()
 
@@ -0,0 +1,842 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <png.h>
+
+#include "scoped.hpp"
+#include "get_file_size.hpp"
+#include "utilPix.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// asset_cook converts all PNG files of a directory into raw files of the layout of raw_from_png, or,
+// with mipmaps requested, into KTX files of all levels, as taken by setupTexture2D; files are read once,
+// and decoded and processed on a pool of threads, each output written to a temporary file and renamed
+// into place; outputs up to date with their source, by timestamp or by a hash of the source and the
+// recipe, are skipped
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace testbed
+{
+
+template < typename T >
+class generic_free
+{
+public:
+
+	void operator()(T* arg)
+	{
+		free(arg);
+	}
+};
+
+} // namespace testbed
+
+using namespace testbed;
+
+enum op_type_t
+{
+	OP_FLIP_GREEN,
+	OP_SWIZZLE,
+	OP_NORMAL,
+	OP_MIP
+};
+
+struct op_t
+{
+	op_type_t type;
+	unsigned source[3];			// OP_SWIZZLE
+	float strength;				// OP_NORMAL
+	util::normal_filter_t normal_filter;
+	util::normal_wrap_t wrap;
+	util::mip_filter_t filter;	// OP_MIP
+	bool srgb;					// OP_MIP
+};
+
+enum rebuild_t
+{
+	REBUILD_TIME,
+	REBUILD_HASH,
+	REBUILD_ALL
+};
+
+enum asset_status_t
+{
+	ASSET_FAILED,
+	ASSET_SKIPPED,
+	ASSET_COOKED
+};
+
+struct asset_t
+{
+	std::string src;
+	std::string dst;
+	asset_status_t status;
+	unsigned w;
+	unsigned h;
+};
+
+static const struct
+{
+	const char* name;
+	util::mip_filter_t filter;
+	bool srgb;
+}
+mip_option[] =
+{
+	{ "box",			util::MIP_FILTER_BOX,		false },
+	{ "box_srgb",		util::MIP_FILTER_BOX,		true },
+	{ "kaiser",			util::MIP_FILTER_KAISER,	false },
+	{ "kaiser_srgb",	util::MIP_FILTER_KAISER,	true }
+};
+
+static const struct
+{
+	const char* name;
+	util::normal_filter_t filter;
+}
+normal_filter_option[] =
+{
+	{ "sobel",	util::NORMAL_FILTER_SOBEL },
+	{ "scharr",	util::NORMAL_FILTER_SCHARR }
+};
+
+static const struct
+{
+	const char* name;
+	util::normal_wrap_t wrap;
+}
+wrap_option[] =
+{
+	{ "repeat",	util::NORMAL_WRAP_REPEAT },
+	{ "clamp",	util::NORMAL_WRAP_CLAMP }
+};
+
+static std::vector< op_t > g_op;
+static std::string g_recipe;			// canonical form of the op chain, hashed along with sources
+static rebuild_t g_rebuild = REBUILD_TIME;
+static unsigned g_op_threads;
+
+static std::vector< asset_t > g_asset;
+static size_t g_next_asset;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+static uint64_t
+hash_fnv1a(
+	uint64_t hash,
+	const void* const data,
+	const size_t length)
+{
+	const uint8_t* const p = reinterpret_cast< const uint8_t* >(data);
+
+	for (size_t i = 0; i < length; ++i)
+		hash = (hash ^ p[i]) * 0x100000001b3ULL;
+
+	return hash;
+}
+
+
+struct png_source_t
+{
+	const uint8_t* data;
+	size_t length;
+	size_t offset;
+};
+
+
+static void
+png_read_fn(
+	png_structp png_ptr,
+	png_bytep data,
+	png_size_t length)
+{
+	png_source_t& source = *reinterpret_cast< png_source_t* >(png_get_io_ptr(png_ptr));
+
+	if (length > source.length - source.offset)
+		png_error(png_ptr, "read past the end of file");
+
+	memcpy(data, source.data + source.offset, length);
+	source.offset += length;
+}
+
+
+static void
+png_error_fn(
+	png_structp png_ptr,
+	png_const_charp msg)
+{
+	std::cerr << "critical libpng issue: " << msg << std::endl;
+
+	longjmp(png_jmpbuf(png_ptr), 1);
+}
+
+
+static void
+png_warn_fn(
+	png_structp,
+	png_const_charp)
+{
+}
+
+
+// decode a PNG file from memory into RGB888, bottom row first, as per raw_from_png; libpng reports
+// errors by longjmp, which lands back here, with nothing of C++ in-between to unwind
+static bool
+decode_png(
+	const uint8_t* const data,
+	const size_t length,
+	std::vector< uint8_t >& image,
+	unsigned& image_w,
+	unsigned& image_h)
+{
+	if (8 > length || png_sig_cmp(const_cast< png_bytep >(data), 0, 8))
+	{
+		std::cerr << __FUNCTION__ << " failed at recognizing png file" << std::endl;
+		return false;
+	}
+
+	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, 0, png_error_fn, png_warn_fn);
+
+	if (0 == png_ptr)
+	{
+		std::cerr << __FUNCTION__ << " failed at png_create_read_struct" << std::endl;
+		return false;
+	}
+
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+
+	if (0 == info_ptr)
+	{
+		png_destroy_read_struct(&png_ptr, 0, 0);
+		std::cerr << __FUNCTION__ << " failed at png_create_info_struct" << std::endl;
+		return false;
+	}
+
+	png_source_t source = { data, length, 0 };
+
+	if (setjmp(png_jmpbuf(png_ptr)))
+	{
+		png_destroy_read_struct(&png_ptr, &info_ptr, 0);
+		return false;
+	}
+
+	png_set_read_fn(png_ptr, &source, png_read_fn);
+
+	png_read_png(
+		png_ptr,
+		info_ptr,
+		PNG_TRANSFORM_STRIP_16 |
+		PNG_TRANSFORM_STRIP_ALPHA |
+		PNG_TRANSFORM_PACKING |
+		PNG_TRANSFORM_EXPAND |
+		PNG_TRANSFORM_GRAY_TO_RGB,
+		0);
+
+	image_w = png_get_image_width(png_ptr, info_ptr);
+	image_h = png_get_image_height(png_ptr, info_ptr);
+
+	const size_t row_size = size_t(image_w) * sizeof(util::pix);
+	png_bytep* const row_pointers = png_get_rows(png_ptr, info_ptr);
+
+	// a guardband past the last pixel, for the SIMD kernels
+	image.resize(row_size * image_h + 16);
+
+	for (unsigned i = 0; i < image_h; ++i)
+		memcpy(&image[row_size * i], row_pointers[image_h - 1 - i], row_size);
+
+	png_destroy_read_struct(&png_ptr, &info_ptr, 0);
+
+	return true;
+}
+
+
+// write to a temporary file in the destination directory, then rename over the destination, so that
+// readers never see a partial file, and an interrupted cook leaves the previous output intact
+static bool
+write_file_atomic(
+	const std::string& filename,
+	const uint8_t* const data,
+	const size_t length)
+{
+	char suffix[64];
+	snprintf(suffix, sizeof(suffix), ".tmp.%d.%lx", int(getpid()), (unsigned long) pthread_self());
+
+	const std::string tmp_filename = filename + suffix;
+	FILE* const file = fopen(tmp_filename.c_str(), "wb");
+
+	if (0 == file)
+	{
+		std::cerr << __FUNCTION__ << " failed at opening '" << tmp_filename << "'" << std::endl;
+		return false;
+	}
+
+	const bool written = 0 == length || 1 == fwrite(data, length, 1, file);
+
+	if (0 != fclose(file) || !written || 0 != rename(tmp_filename.c_str(), filename.c_str()))
+	{
+		std::cerr << __FUNCTION__ << " failed at writing '" << filename << "'" << std::endl;
+		unlink(tmp_filename.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+is_newer(
+	const struct stat& a,
+	const struct stat& b)
+{
+	if (a.st_mtim.tv_sec != b.st_mtim.tv_sec)
+		return a.st_mtim.tv_sec > b.st_mtim.tv_sec;
+
+	return a.st_mtim.tv_nsec > b.st_mtim.tv_nsec;
+}
+
+
+static std::string
+get_hash_filename(
+	const asset_t& asset)
+{
+	return asset.dst + ".hash";
+}
+
+
+static bool
+is_hash_current(
+	const asset_t& asset,
+	const uint64_t hash)
+{
+	struct stat dst_stat;
+
+	if (0 != stat(asset.dst.c_str(), &dst_stat))
+		return false;
+
+	FILE* const file = fopen(get_hash_filename(asset).c_str(), "r");
+
+	if (0 == file)
+		return false;
+
+	unsigned long long stored = 0;
+	const bool read = 1 == fscanf(file, "%llx", &stored);
+
+	fclose(file);
+
+	return read && stored == hash;
+}
+
+
+// raw file of the layout of raw_from_png: dimensions, then rows
+static void
+append_raw(
+	std::vector< uint8_t >& out,
+	const std::vector< uint8_t >& image,
+	const unsigned w,
+	const unsigned h)
+{
+	const uint32_t image_dim[] = { w, h };
+	const size_t image_size = size_t(w) * h * sizeof(util::pix);
+
+	out.reserve(sizeof(image_dim) + image_size);
+	out.insert(out.end(), reinterpret_cast< const uint8_t* >(image_dim), reinterpret_cast< const uint8_t* >(image_dim + 2));
+	out.insert(out.end(), image.begin(), image.begin() + image_size);
+}
+
+
+static void
+append_u32(
+	std::vector< uint8_t >& out,
+	const uint32_t value)
+{
+	out.insert(out.end(), reinterpret_cast< const uint8_t* >(&value), reinterpret_cast< const uint8_t* >(&value + 1));
+}
+
+
+// KTX file of GL_RGB/GL_UNSIGNED_BYTE levels, rows padded to 4 bytes, in native byte order
+static bool
+append_ktx(
+	std::vector< uint8_t >& out,
+	const std::vector< uint8_t >& image,
+	const unsigned w,
+	const unsigned h,
+	const op_t& mip)
+{
+	static const uint8_t identifier[12] =
+	{
+		0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+	};
+
+	const unsigned level_count = util::get_mip_count(w, h);
+	std::vector< util::pix > level(util::get_mip_size(w, h) + 1);
+
+	if (!util::fill_mipmap(&level.front(), reinterpret_cast< const util::pix* >(&image.front()),
+			w * sizeof(util::pix), w, h, mip.filter, mip.srgb, g_op_threads))
+	{
+		return false;
+	}
+
+	out.insert(out.end(), identifier, identifier + sizeof(identifier));
+	append_u32(out, 0x04030201);	// endianness
+	append_u32(out, 0x1401);		// gl_type: GL_UNSIGNED_BYTE
+	append_u32(out, 1);				// gl_type_size
+	append_u32(out, 0x1907);		// gl_format: GL_RGB
+	append_u32(out, 0x8051);		// gl_internal_format: GL_RGB8
+	append_u32(out, 0x1907);		// gl_base_internal_format: GL_RGB
+	append_u32(out, w);
+	append_u32(out, h);
+	append_u32(out, 0);				// pixel_depth
+	append_u32(out, 0);				// number_of_array_elements
+	append_u32(out, 1);				// number_of_faces
+	append_u32(out, level_count);
+	append_u32(out, 0);				// bytes_of_key_value_data
+
+	const uint8_t* src = &image.front();
+	const uint8_t* const mip_src = reinterpret_cast< const uint8_t* >(&level.front());
+
+	for (unsigned i = 0, lw = w, lh = h; i < level_count; ++i)
+	{
+		const size_t row_size = size_t(lw) * sizeof(util::pix);
+		const size_t row_pitch = (row_size + 3) & ~size_t(3);
+
+		append_u32(out, uint32_t(row_pitch * lh));
+
+		for (unsigned j = 0; j < lh; ++j)
+		{
+			out.insert(out.end(), src + row_size * j, src + row_size * (j + 1));
+			out.insert(out.end(), row_pitch - row_size, uint8_t(0));
+		}
+
+		src = 0 == i ? mip_src : src + row_size * lh;
+
+		lw = lw > 1 ? lw / 2 : 1;
+		lh = lh > 1 ? lh / 2 : 1;
+	}
+
+	return true;
+}
+
+
+static asset_status_t
+cook_asset(
+	asset_t& asset)
+{
+	struct stat src_stat;
+	struct stat dst_stat;
+
+	if (0 != stat(asset.src.c_str(), &src_stat))
+	{
+		std::cerr << __FUNCTION__ << " failed at stat '" << asset.src << "'" << std::endl;
+		return ASSET_FAILED;
+	}
+
+	if (REBUILD_TIME == g_rebuild &&
+		0 == stat(asset.dst.c_str(), &dst_stat) &&
+		is_newer(dst_stat, src_stat))
+	{
+		return ASSET_SKIPPED;
+	}
+
+	size_t length = 0;
+	const scoped_ptr< char, generic_free > data(get_buffer_from_file(asset.src.c_str(), length));
+
+	if (0 == data())
+		return ASSET_FAILED;
+
+	const uint64_t hash = hash_fnv1a(hash_fnv1a(0xcbf29ce484222325ULL,
+		data(), length), g_recipe.data(), g_recipe.size());
+
+	if (REBUILD_HASH == g_rebuild && is_hash_current(asset, hash))
+		return ASSET_SKIPPED;
+
+	std::vector< uint8_t > image;
+
+	if (!decode_png(reinterpret_cast< const uint8_t* >(data()), length, image, asset.w, asset.h))
+	{
+		std::cerr << __FUNCTION__ << " failed at decoding '" << asset.src << "'" << std::endl;
+		return ASSET_FAILED;
+	}
+
+	util::pix* const pix = reinterpret_cast< util::pix* >(&image.front());
+	const unsigned stride = asset.w * sizeof(util::pix);
+	const op_t* mip = 0;
+
+	for (size_t i = 0; i < g_op.size(); ++i)
+	{
+		const op_t& op = g_op[i];
+
+		switch (op.type)
+		{
+		case OP_FLIP_GREEN:
+			{
+				const unsigned source[3] = { 0, 1, 2 };
+				const bool invert[3] = { false, true, false };
+
+				util::remap_RGB_channels(pix, stride, asset.w, asset.h, source, invert, g_op_threads);
+			}
+			break;
+
+		case OP_SWIZZLE:
+			{
+				const bool invert[3] = { false, false, false };
+
+				util::remap_RGB_channels(pix, stride, asset.w, asset.h, op.source, invert, g_op_threads);
+			}
+			break;
+
+		case OP_NORMAL:
+			{
+				// heights come from the red channel, ie. the grey of greyscale files
+				std::vector< uint8_t > height(size_t(asset.w) * asset.h);
+
+				for (size_t j = 0; j < height.size(); ++j)
+					height[j] = pix[j].c[0];
+
+				util::fill_normal_from_height(pix, stride, &height.front(), asset.w, asset.w, asset.h,
+					op.strength, op.normal_filter, op.wrap, g_op_threads);
+			}
+			break;
+
+		case OP_MIP:
+			mip = &op;
+			break;
+		}
+	}
+
+	std::vector< uint8_t > out;
+
+	if (0 != mip)
+	{
+		if (!append_ktx(out, image, asset.w, asset.h, *mip))
+		{
+			std::cerr << __FUNCTION__ << " failed at building mipmap of '" << asset.src << "'" << std::endl;
+			return ASSET_FAILED;
+		}
+	}
+	else
+		append_raw(out, image, asset.w, asset.h);
+
+	if (!write_file_atomic(asset.dst, &out.front(), out.size()))
+		return ASSET_FAILED;
+
+	if (REBUILD_TIME != g_rebuild)
+	{
+		char hash_str[32];
+		const int hash_len = snprintf(hash_str, sizeof(hash_str), "%016llx\n", (unsigned long long) hash);
+
+		if (!write_file_atomic(get_hash_filename(asset), reinterpret_cast< const uint8_t* >(hash_str), hash_len))
+			return ASSET_FAILED;
+	}
+
+	return ASSET_COOKED;
+}
+
+
+static void*
+cook_worker(
+	void*)
+{
+	while (true)
+	{
+		pthread_mutex_lock(&g_mutex);
+		const size_t i = g_next_asset < g_asset.size() ? g_next_asset++ : g_asset.size();
+		pthread_mutex_unlock(&g_mutex);
+
+		if (g_asset.size() == i)
+			break;
+
+		g_asset[i].status = cook_asset(g_asset[i]);
+	}
+
+	return 0;
+}
+
+
+static bool
+has_suffix(
+	const char* const name,
+	const char* const suffix)
+{
+	const size_t len = strlen(name);
+	const size_t len_suffix = strlen(suffix);
+
+	return len > len_suffix && 0 == strcasecmp(name + len - len_suffix, suffix);
+}
+
+
+static bool
+parse_swizzle(
+	const char* const arg,
+	unsigned (&source)[3])
+{
+	static const char channel[] = "rgb";
+
+	if (3 != strlen(arg))
+		return false;
+
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		const char* const c = strchr(channel, arg[i]);
+
+		if (0 == c || 0 == *c)
+			return false;
+
+		source[i] = unsigned(c - channel);
+	}
+
+	return true;
+}
+
+
+static void
+print_usage(
+	const char* const argv0)
+{
+	std::cerr << "usage: " << argv0 << " [option ...] src_dir dst_dir\n"
+		"options, the ops applied in the order given:\n"
+		"\t-flip_green\t\t\t: op: invert the green channel, as of normal maps between GL and D3D conventions\n"
+		"\t-swizzle <rgb permutation>\t: op: reorder channels, eg. bgr\n"
+		"\t-normal <strength> <sobel|scharr> <repeat|clamp>\t: op: replace a height map, taken from the red channel,"
+		" by its tangent-space normal map; strength is the height of full-scale samples, in texels\n"
+		"\t-mip <box|box_srgb|kaiser|kaiser_srgb>\t: op, last: build all mip levels, writing KTX rather than raw files\n"
+		"\t-rebuild <time|hash|all>\t: skip outputs newer than their source, or of the same hash of source and ops,"
+		" or skip none; default is time, which misses changes of ops\n"
+		"\t-threads <n>\t\t\t: number of worker threads; default is one per online CPU" << std::endl;
+}
+
+
+int
+main(
+	int argc,
+	char** argv)
+{
+	unsigned num_threads = 0;
+	int i = 1;
+
+	for (; i < argc && '-' == argv[i][0]; ++i)
+	{
+		op_t op;
+		memset(&op, 0, sizeof(op));
+
+		if (!g_op.empty() && OP_MIP == g_op.back().type &&
+			(!strcmp(argv[i], "-flip_green") || !strcmp(argv[i], "-swizzle") ||
+			 !strcmp(argv[i], "-normal") || !strcmp(argv[i], "-mip")))
+		{
+			std::cerr << "mipmaps must be the last op" << std::endl;
+			return -1;
+		}
+
+		if (!strcmp(argv[i], "-flip_green"))
+		{
+			op.type = OP_FLIP_GREEN;
+			g_op.push_back(op);
+			g_recipe += "flip_green;";
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-swizzle") && i + 1 < argc && parse_swizzle(argv[i + 1], op.source))
+		{
+			op.type = OP_SWIZZLE;
+			g_op.push_back(op);
+			g_recipe += std::string("swizzle ") + argv[++i] + ";";
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-normal") && i + 3 < argc && 1 == sscanf(argv[i + 1], "%f", &op.strength))
+		{
+			unsigned j = 0;
+			unsigned k = 0;
+
+			for (; j < sizeof(normal_filter_option) / sizeof(normal_filter_option[0]); ++j)
+				if (!strcmp(argv[i + 2], normal_filter_option[j].name))
+					break;
+
+			for (; k < sizeof(wrap_option) / sizeof(wrap_option[0]); ++k)
+				if (!strcmp(argv[i + 3], wrap_option[k].name))
+					break;
+
+			if (j < sizeof(normal_filter_option) / sizeof(normal_filter_option[0]) &&
+				k < sizeof(wrap_option) / sizeof(wrap_option[0]))
+			{
+				op.type = OP_NORMAL;
+				op.normal_filter = normal_filter_option[j].filter;
+				op.wrap = wrap_option[k].wrap;
+				g_op.push_back(op);
+				g_recipe += std::string("normal ") + argv[i + 1] + " " + argv[i + 2] + " " + argv[i + 3] + ";";
+				i += 3;
+				continue;
+			}
+		}
+
+		if (!strcmp(argv[i], "-mip") && i + 1 < argc)
+		{
+			unsigned j = 0;
+
+			for (; j < sizeof(mip_option) / sizeof(mip_option[0]); ++j)
+				if (!strcmp(argv[i + 1], mip_option[j].name))
+					break;
+
+			if (j < sizeof(mip_option) / sizeof(mip_option[0]))
+			{
+				op.type = OP_MIP;
+				op.filter = mip_option[j].filter;
+				op.srgb = mip_option[j].srgb;
+				g_op.push_back(op);
+				g_recipe += std::string("mip ") + argv[++i] + ";";
+				continue;
+			}
+		}
+
+		if (!strcmp(argv[i], "-rebuild") && i + 1 < argc)
+		{
+			const char* const mode = argv[++i];
+
+			if (!strcmp(mode, "time"))
+			{
+				g_rebuild = REBUILD_TIME;
+				continue;
+			}
+
+			if (!strcmp(mode, "hash"))
+			{
+				g_rebuild = REBUILD_HASH;
+				continue;
+			}
+
+			if (!strcmp(mode, "all"))
+			{
+				g_rebuild = REBUILD_ALL;
+				continue;
+			}
+		}
+
+		if (!strcmp(argv[i], "-threads") && i + 1 < argc && 1 == sscanf(argv[i + 1], "%u", &num_threads))
+		{
+			++i;
+			continue;
+		}
+
+		print_usage(argv[0]);
+		return -1;
+	}
+
+	if (i + 2 != argc)
+	{
+		print_usage(argv[0]);
+		return -1;
+	}
+
+	const std::string src_dir(argv[i]);
+	const std::string dst_dir(argv[i + 1]);
+	const bool ktx = !g_op.empty() && OP_MIP == g_op.back().type;
+
+	DIR* const dir = opendir(src_dir.c_str());
+
+	if (0 == dir)
+	{
+		std::cerr << "failure at opening source directory '" << src_dir << "'" << std::endl;
+		return -1;
+	}
+
+	std::vector< std::string > name;
+
+	for (const dirent* entry = readdir(dir); 0 != entry; entry = readdir(dir))
+		if (has_suffix(entry->d_name, ".png"))
+			name.push_back(entry->d_name);
+
+	closedir(dir);
+
+	std::sort(name.begin(), name.end());
+
+	if (0 != mkdir(dst_dir.c_str(), 0755) && EEXIST != errno)
+	{
+		std::cerr << "failure at creating destination directory '" << dst_dir << "'" << std::endl;
+		return -1;
+	}
+
+	g_asset.resize(name.size());
+
+	for (size_t j = 0; j < name.size(); ++j)
+	{
+		g_asset[j].src = src_dir + "/" + name[j];
+		g_asset[j].dst = dst_dir + "/" + name[j].substr(0, name[j].size() - 4) + (ktx ? ".ktx" : ".raw");
+		g_asset[j].status = ASSET_FAILED;
+		g_asset[j].w = 0;
+		g_asset[j].h = 0;
+	}
+
+	long num_workers = num_threads;
+
+	if (0 == num_workers)
+		num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (num_workers > long(g_asset.size()))
+		num_workers = long(g_asset.size());
+
+	if (1 > num_workers)
+		num_workers = 1;
+
+	// files are the unit of parallelism; a lone worker lets the ops thread over rows instead
+	g_op_threads = 1 < num_workers ? 1 : num_threads;
+
+	timespec t0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	std::vector< pthread_t > worker;
+	worker.reserve(num_workers - 1);
+
+	for (long j = 1; j < num_workers; ++j)
+	{
+		pthread_t t;
+
+		if (0 != pthread_create(&t, NULL, cook_worker, NULL))
+			break;
+
+		worker.push_back(t);
+	}
+
+	cook_worker(0);
+
+	for (size_t j = 0; j < worker.size(); ++j)
+		pthread_join(worker[j], NULL);
+
+	timespec t1;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	unsigned count[3] = { 0, 0, 0 };
+
+	for (size_t j = 0; j < g_asset.size(); ++j)
+	{
+		static const char* const status[] = { "failed", "skipped", "cooked" };
+		const asset_t& asset = g_asset[j];
+
+		++count[asset.status];
+
+		std::cout << status[asset.status] << "\t" << asset.src;
+
+		if (ASSET_COOKED == asset.status)
+			std::cout << " -> " << asset.dst << ", " << asset.w << 'x' << asset.h;
+
+		std::cout << '\n';
+	}
+
+	const double elapsed = double(t1.tv_sec - t0.tv_sec) + double(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+	std::cout << count[ASSET_COOKED] << " cooked, " << count[ASSET_SKIPPED] << " skipped, " <<
+		count[ASSET_FAILED] << " failed, on " << worker.size() + 1 << " threads, in " << elapsed << " s" << std::endl;
+
+	return 0 == count[ASSET_FAILED] ? 0 : -1;
+}
@@ -3,6 +3,12 @@
 TARGET=test_bcm_image_native
 SOURCE=(
 	main_bcm.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
+	utilPix.cpp
+	utilPixYUV.cpp
 	app_image_native_bcm.cpp
 	get_file_size.cpp
 )
@@ -38,6 +44,7 @@ LFLAGS=(
 	-lstdc++
 	-ldl
 	-lrt
+	-lpthread
 	-L/opt/vc/lib
 	-lGLESv2
 	-lEGL
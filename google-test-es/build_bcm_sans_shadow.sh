@@ -3,9 +3,19 @@
 TARGET=test_bcm_sans_shadow 
 SOURCE=(
 	main_bcm.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
 	app_sans_shadow.cpp
 	rendIndexedTrilist.cpp
+	rendMeshlet.cpp
+	rendSimplify.cpp
+	rendTangent.cpp
 	utilPix.cpp
+	utilPixYUV.cpp
+	utilPixMip.cpp
+	utilPixETC.cpp
 	utilTex.cpp
 	get_file_size.cpp
 )
@@ -41,6 +51,7 @@ LFLAGS=(
 	-lstdc++
 	-ldl
 	-lrt
+	-lpthread
 	-L/opt/vc/lib
 	-lGLESv2
 	-lEGL
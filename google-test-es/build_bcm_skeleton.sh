@@ -3,11 +3,22 @@
 TARGET=test_bcm_skeleton 
 SOURCE=(
 	main_bcm.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
 	app_skeleton.cpp
 	rendSkeleton.cpp
 	rendIndexedTrilist.cpp
+	rendMeshlet.cpp
+	rendSimplify.cpp
+	rendTangent.cpp
 	utilPix.cpp
+	utilPixYUV.cpp
+	utilPixMip.cpp
+	utilPixETC.cpp
 	utilTex.cpp
+	utilLoader.cpp
 	get_file_size.cpp
 )
 CFLAGS=(
@@ -42,6 +53,7 @@ LFLAGS=(
 	-lstdc++
 	-ldl
 	-lrt
+	-lpthread
 	-L/opt/vc/lib
 	-lGLESv2
 	-lEGL
@@ -5,9 +5,16 @@ SOURCE=(
 	main_glx.cpp
 	app_linear.cpp
 	utilPix.cpp
+	utilPixYUV.cpp
+	utilPixMip.cpp
+	utilPixETC.cpp
 	utilTex.cpp
 	get_file_size.cpp
 	amd_perf_monitor.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
 )
 CFLAGS=(
 	-pipe
@@ -26,6 +33,7 @@ LFLAGS=(
 	-lstdc++
 	-ldl
 	-lrt
+	-lpthread
 	-lGL
 	-lX11
 )
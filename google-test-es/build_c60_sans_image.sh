@@ -6,6 +6,12 @@ SOURCE=(
 	app_sans_image.cpp
 	get_file_size.cpp
 	amd_perf_monitor.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
+	utilPix.cpp
+	utilPixYUV.cpp
 )
 CFLAGS=(
 	-pipe
@@ -24,6 +30,7 @@ LFLAGS=(
 	-lstdc++
 	-ldl
 	-lrt
+	-lpthread
 	-lGL
 	-lX11
 )
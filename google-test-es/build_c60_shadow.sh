@@ -5,10 +5,21 @@ SOURCE=(
 	main_glx.cpp
 	app_shadow.cpp
 	rendIndexedTrilist.cpp
+	rendMeshlet.cpp
+	rendSimplify.cpp
+	rendTangent.cpp
 	utilPix.cpp
+	utilPixYUV.cpp
+	utilPixMip.cpp
+	utilPixETC.cpp
 	utilTex.cpp
+	utilLoader.cpp
 	get_file_size.cpp
 	amd_perf_monitor.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
 )
 CFLAGS=(
 	-pipe
@@ -27,6 +38,7 @@ LFLAGS=(
 	-lstdc++
 	-ldl
 	-lrt
+	-lpthread
 	-lGL
 	-lX11
 )
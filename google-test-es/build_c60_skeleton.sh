@@ -6,10 +6,21 @@ SOURCE=(
 	app_skeleton.cpp
 	rendSkeleton.cpp
 	rendIndexedTrilist.cpp
+	rendMeshlet.cpp
+	rendSimplify.cpp
+	rendTangent.cpp
 	utilPix.cpp
+	utilPixYUV.cpp
+	utilPixMip.cpp
+	utilPixETC.cpp
 	utilTex.cpp
+	utilLoader.cpp
 	get_file_size.cpp
 	amd_perf_monitor.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
 )
 CFLAGS=(
 	-pipe
@@ -28,6 +39,7 @@ LFLAGS=(
 	-lstdc++
 	-ldl
 	-lrt
+	-lpthread
 	-lGL
 	-lX11
 )
@@ -0,0 +1,63 @@
+#!/bin/bash
+
+CC=g++
+TARGET=golden_diff
+SOURCE=(
+	golden_diff.cpp
+	utilPix.cpp
+	utilPixDiff.cpp
+	get_file_size.cpp
+)
+CFLAGS=(
+	-pipe
+	-fno-exceptions
+	-fno-rtti
+	-ffast-math
+	-fstrict-aliasing
+)
+LFLAGS=(
+	-lstdc++
+	-lrt
+	-lpthread
+)
+
+if [[ $HOSTTYPE == "arm" ]]; then
+
+	UNAME_SUFFIX=`uname -r | grep -o -E -e -[^-]+$`
+
+	if [[ $UNAME_SUFFIX == "-efikamx" ]]; then
+
+		CFLAGS+=(
+			-marm
+			-march=armv7-a
+			-mtune=cortex-a8
+			-mcpu=cortex-a8
+			-mfpu=neon
+		)
+	fi
+
+elif [[ $HOSTTYPE == "x86_64" ]]; then
+
+	CFLAGS+=(
+# Set -march and -mtune accordingly:
+#		-march=btver1
+#		-mtune=btver1
+	)
+fi
+
+if [[ $1 == "debug" ]]; then
+	CFLAGS+=(
+		-Wall
+		-O0
+		-g
+		-DDEBUG)
+else
+	CFLAGS+=(
+		-funroll-loops
+		-O3
+		-DNDEBUG)
+fi
+
+BUILD_CMD=$CC" -o "$TARGET" "${CFLAGS[@]}" "${SOURCE[@]}" "${LFLAGS[@]}
+echo $BUILD_CMD
+$BUILD_CMD
@@ -0,0 +1,62 @@
+#!/bin/bash
+
+# headless build: renders to an EGL pbuffer, on the Mesa surfaceless platform where available, so it
+# runs sans window system, eg. on build servers of a software EGL only
+
+TARGET=test_headless_fbo
+SOURCE=(
+	main.cpp
+	amd_perf_monitor.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
+	app_fbo.cpp
+	utilPix.cpp
+	utilPixYUV.cpp
+	utilPixMip.cpp
+	utilPixETC.cpp
+	utilTex.cpp
+	get_file_size.cpp
+)
+CFLAGS=(
+	-pipe
+	-fno-exceptions
+	-fno-rtti
+	-ffast-math
+	-fstrict-aliasing
+	-Wtrigraphs
+	-Wreturn-type
+	-Wunused-variable
+	-Wunused-value
+	-DPLATFORM_HEADLESS
+	-DEGL_EGLEXT_PROTOTYPES
+	-DGL_GLEXT_PROTOTYPES
+)
+LFLAGS=(
+	-lstdc++
+	-lrt
+	-lpthread
+	-ldl
+	-lGLESv2
+	-lEGL
+)
+
+if [[ $1 == "debug" ]]; then
+	CFLAGS+=(
+		-Wall
+		-O0
+		-g
+		-DDEBUG
+	)
+else
+	CFLAGS+=(
+		-funroll-loops
+		-O3
+		-DNDEBUG
+	)
+fi
+
+BUILD_CMD="g++ -o "$TARGET" "${CFLAGS[@]}" "${SOURCE[@]}" "${LFLAGS[@]}
+echo $BUILD_CMD
+$BUILD_CMD
@@ -9,9 +9,16 @@ SOURCE=(
 	main.cpp
 	app_fbo.cpp
 	utilPix.cpp
+	utilPixYUV.cpp
+	utilPixMip.cpp
+	utilPixETC.cpp
 	utilTex.cpp
 	get_file_size.cpp
 	amd_perf_monitor.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
 	xrandr_util.cpp
 )
 CFLAGS=(
@@ -32,6 +39,7 @@ LFLAGS=(
 	-lstdc++
 	-ldl
 	-lrt
+	-lpthread
 	-lGLESv2
 	-lEGL
 	-lX11
@@ -9,8 +9,13 @@ SOURCE=(
 	main.cpp
 	app_image_external.cpp
 	utilPix.cpp
+	utilPixYUV.cpp
 	get_file_size.cpp
 	amd_perf_monitor.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
 	xrandr_util.cpp
 )
 CFLAGS=(
@@ -31,6 +36,7 @@ LFLAGS=(
 	-lstdc++
 	-ldl
 	-lrt
+	-lpthread
 	-lGLESv2
 	-lEGL
 	-lX11
@@ -10,6 +10,12 @@ SOURCE=(
 	app_image_pixmap.cpp
 	get_file_size.cpp
 	amd_perf_monitor.cpp
+	frame_capture.cpp
+	frame_stats.cpp
+	gpu_timer.cpp
+	frame_pacer.cpp
+	utilPix.cpp
+	utilPixYUV.cpp
 	xrandr_util.cpp
 )
 CFLAGS=(
@@ -30,6 +36,7 @@ LFLAGS=(
 	-lstdc++
 	-ldl
 	-lrt
+	-lpthread
 	-lGLESv2
 	-lEGL
 	-lX11
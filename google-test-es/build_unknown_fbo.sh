@@ -4,6 +4,9 @@ TARGET=test_unknown_fbo
 SOURCE=(
 	app_fbo.cpp
 	utilPix.cpp
+	utilPixYUV.cpp
+	utilPixMip.cpp
+	utilPixETC.cpp
 	utilTex.cpp
 	get_file_size.cpp
 )
@@ -21,6 +24,7 @@ CFLAGS=(
 LFLAGS=(
 	-lstdc++
 	-lrt
+	-lpthread
 	-ldl
 )
 
@@ -40,6 +44,10 @@ if [[ $HOSTTYPE == "arm" ]]; then
 		SOURCE+=(
 			main.cpp
 			amd_perf_monitor.cpp
+			frame_capture.cpp
+			frame_stats.cpp
+			gpu_timer.cpp
+			frame_pacer.cpp
 		)
 		CFLAGS+=(
 			-marm
@@ -61,6 +69,10 @@ elif [[ ${HOSTTYPE:0:3} == "x86" ]]; then
 	SOURCE+=(
 		main_glx.cpp
 		amd_perf_monitor.cpp
+		frame_capture.cpp
+		frame_stats.cpp
+		gpu_timer.cpp
+		frame_pacer.cpp
 	)
 	CFLAGS+=(
 		-msse3
@@ -19,6 +19,7 @@ CFLAGS=(
 LFLAGS=(
 	-lstdc++
 	-lrt
+	-lpthread
 	-ldl
 )
 
@@ -38,6 +39,12 @@ if [[ $HOSTTYPE == "arm" ]]; then
 		SOURCE+=(
 			main.cpp
 			amd_perf_monitor.cpp
+			frame_capture.cpp
+			frame_stats.cpp
+			gpu_timer.cpp
+			frame_pacer.cpp
+			utilPix.cpp
+			utilPixYUV.cpp
 		)
 		CFLAGS+=(
 			-marm
@@ -59,6 +66,12 @@ elif [[ ${HOSTTYPE:0:3} == "x86" ]]; then
 	SOURCE+=(
 		main_glx.cpp
 		amd_perf_monitor.cpp
+		frame_capture.cpp
+		frame_stats.cpp
+		gpu_timer.cpp
+		frame_pacer.cpp
+		utilPix.cpp
+		utilPixYUV.cpp
 	)
 	CFLAGS+=(
 		-msse3
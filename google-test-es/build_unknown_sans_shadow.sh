@@ -4,7 +4,13 @@ TARGET=test_unknown_sans_shadow
 SOURCE=(
 	app_sans_shadow.cpp
 	rendIndexedTrilist.cpp
+	rendMeshlet.cpp
+	rendSimplify.cpp
+	rendTangent.cpp
 	utilPix.cpp
+	utilPixYUV.cpp
+	utilPixMip.cpp
+	utilPixETC.cpp
 	utilTex.cpp
 	get_file_size.cpp
 )
@@ -22,6 +28,7 @@ CFLAGS=(
 LFLAGS=(
 	-lstdc++
 	-lrt
+	-lpthread
 	-ldl
 )
 
@@ -41,6 +48,10 @@ if [[ $HOSTTYPE == "arm" ]]; then
 		SOURCE+=(
 			main.cpp
 			amd_perf_monitor.cpp
+			frame_capture.cpp
+			frame_stats.cpp
+			gpu_timer.cpp
+			frame_pacer.cpp
 		)
 		CFLAGS+=(
 			-marm
@@ -94,6 +105,10 @@ elif [[ ${HOSTTYPE:0:3} == "x86" ]]; then
 	SOURCE+=(
 		main_glx.cpp
 		amd_perf_monitor.cpp
+		frame_capture.cpp
+		frame_stats.cpp
+		gpu_timer.cpp
+		frame_pacer.cpp
 	)
 	CFLAGS+=(
 		-msse3
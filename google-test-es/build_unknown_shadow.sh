@@ -4,8 +4,15 @@ TARGET=test_unknown_shadow
 SOURCE=(
 	app_shadow.cpp
 	rendIndexedTrilist.cpp
+	rendMeshlet.cpp
+	rendSimplify.cpp
+	rendTangent.cpp
 	utilPix.cpp
+	utilPixYUV.cpp
+	utilPixMip.cpp
+	utilPixETC.cpp
 	utilTex.cpp
+	utilLoader.cpp
 	get_file_size.cpp
 )
 CFLAGS=(
@@ -22,6 +29,7 @@ CFLAGS=(
 LFLAGS=(
 	-lstdc++
 	-lrt
+	-lpthread
 	-ldl
 )
 
@@ -41,6 +49,10 @@ if [[ $HOSTTYPE == "arm" ]]; then
 		SOURCE+=(
 			main.cpp
 			amd_perf_monitor.cpp
+			frame_capture.cpp
+			frame_stats.cpp
+			gpu_timer.cpp
+			frame_pacer.cpp
 		)
 		CFLAGS+=(
 			-marm
@@ -62,6 +74,10 @@ elif [[ ${HOSTTYPE:0:3} == "x86" ]]; then
 	SOURCE+=(
 		main_glx.cpp
 		amd_perf_monitor.cpp
+		frame_capture.cpp
+		frame_stats.cpp
+		gpu_timer.cpp
+		frame_pacer.cpp
 	)
 	CFLAGS+=(
 		-msse3
@@ -0,0 +1,783 @@
+#if defined(PLATFORM_GLX)
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#else
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <iostream>
+
+#include "get_proc_address.hpp"
+#include "utilPix.hpp"
+#include "frame_capture.hpp"
+
+namespace frame_capture
+{
+
+#if defined(PLATFORM_GLX)
+
+#define CAPTURE_PBO_CAPABLE	1
+
+typedef PFNGLMAPBUFFERRANGEPROC	PFNMAPBUFFERRANGEPROC;
+typedef PFNGLUNMAPBUFFERPROC	PFNUNMAPBUFFERPROC;
+
+static const GLenum g_pack_target = GL_PIXEL_PACK_BUFFER;
+static const GLbitfield g_map_read_bit = GL_MAP_READ_BIT;
+
+#elif GL_EXT_map_buffer_range != 0 && GL_OES_mapbuffer != 0 && defined(GL_PIXEL_PACK_BUFFER_NV)
+
+#define CAPTURE_PBO_CAPABLE	1
+
+// ES3 core entry points are of the same signatures and enum values as their ES2 extension counterparts
+typedef PFNGLMAPBUFFERRANGEEXTPROC	PFNMAPBUFFERRANGEPROC;
+typedef PFNGLUNMAPBUFFEROESPROC		PFNUNMAPBUFFERPROC;
+
+static const GLenum g_pack_target = GL_PIXEL_PACK_BUFFER_NV;
+static const GLbitfield g_map_read_bit = GL_MAP_READ_BIT_EXT;
+
+#endif
+
+enum {
+	// client buffers in flight between the ring and the writer; a slow writer stalls the render
+	// thread once they are all queued
+	MAX_BUFFERS = MAX_RING_DEPTH + 2
+};
+
+static bool g_active;
+static format_t g_format;
+
+static unsigned g_w;
+static unsigned g_h;
+static unsigned g_first;
+static unsigned g_last;
+static unsigned g_step;
+static char g_name[FILENAME_MAX + 1];
+
+// y4m sink: a single stream of even dimensions, written by the writer only
+static FILE* g_video;
+static unsigned g_video_w;
+static unsigned g_video_h;
+static uint8_t* g_yuv;
+
+#if CAPTURE_PBO_CAPABLE != 0
+
+static PFNMAPBUFFERRANGEPROC gglMapBufferRange;
+static PFNUNMAPBUFFERPROC gglUnmapBuffer;
+
+#if !defined(PLATFORM_GLX)
+static bool g_es3;
+#endif
+
+#endif
+
+static bool g_use_pbo;
+static unsigned g_depth;
+static GLuint g_pbo[MAX_RING_DEPTH];
+static unsigned g_slot_frame[MAX_RING_DEPTH];
+static bool g_slot_busy[MAX_RING_DEPTH];
+static unsigned g_slot_next;
+
+struct buffer_t
+{
+	void* pixels;
+	unsigned nframe;
+};
+
+static buffer_t g_buffer[MAX_BUFFERS];
+static unsigned g_num_buffers;
+
+// guarded by g_mutex: free buffers as a stack, queued buffers as a fifo, and the writer stats
+static unsigned g_free[MAX_BUFFERS];
+static unsigned g_num_free;
+static unsigned g_queue[MAX_BUFFERS];
+static unsigned g_queue_head;
+static unsigned g_queue_count;
+static bool g_quit;
+static unsigned g_num_written;
+static unsigned g_num_write_failed;
+
+static pthread_mutex_t g_mutex;
+static pthread_cond_t g_cond_free;
+static pthread_cond_t g_cond_queued;
+static pthread_t g_writer;
+
+// render-thread stats
+static unsigned g_num_captured;
+static unsigned g_num_map_failed;
+static unsigned g_num_dropped;
+static unsigned g_num_stalls;
+static uint64_t g_t_capture;
+static uint64_t g_t_stall;
+
+
+static uint64_t
+timer_nsec()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+
+static size_t
+sizeof_frame()
+{
+	return size_t(g_w) * g_h * 4;
+}
+
+
+static bool
+write_frame_raw(
+	const buffer_t& buffer)
+{
+	char name[FILENAME_MAX + 16];
+	snprintf(name, sizeof(name), "%s%06u.raw", g_name, buffer.nframe);
+
+	FILE* const file = fopen(name, "wb");
+
+	if (0 == file)
+	{
+		std::cerr << "failure opening framegrab file '" << name << "'" << std::endl;
+		return false;
+	}
+
+	const unsigned dims[] = { g_h, g_w };
+
+	const bool success =
+		1 == fwrite(dims, sizeof(dims), 1, file) &&
+		1 == fwrite(buffer.pixels, sizeof_frame(), 1, file);
+
+	if (0 != fclose(file) || !success)
+	{
+		std::cerr << "failure writing framegrab file '" << name << "'" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+// append a frame to the y4m stream; frames are read back bottom-up, while y4m is top-down; the first
+// failure closes the stream, as a partial frame leaves the rest of it unreadable
+static bool
+write_frame_y4m(
+	const buffer_t& buffer)
+{
+	if (0 == g_video)
+		return false;
+
+	const unsigned c_w = g_video_w / 2;
+	const unsigned c_h = g_video_h / 2;
+
+	uint8_t* const y = g_yuv;
+	uint8_t* const u = y + size_t(g_video_w) * g_video_h;
+	uint8_t* const v = u + size_t(c_w) * c_h;
+
+	// single-threaded, to keep clear of the render thread
+	testbed::util::fill_YUV420_from_RGBA(
+		y, u, v, g_video_w, c_w, c_w,
+		reinterpret_cast< const uint8_t* >(buffer.pixels), g_w * 4,
+		g_video_w, g_video_h,
+		testbed::util::YUV_MATRIX_BT601,
+		testbed::util::YUV_RANGE_FULL, 1);
+
+	bool success = 0 <= fputs("FRAME\n", g_video);
+
+	for (unsigned i = g_video_h; success && 0 != i; --i)
+		success = 1 == fwrite(y + size_t(i - 1) * g_video_w, g_video_w, 1, g_video);
+
+	for (unsigned i = c_h; success && 0 != i; --i)
+		success = 1 == fwrite(u + size_t(i - 1) * c_w, c_w, 1, g_video);
+
+	for (unsigned i = c_h; success && 0 != i; --i)
+		success = 1 == fwrite(v + size_t(i - 1) * c_w, c_w, 1, g_video);
+
+	if (!success)
+	{
+		std::cerr << "failure writing frame " << buffer.nframe << " to video file '" << g_name <<
+			"'; closing it, subsequent frames are dropped" << std::endl;
+
+		fclose(g_video);
+		g_video = 0;
+	}
+
+	return success;
+}
+
+
+static void*
+writer(
+	void*)
+{
+	pthread_mutex_lock(&g_mutex);
+
+	while (true)
+	{
+		while (!g_quit && 0 == g_queue_count)
+			pthread_cond_wait(&g_cond_queued, &g_mutex);
+
+		// drain the queue before quitting
+		if (0 == g_queue_count)
+			break;
+
+		const unsigned idx = g_queue[g_queue_head];
+		g_queue_head = (g_queue_head + 1) % MAX_BUFFERS;
+		--g_queue_count;
+
+		pthread_mutex_unlock(&g_mutex);
+
+		const bool success = FORMAT_Y4M == g_format
+			? write_frame_y4m(g_buffer[idx])
+			: write_frame_raw(g_buffer[idx]);
+
+		pthread_mutex_lock(&g_mutex);
+
+		if (success)
+			++g_num_written;
+		else
+			++g_num_write_failed;
+
+		g_free[g_num_free++] = idx;
+		pthread_cond_signal(&g_cond_free);
+	}
+
+	pthread_mutex_unlock(&g_mutex);
+
+	return 0;
+}
+
+
+// get a free client buffer, waiting on the writer if there are none
+static unsigned
+acquire_buffer()
+{
+	pthread_mutex_lock(&g_mutex);
+
+	if (0 == g_num_free)
+	{
+		const uint64_t t0 = timer_nsec();
+
+		while (0 == g_num_free)
+			pthread_cond_wait(&g_cond_free, &g_mutex);
+
+		g_t_stall += timer_nsec() - t0;
+		++g_num_stalls;
+	}
+
+	const unsigned idx = g_free[--g_num_free];
+
+	pthread_mutex_unlock(&g_mutex);
+
+	return idx;
+}
+
+
+// get a free client buffer, or -1U if there are none
+static unsigned
+try_acquire_buffer()
+{
+	pthread_mutex_lock(&g_mutex);
+
+	const unsigned idx = 0 != g_num_free ? g_free[--g_num_free] : -1U;
+
+	pthread_mutex_unlock(&g_mutex);
+
+	return idx;
+}
+
+
+// sinks of sequences block on a slow writer, while streaming sinks drop frames instead
+static unsigned
+get_buffer()
+{
+	if (FORMAT_Y4M != g_format)
+		return acquire_buffer();
+
+	const unsigned idx = try_acquire_buffer();
+
+	if (-1U == idx)
+		++g_num_dropped;
+
+	return idx;
+}
+
+
+static void
+release_buffer(
+	const unsigned idx)
+{
+	pthread_mutex_lock(&g_mutex);
+
+	g_free[g_num_free++] = idx;
+
+	pthread_mutex_unlock(&g_mutex);
+}
+
+
+static void
+submit_buffer(
+	const unsigned idx)
+{
+	pthread_mutex_lock(&g_mutex);
+
+	g_queue[(g_queue_head + g_queue_count) % MAX_BUFFERS] = idx;
+	++g_queue_count;
+	pthread_cond_signal(&g_cond_queued);
+
+	pthread_mutex_unlock(&g_mutex);
+}
+
+
+static bool
+load_extension()
+{
+#if CAPTURE_PBO_CAPABLE != 0
+
+#if defined(PLATFORM_GLX)
+
+	// our GLX contexts are of version 3.2, where both pixel-pack buffers and buffer range mapping are core
+	const char* const map_name = "glMapBufferRange";
+	const char* const unmap_name = "glUnmapBuffer";
+
+#else
+
+	const char* const version = (const char*) glGetString(GL_VERSION);
+	const char* const extensions = (const char*) glGetString(GL_EXTENSIONS);
+
+	const char* map_name = "glMapBufferRange";
+	const char* unmap_name = "glUnmapBuffer";
+
+	g_es3 = 0 != version && 0 == strncmp(version, "OpenGL ES 3", sizeof("OpenGL ES 3") - 1);
+
+	if (!g_es3)
+	{
+		if (0 == extensions ||
+			0 == strstr(extensions, "GL_NV_pixel_buffer_object") ||
+			0 == strstr(extensions, "GL_EXT_map_buffer_range"))
+		{
+			return false;
+		}
+
+		map_name = "glMapBufferRangeEXT";
+		unmap_name = "glUnmapBufferOES";
+	}
+
+#endif
+
+	gglMapBufferRange = (PFNMAPBUFFERRANGEPROC) getProcAddress(map_name);
+	gglUnmapBuffer = (PFNUNMAPBUFFERPROC) getProcAddress(unmap_name);
+
+	return 0 != gglMapBufferRange && 0 != gglUnmapBuffer;
+
+#else
+
+	return false;
+
+#endif // CAPTURE_PBO_CAPABLE
+}
+
+
+// map the pixels of a slot into a client buffer and queue that for writing
+static void
+retire_slot(
+	const unsigned slot)
+{
+#if CAPTURE_PBO_CAPABLE != 0
+
+	assert(g_slot_busy[slot]);
+
+	g_slot_busy[slot] = false;
+
+	// a dropped frame is never mapped
+	const unsigned idx = get_buffer();
+
+	if (-1U == idx)
+		return;
+
+	g_buffer[idx].nframe = g_slot_frame[slot];
+
+	glBindBuffer(g_pack_target, g_pbo[slot]);
+
+	const void* const pixels = gglMapBufferRange(g_pack_target, 0, GLsizeiptr(sizeof_frame()), g_map_read_bit);
+
+	if (0 != pixels)
+	{
+		memcpy(g_buffer[idx].pixels, pixels, sizeof_frame());
+		gglUnmapBuffer(g_pack_target);
+	}
+
+	glBindBuffer(g_pack_target, 0);
+
+	if (0 == pixels)
+	{
+		std::cerr << "failure mapping frame " << g_buffer[idx].nframe << " for capture" << std::endl;
+		++g_num_map_failed;
+		release_buffer(idx);
+		return;
+	}
+
+	submit_buffer(idx);
+
+#endif // CAPTURE_PBO_CAPABLE
+}
+
+
+// issue the readback of a frame into the next slot; the readback completes asynchronously
+static void
+pack_slot(
+	const unsigned nframe)
+{
+#if CAPTURE_PBO_CAPABLE != 0
+
+	const unsigned slot = g_slot_next;
+	g_slot_next = (g_slot_next + 1) % g_depth;
+
+	// a slot is reused at least ring-depth frames after it was packed, so it got retired by now
+	assert(!g_slot_busy[slot]);
+
+	glBindBuffer(g_pack_target, g_pbo[slot]);
+	glReadPixels(0, 0, g_w, g_h, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(g_pack_target, 0);
+
+	g_slot_frame[slot] = nframe;
+	g_slot_busy[slot] = true;
+
+#endif // CAPTURE_PBO_CAPABLE
+}
+
+
+// release whatever of the capture resources is held; GL ones need the context current
+static void
+release_resources()
+{
+	for (unsigned i = 0; i < g_num_buffers; ++i)
+	{
+		free(g_buffer[i].pixels);
+		g_buffer[i].pixels = 0;
+	}
+
+	g_num_buffers = 0;
+
+	if (g_use_pbo)
+	{
+		glDeleteBuffers(g_depth, g_pbo);
+		g_use_pbo = false;
+	}
+
+	free(g_yuv);
+	g_yuv = 0;
+
+	if (0 != g_video && 0 != fclose(g_video))
+		std::cerr << "failure closing video file '" << g_name << "'" << std::endl;
+
+	g_video = 0;
+}
+
+
+static bool
+open_video(
+	const unsigned fps)
+{
+	g_video_w = g_w & ~1U;
+	g_video_h = g_h & ~1U;
+
+	if (0 == g_video_w || 0 == g_video_h)
+	{
+		std::cerr << __FUNCTION__ << " got a framebuffer too small for YUV420" << std::endl;
+		return false;
+	}
+
+	g_yuv = reinterpret_cast< uint8_t* >(malloc(size_t(g_video_w) * g_video_h * 3 / 2));
+
+	if (0 == g_yuv)
+	{
+		std::cerr << __FUNCTION__ << " failed to allocate the YUV buffer" << std::endl;
+		return false;
+	}
+
+	g_video = fopen(g_name, "wb");
+
+	if (0 == g_video)
+	{
+		std::cerr << "failure opening video file '" << g_name << "'" << std::endl;
+		return false;
+	}
+
+	// YUV420 of JPEG chroma siting and full range, ie. that of fill_YUV420_from_RGBA
+	if (0 > fprintf(g_video, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", g_video_w, g_video_h, fps))
+	{
+		std::cerr << "failure writing video file '" << g_name << "'" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+bool
+init(
+	const format_t format,
+	const unsigned w,
+	const unsigned h,
+	const unsigned first,
+	const unsigned last,
+	const unsigned step,
+	const unsigned ring_depth,
+	const char* const name,
+	const unsigned fps)
+{
+	assert(!g_active);
+
+	if (0 == w || 0 == h || 0 == step || first > last || 0 == ring_depth || MAX_RING_DEPTH < ring_depth || 0 == fps)
+	{
+		std::cerr << __FUNCTION__ << " got invalid arguments" << std::endl;
+		return false;
+	}
+
+	g_format = format;
+	g_w = w;
+	g_h = h;
+	g_first = first;
+	g_last = last;
+	g_step = step;
+	g_depth = ring_depth;
+
+	strncpy(g_name, 0 != name && name[0] ? name : (FORMAT_Y4M == format ? "frames.y4m" : "frame"), FILENAME_MAX);
+	g_name[FILENAME_MAX] = '\0';
+
+	if (FORMAT_Y4M == g_format && !open_video(fps))
+	{
+		release_resources();
+		return false;
+	}
+
+	g_use_pbo = load_extension();
+
+	if (g_use_pbo)
+	{
+#if CAPTURE_PBO_CAPABLE != 0
+
+#if defined(PLATFORM_GLX)
+		const GLenum usage = GL_STREAM_READ;
+#else
+		// GL_STREAM_READ is not a valid usage to ES2
+		const GLenum usage = g_es3 ? GLenum(0x88E1) /* GL_STREAM_READ */ : GLenum(GL_STREAM_DRAW);
+#endif
+
+		// don't mistake errors left over by the app for ours
+		while (GL_NO_ERROR != glGetError());
+
+		glGenBuffers(g_depth, g_pbo);
+
+		for (unsigned i = 0; i < g_depth; ++i)
+		{
+			glBindBuffer(g_pack_target, g_pbo[i]);
+			glBufferData(g_pack_target, GLsizeiptr(sizeof_frame()), 0, usage);
+			g_slot_busy[i] = false;
+		}
+
+		glBindBuffer(g_pack_target, 0);
+
+		if (GL_NO_ERROR != glGetError())
+		{
+			std::cerr << __FUNCTION__ << " failed to create the pixel-pack ring; capturing synchronously" << std::endl;
+
+			glDeleteBuffers(g_depth, g_pbo);
+			g_use_pbo = false;
+		}
+
+#endif // CAPTURE_PBO_CAPABLE
+	}
+
+	g_slot_next = 0;
+
+	// also the bound of the writer queue, past which streaming sinks drop frames
+	const unsigned num_buffers = g_use_pbo ? g_depth + 2 : 2;
+
+	for (g_num_buffers = 0; g_num_buffers < num_buffers; ++g_num_buffers)
+	{
+		g_buffer[g_num_buffers].pixels = malloc(sizeof_frame());
+
+		if (0 == g_buffer[g_num_buffers].pixels)
+		{
+			std::cerr << __FUNCTION__ << " failed to allocate capture buffers" << std::endl;
+
+			release_resources();
+			return false;
+		}
+
+		g_free[g_num_buffers] = g_num_buffers;
+	}
+
+	g_num_free = g_num_buffers;
+	g_queue_head = 0;
+	g_queue_count = 0;
+	g_quit = false;
+
+	g_num_written = 0;
+	g_num_write_failed = 0;
+	g_num_captured = 0;
+	g_num_map_failed = 0;
+	g_num_dropped = 0;
+	g_num_stalls = 0;
+	g_t_capture = 0;
+	g_t_stall = 0;
+
+	pthread_mutex_init(&g_mutex, NULL);
+	pthread_cond_init(&g_cond_free, NULL);
+	pthread_cond_init(&g_cond_queued, NULL);
+
+	const int r = pthread_create(&g_writer, NULL, writer, NULL);
+
+	if (0 != r)
+	{
+		std::cerr << __FUNCTION__ << " failed to start the writer, err: " << r << std::endl;
+
+		pthread_cond_destroy(&g_cond_queued);
+		pthread_cond_destroy(&g_cond_free);
+		pthread_mutex_destroy(&g_mutex);
+
+		release_resources();
+		return false;
+	}
+
+	g_active = true;
+
+	std::cout << "capturing frames " << g_first << " to " << g_last << " step " << g_step;
+
+	if (FORMAT_Y4M == g_format)
+		std::cout << " to video '" << g_name << "' of " << g_video_w << "x" << g_video_h << " at " << fps << " fps, ";
+	else
+		std::cout << " as '" << g_name << "NNNNNN.raw', ";
+
+	if (g_use_pbo)
+		std::cout << "through a pixel-pack ring of depth " << g_depth << std::endl;
+	else
+		std::cout << "synchronously" << std::endl;
+
+	return true;
+}
+
+
+void
+capture_frame(
+	const unsigned nframe)
+{
+	if (!g_active)
+		return;
+
+	const uint64_t t0 = timer_nsec();
+	const bool capture = nframe >= g_first && nframe <= g_last && 0 == (nframe - g_first) % g_step;
+	bool any = capture;
+
+	if (g_use_pbo)
+	{
+		// slots are taken in round-robin, so walking them from the next one visits them oldest first
+		for (unsigned i = 0; i < g_depth; ++i)
+		{
+			const unsigned slot = (g_slot_next + i) % g_depth;
+
+			if (!g_slot_busy[slot] || nframe - g_slot_frame[slot] < g_depth)
+				continue;
+
+			retire_slot(slot);
+			any = true;
+		}
+	}
+
+	if (capture)
+	{
+		if (g_use_pbo)
+		{
+			pack_slot(nframe);
+		}
+		else
+		{
+			const unsigned idx = get_buffer();
+
+			if (-1U != idx)
+			{
+				g_buffer[idx].nframe = nframe;
+
+				glReadPixels(0, 0, g_w, g_h, GL_RGBA, GL_UNSIGNED_BYTE, g_buffer[idx].pixels);
+
+				submit_buffer(idx);
+			}
+		}
+
+		++g_num_captured;
+	}
+
+	if (any)
+		g_t_capture += timer_nsec() - t0;
+}
+
+
+void
+deinit()
+{
+	if (!g_active)
+		return;
+
+	g_active = false;
+
+	if (g_use_pbo)
+	{
+		for (unsigned i = 0; i < g_depth; ++i)
+		{
+			const unsigned slot = (g_slot_next + i) % g_depth;
+
+			if (g_slot_busy[slot])
+				retire_slot(slot);
+		}
+	}
+
+	pthread_mutex_lock(&g_mutex);
+
+	g_quit = true;
+	pthread_cond_signal(&g_cond_queued);
+
+	pthread_mutex_unlock(&g_mutex);
+
+	const int r = pthread_join(g_writer, NULL);
+
+	if (0 != r)
+		std::cerr << __FUNCTION__ << " failed to join the writer, err: " << r << std::endl;
+
+	pthread_cond_destroy(&g_cond_queued);
+	pthread_cond_destroy(&g_cond_free);
+	pthread_mutex_destroy(&g_mutex);
+
+	release_resources();
+
+	std::cout << "frames captured: " << g_num_captured <<
+		"\nframes written: " << g_num_written;
+
+	if (g_num_map_failed || g_num_write_failed)
+		std::cout << " (failed to map " << g_num_map_failed << ", failed to write " << g_num_write_failed << ")";
+
+	if (FORMAT_Y4M == g_format)
+		std::cout << "\nframes dropped on a busy writer: " << g_num_dropped;
+
+	std::cout << "\ncapture time on render thread: " << double(g_t_capture) * 1e-6 << " ms";
+
+	if (g_num_captured)
+		std::cout << " (" << double(g_t_capture) * 1e-6 / g_num_captured << " ms per frame)";
+
+	std::cout << "\ncapture stalls on writer: " << g_num_stalls << " (" << double(g_t_stall) * 1e-6 << " ms)" << std::endl;
+}
+
+} // namespace frame_capture
@@ -0,0 +1,68 @@
+#ifndef frame_capture_H__
+#define frame_capture_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// asynchronous capture of frame sequences: each captured frame is packed into a slot of a ring of
+// pixel-pack buffers, mapped only once the ring has cycled, ie. ring-depth frames later, when the GPU
+// is long done with it, and handed to a writer thread which saves it either in the format of -grab_frame,
+// or into a y4m video stream, converted to YUV420; without pixel-pack buffers (ES2 sans
+// GL_NV_pixel_buffer_object and GL_EXT_map_buffer_range) frames get read synchronously, but are still
+// written off the render thread; the writer queue is bounded: raw sequences stall the render thread
+// once it fills up, while video streams drop frames instead, and count them
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace frame_capture
+{
+
+enum format_t {
+	FORMAT_RAW,			// a file per frame, <name>NNNNNN.raw, of the -grab_frame format
+	FORMAT_Y4M			// a single y4m stream, <name>, of YUV420 of full range and BT.601 matrix
+};
+
+enum {
+	DEFAULT_RING_DEPTH	= 3,
+	MAX_RING_DEPTH		= 16,
+	DEFAULT_FPS			= 60
+};
+
+// init()	: start capturing frames [first, last] of the specified step; to be called with the GL context
+//			  current, past the app's resource init
+//		- format,		const format_t	: output format,												input
+//		- w, h,			const unsigned	: dimensions of the framebuffer; y4m crops them to even,		input
+//		- first,		const unsigned	: zero-based index of the first frame to capture,				input
+//		- last,			const unsigned	: index of the last frame to capture, inclusive,				input
+//		- step,			const unsigned	: capture every step-th frame of the range,						input
+//		- ring_depth,	const unsigned	: frames a captured frame stays in its slot before mapped,		input
+//		- name,			const char*		: path prefix of raw files, or path of the y4m file; null means
+//										  "frame", or "frames.y4m", respectively,						input
+//		- fps,			const unsigned	: frame rate recorded in the y4m header,						input
+// returns
+//		bool			: success
+
+bool
+init(
+	const format_t format,
+	const unsigned w,
+	const unsigned h,
+	const unsigned first,
+	const unsigned last,
+	const unsigned step,
+	const unsigned ring_depth = DEFAULT_RING_DEPTH,
+	const char* const name = 0,
+	const unsigned fps = DEFAULT_FPS);
+
+// capture_frame()	: to be called once per frame, after the frame is rendered and before it is swapped
+//		- nframe,		const unsigned	: zero-based index of the frame,								input
+
+void
+capture_frame(
+	const unsigned nframe);
+
+// deinit()	: flush the ring, join the writer and print capture statistics
+
+void
+deinit();
+
+} // namespace frame_capture
+
+#endif // frame_capture_H__
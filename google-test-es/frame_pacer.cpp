@@ -0,0 +1,269 @@
+#if defined(PLATFORM_GLX)
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#else
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <iostream>
+
+#if defined(PLATFORM_GLX)
+#include "get_proc_address.hpp"
+#endif
+#include "frame_pacer.hpp"
+
+namespace frame_pacer
+{
+
+#if defined(PLATFORM_GLX)
+
+typedef GLsync sync_t;
+
+static PFNGLFENCESYNCPROC gglFenceSync;
+static PFNGLCLIENTWAITSYNCPROC gglClientWaitSync;
+static PFNGLDELETESYNCPROC gglDeleteSync;
+
+#else
+
+typedef EGLSyncKHR sync_t;
+
+static EGLDisplay g_display;
+
+static PFNEGLCREATESYNCKHRPROC geglCreateSyncKHR;
+static PFNEGLCLIENTWAITSYNCKHRPROC geglClientWaitSyncKHR;
+static PFNEGLDESTROYSYNCKHRPROC geglDestroySyncKHR;
+
+#endif
+
+// a wait of longer than this is given up on, lest a lost fence hang the run
+static const uint64_t wait_timeout = 1000000000ULL;
+
+static unsigned g_depth;
+static sync_t g_fence[MAX_FRAMES_IN_FLIGHT];
+static uint64_t g_num_frames;
+
+static uint64_t g_t_start;
+static uint64_t g_t_wait;
+static uint64_t g_max_wait;
+static uint64_t g_num_waits;
+static uint64_t g_num_timeouts;
+static uint64_t g_num_failures;
+
+
+static uint64_t
+timer_nsec()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+
+static bool
+load_extension()
+{
+#if defined(PLATFORM_GLX)
+
+	// GL_ARB_sync is core as of GL 3.2
+	gglFenceSync = (PFNGLFENCESYNCPROC) getProcAddress("glFenceSync");
+	gglClientWaitSync = (PFNGLCLIENTWAITSYNCPROC) getProcAddress("glClientWaitSync");
+	gglDeleteSync = (PFNGLDELETESYNCPROC) getProcAddress("glDeleteSync");
+
+	return 0 != gglFenceSync && 0 != gglClientWaitSync && 0 != gglDeleteSync;
+
+#else
+
+	g_display = eglGetCurrentDisplay();
+
+	if (EGL_NO_DISPLAY == g_display)
+		return false;
+
+	const char* const extensions = eglQueryString(g_display, EGL_EXTENSIONS);
+
+	if (0 == extensions || !strstr(extensions, "EGL_KHR_fence_sync"))
+		return false;
+
+	geglCreateSyncKHR = (PFNEGLCREATESYNCKHRPROC) eglGetProcAddress("eglCreateSyncKHR");
+	geglClientWaitSyncKHR = (PFNEGLCLIENTWAITSYNCKHRPROC) eglGetProcAddress("eglClientWaitSyncKHR");
+	geglDestroySyncKHR = (PFNEGLDESTROYSYNCKHRPROC) eglGetProcAddress("eglDestroySyncKHR");
+
+	return 0 != geglCreateSyncKHR && 0 != geglClientWaitSyncKHR && 0 != geglDestroySyncKHR;
+
+#endif
+}
+
+
+static sync_t
+create_fence()
+{
+#if defined(PLATFORM_GLX)
+
+	return gglFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+#else
+
+	const sync_t fence = geglCreateSyncKHR(g_display, EGL_SYNC_FENCE_KHR, 0);
+
+	return EGL_NO_SYNC_KHR != fence ? fence : 0;
+
+#endif
+}
+
+
+// returns false on timeout or failure
+static bool
+wait_fence(
+	const sync_t fence)
+{
+#if defined(PLATFORM_GLX)
+
+	const GLenum status = gglClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait_timeout);
+
+	if (GL_TIMEOUT_EXPIRED == status)
+		++g_num_timeouts;
+
+	return GL_ALREADY_SIGNALED == status || GL_CONDITION_SATISFIED == status;
+
+#else
+
+	const EGLint status = geglClientWaitSyncKHR(g_display, fence, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, wait_timeout);
+
+	if (EGL_TIMEOUT_EXPIRED_KHR == status)
+		++g_num_timeouts;
+
+	return EGL_CONDITION_SATISFIED_KHR == status;
+
+#endif
+}
+
+
+static void
+delete_fence(
+	const sync_t fence)
+{
+#if defined(PLATFORM_GLX)
+
+	gglDeleteSync(fence);
+
+#else
+
+	geglDestroySyncKHR(g_display, fence);
+
+#endif
+}
+
+
+bool
+init(
+	const unsigned frames_in_flight)
+{
+	if (0 == frames_in_flight || MAX_FRAMES_IN_FLIGHT < frames_in_flight)
+	{
+		std::cerr << __FUNCTION__ << " got a number of frames in flight out of range" << std::endl;
+		return false;
+	}
+
+	if (!load_extension())
+	{
+		std::cerr << __FUNCTION__ << " found no fence sync; no frame pacing" << std::endl;
+		return false;
+	}
+
+	for (unsigned i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		g_fence[i] = 0;
+
+	g_depth = frames_in_flight;
+	g_num_frames = 0;
+	g_t_start = timer_nsec();
+	g_t_wait = 0;
+	g_max_wait = 0;
+	g_num_waits = 0;
+	g_num_timeouts = 0;
+	g_num_failures = 0;
+
+	return true;
+}
+
+
+void
+end_frame()
+{
+	if (0 == g_depth)
+		return;
+
+	// the slot of this frame was freed by the wait of the previous frame
+	const sync_t fence = create_fence();
+
+	if (0 == fence)
+		++g_num_failures;
+
+	g_fence[g_num_frames % g_depth] = fence;
+	++g_num_frames;
+
+	// the oldest fence is that of this very frame at a depth of one
+	sync_t& oldest = g_fence[g_num_frames % g_depth];
+
+	if (0 == oldest)
+		return;
+
+	const uint64_t t0 = timer_nsec();
+
+	if (!wait_fence(oldest))
+		++g_num_failures;
+
+	const uint64_t dt = timer_nsec() - t0;
+
+	g_t_wait += dt;
+	g_max_wait = std::max(g_max_wait, dt);
+	++g_num_waits;
+
+	delete_fence(oldest);
+	oldest = 0;
+}
+
+
+void
+report()
+{
+	if (0 == g_depth)
+		return;
+
+	const uint64_t dt = timer_nsec() - g_t_start;
+
+	for (unsigned i = 0; i < g_depth; ++i)
+		if (0 != g_fence[i])
+		{
+			delete_fence(g_fence[i]);
+			g_fence[i] = 0;
+		}
+
+	char line[256];
+	snprintf(line, sizeof(line), "frame pacing at %u frame(s) in flight: CPU waited %.6f s (%.2f%% of the run) "
+		"over %llu frames, mean %.3f ms, max %.3f ms",
+		g_depth,
+		double(g_t_wait) * 1e-9,
+		0 != dt ? 100.0 * g_t_wait / dt : 0.0,
+		(unsigned long long) g_num_waits,
+		0 != g_num_waits ? double(g_t_wait) * 1e-6 / g_num_waits : 0.0,
+		double(g_max_wait) * 1e-6);
+
+	std::cout << line << std::endl;
+
+	if (0 != g_num_failures)
+		std::cout << "frame pacing failures: " << g_num_failures << ", of which wait timeouts: " << g_num_timeouts << std::endl;
+
+	g_depth = 0;
+}
+
+} // namespace frame_pacer
@@ -0,0 +1,40 @@
+#ifndef frame_pacer_H__
+#define frame_pacer_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// bounded frames-in-flight pacing: a fence goes in after each frame and the CPU waits on the fence of
+// the frame N - 1 frames back, so at most N frames are ever queued ahead of the GPU, and N = 1 runs
+// each frame to completion; fences are EGL_KHR_fence_sync on EGL, GL sync objects on GLX; the time the
+// CPU spends waiting is reported, as what is left of the frame time is the CPU's own
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace frame_pacer
+{
+
+enum {
+	MAX_FRAMES_IN_FLIGHT	= 16
+};
+
+// init()	: load the fence extension; to be called with the context current, before the main loop
+//		- frames_in_flight,	const unsigned	: max number of frames queued ahead, 1 - MAX_FRAMES_IN_FLIGHT,	input
+// returns
+//		bool			: success; on failure pacing stays off
+
+bool
+init(
+	const unsigned frames_in_flight);
+
+// end_frame()	: to be called once per frame, at its end, ie. after the swap or flush; fences the frame
+// and waits on the oldest fence due
+
+void
+end_frame();
+
+// report()	: print the CPU-wait stats and release the fences
+
+void
+report();
+
+} // namespace frame_pacer
+
+#endif // frame_pacer_H__
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <iostream>
+
+#include "frame_stats.hpp"
+
+namespace frame_stats
+{
+
+enum {
+	HISTOGRAM_STEPS_PER_OCTAVE	= 4,
+	HISTOGRAM_OCTAVES			= 10,		// 1 ms to 1024 ms
+	HISTOGRAM_BUCKETS			= HISTOGRAM_STEPS_PER_OCTAVE * HISTOGRAM_OCTAVES + 2,	// plus under and over range
+	HISTOGRAM_BAR				= 40
+};
+
+static uint64_t* g_ring;
+static unsigned g_capacity;
+static unsigned g_next;
+static uint64_t g_num_frames;		// all frames recorded, of which the ring keeps the last g_capacity
+static uint64_t g_t_last;
+static uint64_t g_min;
+static uint64_t g_max;
+
+
+bool
+init(
+	const unsigned capacity,
+	const uint64_t t_start)
+{
+	if (0 == capacity || MAX_RING_CAPACITY < capacity)
+	{
+		std::cerr << __FUNCTION__ << " got a ring capacity out of range" << std::endl;
+		return false;
+	}
+
+	free(g_ring);
+	g_ring = reinterpret_cast< uint64_t* >(malloc(sizeof(g_ring[0]) * capacity));
+
+	if (0 == g_ring)
+	{
+		std::cerr << __FUNCTION__ << " failed to allocate the ring" << std::endl;
+		return false;
+	}
+
+	// fault the pages in now rather than in the loop
+	memset(g_ring, 0, sizeof(g_ring[0]) * capacity);
+
+	g_capacity = capacity;
+	g_next = 0;
+	g_num_frames = 0;
+	g_t_last = t_start;
+	g_min = uint64_t(-1);
+	g_max = 0;
+
+	return true;
+}
+
+
+void
+record_frame(
+	const uint64_t t_end)
+{
+	if (0 == g_ring)
+		return;
+
+	const uint64_t dt = t_end - g_t_last;
+	g_t_last = t_end;
+
+	g_ring[g_next] = dt;
+	g_next = g_next + 1 == g_capacity ? 0 : g_next + 1;
+	++g_num_frames;
+
+	g_min = std::min(g_min, dt);
+	g_max = std::max(g_max, dt);
+}
+
+
+// nearest-rank percentile of sorted samples
+static uint64_t
+percentile(
+	const uint64_t* const sorted,
+	const unsigned count,
+	const double p)
+{
+	const unsigned rank = unsigned(ceil(p * count));
+
+	return sorted[0 == rank ? 0 : rank - 1];
+}
+
+
+static unsigned
+bucket_of(
+	const uint64_t dt)
+{
+	const double ms = double(dt) * 1e-6;
+
+	if (1.0 > ms)
+		return 0;
+
+	const unsigned step = unsigned(log2(ms) * HISTOGRAM_STEPS_PER_OCTAVE);
+
+	return std::min(step + 1, unsigned(HISTOGRAM_BUCKETS - 1));
+}
+
+
+// lower edge of a bucket in ms; the under-range bucket starts at zero
+static double
+bucket_edge(
+	const unsigned bucket)
+{
+	if (0 == bucket)
+		return 0.0;
+
+	return exp2(double(bucket - 1) / HISTOGRAM_STEPS_PER_OCTAVE);
+}
+
+
+static bool
+dump(
+	const char* const filename,
+	const uint64_t* const sample,
+	const unsigned count,
+	const uint64_t first_frame,
+	const uint64_t* const sorted)
+{
+	FILE* const file = fopen(filename, "w");
+
+	if (0 == file)
+	{
+		std::cerr << __FUNCTION__ << " failed to open '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	const size_t len = strlen(filename);
+	const bool json = 5 <= len && !strcmp(filename + len - 5, ".json");
+
+	if (json)
+	{
+		fprintf(file, "{\n\t\"frames\": %llu,\n\t\"first_frame\": %llu,\n"
+			"\t\"min_ms\": %.6f,\n\t\"p50_ms\": %.6f,\n\t\"p90_ms\": %.6f,\n"
+			"\t\"p99_ms\": %.6f,\n\t\"p999_ms\": %.6f,\n\t\"max_ms\": %.6f,\n\t\"frame_ms\": [",
+			(unsigned long long) g_num_frames,
+			(unsigned long long) first_frame,
+			double(g_min) * 1e-6,
+			double(percentile(sorted, count, .5)) * 1e-6,
+			double(percentile(sorted, count, .9)) * 1e-6,
+			double(percentile(sorted, count, .99)) * 1e-6,
+			double(percentile(sorted, count, .999)) * 1e-6,
+			double(g_max) * 1e-6);
+
+		for (unsigned i = 0; i < count; ++i)
+			fprintf(file, "%s%.6f", 0 == i ? "" : ", ", double(sample[i]) * 1e-6);
+
+		fprintf(file, "]\n}\n");
+	}
+	else
+	{
+		fprintf(file, "frame,ms\n");
+
+		for (unsigned i = 0; i < count; ++i)
+			fprintf(file, "%llu,%.6f\n", (unsigned long long) (first_frame + i), double(sample[i]) * 1e-6);
+	}
+
+	const bool failed = 0 != ferror(file);
+
+	if (0 != fclose(file) || failed)
+	{
+		std::cerr << __FUNCTION__ << " failed to write '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+void
+report(
+	const char* const dump_filename)
+{
+	if (0 == g_ring || 0 == g_num_frames)
+	{
+		free(g_ring);
+		g_ring = 0;
+		return;
+	}
+
+	// the kept frames in order, oldest first; the ring storage is reused for the sorted copy
+	const unsigned count = unsigned(std::min(g_num_frames, uint64_t(g_capacity)));
+	const unsigned oldest = count < g_capacity ? 0 : g_next;
+	const uint64_t first_frame = g_num_frames - count;
+
+	uint64_t* const sample = reinterpret_cast< uint64_t* >(malloc(sizeof(sample[0]) * count));
+
+	if (0 == sample)
+	{
+		std::cerr << __FUNCTION__ << " failed to allocate frame-time stats" << std::endl;
+		free(g_ring);
+		g_ring = 0;
+		return;
+	}
+
+	for (unsigned i = 0; i < count; ++i)
+		sample[i] = g_ring[(oldest + i) % g_capacity];
+
+	uint64_t* const sorted = g_ring;
+	memcpy(sorted, sample, sizeof(sample[0]) * count);
+	std::sort(sorted, sorted + count);
+
+	std::cout << "frame time ms: min " << double(g_min) * 1e-6 <<
+		", p50 " << double(percentile(sorted, count, .5)) * 1e-6 <<
+		", p90 " << double(percentile(sorted, count, .9)) * 1e-6 <<
+		", p99 " << double(percentile(sorted, count, .99)) * 1e-6 <<
+		", p99.9 " << double(percentile(sorted, count, .999)) * 1e-6 <<
+		", max " << double(g_max) * 1e-6;
+
+	if (count < g_num_frames)
+		std::cout << " (percentiles of the last " << count << " frames)";
+
+	std::cout << std::endl;
+
+	unsigned histogram[HISTOGRAM_BUCKETS] = { 0 };
+
+	for (unsigned i = 0; i < count; ++i)
+		++histogram[bucket_of(sorted[i])];
+
+	const unsigned bucket_first = bucket_of(sorted[0]);
+	const unsigned bucket_last = bucket_of(sorted[count - 1]);
+	const unsigned peak = *std::max_element(histogram, histogram + HISTOGRAM_BUCKETS);
+
+	std::cout << "frame time histogram:\n";
+
+	for (unsigned i = bucket_first; i <= bucket_last; ++i)
+	{
+		// a run of empty buckets shows as a single ellipsis
+		if (0 == histogram[i])
+		{
+			if (0 != histogram[i - 1])
+				std::cout << "  ...\n";
+
+			continue;
+		}
+
+		char line[128];
+		char bar[HISTOGRAM_BAR + 1];
+		const unsigned bar_len = unsigned(uint64_t(histogram[i]) * HISTOGRAM_BAR / peak);
+
+		memset(bar, '#', bar_len);
+		bar[bar_len] = '\0';
+
+		if (HISTOGRAM_BUCKETS - 1 == i)
+			snprintf(line, sizeof(line), "  %8.3f -          ms: %8u %6.2f%% %s",
+				bucket_edge(i), histogram[i], 100.0 * histogram[i] / count, bar);
+		else
+			snprintf(line, sizeof(line), "  %8.3f - %8.3f ms: %8u %6.2f%% %s",
+				bucket_edge(i), bucket_edge(i + 1), histogram[i], 100.0 * histogram[i] / count, bar);
+
+		std::cout << line << '\n';
+	}
+
+	std::cout << std::flush;
+
+	if (0 != dump_filename && dump(dump_filename, sample, count, first_frame, sorted))
+		std::cout << "frame times written to '" << dump_filename << "'" << std::endl;
+
+	free(sample);
+	free(g_ring);
+	g_ring = 0;
+}
+
+} // namespace frame_stats
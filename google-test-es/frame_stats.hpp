@@ -0,0 +1,49 @@
+#ifndef frame_stats_H__
+#define frame_stats_H__
+
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// per-frame CPU timing of the main loop: the interval between consecutive frame ends is recorded into a
+// ring preallocated at init, so recording costs no allocation or I/O; the report gives the percentiles
+// and a histogram of those intervals, and optionally dumps them to a CSV or JSON file; once the ring
+// fills up it keeps the latest frames, while min, max and the frame count still cover the whole run
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace frame_stats
+{
+
+enum {
+	DEFAULT_RING_CAPACITY	= 1 << 16,
+	MAX_RING_CAPACITY		= 1 << 22
+};
+
+// init()	: allocate and touch the ring; to be called before the main loop
+//		- capacity,		const unsigned	: number of most recent frames kept,							input
+//		- t_start,		const uint64_t	: timestamp in nanoseconds the first frame counts from,			input
+// returns
+//		bool			: success
+
+bool
+init(
+	const unsigned capacity,
+	const uint64_t t_start);
+
+// record_frame()	: to be called once per frame, at its end, ie. after the swap or flush
+//		- t_end,		const uint64_t	: timestamp in nanoseconds of the end of the frame,				input
+
+void
+record_frame(
+	const uint64_t t_end);
+
+// report()	: print the frame-time stats, dump the frame times if a file is specified, and free the ring
+//		- dump_filename,	const char*	: output file of the frame times, as JSON if of suffix ".json",
+//									  otherwise as CSV; null means no dump,							input
+
+void
+report(
+	const char* const dump_filename = 0);
+
+} // namespace frame_stats
+
+#endif // frame_stats_H__
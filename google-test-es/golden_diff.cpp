@@ -0,0 +1,348 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <iostream>
+
+#include "scoped.hpp"
+#include "get_file_size.hpp"
+#include "utilPix.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// golden_diff compares a frame grab against a reference grab, both of the -grab_frame format, ie. a
+// header of height and width followed by RGBA8888 rows, bottom row first; the comparison fails when
+// more pixels than allowed have a channel off its reference by more than the tolerance, or when the
+// PSNR or the SSIM fall under their thresholds; optionally a diff image of the same format is written
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace testbed
+{
+
+template < typename T >
+class generic_free
+{
+public:
+
+	void operator()(T* arg)
+	{
+		free(arg);
+	}
+};
+
+
+template <>
+class scoped_functor< FILE >
+{
+public:
+
+	void operator()(FILE* arg)
+	{
+		fclose(arg);
+	}
+};
+
+} // namespace testbed
+
+using namespace testbed;
+
+enum {
+	EXIT_PASS			= 0,
+	EXIT_REGRESSION		= 1,
+	EXIT_ERROR			= 2
+};
+
+struct grab_t
+{
+	unsigned w;
+	unsigned h;
+	uint8_t* pixels;	// points into the file buffer, past the header
+};
+
+
+// returns the file buffer, which the grab points into, or null on failure
+static char*
+load_grab(
+	const char* const filename,
+	grab_t& grab)
+{
+	size_t length;
+	scoped_ptr< char, generic_free > buffer(get_buffer_from_file(filename, length));
+
+	if (0 == buffer())
+		return 0;
+
+	unsigned dims[2];
+
+	if (sizeof(dims) > length)
+	{
+		std::cerr << "file '" << filename << "' is too short for a grab header" << std::endl;
+		return 0;
+	}
+
+	memcpy(dims, buffer(), sizeof(dims));
+
+	grab.h = dims[0];
+	grab.w = dims[1];
+	grab.pixels = reinterpret_cast< uint8_t* >(buffer()) + sizeof(dims);
+
+	if (uint64_t(length - sizeof(dims)) != uint64_t(grab.w) * grab.h * 4)
+	{
+		std::cerr << "file '" << filename << "' of " << grab.w << " by " << grab.h <<
+			" pixels is not of RGBA8888 payload" << std::endl;
+		return 0;
+	}
+
+	char* const ret = buffer();
+	buffer.reset();
+
+	return ret;
+}
+
+
+static bool
+save_grab(
+	const char* const filename,
+	const unsigned w,
+	const unsigned h,
+	const uint8_t* const pixels)
+{
+	const scoped_ptr< FILE, scoped_functor > file(fopen(filename, "wb"));
+
+	if (0 == file())
+	{
+		std::cerr << "failure at opening '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	const unsigned dims[2] = { h, w };
+
+	if (1 != fwrite(dims, sizeof(dims), 1, file()) ||
+		1 != fwrite(pixels, size_t(w) * h * 4, 1, file()))
+	{
+		std::cerr << "failure at writing '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static void
+print_usage(
+	const char* const argv0)
+{
+	std::cerr << "usage: " << argv0 << " [option ...] result.raw reference.raw\n"
+		"options:\n"
+		"\t-tolerance \"<n>\"|\"<r> <g> <b> <a>\"\t: max absolute difference per channel of a passing pixel; default is 0\n"
+		"\t-mask <file.raw>\t\t: per-pixel tolerances, as RGBA of a grab of the same dimensions; overrides -tolerance\n"
+		"\t-max_failed <n>\t\t\t: number of pixels allowed over tolerance; default is 0\n"
+		"\t-min_psnr <dB>\t\t\t: fail under this PSNR of RGB; default is none\n"
+		"\t-min_ssim <x>\t\t\t: fail under this mean SSIM of luma; default is none\n"
+		"\t-diff <file.raw> [<gain>]\t: write the absolute difference, scaled by gain (1 - 255, default 8), as a grab\n"
+		"\t-threads <n>\t\t\t: number of worker threads; default is one per online CPU\n"
+		"exit status is 0 for pass, 1 for regression, 2 for error" << std::endl;
+}
+
+
+static void
+print_psnr(
+	const char* const name,
+	const double psnr)
+{
+	if (HUGE_VAL == psnr)
+		printf("%s inf", name);
+	else
+		printf("%s %.3f", name, psnr);
+}
+
+
+int
+main(
+	int argc,
+	char** argv)
+{
+	uint8_t tolerance[4] = { 0, 0, 0, 0 };
+	const char* mask_filename = 0;
+	const char* diff_filename = 0;
+	unsigned diff_gain = 8;
+	uint64_t max_failed = 0;
+	double min_psnr = -HUGE_VAL;
+	double min_ssim = -HUGE_VAL;
+	unsigned num_threads = 0;
+	int i = 1;
+
+	for (; i < argc && '-' == argv[i][0]; ++i)
+	{
+		if (!strcmp(argv[i], "-tolerance") && i + 1 < argc)
+		{
+			unsigned t[4];
+			const int n = sscanf(argv[i + 1], "%u %u %u %u", &t[0], &t[1], &t[2], &t[3]);
+
+			if (1 == n && 256 > t[0])
+			{
+				tolerance[0] = tolerance[1] = tolerance[2] = tolerance[3] = uint8_t(t[0]);
+				++i;
+				continue;
+			}
+
+			if (4 == n && 256 > t[0] && 256 > t[1] && 256 > t[2] && 256 > t[3])
+			{
+				for (unsigned c = 0; c < 4; ++c)
+					tolerance[c] = uint8_t(t[c]);
+
+				++i;
+				continue;
+			}
+		}
+
+		if (!strcmp(argv[i], "-mask") && i + 1 < argc)
+		{
+			mask_filename = argv[++i];
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-max_failed") && i + 1 < argc)
+		{
+			unsigned long long n;
+
+			if (1 == sscanf(argv[i + 1], "%llu", &n))
+			{
+				max_failed = n;
+				++i;
+				continue;
+			}
+		}
+
+		if (!strcmp(argv[i], "-min_psnr") && i + 1 < argc && 1 == sscanf(argv[i + 1], "%lf", &min_psnr))
+		{
+			++i;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-min_ssim") && i + 1 < argc && 1 == sscanf(argv[i + 1], "%lf", &min_ssim))
+		{
+			++i;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-diff") && i + 1 < argc)
+		{
+			diff_filename = argv[++i];
+
+			// the optional gain is told from the inputs by being a number
+			unsigned gain;
+			char trail;
+
+			if (i + 1 < argc && 1 == sscanf(argv[i + 1], "%u%c", &gain, &trail))
+			{
+				if (0 == gain || 255 < gain)
+				{
+					print_usage(argv[0]);
+					return EXIT_ERROR;
+				}
+
+				diff_gain = gain;
+				++i;
+			}
+
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-threads") && i + 1 < argc && 1 == sscanf(argv[i + 1], "%u", &num_threads))
+		{
+			++i;
+			continue;
+		}
+
+		print_usage(argv[0]);
+		return EXIT_ERROR;
+	}
+
+	if (i + 2 != argc)
+	{
+		print_usage(argv[0]);
+		return EXIT_ERROR;
+	}
+
+	grab_t result;
+	grab_t reference;
+	grab_t mask;
+
+	const scoped_ptr< char, generic_free > result_buffer(load_grab(argv[i], result));
+
+	if (0 == result_buffer())
+		return EXIT_ERROR;
+
+	const scoped_ptr< char, generic_free > reference_buffer(load_grab(argv[i + 1], reference));
+
+	if (0 == reference_buffer())
+		return EXIT_ERROR;
+
+	// a change of dimensions is a regression of the app, not a failure of the comparison
+	if (result.w != reference.w || result.h != reference.h)
+	{
+		printf("dimensions %u x %u, reference %u x %u\n", result.w, result.h, reference.w, reference.h);
+		return EXIT_REGRESSION;
+	}
+
+	const scoped_ptr< char, generic_free > mask_buffer(0 != mask_filename ? load_grab(mask_filename, mask) : 0);
+
+	if (0 != mask_filename)
+	{
+		if (0 == mask_buffer())
+			return EXIT_ERROR;
+
+		if (mask.w != reference.w || mask.h != reference.h)
+		{
+			std::cerr << "mask of " << mask.w << " by " << mask.h << " pixels does not match the reference" << std::endl;
+			return EXIT_ERROR;
+		}
+	}
+
+	const scoped_ptr< uint8_t, generic_free > diff_image(0 != diff_filename
+		? reinterpret_cast< uint8_t* >(malloc(size_t(reference.w) * reference.h * 4 + 1))
+		: 0);
+
+	if (0 != diff_filename && 0 == diff_image())
+	{
+		std::cerr << "failure at allocating the diff image" << std::endl;
+		return EXIT_ERROR;
+	}
+
+	util::image_diff_t diff;
+
+	util::diff_RGBA(
+		result.pixels,
+		reference.pixels,
+		reference.w * 4,
+		reference.w,
+		reference.h,
+		tolerance,
+		0 != mask_filename ? mask.pixels : 0,
+		diff,
+		diff_image(),
+		diff_gain,
+		num_threads);
+
+	if (0 != diff_filename && !save_grab(diff_filename, reference.w, reference.h, diff_image()))
+		return EXIT_ERROR;
+
+	printf("max abs diff %u %u %u %u, ", diff.max_abs[0], diff.max_abs[1], diff.max_abs[2], diff.max_abs[3]);
+	print_psnr("psnr", diff.psnr_rgb);
+	print_psnr(" (r", diff.psnr[0]);
+	print_psnr(", g", diff.psnr[1]);
+	print_psnr(", b", diff.psnr[2]);
+	print_psnr(", a", diff.psnr[3]);
+	printf("), ssim %.5f, pixels over tolerance %llu of %llu\n",
+		diff.ssim, (unsigned long long) diff.num_over, (unsigned long long) reference.w * reference.h);
+
+	if (diff.num_over > max_failed ||
+		diff.psnr_rgb < min_psnr ||
+		diff.ssim < min_ssim)
+	{
+		return EXIT_REGRESSION;
+	}
+
+	return EXIT_PASS;
+}
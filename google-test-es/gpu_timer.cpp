@@ -0,0 +1,532 @@
+#if defined(PLATFORM_GLX)
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#else
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <iostream>
+
+#if defined(PLATFORM_GLX)
+#include "get_proc_address.hpp"
+#endif
+#include "gpu_timer.hpp"
+
+namespace gpu_timer
+{
+
+#if defined(PLATFORM_GLX)
+
+// GL_ARB_timer_query is core as of GL 3.3, under the same tokens sans suffix, and knows no disjoint events
+typedef PFNGLGENQUERIESPROC				pfn_gen_queries_t;
+typedef PFNGLDELETEQUERIESPROC			pfn_delete_queries_t;
+typedef PFNGLBEGINQUERYPROC				pfn_begin_query_t;
+typedef PFNGLENDQUERYPROC				pfn_end_query_t;
+typedef PFNGLGETQUERYOBJECTUIVPROC		pfn_get_query_objectuiv_t;
+typedef PFNGLGETQUERYOBJECTUI64VPROC	pfn_get_query_objectui64v_t;
+
+static const char ext_name_string[] = "GL_ARB_timer_query";
+
+static const char* const proc_name[] =
+{
+	"glGenQueries",
+	"glDeleteQueries",
+	"glBeginQuery",
+	"glEndQuery",
+	"glGetQueryObjectuiv",
+	"glGetQueryObjectui64v"
+};
+
+enum {
+	TIME_ELAPSED			= GL_TIME_ELAPSED,
+	QUERY_RESULT			= GL_QUERY_RESULT,
+	QUERY_RESULT_AVAILABLE	= GL_QUERY_RESULT_AVAILABLE
+};
+
+#else
+
+typedef PFNGLGENQUERIESEXTPROC			pfn_gen_queries_t;
+typedef PFNGLDELETEQUERIESEXTPROC		pfn_delete_queries_t;
+typedef PFNGLBEGINQUERYEXTPROC			pfn_begin_query_t;
+typedef PFNGLENDQUERYEXTPROC			pfn_end_query_t;
+typedef PFNGLGETQUERYOBJECTUIVEXTPROC	pfn_get_query_objectuiv_t;
+typedef PFNGLGETQUERYOBJECTUI64VEXTPROC	pfn_get_query_objectui64v_t;
+
+static const char ext_name_string[] = "GL_EXT_disjoint_timer_query";
+
+static const char* const proc_name[] =
+{
+	"glGenQueriesEXT",
+	"glDeleteQueriesEXT",
+	"glBeginQueryEXT",
+	"glEndQueryEXT",
+	"glGetQueryObjectuivEXT",
+	"glGetQueryObjectui64vEXT"
+};
+
+enum {
+	TIME_ELAPSED			= GL_TIME_ELAPSED_EXT,
+	QUERY_RESULT			= GL_QUERY_RESULT_EXT,
+	QUERY_RESULT_AVAILABLE	= GL_QUERY_RESULT_AVAILABLE_EXT
+};
+
+#endif
+
+static pfn_gen_queries_t			gglGenQueries;
+static pfn_delete_queries_t			gglDeleteQueries;
+static pfn_begin_query_t			gglBeginQuery;
+static pfn_end_query_t				gglEndQuery;
+static pfn_get_query_objectuiv_t	gglGetQueryObjectuiv;
+static pfn_get_query_objectui64v_t	gglGetQueryObjectui64v;
+
+// the queries of one frame, in issue order
+struct frame_t
+{
+	GLuint query[MAX_PASSES_PER_FRAME];
+	unsigned pass[MAX_PASSES_PER_FRAME];
+	unsigned count;
+	bool pending;
+	uint64_t t_begin;	// CPU time of the first pass, which no result of the frame can exceed
+};
+
+struct pass_t
+{
+	const char* name;
+	uint64_t* ring;
+	unsigned next;
+	uint64_t count;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+};
+
+static bool g_enabled;
+static frame_t g_frame[QUERY_FRAMES];
+static unsigned g_current;
+static bool g_in_pass;
+
+static pass_t g_pass[MAX_PASSES];
+static unsigned g_num_passes;
+
+static uint64_t g_num_collected;
+static uint64_t g_num_dropped;		// still pending when their slot came up for reuse
+static uint64_t g_num_discarded;	// spanning a disjoint event
+static uint64_t g_num_untimed;		// passes over MAX_PASSES_PER_FRAME or MAX_PASSES
+static uint64_t g_num_invalid;		// results longer than the frame could have taken, eg. the first on llvmpipe
+
+
+static uint64_t
+timer_nsec()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+
+// extension entry points need not be exported by the ES library, eg. under GLVND, so ES goes through EGL
+static void*
+get_proc(
+	const char* const proc_name)
+{
+#if defined(PLATFORM_GLX)
+
+	return getProcAddress(proc_name);
+
+#else
+
+	void* const proc = (void*) eglGetProcAddress(proc_name);
+
+	if (0 == proc)
+		std::cerr << "error: no entry point " << proc_name << std::endl;
+
+	return proc;
+
+#endif
+}
+
+
+static bool
+load_extension()
+{
+#if defined(PLATFORM_GLX)
+
+	GLint num_extensions;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+
+	GLuint i = 0;
+	for (; i != (GLuint) num_extensions; ++i)
+		if (0 == strcmp((const char*) glGetStringi(GL_EXTENSIONS, i), ext_name_string))
+			break;
+
+	if (i == (GLuint) num_extensions)
+		return false;
+
+#else
+
+	const GLubyte* extensions = glGetString(GL_EXTENSIONS);
+
+	if (0 == extensions || !strstr((const char*) extensions, ext_name_string))
+		return false;
+
+#endif
+
+	void* proc[sizeof(proc_name) / sizeof(proc_name[0])];
+
+	for (unsigned i = 0; i < sizeof(proc_name) / sizeof(proc_name[0]); ++i)
+		if (0 == (proc[i] = get_proc(proc_name[i])))
+			return false;
+
+	gglGenQueries			= (pfn_gen_queries_t) proc[0];
+	gglDeleteQueries		= (pfn_delete_queries_t) proc[1];
+	gglBeginQuery			= (pfn_begin_query_t) proc[2];
+	gglEndQuery				= (pfn_end_query_t) proc[3];
+	gglGetQueryObjectuiv	= (pfn_get_query_objectuiv_t) proc[4];
+	gglGetQueryObjectui64v	= (pfn_get_query_objectui64v_t) proc[5];
+
+	return true;
+}
+
+
+bool
+init()
+{
+	if (g_enabled)
+		return true;
+
+	if (!load_extension())
+	{
+		std::cerr << __FUNCTION__ << " found no " << ext_name_string << "; no GPU pass timing" << std::endl;
+		return false;
+	}
+
+#if !defined(PLATFORM_GLX)
+
+	// some implementations expose the extension sans a usable timer
+	const PFNGLGETQUERYIVEXTPROC gglGetQueryivEXT = (PFNGLGETQUERYIVEXTPROC) get_proc("glGetQueryivEXT");
+
+	GLint bits = 0;
+
+	if (0 != gglGetQueryivEXT)
+		gglGetQueryivEXT(GL_TIME_ELAPSED_EXT, GL_QUERY_COUNTER_BITS_EXT, &bits);
+
+	if (0 == bits)
+	{
+		std::cerr << __FUNCTION__ << " found a time-elapsed counter of no bits; no GPU pass timing" << std::endl;
+		return false;
+	}
+
+	// clear any disjoint state from before our time
+	GLint disjoint;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+#endif
+
+	for (unsigned i = 0; i < QUERY_FRAMES; ++i)
+	{
+		gglGenQueries(MAX_PASSES_PER_FRAME, g_frame[i].query);
+		g_frame[i].count = 0;
+		g_frame[i].pending = false;
+	}
+
+	if (GL_NO_ERROR != glGetError())
+	{
+		std::cerr << __FUNCTION__ << " failed to create the queries; no GPU pass timing" << std::endl;
+
+		for (unsigned i = 0; i < QUERY_FRAMES; ++i)
+			gglDeleteQueries(MAX_PASSES_PER_FRAME, g_frame[i].query);
+
+		return false;
+	}
+
+	g_current = 0;
+	g_in_pass = false;
+	g_num_passes = 0;
+	g_num_collected = 0;
+	g_num_dropped = 0;
+	g_num_discarded = 0;
+	g_num_untimed = 0;
+	g_num_invalid = 0;
+	g_enabled = true;
+
+	return true;
+}
+
+
+static unsigned
+pass_of(
+	const char* const name)
+{
+	for (unsigned i = 0; i < g_num_passes; ++i)
+		if (g_pass[i].name == name || !strcmp(g_pass[i].name, name))
+			return i;
+
+	if (MAX_PASSES == g_num_passes)
+		return -1U;
+
+	uint64_t* const ring = reinterpret_cast< uint64_t* >(malloc(sizeof(ring[0]) * SAMPLE_RING_CAPACITY));
+
+	if (0 == ring)
+	{
+		std::cerr << __FUNCTION__ << " failed to allocate the samples of pass '" << name << "'" << std::endl;
+		return -1U;
+	}
+
+	pass_t& pass = g_pass[g_num_passes];
+
+	pass.name = name;
+	pass.ring = ring;
+	pass.next = 0;
+	pass.count = 0;
+	pass.sum = 0;
+	pass.min = uint64_t(-1);
+	pass.max = 0;
+
+	return g_num_passes++;
+}
+
+
+void
+begin_pass(
+	const char* const name)
+{
+	if (!g_enabled || g_in_pass)
+		return;
+
+	frame_t& frame = g_frame[g_current];
+	const unsigned pass = MAX_PASSES_PER_FRAME != frame.count ? pass_of(name) : -1U;
+
+	if (-1U == pass)
+	{
+		++g_num_untimed;
+		return;
+	}
+
+	if (0 == frame.count)
+		frame.t_begin = timer_nsec();
+
+	frame.pass[frame.count] = pass;
+	gglBeginQuery(TIME_ELAPSED, frame.query[frame.count]);
+
+	g_in_pass = true;
+}
+
+
+void
+end_pass()
+{
+	if (!g_enabled || !g_in_pass)
+		return;
+
+	gglEndQuery(TIME_ELAPSED);
+
+	++g_frame[g_current].count;
+	g_in_pass = false;
+}
+
+
+// read the results of a frame if all are available; does not block
+static bool
+collect(
+	frame_t& frame)
+{
+	for (unsigned i = frame.count; i > 0; --i)
+	{
+		GLuint available = GL_FALSE;
+		gglGetQueryObjectuiv(frame.query[i - 1], QUERY_RESULT_AVAILABLE, &available);
+
+		if (GL_FALSE == available)
+			return false;
+	}
+
+	const uint64_t bound = timer_nsec() - frame.t_begin;
+
+	for (unsigned i = 0; i < frame.count; ++i)
+	{
+		GLuint64 elapsed = 0;
+		gglGetQueryObjectui64v(frame.query[i], QUERY_RESULT, &elapsed);
+
+		if (elapsed > bound)
+		{
+			++g_num_invalid;
+			continue;
+		}
+
+		pass_t& pass = g_pass[frame.pass[i]];
+
+		pass.ring[pass.next] = elapsed;
+		pass.next = pass.next + 1 == SAMPLE_RING_CAPACITY ? 0 : pass.next + 1;
+		pass.count += 1;
+		pass.sum += elapsed;
+		pass.min = std::min(pass.min, uint64_t(elapsed));
+		pass.max = std::max(pass.max, uint64_t(elapsed));
+	}
+
+	frame.pending = false;
+	++g_num_collected;
+
+	return true;
+}
+
+
+// collect the pending frames oldest first, up to the first one not yet available
+static void
+collect_pending()
+{
+#if !defined(PLATFORM_GLX)
+
+	// a disjoint event spoils the results of all queries in flight; reading the state also clears it
+	GLint disjoint = 0;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+	if (0 != disjoint)
+	{
+		for (unsigned i = 0; i < QUERY_FRAMES; ++i)
+			if (g_frame[i].pending)
+			{
+				g_frame[i].pending = false;
+				++g_num_discarded;
+			}
+
+		return;
+	}
+
+#endif
+
+	for (unsigned i = 0; i < QUERY_FRAMES; ++i)
+	{
+		frame_t& frame = g_frame[(g_current + i) % QUERY_FRAMES];
+
+		if (frame.pending && !collect(frame))
+			break;
+	}
+}
+
+
+void
+end_frame()
+{
+	if (!g_enabled)
+		return;
+
+	// an unbalanced pass ends with the frame
+	end_pass();
+
+	g_frame[g_current].pending = 0 != g_frame[g_current].count;
+	g_current = (g_current + 1) % QUERY_FRAMES;
+
+	collect_pending();
+
+	// the oldest frame has had all its time; the slot goes to the next frame regardless
+	frame_t& next = g_frame[g_current];
+
+	if (next.pending)
+	{
+		next.pending = false;
+		++g_num_dropped;
+	}
+
+	next.count = 0;
+}
+
+
+// nearest-rank percentile of sorted samples
+static uint64_t
+percentile(
+	const uint64_t* const sorted,
+	const unsigned count,
+	const double p)
+{
+	const unsigned rank = unsigned(ceil(p * count));
+
+	return sorted[0 == rank ? 0 : rank - 1];
+}
+
+
+void
+report()
+{
+	if (!g_enabled)
+		return;
+
+	end_pass();
+
+	g_frame[g_current].pending = 0 != g_frame[g_current].count;
+	g_current = (g_current + 1) % QUERY_FRAMES;
+
+	collect_pending();
+
+	for (unsigned i = 0; i < QUERY_FRAMES; ++i)
+	{
+		if (g_frame[i].pending)
+			++g_num_dropped;
+
+		gglDeleteQueries(MAX_PASSES_PER_FRAME, g_frame[i].query);
+	}
+
+	std::cout << "gpu pass timing: frames collected " << g_num_collected <<
+		", dropped as late " << g_num_dropped <<
+		", discarded as disjoint " << g_num_discarded;
+
+	if (0 != g_num_untimed)
+		std::cout << ", passes untimed for exceeding the limits " << g_num_untimed;
+
+	if (0 != g_num_invalid)
+		std::cout << ", results discarded as invalid " << g_num_invalid;
+
+	std::cout << std::endl;
+
+	for (unsigned i = 0; i < g_num_passes; ++i)
+	{
+		pass_t& pass = g_pass[i];
+
+		if (0 == pass.count)
+		{
+			std::cout << "gpu pass '" << pass.name << "': no results" << std::endl;
+			free(pass.ring);
+			continue;
+		}
+
+		// ring order is irrelevant to the percentiles, so it gets sorted in place
+		const unsigned count = unsigned(std::min(pass.count, uint64_t(SAMPLE_RING_CAPACITY)));
+		std::sort(pass.ring, pass.ring + count);
+
+		char line[256];
+		snprintf(line, sizeof(line), "gpu pass '%s' ms: mean %.3f, min %.3f, p50 %.3f, p99 %.3f, max %.3f over %llu frames",
+			pass.name,
+			double(pass.sum) * 1e-6 / pass.count,
+			double(pass.min) * 1e-6,
+			double(percentile(pass.ring, count, .5)) * 1e-6,
+			double(percentile(pass.ring, count, .99)) * 1e-6,
+			double(pass.max) * 1e-6,
+			(unsigned long long) pass.count);
+
+		std::cout << line;
+
+		if (count < pass.count)
+			std::cout << " (percentiles of the last " << count << ")";
+
+		std::cout << std::endl;
+
+		free(pass.ring);
+	}
+
+	g_num_passes = 0;
+	g_enabled = false;
+}
+
+} // namespace gpu_timer
@@ -0,0 +1,57 @@
+#ifndef gpu_timer_H__
+#define gpu_timer_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// per-pass GPU timing via GL_EXT_disjoint_timer_query (GL_ARB_timer_query on desktop GL): apps bracket
+// their render passes by begin_pass()/end_pass(), each of which becomes a time-elapsed query; the queries
+// of a frame are read back only once available, up to QUERY_FRAMES frames later, so the CPU never waits
+// on them; frames whose queries are still pending when their slot is due for reuse are dropped, and
+// frames spanning a disjoint event are discarded; all calls are no-ops unless init() succeeded
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace gpu_timer
+{
+
+enum {
+	MAX_PASSES				= 16,		// distinct pass names
+	MAX_PASSES_PER_FRAME	= 32,		// timed passes per frame; excess passes go untimed
+	QUERY_FRAMES			= 4,		// frames of queries in flight
+	SAMPLE_RING_CAPACITY	= 1 << 12	// most recent samples per pass kept for the percentiles
+};
+
+// init()	: load the extension and allocate the queries; to be called with the context current, before
+// the main loop
+// returns
+//		bool			: success; on failure pass timing stays off
+
+bool
+init();
+
+// begin_pass()	: start timing a pass; passes do not nest
+//		- name,			const char*		: name of the pass, of static storage; passes of the same name are
+//									  accumulated together,											input
+
+void
+begin_pass(
+	const char* const name);
+
+// end_pass()	: stop timing the current pass
+
+void
+end_pass();
+
+// end_frame()	: to be called once per frame, at its end, ie. after the swap or flush; collects the results
+// of prior frames which are available by now
+
+void
+end_frame();
+
+// report()	: collect the remaining results, print the per-pass GPU times and release the queries; to be
+// called with the context current, after the GPU went idle, eg. after glFinish
+
+void
+report();
+
+} // namespace gpu_timer
+
+#endif // gpu_timer_H__
@@ -1,8 +1,13 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+
+#if defined(PLATFORM_HEADLESS)
+#include <EGL/eglext.h>
+#else
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#endif
 
 #include <unistd.h>
 #include <stdio.h>
@@ -15,11 +20,15 @@
 #include <sstream>
 #include <iomanip>
 
-#ifdef USE_XRANDR
+#if defined(USE_XRANDR) && !defined(PLATFORM_HEADLESS)
 #include "xrandr_util.hpp"
 #endif
 
 #include "amd_perf_monitor.hpp"
+#include "frame_capture.hpp"
+#include "frame_stats.hpp"
+#include "gpu_timer.hpp"
+#include "frame_pacer.hpp"
 #include "get_file_size.hpp"
 #include "testbed.hpp"
 
@@ -62,14 +71,25 @@ static const char arg_config_id[]		= "config_id";
 static const char arg_fsaa[]			= "fsaa";
 static const char arg_skip[]			= "skip_frames";
 static const char arg_grab[]			= "grab_frame";
+static const char arg_grab_frames[]		= "grab_frames";
+static const char arg_grab_ring[]		= "grab_ring";
+static const char arg_grab_video[]		= "grab_video";
 static const char arg_drawcalls[]		= "drawcalls";
 static const char arg_print_configs[]	= "print_egl_configs";
 static const char arg_print_perf[]		= "print_perf_counters";
+static const char arg_frame_times[]		= "frame_times";
+static const char arg_frame_ring[]		= "frame_ring";
+static const char arg_gpu_passes[]		= "gpu_passes";
+static const char arg_frames_in_flight[]	= "frames_in_flight";
+
+#if !defined(PLATFORM_HEADLESS)
 
 static Display* display;
 static Atom wm_protocols;
 static Atom wm_delete_window;
 
+#endif
+
 
 static uint64_t
 timer_nsec()
@@ -87,7 +107,9 @@ timer_nsec()
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-// EGL helper
+// EGL helper; under PLATFORM_HEADLESS the render target is a pbuffer of the screen geometry, on the
+// surfaceless platform where available, so no window system is needed; unlike an offscreen FBO, the
+// pbuffer keeps framebuffer 0 valid for apps which return to it from their own FBOs
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 struct EGL
@@ -103,15 +125,21 @@ struct EGL
 	{}
 
 	bool initGLES2(
+#if defined(PLATFORM_HEADLESS)
+		const unsigned surface_w,
+		const unsigned surface_h,
+#else
 		Display* xdisplay,
 		const Window& window,
+#endif
 		const unsigned config_id,
 		const unsigned fsaa,
 		const unsigned nbits_r,
 		const unsigned nbits_g,
 		const unsigned nbits_b,
 		const unsigned nbits_a,
-		const bool print_configs);
+		const bool print_configs,
+		const bool depth);
 
 	void deinit();
 	void swapBuffers() const;
@@ -305,7 +333,11 @@ string_from_EGL_attrib(
 uintptr_t
 testbed::util::getNativeWindowSystem()
 {
+#if defined(PLATFORM_HEADLESS)
+	return 0;
+#else
 	return uintptr_t(display);
+#endif
 }
 
 namespace testbed
@@ -325,22 +357,68 @@ public:
 
 } // namespace testbed
 
+#if defined(PLATFORM_HEADLESS)
+
+static EGLDisplay
+getHeadlessDisplay()
+{
+#if defined(EGL_MESA_platform_surfaceless)
+
+	// client extensions are queried of no display; EGL versions sans client extensions fail the query
+	const char* str_client_exten = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+	if (0 == str_client_exten)
+		eglGetError();
+
+	if (0 != str_client_exten &&
+		strstr(str_client_exten, "EGL_MESA_platform_surfaceless") &&
+		strstr(str_client_exten, "EGL_EXT_platform_base"))
+	{
+		const PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+		if (0 != getPlatformDisplay)
+		{
+			const EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+
+			if (EGL_NO_DISPLAY != display)
+			{
+				std::cout << "using EGL surfaceless platform" << std::endl;
+				return display;
+			}
+		}
+	}
+
+#endif
+
+	std::cout << "using EGL default display" << std::endl;
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+#endif // PLATFORM_HEADLESS
+
 bool EGL::initGLES2(
+#if defined(PLATFORM_HEADLESS)
+	const unsigned surface_w,
+	const unsigned surface_h,
+#else
 	Display* xdisplay,
 	const Window& window,
+#endif
 	const unsigned config_id,
 	const unsigned fsaa,
 	const unsigned nbits_r,
 	const unsigned nbits_g,
 	const unsigned nbits_b,
 	const unsigned nbits_a,
-	const bool print_configs)
+	const bool print_configs,
+	const bool depth)
 {
 	const unsigned nbits_pixel =
-		nbits_r +
+		(nbits_r +
 		nbits_g +
 		nbits_b +
-		nbits_a + 7 & ~7;
+		nbits_a + 7) & ~7;
 
 	if (0 == config_id && 0 == nbits_pixel)
 	{
@@ -350,7 +428,11 @@ bool EGL::initGLES2(
 
 	deinit();
 
+#if defined(PLATFORM_HEADLESS)
+	display = getHeadlessDisplay();
+#else
 	display = eglGetDisplay(xdisplay /*EGL_DEFAULT_DISPLAY*/);
+#endif
 
 	testbed::scoped_ptr< EGL, testbed::scoped_functor > deinit_self(this);
 
@@ -456,11 +538,15 @@ bool EGL::initGLES2(
 		attr[na++] = EGL_ALPHA_SIZE;
 		attr[na++] = EGLint(nbits_a);
 		attr[na++] = EGL_SURFACE_TYPE;
+#if defined(PLATFORM_HEADLESS)
+		attr[na++] = EGL_PBUFFER_BIT;
+#else
 		attr[na++] = EGL_WINDOW_BIT;
+#endif
 		attr[na++] = EGL_RENDERABLE_TYPE;
 		attr[na++] = EGL_OPENGL_ES2_BIT;
 
-		if (testbed::hook::requires_depth())
+		if (depth)
 		{
 			attr[na++] = EGL_DEPTH_SIZE;
 			attr[na++] = 16;
@@ -561,6 +647,25 @@ bool EGL::initGLES2(
 		return false;
 	}
 
+#if defined(PLATFORM_HEADLESS)
+
+	const EGLint surface_attr[] =
+	{
+		EGL_WIDTH, EGLint(surface_w),
+		EGL_HEIGHT, EGLint(surface_h),
+		EGL_NONE
+	};
+
+	surface = eglCreatePbufferSurface(display, config[best_match], surface_attr);
+
+	if (EGL_NO_SURFACE == surface)
+	{
+		std::cerr << "eglCreatePbufferSurface() failed" << std::endl;
+		return false;
+	}
+
+#else
+
 	surface = eglCreateWindowSurface(display, config[best_match], window, 0);
 
 	if (EGL_NO_SURFACE == surface)
@@ -575,6 +680,8 @@ bool EGL::initGLES2(
 		return false;
 	}
 
+#endif
+
 	if (EGL_FALSE == eglMakeCurrent(display, surface, surface, context))
 	{
 		std::cerr << "eglMakeCurrent() failed" << std::endl;
@@ -614,7 +721,12 @@ void EGL::deinit()
 
 void EGL::swapBuffers() const
 {
+#if defined(PLATFORM_HEADLESS)
+	// a pbuffer has nothing to post, so the swap amounts to submitting the frame
+	glFlush();
+#else
 	eglSwapBuffers(display, surface);
+#endif
 }
 
 
@@ -722,8 +834,8 @@ reportGLCaps()
 }
 
 
-static bool
-setupShaderFromString(
+bool
+testbed::util::setupShaderFromString(
 	const GLuint shader_name,
 	const char* const source,
 	const size_t length)
@@ -995,6 +1107,8 @@ validate_bitness(
 }
 
 
+#if !defined(PLATFORM_HEADLESS)
+
 static bool
 processEvents(
 	Display* display,
@@ -1016,6 +1130,8 @@ processEvents(
 	return true;
 }
 
+#endif // PLATFORM_HEADLESS
+
 
 static inline unsigned
 bitcount(
@@ -1037,11 +1153,21 @@ int main(
 	int argc,
 	char** argv)
 {
+	const uint64_t t_launch = timer_nsec();
+
 	unsigned fsaa = 0;
 	unsigned frames = -1U;
 	unsigned skip_frames = 0;
 	unsigned grab_frame = -1U;
 	char grab_filename[FILENAME_MAX + 1] = { 0 };
+	unsigned grab_range[3] = { 0 };
+	char grab_prefix[FILENAME_MAX + 1] = { 0 };
+	unsigned grab_ring = frame_capture::DEFAULT_RING_DEPTH;
+	unsigned grab_video[2] = { 0, frame_capture::DEFAULT_FPS };
+	char grab_video_filename[FILENAME_MAX + 1] = { 0 };
+	char frame_times_filename[FILENAME_MAX + 1] = { 0 };
+	unsigned frame_ring = 0;
+	unsigned frames_in_flight = 0;
 	unsigned w = 512, h = 512;
 	unsigned bitness[4] = { 0 };
 	unsigned config_id = 0;
@@ -1050,6 +1176,7 @@ int main(
 	bool cli_err = false;
 	bool print_configs = false;
 	bool print_perf_counters = false;
+	bool gpu_passes = false;
 
 	const unsigned prefix_len = strlen(testbed::arg_prefix);
 
@@ -1119,8 +1246,45 @@ int main(
 
 		if (!strcmp(argv[i] + prefix_len, arg_grab))
 		{
-			if (!(++i < argc) || !sscanf(argv[i], "%u %" XQUOTE(FILENAME_MAX) "s", &grab_frame, grab_filename))
+			if (!(++i < argc) || 1 > sscanf(argv[i], "%u %" XQUOTE(FILENAME_MAX) "s", &grab_frame, grab_filename))
+				cli_err = true;
+
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_grab_frames))
+		{
+			if (!(++i < argc) || 3 > sscanf(argv[i], "%u %u %u %" XQUOTE(FILENAME_MAX) "s",
+					&grab_range[0], &grab_range[1], &grab_range[2], grab_prefix) ||
+				grab_range[0] > grab_range[1] || 0 == grab_range[2])
+			{
+				cli_err = true;
+			}
+
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_grab_video))
+		{
+			grab_video[0] = 1;
+
+			if (!(++i < argc) || 1 > sscanf(argv[i], "%" XQUOTE(FILENAME_MAX) "s %u %u",
+					grab_video_filename, &grab_video[0], &grab_video[1]) ||
+				0 == grab_video[0] || 0 == grab_video[1])
+			{
+				cli_err = true;
+			}
+
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_grab_ring))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%u", &grab_ring)) ||
+				0 == grab_ring || frame_capture::MAX_RING_DEPTH < grab_ring)
+			{
 				cli_err = true;
+			}
 
 			continue;
 		}
@@ -1145,9 +1309,49 @@ int main(
 			continue;
 		}
 
+		if (!strcmp(argv[i] + prefix_len, arg_frame_times))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%" XQUOTE(FILENAME_MAX) "s", frame_times_filename)))
+				cli_err = true;
+
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_frame_ring))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%u", &frame_ring)) ||
+				0 == frame_ring || frame_stats::MAX_RING_CAPACITY < frame_ring)
+			{
+				cli_err = true;
+			}
+
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_gpu_passes))
+		{
+			gpu_passes = true;
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_frames_in_flight))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%u", &frames_in_flight)) ||
+				0 == frames_in_flight || frame_pacer::MAX_FRAMES_IN_FLIGHT < frames_in_flight)
+			{
+				cli_err = true;
+			}
+
+			continue;
+		}
+
 		cli_err = true;
 	}
 
+	// a single capture at a time
+	if (0 != grab_range[2] && 0 != grab_video[0])
+		cli_err = true;
+
 	if (cli_err)
 	{
 		std::cerr << "usage: " << argv[0] << " [<option> ...]\n"
@@ -1155,9 +1359,17 @@ int main(
 			"\t" << testbed::arg_prefix << arg_nframes <<
 			" <unsigned_integer>\t\t: set number of frames to run; default is max unsigned int\n"
 			"\t" << testbed::arg_prefix << arg_screen <<
+#if defined(PLATFORM_HEADLESS)
+			" <width> <height> <Hz>\t\t: set offscreen surface of specified geometry; refresh is ignored\n"
+#else
 			" <width> <height> <Hz>\t\t: set fullscreen output of specified geometry and refresh\n"
+#endif
 			"\t" << testbed::arg_prefix << arg_bitness <<
+#if defined(PLATFORM_HEADLESS)
+			" <r> <g> <b> <a>\t\t: set EGL config of specified RGBA bitness; default is 8 8 8 8\n"
+#else
 			" <r> <g> <b> <a>\t\t: set EGL config of specified RGBA bitness; default is screen's bitness\n"
+#endif
 			"\t" << testbed::arg_prefix << arg_config_id <<
 			" <positive_integer>\t\t: set EGL config of specified ID; overrides any other config options\n"
 			"\t" << testbed::arg_prefix << arg_fsaa <<
@@ -1166,12 +1378,32 @@ int main(
 			" <unsigned_integer>\t\t: display every (2^N)th frame, draw the rest to completion via glFinish\n"
 			"\t" << testbed::arg_prefix << arg_grab <<
 			" <unsigned_integer> [<file>]\t: grab the Nth frame to file; index is zero-based\n"
+			"\t" << testbed::arg_prefix << arg_grab_frames <<
+			" <first> <last> <step> [<prefix>]\t: grab every step-th frame of [first, last] to files <prefix>NNNNNN.raw, "
+			"off the render thread\n"
+			"\t" << testbed::arg_prefix << arg_grab_ring <<
+			" <positive_integer>\t\t: set depth of the pixel-pack ring of " << arg_grab_frames << "; default is " <<
+			unsigned(frame_capture::DEFAULT_RING_DEPTH) << ", max is " << unsigned(frame_capture::MAX_RING_DEPTH) << "\n"
+			"\t" << testbed::arg_prefix << arg_grab_video <<
+			" <file> [<step> [<fps>]]\t: stream every step-th frame to a y4m file of the specified frame rate, "
+			"dropping frames the disk cannot keep up with; default fps is " << unsigned(frame_capture::DEFAULT_FPS) <<
+			"; exclusive with " << arg_grab_frames << "\n"
 			"\t" << testbed::arg_prefix << arg_drawcalls <<
 			" <positive_integer>\t\t: set number of drawcalls per frame; may be ignored by apps\n"
 			"\t" << testbed::arg_prefix << arg_print_configs <<
 			"\t\t\t: print available EGL configs\n"
 			"\t" << testbed::arg_prefix << arg_print_perf <<
 			"\t\t\t: print available GPU performance monitor groups and counters\n"
+			"\t" << testbed::arg_prefix << arg_frame_times <<
+			" <file>\t\t\t: write the time of each frame to file, as JSON if of suffix .json, otherwise as CSV\n"
+			"\t" << testbed::arg_prefix << arg_frame_ring <<
+			" <positive_integer>\t\t: set number of most recent frames kept for frame-time stats; default is " <<
+			unsigned(frame_stats::DEFAULT_RING_CAPACITY) << ", max is " << unsigned(frame_stats::MAX_RING_CAPACITY) << "\n"
+			"\t" << testbed::arg_prefix << arg_gpu_passes <<
+			"\t\t\t\t: time the render passes marked by the app on the GPU, via timer queries\n"
+			"\t" << testbed::arg_prefix << arg_frames_in_flight <<
+			" <positive_integer>\t\t: fence each frame and keep at most N frames queued ahead of the GPU; max is " <<
+			unsigned(frame_pacer::MAX_FRAMES_IN_FLIGHT) << "; default is no pacing\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app <<
 			" <option> [<arguments>]\t\t: app-specific option" << std::endl;
 
@@ -1183,6 +1415,20 @@ int main(
 	if (drawcalls && !testbed::hook::set_num_drawcalls(drawcalls))
 		std::cerr << "drawcalls argument ignored by app" << std::endl;
 
+#if defined(PLATFORM_HEADLESS)
+
+	if (0 == config_id && 0 == bitness[0])
+	{
+		bitness[0] = 8;
+		bitness[1] = 8;
+		bitness[2] = 8;
+		bitness[3] = 8;
+
+		std::cout << "Using default RGBA bitness: 8 8 8 8" << std::endl;
+	}
+
+#else
+
 	display = XOpenDisplay(NULL);
 
 	if (!display)
@@ -1248,30 +1494,70 @@ int main(
 	XMapWindow(display, window);
 	XFlush(display);
 
+#endif // PLATFORM_HEADLESS
+
 	int exit_code = 0;
 	EGL egl;
 
 	if (egl.initGLES2(
+#if defined(PLATFORM_HEADLESS)
+			w,
+			h,
+#else
 			display,
 			window,
+#endif
 			config_id,
 			fsaa,
 			bitness[0],
 			bitness[1],
 			bitness[2],
 			bitness[3],
-			print_configs) &&
+			print_configs,
+			testbed::hook::requires_depth(argc, argv)) &&
 		reportGLCaps() &&
 		testbed::hook::init_resources(argc, argv))
 	{
 		amd_perf_monitor::load_extension();
 		amd_perf_monitor::peek_performance_monitor(print_perf_counters);
 
+		if (0 != grab_range[2] &&
+			!frame_capture::init(frame_capture::FORMAT_RAW,
+				w, h, grab_range[0], grab_range[1], grab_range[2], grab_ring, grab_prefix))
+		{
+			std::cerr << "failed to start frame capture; carrying on without it" << std::endl;
+		}
+
+		if (0 != grab_video[0] &&
+			!frame_capture::init(frame_capture::FORMAT_Y4M,
+				w, h, 0, -1U, grab_video[0], grab_ring, grab_video_filename, grab_video[1]))
+		{
+			std::cerr << "failed to start video capture; carrying on without it" << std::endl;
+		}
+
+		if (0 == frame_ring)
+			frame_ring = frames < unsigned(frame_stats::DEFAULT_RING_CAPACITY) && 0 != frames ?
+				frames : unsigned(frame_stats::DEFAULT_RING_CAPACITY);
+
+		if (!frame_stats::init(frame_ring, timer_nsec()))
+			std::cerr << "failed to start frame timing; carrying on without it" << std::endl;
+
+		if (gpu_passes && !gpu_timer::init())
+			std::cerr << "failed to start GPU pass timing; carrying on without it" << std::endl;
+
+		if (0 != frames_in_flight && !frame_pacer::init(frames_in_flight))
+			std::cerr << "failed to start frame pacing; carrying on without it" << std::endl;
+
 		unsigned nframes = 0;
+		uint64_t t_first = 0;
 		const uint64_t t0 = timer_nsec();
 
+#if defined(PLATFORM_HEADLESS)
+		while (nframes < frames)
+#else
 		while (processEvents(display, window) &&
 			nframes < frames)
+#endif
 		{
 			if (!testbed::hook::render_frame())
 			{
@@ -1283,11 +1569,22 @@ int main(
 			if (nframes == grab_frame)
 				saveFramebuffer(w, h, grab_filename);
 
+			frame_capture::capture_frame(nframes);
+
 			if (nframes & skip_frames)
 				glFlush();
 			else
 				egl.swapBuffers();
 
+			frame_pacer::end_frame();
+
+			const uint64_t t_frame = timer_nsec();
+			frame_stats::record_frame(t_frame);
+			gpu_timer::end_frame();
+
+			if (0 == nframes)
+				t_first = t_frame;
+
 			++nframes;
 		}
 
@@ -1306,6 +1603,16 @@ int main(
 				"\naverage FPS: " << (double(nframes) / sec) << std::endl;
 		}
 
+		if (nframes)
+			std::cout << "time to first frame: " << (double(t_first - t_launch) * 1e-9) << " s" << std::endl;
+
+		frame_stats::report(0 != frame_times_filename[0] ? frame_times_filename : 0);
+		gpu_timer::report();
+		frame_pacer::report();
+
+		// flush and report any capture past the timing, as that includes waiting on the writer
+		frame_capture::deinit();
+
 		amd_perf_monitor::depeek_performance_monitor();
 
 		testbed::hook::deinit_resources();
@@ -1318,8 +1625,10 @@ int main(
 
 	egl.deinit();
 
+#if !defined(PLATFORM_HEADLESS)
 	XDestroyWindow(display, window);
 	XCloseDisplay(display);
+#endif
 
 	return exit_code;
 }
@@ -15,6 +15,10 @@
 #include <sstream>
 #include <iomanip>
 
+#include "frame_capture.hpp"
+#include "frame_stats.hpp"
+#include "gpu_timer.hpp"
+#include "frame_pacer.hpp"
 #include "get_file_size.hpp"
 #include "testbed.hpp"
 
@@ -57,9 +61,16 @@ static const char arg_config_id[]		= "config_id";
 static const char arg_fsaa[]			= "fsaa";
 static const char arg_skip[]			= "skip_frames";
 static const char arg_grab[]			= "grab_frame";
+static const char arg_grab_frames[]		= "grab_frames";
+static const char arg_grab_ring[]		= "grab_ring";
+static const char arg_grab_video[]		= "grab_video";
 static const char arg_drawcalls[]		= "drawcalls";
 static const char arg_print_configs[]	= "print_egl_configs";
 static const char arg_print_perf[]		= "print_perf_counters";
+static const char arg_frame_times[]		= "frame_times";
+static const char arg_frame_ring[]		= "frame_ring";
+static const char arg_gpu_passes[]		= "gpu_passes";
+static const char arg_frames_in_flight[]	= "frames_in_flight";
 
 
 static uint64_t
@@ -104,7 +115,8 @@ struct EGL
 		const unsigned nbits_g,
 		const unsigned nbits_b,
 		const unsigned nbits_a,
-		const bool print_configs);
+		const bool print_configs,
+		const bool depth);
 
 	void deinit();
 	void swapBuffers() const;
@@ -318,7 +330,8 @@ bool EGL::initGLES2(
 	const unsigned nbits_g,
 	const unsigned nbits_b,
 	const unsigned nbits_a,
-	const bool print_configs)
+	const bool print_configs,
+	const bool depth)
 {
 	const unsigned nbits_pixel =
 		nbits_r +
@@ -444,7 +457,7 @@ bool EGL::initGLES2(
 		attr[na++] = EGL_RENDERABLE_TYPE;
 		attr[na++] = EGL_OPENGL_ES2_BIT;
 
-		if (testbed::hook::requires_depth())
+		if (depth)
 		{
 			attr[na++] = EGL_DEPTH_SIZE;
 			attr[na++] = 16;
@@ -750,8 +763,8 @@ reportGLCaps()
 }
 
 
-static bool
-setupShaderFromString(
+bool
+testbed::util::setupShaderFromString(
 	const GLuint shader_name,
 	const char* const source,
 	const size_t length)
@@ -1043,11 +1056,21 @@ int main(
 	int argc,
 	char** argv)
 {
+	const uint64_t t_launch = timer_nsec();
+
 	unsigned fsaa = 0;
 	unsigned frames = -1U;
 	unsigned skip_frames = 0;
 	unsigned grab_frame = -1U;
 	char grab_filename[FILENAME_MAX + 1] = { 0 };
+	unsigned grab_range[3] = { 0 };
+	char grab_prefix[FILENAME_MAX + 1] = { 0 };
+	unsigned grab_ring = frame_capture::DEFAULT_RING_DEPTH;
+	unsigned grab_video[2] = { 0, frame_capture::DEFAULT_FPS };
+	char grab_video_filename[FILENAME_MAX + 1] = { 0 };
+	char frame_times_filename[FILENAME_MAX + 1] = { 0 };
+	unsigned frame_ring = 0;
+	unsigned frames_in_flight = 0;
 	unsigned w = 512, h = 512;
 	unsigned bitness[4] = { 0 };
 	unsigned config_id = 0;
@@ -1056,6 +1079,7 @@ int main(
 	bool cli_err = false;
 	bool print_configs = false;
 	bool print_perf_counters = false;
+	bool gpu_passes = false;
 
 	const unsigned prefix_len = strlen(testbed::arg_prefix);
 
@@ -1125,12 +1149,49 @@ int main(
 
 		if (!strcmp(argv[i] + prefix_len, arg_grab))
 		{
-			if (!(++i < argc) || !sscanf(argv[i], "%u %" XQUOTE(FILENAME_MAX) "s", &grab_frame, grab_filename))
+			if (!(++i < argc) || 1 > sscanf(argv[i], "%u %" XQUOTE(FILENAME_MAX) "s", &grab_frame, grab_filename))
 				cli_err = true;
 
 			continue;
 		}
 
+		if (!strcmp(argv[i] + prefix_len, arg_grab_frames))
+		{
+			if (!(++i < argc) || 3 > sscanf(argv[i], "%u %u %u %" XQUOTE(FILENAME_MAX) "s",
+					&grab_range[0], &grab_range[1], &grab_range[2], grab_prefix) ||
+				grab_range[0] > grab_range[1] || 0 == grab_range[2])
+			{
+				cli_err = true;
+			}
+
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_grab_video))
+		{
+			grab_video[0] = 1;
+
+			if (!(++i < argc) || 1 > sscanf(argv[i], "%" XQUOTE(FILENAME_MAX) "s %u %u",
+					grab_video_filename, &grab_video[0], &grab_video[1]) ||
+				0 == grab_video[0] || 0 == grab_video[1])
+			{
+				cli_err = true;
+			}
+
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_grab_ring))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%u", &grab_ring)) ||
+				0 == grab_ring || frame_capture::MAX_RING_DEPTH < grab_ring)
+			{
+				cli_err = true;
+			}
+
+			continue;
+		}
+
 		if (!strcmp(argv[i] + prefix_len, arg_drawcalls))
 		{
 			if (!(++i < argc) || (1 != sscanf(argv[i], "%u", &drawcalls)) || !drawcalls)
@@ -1151,9 +1212,49 @@ int main(
 			continue;
 		}
 
+		if (!strcmp(argv[i] + prefix_len, arg_frame_times))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%" XQUOTE(FILENAME_MAX) "s", frame_times_filename)))
+				cli_err = true;
+
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_frame_ring))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%u", &frame_ring)) ||
+				0 == frame_ring || frame_stats::MAX_RING_CAPACITY < frame_ring)
+			{
+				cli_err = true;
+			}
+
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_gpu_passes))
+		{
+			gpu_passes = true;
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_frames_in_flight))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%u", &frames_in_flight)) ||
+				0 == frames_in_flight || frame_pacer::MAX_FRAMES_IN_FLIGHT < frames_in_flight)
+			{
+				cli_err = true;
+			}
+
+			continue;
+		}
+
 		cli_err = true;
 	}
 
+	// a single capture at a time
+	if (0 != grab_range[2] && 0 != grab_video[0])
+		cli_err = true;
+
 	if (cli_err)
 	{
 		std::cerr << "usage: " << argv[0] << " [<option> ...]\n"
@@ -1172,12 +1273,32 @@ int main(
 			" <unsigned_integer>\t\t: display every (2^N)th frame, draw the rest to completion via glFinish\n"
 			"\t" << testbed::arg_prefix << arg_grab <<
 			" <unsigned_integer> [<file>]\t: grab the Nth frame to file; index is zero-based\n"
+			"\t" << testbed::arg_prefix << arg_grab_frames <<
+			" <first> <last> <step> [<prefix>]\t: grab every step-th frame of [first, last] to files <prefix>NNNNNN.raw, "
+			"off the render thread\n"
+			"\t" << testbed::arg_prefix << arg_grab_ring <<
+			" <positive_integer>\t\t: set depth of the pixel-pack ring of " << arg_grab_frames << "; default is " <<
+			unsigned(frame_capture::DEFAULT_RING_DEPTH) << ", max is " << unsigned(frame_capture::MAX_RING_DEPTH) << "\n"
+			"\t" << testbed::arg_prefix << arg_grab_video <<
+			" <file> [<step> [<fps>]]\t: stream every step-th frame to a y4m file of the specified frame rate, "
+			"dropping frames the disk cannot keep up with; default fps is " << unsigned(frame_capture::DEFAULT_FPS) <<
+			"; exclusive with " << arg_grab_frames << "\n"
 			"\t" << testbed::arg_prefix << arg_drawcalls <<
 			" <positive_integer>\t\t: set number of drawcalls per frame; may be ignored by apps\n"
 			"\t" << testbed::arg_prefix << arg_print_configs <<
 			"\t\t\t: print available EGL configs\n"
 			"\t" << testbed::arg_prefix << arg_print_perf <<
 			"\t\t\t: print available GPU performance monitor groups and counters\n"
+			"\t" << testbed::arg_prefix << arg_frame_times <<
+			" <file>\t\t\t: write the time of each frame to file, as JSON if of suffix .json, otherwise as CSV\n"
+			"\t" << testbed::arg_prefix << arg_frame_ring <<
+			" <positive_integer>\t\t: set number of most recent frames kept for frame-time stats; default is " <<
+			unsigned(frame_stats::DEFAULT_RING_CAPACITY) << ", max is " << unsigned(frame_stats::MAX_RING_CAPACITY) << "\n"
+			"\t" << testbed::arg_prefix << arg_gpu_passes <<
+			"\t\t\t\t: time the render passes marked by the app on the GPU, via timer queries\n"
+			"\t" << testbed::arg_prefix << arg_frames_in_flight <<
+			" <positive_integer>\t\t: fence each frame and keep at most N frames queued ahead of the GPU; max is " <<
+			unsigned(frame_pacer::MAX_FRAMES_IN_FLIGHT) << "; default is no pacing\n"
 			"\t" << testbed::arg_prefix << testbed::arg_app <<
 			" <option> [<arguments>]\t\t: app-specific option" << std::endl;
 
@@ -1207,11 +1328,40 @@ int main(
 			bitness[1],
 			bitness[2],
 			bitness[3],
-			print_configs) &&
+			print_configs,
+			testbed::hook::requires_depth(argc, argv)) &&
 		reportGLCaps() &&
 		testbed::hook::init_resources(argc, argv))
 	{
+		if (0 != grab_range[2] &&
+			!frame_capture::init(frame_capture::FORMAT_RAW,
+				w, h, grab_range[0], grab_range[1], grab_range[2], grab_ring, grab_prefix))
+		{
+			std::cerr << "failed to start frame capture; carrying on without it" << std::endl;
+		}
+
+		if (0 != grab_video[0] &&
+			!frame_capture::init(frame_capture::FORMAT_Y4M,
+				w, h, 0, -1U, grab_video[0], grab_ring, grab_video_filename, grab_video[1]))
+		{
+			std::cerr << "failed to start video capture; carrying on without it" << std::endl;
+		}
+
+		if (0 == frame_ring)
+			frame_ring = frames < unsigned(frame_stats::DEFAULT_RING_CAPACITY) && 0 != frames ?
+				frames : unsigned(frame_stats::DEFAULT_RING_CAPACITY);
+
+		if (!frame_stats::init(frame_ring, timer_nsec()))
+			std::cerr << "failed to start frame timing; carrying on without it" << std::endl;
+
+		if (gpu_passes && !gpu_timer::init())
+			std::cerr << "failed to start GPU pass timing; carrying on without it" << std::endl;
+
+		if (0 != frames_in_flight && !frame_pacer::init(frames_in_flight))
+			std::cerr << "failed to start frame pacing; carrying on without it" << std::endl;
+
 		unsigned nframes = 0;
+		uint64_t t_first = 0;
 		const uint64_t t0 = timer_nsec();
 
 		while (nframes < frames)
@@ -1226,11 +1376,22 @@ int main(
 			if (nframes == grab_frame)
 				saveFramebuffer(w, h, grab_filename);
 
+			frame_capture::capture_frame(nframes);
+
 			if (nframes & skip_frames)
 				glFlush();
 			else
 				egl.swapBuffers();
 
+			frame_pacer::end_frame();
+
+			const uint64_t t_frame = timer_nsec();
+			frame_stats::record_frame(t_frame);
+			gpu_timer::end_frame();
+
+			if (0 == nframes)
+				t_first = t_frame;
+
 			++nframes;
 		}
 
@@ -1249,6 +1410,16 @@ int main(
 				"\naverage FPS: " << (double(nframes) / sec) << std::endl;
 		}
 
+		if (nframes)
+			std::cout << "time to first frame: " << (double(t_first - t_launch) * 1e-9) << " s" << std::endl;
+
+		frame_stats::report(0 != frame_times_filename[0] ? frame_times_filename : 0);
+		gpu_timer::report();
+		frame_pacer::report();
+
+		// flush and report any capture past the timing, as that includes waiting on the writer
+		frame_capture::deinit();
+
 		testbed::hook::deinit_resources();
 	}
 	else
@@ -10,13 +10,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <math.h>
 #include <limits>
 #include <iostream>
 #include <iomanip>
 
 #include "testbed.hpp"
 #include "rendIndexedTrilist.hpp"
+#include "rendTangent.hpp"
 
 
 namespace testbed
@@ -138,20 +141,226 @@ const T& max(
 }
 
 
+// bit pattern of a vertex component for the purpose of welding; either the exact value, or the index
+// of the epsilon-sized grid cell the value falls in; positive and negative zeros are equivalent
+inline uint32_t
+weld_key(
+	const float value,
+	const float rcp_epsilon)
+{
+	if (0.f == rcp_epsilon)
+	{
+		if (0.f == value)
+			return 0;
+
+		union
+		{
+			float f;
+			uint32_t u;
+		} bits;
+
+		bits.f = value;
+		return bits.u;
+	}
+
+	return uint32_t(int32_t(floorf(value * rcp_epsilon)));
+}
+
+
+// vertices weld when bit-identical, or when none of their components differ by more than epsilon
+template < unsigned NUM_FLOATS_T >
+bool
+weld_equal(
+	const float (&a)[NUM_FLOATS_T],
+	const float (&b)[NUM_FLOATS_T],
+	const float epsilon)
+{
+	for (unsigned i = 0; i < NUM_FLOATS_T; ++i)
+		if (0.f == epsilon
+				? weld_key(a[i], 0.f) != weld_key(b[i], 0.f)
+				: fabsf(a[i] - b[i]) > epsilon)
+			return false;
+
+	return true;
+}
+
+
+inline uint32_t
+weld_hash(
+	const uint32_t* const key,
+	const unsigned num_keys)
+{
+	// FNV-1a over the component keys
+	uint32_t hash = 2166136261u;
+
+	for (unsigned i = 0; i < num_keys; ++i)
+		for (unsigned j = 0; j < sizeof(key[i]); ++j)
+		{
+			hash ^= (key[i] >> j * 8) & 0xff;
+			hash *= 16777619u;
+		}
+
+	return hash;
+}
+
+
+// merge vertices which are bit-identical, or which differ by no more than epsilon in any component; each
+// vertex merges into the first surviving one it matches, vertex order is otherwise preserved; returns number
+// of surviving vertices
+template <
+	unsigned NUM_FLOATS_T,
+	typename INDEX_T >
+unsigned
+weld_vertices(
+	float (* const vertex)[NUM_FLOATS_T],
+	const unsigned num_vertices,
+	INDEX_T* const index,
+	const size_t num_indices,
+	const float epsilon)
+{
+	const float rcp_epsilon = 0.f < epsilon ? 1.f / epsilon : 0.f;
+
+	// exact welds hash all components; epsilon welds hash the epsilon-sized grid cell of the position only,
+	// and also search the 26 cells around it, as positions within epsilon are at most a cell apart per axis
+	const unsigned num_keys = 0.f < epsilon ? 3 : NUM_FLOATS_T;
+	const unsigned num_cells = 0.f < epsilon ? 27 : 0;
+
+	// open-addressing hash table of surviving vertices, at most half full
+	unsigned capacity = 1;
+
+	while (capacity < num_vertices * 2)
+		capacity <<= 1;
+
+	std::vector< uint32_t > table(capacity, uint32_t(-1));
+	std::vector< uint32_t > remap(num_vertices);
+	unsigned num_welded = 0;
+
+	for (unsigned i = 0; i < num_vertices; ++i)
+	{
+		uint32_t key[NUM_FLOATS_T];
+
+		for (unsigned j = 0; j < num_keys; ++j)
+			key[j] = weld_key(vertex[i][j], rcp_epsilon);
+
+		// the vertex's own cell goes first, so an empty slot found there is where the vertex is inserted
+		unsigned slot = weld_hash(key, num_keys) & (capacity - 1);
+
+		while (uint32_t(-1) != table[slot] &&
+			!weld_equal(vertex[table[slot]], vertex[i], epsilon))
+		{
+			slot = (slot + 1) & (capacity - 1);
+		}
+
+		uint32_t match = table[slot];
+
+		for (unsigned c = 0; c < num_cells && uint32_t(-1) == match; ++c)
+		{
+			if (13 == c) // own cell, searched already
+				continue;
+
+			uint32_t cell[3] =
+			{
+				key[0] + c % 3 - 1,
+				key[1] + c / 3 % 3 - 1,
+				key[2] + c / 9 - 1
+			};
+
+			for (unsigned nslot = weld_hash(cell, 3) & (capacity - 1);
+				uint32_t(-1) != table[nslot];
+				nslot = (nslot + 1) & (capacity - 1))
+			{
+				if (weld_equal(vertex[table[nslot]], vertex[i], epsilon))
+				{
+					match = table[nslot];
+					break;
+				}
+			}
+		}
+
+		if (uint32_t(-1) != match)
+		{
+			remap[i] = match;
+			continue;
+		}
+
+		// surviving vertices move down in place; the table refers to their new positions
+		if (num_welded != i)
+			memcpy(vertex[num_welded], vertex[i], sizeof(vertex[i]));
+
+		table[slot] = num_welded;
+		remap[i] = num_welded++;
+	}
+
+	for (size_t i = 0; i < num_indices; ++i)
+		index[i] = INDEX_T(remap[index[i]]);
+
+	return num_welded;
+}
+
+
+// drop faces which refer to the same vertex more than once, as welding may leave them; face order is otherwise
+// preserved; returns number of surviving faces
+template <
+	unsigned NUM_INDICES_T,
+	typename INDEX_T >
+unsigned
+drop_degenerate_faces(
+	INDEX_T (* const face)[NUM_INDICES_T],
+	const unsigned num_faces)
+{
+	unsigned num_kept = 0;
+
+	for (unsigned i = 0; i < num_faces; ++i)
+	{
+		bool degenerate = false;
+
+		for (unsigned j = 0; j < NUM_INDICES_T && !degenerate; ++j)
+			for (unsigned k = j + 1; k < NUM_INDICES_T && !degenerate; ++k)
+				degenerate = face[i][j] == face[i][k];
+
+		if (degenerate)
+			continue;
+
+		if (num_kept != i)
+			memcpy(face[num_kept], face[i], sizeof(face[i]));
+
+		++num_kept;
+	}
+
+	return num_kept;
+}
+
+
 template <
 	unsigned NUM_FLOATS_T,		// floats per vertex
 	unsigned NUM_INDICES_T >	// indices per face
 bool
-fill_indexed_facelist_from_file(
+load_indexed_facelist_from_file(
 	const char* const filename,
-	const GLuint vbo_arr,
-	const GLuint vbo_idx,
-	unsigned& num_faces,
-	GLenum& index_type,
-	const bool is_rotated)
+	const bool is_rotated,
+	std::vector< rend::Meshlet >* const meshlets,
+	const unsigned meshlet_max_faces,
+	std::vector< rend::MeshLod >* const lods,
+	const float weld_epsilon,
+	const bool tangents,
+	const float* const uv_transform,
+	util::indexed_trilist_t& trilist)
 {
 	assert(filename);
 
+	// tangents and texcoord transforms require texcoords, ie. the PN2 layout
+	if (tangents && 8 != NUM_FLOATS_T)
+	{
+		std::cerr << __FUNCTION__ << " cannot build tangents for vertices void of texcoords" << std::endl;
+		return false;
+	}
+
+	if (0 != uv_transform && 8 != NUM_FLOATS_T)
+	{
+		std::cerr << __FUNCTION__ << " cannot transform texcoords of vertices void of texcoords" << std::endl;
+		return false;
+	}
+
 	scoped_ptr< FILE, scoped_functor > file(fopen(filename, "r"));
 
 	if (0 == file())
@@ -181,7 +390,7 @@ fill_indexed_facelist_from_file(
 	typedef uint32_t BigIndex;
 	typedef uint16_t CompactIndex;
 
-	index_type = GL_UNSIGNED_INT; // BigIndex GL mapping
+	GLenum index_type = GL_UNSIGNED_INT; // BigIndex GL mapping
 	const GLenum compact_index_type = GL_UNSIGNED_SHORT; // CompactIndex GL mapping
 
 	while (true)
@@ -299,6 +508,137 @@ fill_indexed_facelist_from_file(
 			vi[4] = vi[5];
 			vi[5] = vi_4;
 		}
+
+		// remap texcoords into the mesh's rect of a texture atlas
+		if (0 != uv_transform)
+		{
+			vi[6] = vi[6] * uv_transform[0] + uv_transform[2];
+			vi[7] = vi[7] * uv_transform[1] + uv_transform[3];
+		}
+	}
+
+	// weld duplicate vertices, within and across sub-meshes
+	const unsigned nv_read = nv_total;
+	const unsigned nf_read = nf_total;
+
+	nv_total = weld_vertices(
+		reinterpret_cast< float (*)[NUM_FLOATS_T] >(vb_total),
+		nv_total,
+		reinterpret_cast< BigIndex* >(ib_total),
+		size_t(nf_total) * NUM_INDICES_T,
+		weld_epsilon);
+
+	// faces collapsed by the weld would only cost the passes below, and the rasterizer
+	nf_total = drop_degenerate_faces(
+		reinterpret_cast< BigIndex (*)[NUM_INDICES_T] >(ib_total),
+		nf_total);
+
+	if (0 == nf_total)
+	{
+		std::cerr << __FUNCTION__ << " got no faces left after welding '" << filename << "'" << std::endl;
+		free(vb_total);
+		free(ib_total);
+		return false;
+	}
+
+	// cluster faces into meshlets, if requested; faces get reordered along the way
+	if (0 != meshlets)
+	{
+		if (3 != NUM_INDICES_T ||
+			!rend::build_meshlets(
+				reinterpret_cast< const float* >(vb_total),
+				NUM_FLOATS_T,
+				reinterpret_cast< BigIndex* >(ib_total),
+				nf_total,
+				meshlet_max_faces,
+				*meshlets))
+		{
+			std::cerr << __FUNCTION__ << " failed building meshlets for '" << filename << "'" << std::endl;
+			meshlets->clear();
+		}
+	}
+
+	// append a chain of simplified LODs past the original faces, if requested
+	unsigned nf_lods = 0;
+
+	if (0 != lods)
+	{
+		std::vector< BigIndex > lod_index;
+
+		if (3 != NUM_INDICES_T ||
+			!rend::build_lod_chain(
+				reinterpret_cast< const float* >(vb_total),
+				NUM_FLOATS_T,
+				nv_total,
+				reinterpret_cast< const BigIndex* >(ib_total),
+				nf_total,
+				rend::MESH_LOD_MAX,
+				lod_index,
+				*lods))
+		{
+			std::cerr << __FUNCTION__ << " failed building LODs for '" << filename << "'" << std::endl;
+			lods->clear();
+		}
+		else
+		if (!lod_index.empty())
+		{
+			void* const ib = realloc(ib_total, sizeof(BigIndex) * (NUM_INDICES_T * nf_total + lod_index.size()));
+
+			if (0 == ib)
+			{
+				free(vb_total);
+				free(ib_total);
+				return false;
+			}
+
+			memcpy(reinterpret_cast< BigIndex* >(ib) + NUM_INDICES_T * nf_total,
+				&lod_index.front(), sizeof(BigIndex) * lod_index.size());
+
+			ib_total = ib;
+			nf_lods = unsigned(lod_index.size() / NUM_INDICES_T);
+		}
+	}
+
+	// expand vertices with tangent frames past their original attributes, if requested
+	unsigned num_floats = NUM_FLOATS_T;
+
+	if (tangents)
+	{
+		const unsigned num_floats_tangent = NUM_FLOATS_T + 4;
+		float* const vb = reinterpret_cast< float* >(malloc(sizeof(float) * num_floats_tangent * nv_total));
+
+		if (0 == vb)
+		{
+			free(vb_total);
+			free(ib_total);
+			return false;
+		}
+
+		for (unsigned i = 0; i < nv_total; ++i)
+			memcpy(vb + i * num_floats_tangent,
+				reinterpret_cast< const float* >(vb_total) + i * NUM_FLOATS_T, sizeof(float) * NUM_FLOATS_T);
+
+		free(vb_total);
+		vb_total = vb;
+		num_floats = num_floats_tangent;
+
+		if (3 != NUM_INDICES_T ||
+			!rend::build_tangents(
+				vb,
+				num_floats_tangent,
+				3,
+				6,
+				nv_total,
+				reinterpret_cast< const BigIndex* >(ib_total),
+				nf_total,
+				vb + NUM_FLOATS_T,
+				num_floats_tangent))
+		{
+			std::cerr << __FUNCTION__ << " failed building tangents for '" << filename << "'" << std::endl;
+			free(vb_total);
+			free(ib_total);
+			return false;
+		}
 	}
 
 	size_t sizeof_index = sizeof(BigIndex);
@@ -309,14 +649,14 @@ fill_indexed_facelist_from_file(
 	{
 		sizeof_index = sizeof(CompactIndex);
 
-		const size_t sizeof_ib = sizeof_index * NUM_INDICES_T * nf_total;
+		const size_t sizeof_ib = sizeof_index * NUM_INDICES_T * (nf_total + nf_lods);
 		CompactIndex (* const ib)[NUM_INDICES_T] =
 			reinterpret_cast< CompactIndex (*)[NUM_INDICES_T] >(malloc(sizeof_ib));
 
 		if (0 == ib)
 			return false;
 
-		for (unsigned i = 0; i < nf_total; ++i)
+		for (unsigned i = 0; i < nf_total + nf_lods; ++i)
 		{
 			BigIndex (&fi)[NUM_INDICES_T] =
 				reinterpret_cast< BigIndex (*)[NUM_INDICES_T] >(ib_total)[i];
@@ -331,28 +671,118 @@ fill_indexed_facelist_from_file(
 		index_type = compact_index_type;
 	}
 
-	const size_t sizeof_vb = sizeof(float) * NUM_FLOATS_T * nv_total;
-	const size_t sizeof_ib = sizeof_index * NUM_INDICES_T * nf_total;
+	const size_t sizeof_index_read = uint64_t(1) + CompactIndex(-1) >= nv_read
+		? sizeof(CompactIndex)
+		: sizeof(BigIndex);
+
+	std::cout << "welded vertices: " << nv_read << " -> " << nv_total <<
+		"\nfaces sans degenerate ones: " << nf_read << " -> " << nf_total <<
+		"\nvertex buffer bytes: " << sizeof(float) * num_floats * nv_read <<
+		" -> " << sizeof(float) * num_floats * nv_total <<
+		"\nindex buffer bytes: " << sizeof_index_read * NUM_INDICES_T * (nf_read + nf_lods) <<
+		" -> " << sizeof_index * NUM_INDICES_T * (nf_total + nf_lods) << std::endl;
+
+	trilist.reset();
+
+	trilist.vb = vb_total;
+	trilist.ib = ib_total;
+	trilist.sizeof_vb = sizeof(float) * num_floats * nv_total;
+	trilist.sizeof_ib = sizeof_index * NUM_INDICES_T * (nf_total + nf_lods);
+	trilist.num_faces = nf_total;
+	trilist.index_type = index_type;
+
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		trilist.bmin[i] = (vmin[i] - origin[i]) / (span * .5f);
+		trilist.bmax[i] = (vmax[i] - origin[i]) / (span * .5f);
+	}
+
+	if (is_rotated)
+	{
+		const float bmin_1 = -trilist.bmax[1];
+		const float bmax_1 = -trilist.bmin[1];
+
+		trilist.bmin[1] = trilist.bmin[2];
+		trilist.bmax[1] = trilist.bmax[2];
+		trilist.bmin[2] = bmin_1;
+		trilist.bmax[2] = bmax_1;
+	}
+
+	return true;
+}
+
+namespace util
+{
+
+bool
+upload_indexed_trilist(
+	const indexed_trilist_t& trilist,
+	const GLuint vbo_arr,
+	const GLuint vbo_idx)
+{
+	assert(0 != trilist.vb);
+	assert(0 != trilist.ib);
 
 	glBindBuffer(GL_ARRAY_BUFFER, vbo_arr);
-	glBufferData(GL_ARRAY_BUFFER, sizeof_vb, vb_total, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, trilist.sizeof_vb, trilist.vb, GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_idx);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof_ib, ib_total, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, trilist.sizeof_ib, trilist.ib, GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-	free(vb_total);
-	free(ib_total);
+	return true;
+}
 
-	num_faces = nf_total;
 
-	return true;
+bool
+load_indexed_trilist_from_file_PN(
+	const char* const filename,
+	const bool is_rotated,
+	indexed_trilist_t& trilist,
+	std::vector< rend::Meshlet >* const meshlets,
+	const unsigned meshlet_max_faces,
+	std::vector< rend::MeshLod >* const lods,
+	const float weld_epsilon)
+{
+	return load_indexed_facelist_from_file< 6, 3 >(
+		filename,
+		is_rotated,
+		meshlets,
+		meshlet_max_faces,
+		lods,
+		weld_epsilon,
+		false,
+		0,
+		trilist);
 }
 
-namespace util
+
+bool
+load_indexed_trilist_from_file_PN2(
+	const char* const filename,
+	const bool is_rotated,
+	indexed_trilist_t& trilist,
+	std::vector< rend::Meshlet >* const meshlets,
+	const unsigned meshlet_max_faces,
+	std::vector< rend::MeshLod >* const lods,
+	const float weld_epsilon,
+	const bool tangents,
+	const float* const uv_transform)
 {
+	return load_indexed_facelist_from_file< 8, 3 >(
+		filename,
+		is_rotated,
+		meshlets,
+		meshlet_max_faces,
+		lods,
+		weld_epsilon,
+		tangents,
+		uv_transform,
+		trilist);
+}
+
 
 bool
 fill_indexed_trilist_from_file_PN(
@@ -361,15 +791,21 @@ fill_indexed_trilist_from_file_PN(
 	const GLuint vbo_idx,
 	unsigned& num_faces,
 	GLenum& index_type,
-	const bool is_rotated)
+	const bool is_rotated,
+	std::vector< rend::Meshlet >* const meshlets,
+	const unsigned meshlet_max_faces,
+	std::vector< rend::MeshLod >* const lods,
+	const float weld_epsilon)
 {
-	return fill_indexed_facelist_from_file< 6, 3 >(
-		filename,
-		vbo_arr,
-		vbo_idx,
-		num_faces,
-		index_type,
-		is_rotated);
+	indexed_trilist_t trilist;
+
+	if (!load_indexed_trilist_from_file_PN(filename, is_rotated, trilist, meshlets, meshlet_max_faces, lods, weld_epsilon))
+		return false;
+
+	num_faces = trilist.num_faces;
+	index_type = trilist.index_type;
+
+	return upload_indexed_trilist(trilist, vbo_arr, vbo_idx);
 }
 
 
@@ -380,15 +816,23 @@ fill_indexed_trilist_from_file_PN2(
 	const GLuint vbo_idx,
 	unsigned& num_faces,
 	GLenum& index_type,
-	const bool is_rotated)
+	const bool is_rotated,
+	std::vector< rend::Meshlet >* const meshlets,
+	const unsigned meshlet_max_faces,
+	std::vector< rend::MeshLod >* const lods,
+	const float weld_epsilon,
+	const bool tangents,
+	const float* const uv_transform)
 {
-	return fill_indexed_facelist_from_file< 8, 3 >(
-		filename,
-		vbo_arr,
-		vbo_idx,
-		num_faces,
-		index_type,
-		is_rotated);
+	indexed_trilist_t trilist;
+
+	if (!load_indexed_trilist_from_file_PN2(filename, is_rotated, trilist, meshlets, meshlet_max_faces, lods, weld_epsilon, tangents, uv_transform))
+		return false;
+
+	num_faces = trilist.num_faces;
+	index_type = trilist.index_type;
+
+	return upload_indexed_trilist(trilist, vbo_arr, vbo_idx);
 }
 
 
@@ -402,9 +846,37 @@ fill_indexed_trilist_from_file_AGE(
 	GLenum& index_type,
 	float (&bmin)[3],
 	float (&bmax)[3])
+{
+	indexed_trilist_t trilist;
+
+	if (!load_indexed_trilist_from_file_AGE(filename, semantics_offset, trilist))
+		return false;
+
+	num_faces = trilist.num_faces;
+	index_type = trilist.index_type;
+
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		bmin[i] = trilist.bmin[i];
+		bmax[i] = trilist.bmax[i];
+	}
+
+	return upload_indexed_trilist(trilist, vbo_arr, vbo_idx);
+}
+
+
+bool
+load_indexed_trilist_from_file_AGE(
+	const char* const filename,
+	const uintptr_t (&semantics_offset)[4],
+	indexed_trilist_t& trilist)
 {
 	assert(filename);
 
+	GLenum index_type;
+	float (&bmin)[3] = trilist.bmin;
+	float (&bmax)[3] = trilist.bmax;
+
 	scoped_ptr< FILE, scoped_functor > file(fopen(filename, "rb"));
 
 	if (0 == file())
@@ -705,16 +1177,17 @@ fill_indexed_trilist_from_file_AGE(
 	std::cout << "number of vertices: " << num_vertices <<
 		"\nnumber of indices: " << num_indices << std::endl;
 
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_arr);
-	glBufferData(GL_ARRAY_BUFFER, sizeof_vb, vb(), GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_idx);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof_ib, ib(), GL_STATIC_DRAW);
+	trilist.reset();
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	trilist.vb = vb();
+	trilist.ib = ib();
+	trilist.sizeof_vb = sizeof_vb;
+	trilist.sizeof_ib = sizeof_ib;
+	trilist.num_faces = num_indices / 3;
+	trilist.index_type = index_type;
 
-	num_faces = num_indices / 3;
+	vb.reset();
+	ib.reset();
 
 	return true;
 }
@@ -11,12 +11,102 @@
 
 #endif
 
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include "rendMeshlet.hpp"
+#include "rendSimplify.hpp"
+
 namespace testbed
 {
 
 namespace util
 {
 
+// client-side vertex and index buffers of a trilist, as produced by the load_* functions which
+// don't touch GL and can run off the GL thread, and as consumed by upload_indexed_trilist
+struct indexed_trilist_t
+{
+	void* vb;
+	void* ib;
+	size_t sizeof_vb;
+	size_t sizeof_ib;
+	unsigned num_faces;			// faces of LOD0; any further LODs follow in the index buffer
+	GLenum index_type;
+	float bmin[3];
+	float bmax[3];
+
+	indexed_trilist_t()
+	: vb(0)
+	, ib(0)
+	, sizeof_vb(0)
+	, sizeof_ib(0)
+	, num_faces(0)
+	, index_type(GL_UNSIGNED_SHORT)
+	{
+		bmin[0] = bmin[1] = bmin[2] = 0.f;
+		bmax[0] = bmax[1] = bmax[2] = 0.f;
+	}
+
+	~indexed_trilist_t()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		free(vb);
+		free(ib);
+
+		vb = 0;
+		ib = 0;
+		sizeof_vb = 0;
+		sizeof_ib = 0;
+		num_faces = 0;
+	}
+
+private:
+	indexed_trilist_t(const indexed_trilist_t&);
+	indexed_trilist_t& operator =(const indexed_trilist_t&);
+};
+
+bool
+load_indexed_trilist_from_file_PN(
+	const char* const filename,
+	const bool is_rotated,
+	indexed_trilist_t& trilist,
+	std::vector< rend::Meshlet >* const meshlets = 0,
+	const unsigned meshlet_max_faces = rend::MESHLET_DEFAULT_FACES,
+	std::vector< rend::MeshLod >* const lods = 0,
+	const float weld_epsilon = 0.f);
+
+// with tangents requested, each vertex gets its tangent xyz and handedness w appended past its texcoord;
+// with a texcoord transform of scale_u, scale_v, offset_u, offset_v, as of atlas_t::get_uv_transform, texcoords
+// get remapped into the mesh's rect of a texture atlas
+bool
+load_indexed_trilist_from_file_PN2(
+	const char* const filename,
+	const bool is_rotated,
+	indexed_trilist_t& trilist,
+	std::vector< rend::Meshlet >* const meshlets = 0,
+	const unsigned meshlet_max_faces = rend::MESHLET_DEFAULT_FACES,
+	std::vector< rend::MeshLod >* const lods = 0,
+	const float weld_epsilon = 0.f,
+	const bool tangents = false,
+	const float* const uv_transform = 0);
+
+bool
+load_indexed_trilist_from_file_AGE(
+	const char* const filename,
+	const uintptr_t (&semantics_offset)[4],
+	indexed_trilist_t& trilist);
+
+bool
+upload_indexed_trilist(
+	const indexed_trilist_t& trilist,
+	const GLuint vbo_arr,
+	const GLuint vbo_idx);
+
 bool
 fill_indexed_trilist_from_file_PN(
 	const char* const filename,
@@ -24,7 +114,11 @@ fill_indexed_trilist_from_file_PN(
 	const GLuint vbo_idx,
 	unsigned& num_faces,
 	GLenum& index_type,
-	const bool is_rotated);
+	const bool is_rotated,
+	std::vector< rend::Meshlet >* const meshlets = 0,
+	const unsigned meshlet_max_faces = rend::MESHLET_DEFAULT_FACES,
+	std::vector< rend::MeshLod >* const lods = 0,
+	const float weld_epsilon = 0.f);
 
 bool
 fill_indexed_trilist_from_file_PN2(
@@ -33,7 +127,13 @@ fill_indexed_trilist_from_file_PN2(
 	const GLuint vbo_idx,
 	unsigned& num_faces,
 	GLenum& index_type,
-	const bool is_rotated);
+	const bool is_rotated,
+	std::vector< rend::Meshlet >* const meshlets = 0,
+	const unsigned meshlet_max_faces = rend::MESHLET_DEFAULT_FACES,
+	std::vector< rend::MeshLod >* const lods = 0,
+	const float weld_epsilon = 0.f,
+	const bool tangents = false,
+	const float* const uv_transform = 0);
 
 bool
 fill_indexed_trilist_from_file_AGE(
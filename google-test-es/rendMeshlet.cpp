@@ -0,0 +1,403 @@
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <limits>
+#include <vector>
+#include <iostream>
+
+#include "rendMeshlet.hpp"
+
+namespace rend
+{
+
+template < typename INDEX_T >
+static bool
+build_meshlets_generic(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	INDEX_T* const index,
+	const unsigned num_faces,
+	const unsigned max_faces,
+	std::vector< Meshlet >& meshlets)
+{
+	assert(0 != vertex);
+	assert(0 != index);
+	assert(3 <= vertex_stride);
+
+	if (0 == num_faces ||
+		MESHLET_MIN_FACES > max_faces ||
+		MESHLET_MAX_FACES < max_faces)
+	{
+		std::cerr << __FUNCTION__ << " got invalid arguments" << std::endl;
+		return false;
+	}
+
+	unsigned num_vertices = 0;
+
+	for (unsigned i = 0; i < num_faces * 3; ++i)
+		if (index[i] >= num_vertices)
+			num_vertices = index[i] + 1;
+
+	// vertex-to-face adjacency, in compressed-row form
+	std::vector< unsigned > adjacency_start(num_vertices + 1, 0);
+	std::vector< unsigned > adjacency(num_faces * 3);
+
+	for (unsigned i = 0; i < num_faces * 3; ++i)
+		++adjacency_start[index[i] + 1];
+
+	for (unsigned i = 0; i < num_vertices; ++i)
+		adjacency_start[i + 1] += adjacency_start[i];
+
+	{
+		std::vector< unsigned > cursor(adjacency_start.begin(), adjacency_start.end() - 1);
+
+		for (unsigned i = 0; i < num_faces * 3; ++i)
+			adjacency[cursor[index[i]]++] = i / 3;
+	}
+
+	// grow meshlets breadth-first across shared vertices, starting from the first free face in
+	// original order; a meshlet is closed when full or when its connected component is exhausted
+	std::vector< unsigned > order;
+	std::vector< unsigned > queue;
+	std::vector< unsigned > stamp(num_faces, unsigned(-1));
+	std::vector< bool > assigned(num_faces, false);
+
+	order.reserve(num_faces);
+	queue.reserve(num_faces);
+
+	meshlets.clear();
+
+	for (unsigned seed = 0; seed < num_faces; ++seed)
+	{
+		if (assigned[seed])
+			continue;
+
+		const unsigned id = unsigned(meshlets.size());
+
+		Meshlet m;
+		m.first_face = unsigned(order.size());
+		m.num_faces = 0;
+
+		queue.clear();
+		queue.push_back(seed);
+		stamp[seed] = id;
+
+		for (unsigned head = 0; head < queue.size() && m.num_faces < max_faces; ++head)
+		{
+			const unsigned f = queue[head];
+
+			if (assigned[f])
+				continue;
+
+			assigned[f] = true;
+			order.push_back(f);
+			++m.num_faces;
+
+			for (unsigned j = 0; j < 3; ++j)
+			{
+				const unsigned v = index[f * 3 + j];
+
+				for (unsigned k = adjacency_start[v]; k < adjacency_start[v + 1]; ++k)
+				{
+					const unsigned g = adjacency[k];
+
+					if (assigned[g] || id == stamp[g])
+						continue;
+
+					stamp[g] = id;
+					queue.push_back(g);
+				}
+			}
+		}
+
+		meshlets.push_back(m);
+	}
+
+	assert(order.size() == num_faces);
+
+	// compute meshlet bounds and normal cones
+	for (std::vector< Meshlet >::iterator it = meshlets.begin(); it != meshlets.end(); ++it)
+	{
+		Meshlet& m = *it;
+
+		for (unsigned j = 0; j < 3; ++j)
+		{
+			m.bbox_min[j] = std::numeric_limits< float >::infinity();
+			m.bbox_max[j] = -std::numeric_limits< float >::infinity();
+		}
+
+		float axis[3] = { 0.f, 0.f, 0.f };
+
+		for (unsigned i = m.first_face; i < m.first_face + m.num_faces; ++i)
+		{
+			const INDEX_T* const fi = index + order[i] * 3;
+
+			for (unsigned j = 0; j < 3; ++j)
+			{
+				const float* const p = vertex + size_t(fi[j]) * vertex_stride;
+
+				for (unsigned k = 0; k < 3; ++k)
+				{
+					if (p[k] < m.bbox_min[k]) m.bbox_min[k] = p[k];
+					if (p[k] > m.bbox_max[k]) m.bbox_max[k] = p[k];
+				}
+			}
+
+			const float* const p0 = vertex + size_t(fi[0]) * vertex_stride;
+			const float* const p1 = vertex + size_t(fi[1]) * vertex_stride;
+			const float* const p2 = vertex + size_t(fi[2]) * vertex_stride;
+
+			const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const float n[3] =
+			{
+				e0[1] * e1[2] - e0[2] * e1[1],
+				e0[2] * e1[0] - e0[0] * e1[2],
+				e0[0] * e1[1] - e0[1] * e1[0]
+			};
+
+			const float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			if (0.f == len)
+				continue;
+
+			axis[0] += n[0] / len;
+			axis[1] += n[1] / len;
+			axis[2] += n[2] / len;
+		}
+
+		float radius = 0.f;
+
+		for (unsigned k = 0; k < 3; ++k)
+			m.sphere[k] = (m.bbox_min[k] + m.bbox_max[k]) * .5f;
+
+		for (unsigned i = m.first_face; i < m.first_face + m.num_faces; ++i)
+			for (unsigned j = 0; j < 3; ++j)
+			{
+				const float* const p = vertex + size_t(index[order[i] * 3 + j]) * vertex_stride;
+				const float d[3] = { p[0] - m.sphere[0], p[1] - m.sphere[1], p[2] - m.sphere[2] };
+				const float r = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+				if (r > radius)
+					radius = r;
+			}
+
+		m.sphere[3] = radius;
+
+		const float axis_len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+		m.cone[0] = 0.f;
+		m.cone[1] = 0.f;
+		m.cone[2] = 0.f;
+		m.cone[3] = 2.f;
+
+		if (0.f == axis_len)
+			continue;
+
+		for (unsigned k = 0; k < 3; ++k)
+			axis[k] /= axis_len;
+
+		float min_dot = 1.f;
+
+		for (unsigned i = m.first_face; i < m.first_face + m.num_faces; ++i)
+		{
+			const INDEX_T* const fi = index + order[i] * 3;
+
+			const float* const p0 = vertex + size_t(fi[0]) * vertex_stride;
+			const float* const p1 = vertex + size_t(fi[1]) * vertex_stride;
+			const float* const p2 = vertex + size_t(fi[2]) * vertex_stride;
+
+			const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const float n[3] =
+			{
+				e0[1] * e1[2] - e0[2] * e1[1],
+				e0[2] * e1[0] - e0[0] * e1[2],
+				e0[0] * e1[1] - e0[1] * e1[0]
+			};
+
+			const float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			if (0.f == len)
+				continue;
+
+			const float dot = (n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]) / len;
+
+			if (dot < min_dot)
+				min_dot = dot;
+		}
+
+		// cones of spread at or beyond a right angle are of no use for culling
+		if (min_dot <= 0.f)
+			continue;
+
+		m.cone[0] = axis[0];
+		m.cone[1] = axis[1];
+		m.cone[2] = axis[2];
+		m.cone[3] = sqrtf(1.f - min_dot * min_dot);
+	}
+
+	// commit the new face order
+	std::vector< INDEX_T > reordered(num_faces * 3);
+
+	for (unsigned i = 0; i < num_faces; ++i)
+	{
+		reordered[i * 3 + 0] = index[order[i] * 3 + 0];
+		reordered[i * 3 + 1] = index[order[i] * 3 + 1];
+		reordered[i * 3 + 2] = index[order[i] * 3 + 2];
+	}
+
+	memcpy(index, &reordered.front(), sizeof(INDEX_T) * num_faces * 3);
+
+	std::cout << "number of meshlets: " << meshlets.size() <<
+		" (up to " << max_faces << " faces per meshlet)" << std::endl;
+
+	return true;
+}
+
+
+bool
+build_meshlets(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	uint16_t* const index,
+	const unsigned num_faces,
+	const unsigned max_faces,
+	std::vector< Meshlet >& meshlets)
+{
+	return build_meshlets_generic(vertex, vertex_stride, index, num_faces, max_faces, meshlets);
+}
+
+
+bool
+build_meshlets(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	uint32_t* const index,
+	const unsigned num_faces,
+	const unsigned max_faces,
+	std::vector< Meshlet >& meshlets)
+{
+	return build_meshlets_generic(vertex, vertex_stride, index, num_faces, max_faces, meshlets);
+}
+
+
+unsigned
+cull_meshlets(
+	const Meshlet* const meshlets,
+	const unsigned num_meshlets,
+	const float (&mvp)[4][4],
+	const float (&viewer)[4],
+	const GLenum front_face,
+	unsigned (* const range)[2],
+	unsigned* const num_visible)
+{
+	assert(0 != meshlets || 0 == num_meshlets);
+	assert(0 != range || 0 == num_meshlets);
+
+	// clip planes in object space, as per Gribb & Hartmann: row3 +/- row[0..2]
+	float plane[6][4];
+
+	for (unsigned i = 0; i < 3; ++i)
+		for (unsigned j = 0; j < 4; ++j)
+		{
+			plane[i * 2 + 0][j] = mvp[3][j] + mvp[i][j];
+			plane[i * 2 + 1][j] = mvp[3][j] - mvp[i][j];
+		}
+
+	for (unsigned i = 0; i < 6; ++i)
+	{
+		const float len = sqrtf(
+			plane[i][0] * plane[i][0] +
+			plane[i][1] * plane[i][1] +
+			plane[i][2] * plane[i][2]);
+
+		if (0.f == len)
+			continue;
+
+		for (unsigned j = 0; j < 4; ++j)
+			plane[i][j] /= len;
+	}
+
+	// cone axes are set up for CCW front faces; flip the test otherwise
+	const float facing = GL_CW == front_face ? -1.f : 1.f;
+	const bool local_viewer = 0.f != viewer[3];
+
+	float viewer_dir[3] = { 0.f, 0.f, 0.f };
+
+	if (!local_viewer)
+	{
+		const float len = sqrtf(viewer[0] * viewer[0] + viewer[1] * viewer[1] + viewer[2] * viewer[2]);
+
+		if (0.f != len)
+		{
+			viewer_dir[0] = -viewer[0] / len;
+			viewer_dir[1] = -viewer[1] / len;
+			viewer_dir[2] = -viewer[2] / len;
+		}
+	}
+
+	unsigned num_range = 0;
+	unsigned visible = 0;
+
+	for (unsigned i = 0; i < num_meshlets; ++i)
+	{
+		const Meshlet& m = meshlets[i];
+		const float* const c = m.sphere;
+		const float r = m.sphere[3];
+
+		bool culled = false;
+
+		for (unsigned j = 0; j < 6 && !culled; ++j)
+			culled = plane[j][0] * c[0] + plane[j][1] * c[1] + plane[j][2] * c[2] + plane[j][3] < -r;
+
+		if (!culled && m.cone[3] <= 1.f)
+		{
+			const float axis[3] =
+			{
+				m.cone[0] * facing,
+				m.cone[1] * facing,
+				m.cone[2] * facing
+			};
+
+			if (local_viewer)
+			{
+				const float d[3] =
+				{
+					c[0] - viewer[0] / viewer[3],
+					c[1] - viewer[1] / viewer[3],
+					c[2] - viewer[2] / viewer[3]
+				};
+
+				const float dist = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+				culled = d[0] * axis[0] + d[1] * axis[1] + d[2] * axis[2] >= m.cone[3] * dist + r;
+			}
+			else
+				culled = viewer_dir[0] * axis[0] + viewer_dir[1] * axis[1] + viewer_dir[2] * axis[2] >= m.cone[3];
+		}
+
+		if (culled)
+			continue;
+
+		++visible;
+
+		if (num_range && range[num_range - 1][0] + range[num_range - 1][1] == m.first_face)
+		{
+			range[num_range - 1][1] += m.num_faces;
+			continue;
+		}
+
+		range[num_range][0] = m.first_face;
+		range[num_range][1] = m.num_faces;
+		++num_range;
+	}
+
+	if (0 != num_visible)
+		*num_visible = visible;
+
+	return num_range;
+}
+
+} // namespace rend
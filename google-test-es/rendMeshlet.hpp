@@ -0,0 +1,98 @@
+#ifndef rend_meshlet_H__
+#define rend_meshlet_H__
+
+#if defined(PLATFORM_GLX)
+
+#include <GL/gl.h>
+
+#else
+
+#include <GLES2/gl2.h>
+
+#endif
+
+#include <stdint.h>
+#include <vector>
+
+namespace rend
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// meshlets are clusters of spatially-adjacent faces, occupying contiguous ranges of an index buffer;
+// each meshlet carries the bounds necessary to cull it as a whole against the view frustum and
+// against the viewer, the latter via the cone enclosing the normals of all faces in the meshlet
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Meshlet
+{
+	unsigned first_face;	// offset of the meshlet in the index buffer, in faces
+	unsigned num_faces;
+
+	float bbox_min[3];
+	float bbox_max[3];
+	float sphere[4];		// center and radius of bounding sphere
+	float cone[4];			// normal cone axis and sine of cone spread; spread > 1 means cone is void
+};
+
+enum {
+	MESHLET_MIN_FACES		= 16,
+	MESHLET_MAX_FACES		= 256,
+	MESHLET_DEFAULT_FACES	= 64
+};
+
+
+// build_meshlets()	: partition a trilist into meshlets, reordering its faces so that each meshlet
+//					  occupies a contiguous range of the index buffer
+//		- vertex,		const float*	: vertex buffer with the position at the start of each vertex,	input
+//		- vertex_stride,const unsigned	: vertex stride, in floats,										input
+//		- index,		uintN_t*		: index buffer,													input/output
+//		- num_faces,	const unsigned	: number of faces in the index buffer,							input
+//		- max_faces,	const unsigned	: upper limit of faces per meshlet,								input
+//		- meshlets,		vector&			: resulting meshlets,											output
+// returns
+//		bool			: success
+
+bool
+build_meshlets(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	uint16_t* const index,
+	const unsigned num_faces,
+	const unsigned max_faces,
+	std::vector< Meshlet >& meshlets);
+
+bool
+build_meshlets(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	uint32_t* const index,
+	const unsigned num_faces,
+	const unsigned max_faces,
+	std::vector< Meshlet >& meshlets);
+
+
+// cull_meshlets()	: cull meshlets against the view frustum and the viewer
+//		- meshlets,		const Meshlet*	: meshlets to cull,												input
+//		- num_meshlets,	const unsigned	: number of meshlets,											input
+//		- mvp,			float[4][4]		: object-to-clip transform, as rend::matx4 (prior to transposing),	input
+//		- viewer,		float[4]		: object-space viewer position (w = 1), or direction (w = 0),	input
+//		- front_face,	const GLenum	: winding of front-facing faces, as per glFrontFace,			input
+//		- range,		unsigned[][2]	: resulting face ranges (first_face, num_faces), of capacity
+//										  num_meshlets; adjacent surviving meshlets are merged,			output
+//		- num_visible,	unsigned*		: number of meshlets passing the test; can be nil,				output
+// returns
+//		unsigned		: number of ranges to draw
+
+unsigned
+cull_meshlets(
+	const Meshlet* const meshlets,
+	const unsigned num_meshlets,
+	const float (&mvp)[4][4],
+	const float (&viewer)[4],
+	const GLenum front_face,
+	unsigned (* const range)[2],
+	unsigned* const num_visible = 0);
+
+} // namespace rend
+
+#endif // rend_meshlet_H__
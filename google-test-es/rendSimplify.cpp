@@ -0,0 +1,781 @@
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <iostream>
+
+#include "rendSimplify.hpp"
+
+namespace rend
+{
+
+namespace
+{
+
+// symmetric 4x4 error quadric of the plane-distance form, accumulated with weights
+struct Quadric
+{
+	double a00, a11, a22;
+	double a10, a20, a21;
+	double b0, b1, b2;
+	double c;
+	double w;
+};
+
+
+void
+quadric_add_plane(
+	Quadric& q,
+	const double (&n)[3],
+	const double d,
+	const double w)
+{
+	q.a00 += w * n[0] * n[0];
+	q.a11 += w * n[1] * n[1];
+	q.a22 += w * n[2] * n[2];
+	q.a10 += w * n[1] * n[0];
+	q.a20 += w * n[2] * n[0];
+	q.a21 += w * n[2] * n[1];
+	q.b0 += w * n[0] * d;
+	q.b1 += w * n[1] * d;
+	q.b2 += w * n[2] * d;
+	q.c += w * d * d;
+	q.w += w;
+}
+
+
+void
+quadric_add(
+	Quadric& q,
+	const Quadric& r)
+{
+	q.a00 += r.a00;
+	q.a11 += r.a11;
+	q.a22 += r.a22;
+	q.a10 += r.a10;
+	q.a20 += r.a20;
+	q.a21 += r.a21;
+	q.b0 += r.b0;
+	q.b1 += r.b1;
+	q.b2 += r.b2;
+	q.c += r.c;
+	q.w += r.w;
+}
+
+
+// weighted mean squared distance of a point to the planes of a quadric
+double
+quadric_error(
+	const Quadric& q,
+	const float* const p)
+{
+	const double x = p[0];
+	const double y = p[1];
+	const double z = p[2];
+
+	const double e =
+		q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+		2.0 * (q.a10 * x * y + q.a20 * x * z + q.a21 * y * z) +
+		2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+
+	return q.w > 0.0 ? fabs(e) / q.w : 0.0;
+}
+
+
+void
+cross(
+	const float* const p0,
+	const float* const p1,
+	const float* const p2,
+	double (&n)[3])
+{
+	const double e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	const double e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+	n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+	n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+	n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+}
+
+
+struct PositionLess
+{
+	const float* const vertex;
+	const unsigned stride;
+
+	PositionLess(
+		const float* const vertex,
+		const unsigned stride)
+	: vertex(vertex)
+	, stride(stride)
+	{}
+
+	bool operator()(
+		const uint32_t a,
+		const uint32_t b) const
+	{
+		return memcmp(vertex + a * stride, vertex + b * stride, sizeof(float) * 3) < 0;
+	}
+};
+
+
+struct ErrorLess
+{
+	const double* const error;
+
+	ErrorLess(
+		const double* const error)
+	: error(error)
+	{}
+
+	bool operator()(
+		const uint32_t a,
+		const uint32_t b) const
+	{
+		return error[a] < error[b];
+	}
+};
+
+
+// directed half-edge of a face; pos holds the position-unique vertices, vtx the actual ones
+struct Edge
+{
+	uint32_t pos[2];
+	uint32_t vtx[2];
+	uint32_t face;
+
+	bool operator <(const Edge& oth) const
+	{
+		return pos[0] < oth.pos[0] || (pos[0] == oth.pos[0] && pos[1] < oth.pos[1]);
+	}
+};
+
+enum {
+	EDGE_MANIFOLD,		// has a twin, sharing both vertices
+	EDGE_SEAM,			// has a twin, sharing positions but not vertices
+	EDGE_OPEN,			// has no twin
+	EDGE_COMPLEX		// non-manifold
+};
+
+enum {
+	VERTEX_MANIFOLD,	// single vertex at this position, all edges manifold
+	VERTEX_BORDER,		// single vertex at this position, on a single open border
+	VERTEX_SEAM,		// two vertices at this position, on a single seam
+	VERTEX_LOCKED		// anything else - never collapsed
+};
+
+
+void
+build_edges(
+	const std::vector< uint32_t >& index,
+	const std::vector< uint32_t >& canon,
+	std::vector< Edge >& edge,
+	std::vector< uint8_t >& edge_kind)
+{
+	const unsigned num_faces = unsigned(index.size() / 3);
+
+	edge.resize(num_faces * 3);
+	edge_kind.resize(num_faces * 3);
+
+	for (unsigned i = 0; i < num_faces; ++i)
+		for (unsigned j = 0; j < 3; ++j)
+		{
+			Edge& e = edge[i * 3 + j];
+
+			e.vtx[0] = index[i * 3 + j];
+			e.vtx[1] = index[i * 3 + (j + 1) % 3];
+			e.pos[0] = canon[e.vtx[0]];
+			e.pos[1] = canon[e.vtx[1]];
+			e.face = i;
+		}
+
+	std::sort(edge.begin(), edge.end());
+
+	for (unsigned i = 0; i < edge.size(); ++i)
+	{
+		const Edge& e = edge[i];
+
+		Edge twin;
+		twin.pos[0] = e.pos[1];
+		twin.pos[1] = e.pos[0];
+
+		const std::pair< std::vector< Edge >::const_iterator, std::vector< Edge >::const_iterator > same =
+			std::equal_range(edge.begin(), edge.end(), e);
+		const std::pair< std::vector< Edge >::const_iterator, std::vector< Edge >::const_iterator > oppo =
+			std::equal_range(edge.begin(), edge.end(), twin);
+
+		if (1 < same.second - same.first || 1 < oppo.second - oppo.first)
+			edge_kind[i] = EDGE_COMPLEX;
+		else
+		if (oppo.second == oppo.first)
+			edge_kind[i] = EDGE_OPEN;
+		else
+		if (oppo.first->vtx[0] == e.vtx[1] && oppo.first->vtx[1] == e.vtx[0])
+			edge_kind[i] = EDGE_MANIFOLD;
+		else
+			edge_kind[i] = EDGE_SEAM;
+	}
+}
+
+
+// pair each vertex at position v with the vertex at position u it would collapse into; fails if
+// the pairing is ambiguous or incomplete, i.e. when the collapse would break an attribute seam
+bool
+map_wedges(
+	const std::vector< uint32_t >& index,
+	const std::vector< uint32_t >& canon,
+	const uint32_t* const adj_begin,
+	const uint32_t* const adj_end,
+	const uint32_t v,
+	const uint32_t u,
+	uint32_t (&wedge)[2][2],
+	unsigned& num_wedges)
+{
+	num_wedges = 0;
+
+	for (const uint32_t* f = adj_begin; f != adj_end; ++f)
+	{
+		uint32_t w = uint32_t(-1);
+		uint32_t t = uint32_t(-1);
+
+		for (unsigned j = 0; j < 3; ++j)
+		{
+			const uint32_t vtx = index[*f * 3 + j];
+
+			if (v == canon[vtx])
+				w = vtx;
+			else
+			if (u == canon[vtx])
+				t = vtx;
+		}
+
+		if (uint32_t(-1) == t)
+			continue;
+
+		unsigned k = 0;
+
+		for (; k < num_wedges; ++k)
+			if (w == wedge[k][0])
+				break;
+
+		if (k < num_wedges)
+		{
+			if (t != wedge[k][1])
+				return false;
+
+			continue;
+		}
+
+		if (2 == num_wedges)
+			return false;
+
+		wedge[num_wedges][0] = w;
+		wedge[num_wedges][1] = t;
+		++num_wedges;
+	}
+
+	for (const uint32_t* f = adj_begin; f != adj_end; ++f)
+		for (unsigned j = 0; j < 3; ++j)
+		{
+			const uint32_t vtx = index[*f * 3 + j];
+
+			if (v != canon[vtx])
+				continue;
+
+			unsigned k = 0;
+
+			for (; k < num_wedges; ++k)
+				if (vtx == wedge[k][0])
+					break;
+
+			if (k == num_wedges)
+				return false;
+		}
+
+	return 0 != num_wedges;
+}
+
+
+// check if moving position v onto position u would flip or fold any surviving face around v
+bool
+has_flip(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	const std::vector< uint32_t >& index,
+	const std::vector< uint32_t >& canon,
+	const uint32_t* const adj_begin,
+	const uint32_t* const adj_end,
+	const uint32_t v,
+	const uint32_t u)
+{
+	for (const uint32_t* f = adj_begin; f != adj_end; ++f)
+	{
+		const uint32_t c[3] =
+		{
+			canon[index[*f * 3 + 0]],
+			canon[index[*f * 3 + 1]],
+			canon[index[*f * 3 + 2]]
+		};
+
+		if (u == c[0] || u == c[1] || u == c[2])
+			continue;
+
+		const float* p[3] =
+		{
+			vertex + c[0] * vertex_stride,
+			vertex + c[1] * vertex_stride,
+			vertex + c[2] * vertex_stride
+		};
+
+		double n0[3];
+		cross(p[0], p[1], p[2], n0);
+
+		for (unsigned j = 0; j < 3; ++j)
+			if (v == c[j])
+				p[j] = vertex + u * vertex_stride;
+
+		double n1[3];
+		cross(p[0], p[1], p[2], n1);
+
+		const double dot = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+		const double len = sqrt((n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2]) *
+								(n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2]));
+
+		// reject turns of more than ~75 degrees
+		if (dot < .25 * len)
+			return true;
+	}
+
+	return false;
+}
+
+
+// collapse up to enough positions to reach the target face count, cheapest first, while keeping
+// collapses within the pass independent from each other; returns number of collapses
+unsigned
+simplify_pass(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	const unsigned num_vertices,
+	const std::vector< uint32_t >& canon,
+	std::vector< Quadric >& quadric,
+	std::vector< uint32_t >& index,
+	const unsigned target_faces,
+	double& max_error)
+{
+	const unsigned num_faces = unsigned(index.size() / 3);
+
+	std::vector< Edge > edge;
+	std::vector< uint8_t > edge_kind;
+
+	build_edges(index, canon, edge, edge_kind);
+
+	// classify positions
+	std::vector< uint8_t > used(num_vertices, 0);
+	std::vector< uint8_t > num_wedges(num_vertices, 0);
+	std::vector< uint8_t > num_open(num_vertices, 0);
+	std::vector< uint8_t > num_seam(num_vertices, 0);
+	std::vector< uint8_t > kind(num_vertices, VERTEX_LOCKED);
+	std::vector< uint8_t > is_complex(num_vertices, 0);
+
+	for (unsigned i = 0; i < index.size(); ++i)
+		if (!used[index[i]])
+		{
+			used[index[i]] = 1;
+			num_wedges[canon[index[i]]] = std::min(num_wedges[canon[index[i]]] + 1, 255);
+		}
+
+	for (unsigned i = 0; i < edge.size(); ++i)
+		for (unsigned j = 0; j < 2; ++j)
+			switch (edge_kind[i])
+			{
+			case EDGE_OPEN:
+				num_open[edge[i].pos[j]] = std::min(num_open[edge[i].pos[j]] + 1, 255);
+				break;
+			case EDGE_SEAM:
+				num_seam[edge[i].pos[j]] = std::min(num_seam[edge[i].pos[j]] + 1, 255);
+				break;
+			case EDGE_COMPLEX:
+				is_complex[edge[i].pos[j]] = 1;
+				break;
+			}
+
+	for (unsigned i = 0; i < num_vertices; ++i)
+	{
+		if (is_complex[i] || 0 == num_wedges[i])
+			continue;
+
+		if (1 == num_wedges[i] && 0 == num_open[i] && 0 == num_seam[i])
+			kind[i] = VERTEX_MANIFOLD;
+		else
+		if (1 == num_wedges[i] && 2 == num_open[i] && 0 == num_seam[i])
+			kind[i] = VERTEX_BORDER;
+		else
+		if (2 == num_wedges[i] && 0 == num_open[i] && 4 == num_seam[i])
+			kind[i] = VERTEX_SEAM;
+	}
+
+	// position-to-face adjacency, in compressed-row form
+	std::vector< uint32_t > adjacency_start(num_vertices + 1, 0);
+	std::vector< uint32_t > adjacency(num_faces * 3);
+
+	for (unsigned i = 0; i < index.size(); ++i)
+		++adjacency_start[canon[index[i]] + 1];
+
+	for (unsigned i = 0; i < num_vertices; ++i)
+		adjacency_start[i + 1] += adjacency_start[i];
+
+	{
+		std::vector< uint32_t > cursor(adjacency_start.begin(), adjacency_start.end() - 1);
+
+		for (unsigned i = 0; i < index.size(); ++i)
+			adjacency[cursor[canon[index[i]]]++] = i / 3;
+	}
+
+	// cheapest legal collapse per position
+	std::vector< uint32_t > best(num_vertices, uint32_t(-1));
+	std::vector< double > best_error(num_vertices, std::numeric_limits< double >::infinity());
+
+	for (unsigned i = 0; i < edge.size(); ++i)
+		for (unsigned j = 0; j < 2; ++j)
+		{
+			const uint32_t v = edge[i].pos[j];
+			const uint32_t u = edge[i].pos[j ^ 1];
+
+			if (VERTEX_MANIFOLD != kind[v] &&
+				!(VERTEX_BORDER == kind[v] && EDGE_OPEN == edge_kind[i]) &&
+				!(VERTEX_SEAM == kind[v] && EDGE_SEAM == edge_kind[i]))
+			{
+				continue;
+			}
+
+			const double error = quadric_error(quadric[v], vertex + u * vertex_stride);
+
+			if (error < best_error[v])
+			{
+				best_error[v] = error;
+				best[v] = u;
+			}
+		}
+
+	std::vector< uint32_t > candidate;
+
+	for (unsigned i = 0; i < num_vertices; ++i)
+		if (uint32_t(-1) != best[i])
+			candidate.push_back(i);
+
+	std::sort(candidate.begin(), candidate.end(), ErrorLess(&best_error.front()));
+
+	// apply collapses; a collapse locks the neighbourhood of its source for the rest of the pass
+	std::vector< uint32_t > remap(num_vertices);
+	std::vector< uint8_t > touched(num_vertices, 0);
+
+	for (unsigned i = 0; i < num_vertices; ++i)
+		remap[i] = i;
+
+	const unsigned budget = num_faces - target_faces;
+	unsigned removed = 0;
+	unsigned collapses = 0;
+
+	for (unsigned i = 0; i < candidate.size() && removed < budget; ++i)
+	{
+		const uint32_t v = candidate[i];
+		const uint32_t u = best[v];
+
+		if (touched[v] || touched[u])
+			continue;
+
+		const uint32_t* const adj_begin = &adjacency.front() + adjacency_start[v];
+		const uint32_t* const adj_end = &adjacency.front() + adjacency_start[v + 1];
+
+		uint32_t wedge[2][2];
+		unsigned nwedges;
+
+		if (!map_wedges(index, canon, adj_begin, adj_end, v, u, wedge, nwedges) ||
+			has_flip(vertex, vertex_stride, index, canon, adj_begin, adj_end, v, u))
+		{
+			continue;
+		}
+
+		for (unsigned j = 0; j < nwedges; ++j)
+			remap[wedge[j][0]] = wedge[j][1];
+
+		quadric_add(quadric[u], quadric[v]);
+		max_error = std::max(max_error, sqrt(best_error[v]));
+
+		for (const uint32_t* f = adj_begin; f != adj_end; ++f)
+			for (unsigned j = 0; j < 3; ++j)
+				touched[canon[index[*f * 3 + j]]] = 1;
+
+		removed += VERTEX_BORDER == kind[v] ? 1 : 2;
+		++collapses;
+	}
+
+	if (0 == collapses)
+		return 0;
+
+	// rewrite faces, dropping the ones that became degenerate
+	unsigned num_out = 0;
+
+	for (unsigned i = 0; i < num_faces; ++i)
+	{
+		const uint32_t a = remap[index[i * 3 + 0]];
+		const uint32_t b = remap[index[i * 3 + 1]];
+		const uint32_t c = remap[index[i * 3 + 2]];
+
+		if (canon[a] == canon[b] || canon[b] == canon[c] || canon[c] == canon[a])
+			continue;
+
+		index[num_out * 3 + 0] = a;
+		index[num_out * 3 + 1] = b;
+		index[num_out * 3 + 2] = c;
+		++num_out;
+	}
+
+	index.resize(num_out * 3);
+
+	return collapses;
+}
+
+} // namespace
+
+
+bool
+build_lod_chain(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	const unsigned num_vertices,
+	const uint32_t* const index,
+	const unsigned num_faces,
+	const unsigned max_lods,
+	std::vector< uint32_t >& lod_index,
+	std::vector< MeshLod >& lods)
+{
+	assert(0 != vertex);
+	assert(0 != index);
+	assert(3 <= vertex_stride);
+
+	lod_index.clear();
+	lods.clear();
+
+	if (0 == num_vertices || 0 == num_faces || 0 == max_lods)
+	{
+		std::cerr << __FUNCTION__ << " got invalid arguments" << std::endl;
+		return false;
+	}
+
+	for (unsigned i = 0; i < num_faces * 3; ++i)
+		if (index[i] >= num_vertices)
+		{
+			std::cerr << __FUNCTION__ << " encountered out-of-range index" << std::endl;
+			return false;
+		}
+
+	const MeshLod lod0 = { 0, num_faces, 0.f };
+	lods.push_back(lod0);
+
+	// position-unique vertices: bit-identical positions collapse to the lowest-sorted vertex
+	std::vector< uint32_t > canon(num_vertices);
+
+	{
+		std::vector< uint32_t > order(num_vertices);
+
+		for (unsigned i = 0; i < num_vertices; ++i)
+			order[i] = i;
+
+		std::sort(order.begin(), order.end(), PositionLess(vertex, vertex_stride));
+
+		canon[order[0]] = order[0];
+
+		for (unsigned i = 1; i < num_vertices; ++i)
+			canon[order[i]] =
+				memcmp(vertex + order[i] * vertex_stride, vertex + order[i - 1] * vertex_stride, sizeof(float) * 3)
+					? order[i]
+					: canon[order[i - 1]];
+	}
+
+	// bounding sphere, centered at the bbox center, for error normalization
+	float bmin[3] =
+	{
+		std::numeric_limits< float >::infinity(),
+		std::numeric_limits< float >::infinity(),
+		std::numeric_limits< float >::infinity()
+	};
+	float bmax[3] =
+	{
+		-std::numeric_limits< float >::infinity(),
+		-std::numeric_limits< float >::infinity(),
+		-std::numeric_limits< float >::infinity()
+	};
+
+	for (unsigned i = 0; i < num_faces * 3; ++i)
+		for (unsigned j = 0; j < 3; ++j)
+		{
+			bmin[j] = std::min(bmin[j], vertex[index[i] * vertex_stride + j]);
+			bmax[j] = std::max(bmax[j], vertex[index[i] * vertex_stride + j]);
+		}
+
+	double radius = 0.0;
+
+	for (unsigned i = 0; i < num_faces * 3; ++i)
+	{
+		const float* const p = vertex + index[i] * vertex_stride;
+		const double d[3] =
+		{
+			p[0] - (bmin[0] + bmax[0]) * .5,
+			p[1] - (bmin[1] + bmax[1]) * .5,
+			p[2] - (bmin[2] + bmax[2]) * .5
+		};
+
+		radius = std::max(radius, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	}
+
+	radius = sqrt(radius);
+
+	if (0.0 == radius)
+		return true;
+
+	// working copy of the faces, minus the degenerate ones
+	std::vector< uint32_t > work;
+	work.reserve(num_faces * 3);
+
+	for (unsigned i = 0; i < num_faces; ++i)
+	{
+		const uint32_t* const f = index + i * 3;
+
+		if (canon[f[0]] == canon[f[1]] || canon[f[1]] == canon[f[2]] || canon[f[2]] == canon[f[0]])
+			continue;
+
+		work.insert(work.end(), f, f + 3);
+	}
+
+	// seed quadrics with the area-weighted face planes, and with planes perpendicular to faces along
+	// borders and seams, the latter weighted heavily so that borders and seams keep their shape
+	std::vector< Quadric > quadric(num_vertices, Quadric());
+
+	for (unsigned i = 0; i < work.size() / 3; ++i)
+	{
+		const uint32_t* const f = &work.front() + i * 3;
+
+		double n[3];
+		cross(vertex + f[0] * vertex_stride, vertex + f[1] * vertex_stride, vertex + f[2] * vertex_stride, n);
+
+		const double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		if (0.0 == len)
+			continue;
+
+		n[0] /= len;
+		n[1] /= len;
+		n[2] /= len;
+
+		const float* const p = vertex + f[0] * vertex_stride;
+		const double d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+
+		for (unsigned j = 0; j < 3; ++j)
+			quadric_add_plane(quadric[canon[f[j]]], n, d, len * .5);
+	}
+
+	{
+		std::vector< Edge > edge;
+		std::vector< uint8_t > edge_kind;
+
+		build_edges(work, canon, edge, edge_kind);
+
+		const double edge_weight = 10.0;
+
+		for (unsigned i = 0; i < edge.size(); ++i)
+		{
+			if (EDGE_OPEN != edge_kind[i] && EDGE_SEAM != edge_kind[i])
+				continue;
+
+			const uint32_t* const f = &work.front() + edge[i].face * 3;
+
+			double n[3];
+			cross(vertex + f[0] * vertex_stride, vertex + f[1] * vertex_stride, vertex + f[2] * vertex_stride, n);
+
+			const float* const p0 = vertex + edge[i].pos[0] * vertex_stride;
+			const float* const p1 = vertex + edge[i].pos[1] * vertex_stride;
+			const double e[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+
+			double m[3] =
+			{
+				e[1] * n[2] - e[2] * n[1],
+				e[2] * n[0] - e[0] * n[2],
+				e[0] * n[1] - e[1] * n[0]
+			};
+
+			const double len = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+
+			if (0.0 == len)
+				continue;
+
+			m[0] /= len;
+			m[1] /= len;
+			m[2] /= len;
+
+			const double d = -(m[0] * p0[0] + m[1] * p0[1] + m[2] * p0[2]);
+			const double w = (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]) * edge_weight;
+
+			quadric_add_plane(quadric[edge[i].pos[0]], m, d, w);
+			quadric_add_plane(quadric[edge[i].pos[1]], m, d, w);
+		}
+	}
+
+	// each LOD is simplified from its predecessor, so errors accumulate down the chain; the error of a
+	// collapse is the RMS distance to the accumulated planes, an estimate rather than a bound
+	double max_error = 0.0;
+
+	while (lods.size() < max_lods)
+	{
+		const unsigned target = lods.back().num_faces / 2;
+
+		if (MESH_LOD_MIN_FACES > target)
+			break;
+
+		while (work.size() / 3 > target)
+			if (0 == simplify_pass(vertex, vertex_stride, num_vertices, canon, quadric, work, target, max_error))
+				break;
+
+		const unsigned faces = unsigned(work.size() / 3);
+
+		// stop when simplification stalls
+		if (faces > lods.back().num_faces / 4 * 3)
+			break;
+
+		const MeshLod lod = { num_faces + unsigned(lod_index.size() / 3), faces, float(max_error / radius) };
+		lods.push_back(lod);
+
+		lod_index.insert(lod_index.end(), work.begin(), work.end());
+	}
+
+	std::cout << "number of LODs: " << lods.size() << std::endl;
+
+	for (unsigned i = 0; i < lods.size(); ++i)
+		std::cout << "\tLOD" << i << ": " << lods[i].num_faces << " faces, relative error " << lods[i].error << std::endl;
+
+	return true;
+}
+
+
+unsigned
+select_lod(
+	const MeshLod* const lods,
+	const unsigned num_lods,
+	const float radius_px,
+	const float max_error_px)
+{
+	assert(0 != lods);
+	assert(0 != num_lods);
+
+	for (unsigned i = num_lods - 1; i > 0; --i)
+		if (lods[i].error * radius_px <= max_error_px)
+			return i;
+
+	return 0;
+}
+
+} // namespace rend
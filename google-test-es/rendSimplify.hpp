@@ -0,0 +1,77 @@
+#ifndef rend_simplify_H__
+#define rend_simplify_H__
+
+#include <stdint.h>
+#include <vector>
+
+namespace rend
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// LOD chains are successively-simplified versions of a trilist, all of them referencing the vertex
+// buffer of the original; simplification is by quadric-error half-edge collapse, so no vertices are
+// ever created or moved, and vertices on open borders and on attribute seams (same position,
+// different normal or texcoord) are only ever collapsed along their border or seam
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct MeshLod
+{
+	unsigned first_face;	// offset of the LOD in the index buffer, in faces
+	unsigned num_faces;
+	float error;			// error estimate relative to the bounding-sphere radius; see below
+};
+
+// the error of a LOD is the largest, over the collapses leading to it, of the RMS distance of the
+// surviving vertex to the planes of the faces merged into it, weighted by area; it tracks geometric
+// deviation well on smooth surfaces, but it is an estimate, not a bound on the Hausdorff distance:
+// a collapse can move a surface point further from the original than any of its planes tells
+
+enum {
+	MESH_LOD_MAX			= 8,	// LOD0 included
+	MESH_LOD_MIN_FACES		= 32
+};
+
+
+// build_lod_chain()	: build a chain of LODs, each holding about half the faces of its predecessor
+//		- vertex,		const float*	: vertex buffer with the position at the start of each vertex,	input
+//		- vertex_stride,const unsigned	: vertex stride, in floats,										input
+//		- num_vertices,	const unsigned	: number of vertices in the vertex buffer,						input
+//		- index,		const uint32_t*	: index buffer of LOD0,											input
+//		- num_faces,	const unsigned	: number of faces in the index buffer,							input
+//		- max_lods,		const unsigned	: upper limit of LODs, LOD0 included,							input
+//		- lod_index,	vector&			: indices of LOD1 onwards, to be appended to the LOD0 indices,	output
+//		- lods,			vector&			: resulting LODs, LOD0 included,								output
+// returns
+//		bool			: success
+
+bool
+build_lod_chain(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	const unsigned num_vertices,
+	const uint32_t* const index,
+	const unsigned num_faces,
+	const unsigned max_lods,
+	std::vector< uint32_t >& lod_index,
+	std::vector< MeshLod >& lods);
+
+
+// select_lod()	: select the coarsest LOD whose estimated screen-space error stays within the given
+// tolerance; as the error is an RMS estimate, isolated features may still deviate by more on screen
+//		- lods,			const MeshLod*	: LOD chain, finest first,										input
+//		- num_lods,		const unsigned	: number of LODs,												input
+//		- radius_px,	const float		: projected bounding-sphere radius, in pixels,					input
+//		- max_error_px,	const float		: tolerance of estimated screen-space error, in pixels,			input
+// returns
+//		unsigned		: index of the selected LOD
+
+unsigned
+select_lod(
+	const MeshLod* const lods,
+	const unsigned num_lods,
+	const float radius_px,
+	const float max_error_px);
+
+} // namespace rend
+
+#endif // rend_simplify_H__
@@ -0,0 +1,408 @@
+#include <unistd.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+#include <vector>
+#include <iostream>
+
+#include "rendTangent.hpp"
+
+namespace rend
+{
+
+namespace
+{
+
+// angle-weighted tangent of a face corner, and the corner angle signed by the face's uv handedness
+struct Corner
+{
+	float tangent[3];
+	float weight;
+};
+
+template < typename INDEX_T >
+struct TangentJob
+{
+	const float* vertex;
+	unsigned vertex_stride;
+	unsigned normal_offset;
+	unsigned tcoord_offset;
+	const INDEX_T* index;
+
+	float* tangent;
+	unsigned tangent_stride;
+
+	Corner* corner;
+	const unsigned* vertex_corner_start;	// vertex-to-corner adjacency, in CSR form
+	const unsigned* vertex_corner;
+};
+
+template < typename INDEX_T >
+struct TangentRange
+{
+	const TangentJob< INDEX_T >* job;
+	unsigned begin;
+	unsigned end;
+	void (* func)(const TangentJob< INDEX_T >&, const unsigned, const unsigned);
+};
+
+
+static inline float
+dot3(
+	const float (&a)[3],
+	const float (&b)[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+
+// remove the component along unit vector n, then normalize; returns false for a vanishing result
+static inline bool
+project_normalize(
+	float (&v)[3],
+	const float* const n)
+{
+	const float d = v[0] * n[0] + v[1] * n[1] + v[2] * n[2];
+
+	v[0] -= n[0] * d;
+	v[1] -= n[1] * d;
+	v[2] -= n[2] * d;
+
+	const float len = sqrtf(dot3(v, v));
+
+	if (!(len > 1e-20f))
+		return false;
+
+	v[0] /= len;
+	v[1] /= len;
+	v[2] /= len;
+
+	return true;
+}
+
+
+template < typename INDEX_T >
+static void
+build_corners(
+	const TangentJob< INDEX_T >& job,
+	const unsigned begin,
+	const unsigned end)
+{
+	for (unsigned i = begin; i < end; ++i)
+	{
+		const INDEX_T* const fi = job.index + i * 3;
+
+		const float* const p[3] =
+		{
+			job.vertex + size_t(fi[0]) * job.vertex_stride,
+			job.vertex + size_t(fi[1]) * job.vertex_stride,
+			job.vertex + size_t(fi[2]) * job.vertex_stride
+		};
+
+		const float* const t0 = p[0] + job.tcoord_offset;
+		const float* const t1 = p[1] + job.tcoord_offset;
+		const float* const t2 = p[2] + job.tcoord_offset;
+
+		const float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+		const float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+		const float d1[2] = { t1[0] - t0[0], t1[1] - t0[1] };
+		const float d2[2] = { t2[0] - t0[0], t2[1] - t0[1] };
+
+		// twice the signed area of the face in uv space; its sign is the handedness of the face
+		const float area_uv = d1[0] * d2[1] - d2[0] * d1[1];
+		const float sign = area_uv < 0.f ? -1.f : 1.f;
+
+		const float face_tangent[3] =
+		{
+			sign * (d2[1] * e1[0] - d1[1] * e2[0]),
+			sign * (d2[1] * e1[1] - d1[1] * e2[1]),
+			sign * (d2[1] * e1[2] - d1[1] * e2[2])
+		};
+
+		for (unsigned j = 0; j < 3; ++j)
+		{
+			Corner& corner = job.corner[i * 3 + j];
+
+			corner.tangent[0] = 0.f;
+			corner.tangent[1] = 0.f;
+			corner.tangent[2] = 0.f;
+			corner.weight = 0.f;
+
+			// faces degenerate in uv space contribute nothing, as in MikkTSpace
+			if (!(fabsf(area_uv) > 1e-20f))
+				continue;
+
+			const float* const n = p[j] + job.normal_offset;
+			const float* const pnext = p[(j + 1) % 3];
+			const float* const pprev = p[(j + 2) % 3];
+
+			float edge_next[3] = { pnext[0] - p[j][0], pnext[1] - p[j][1], pnext[2] - p[j][2] };
+			float edge_prev[3] = { pprev[0] - p[j][0], pprev[1] - p[j][1], pprev[2] - p[j][2] };
+			float t[3] = { face_tangent[0], face_tangent[1], face_tangent[2] };
+
+			if (!project_normalize(edge_next, n) ||
+				!project_normalize(edge_prev, n) ||
+				!project_normalize(t, n))
+			{
+				continue;
+			}
+
+			const float cos_angle = dot3(edge_next, edge_prev);
+			const float angle = acosf(cos_angle < -1.f ? -1.f : (cos_angle > 1.f ? 1.f : cos_angle));
+
+			corner.tangent[0] = t[0] * angle;
+			corner.tangent[1] = t[1] * angle;
+			corner.tangent[2] = t[2] * angle;
+			corner.weight = sign * angle;
+		}
+	}
+}
+
+
+template < typename INDEX_T >
+static void
+build_vertex_tangents(
+	const TangentJob< INDEX_T >& job,
+	const unsigned begin,
+	const unsigned end)
+{
+	for (unsigned i = begin; i < end; ++i)
+	{
+		float t[3] = { 0.f, 0.f, 0.f };
+		float w = 0.f;
+
+		for (unsigned j = job.vertex_corner_start[i]; j < job.vertex_corner_start[i + 1]; ++j)
+		{
+			const Corner& corner = job.corner[job.vertex_corner[j]];
+
+			t[0] += corner.tangent[0];
+			t[1] += corner.tangent[1];
+			t[2] += corner.tangent[2];
+			w += corner.weight;
+		}
+
+		const float* const n = job.vertex + size_t(i) * job.vertex_stride + job.normal_offset;
+
+		// vertices void of usable corners get an arbitrary tangent orthogonal to their normal
+		if (!project_normalize(t, n))
+		{
+			const float ax = fabsf(n[0]);
+			const float ay = fabsf(n[1]);
+			const float az = fabsf(n[2]);
+
+			t[0] = ax <= ay && ax <= az ? 1.f : 0.f;
+			t[1] = ay < ax && ay <= az ? 1.f : 0.f;
+			t[2] = az < ax && az < ay ? 1.f : 0.f;
+
+			if (!project_normalize(t, n))
+			{
+				t[0] = 1.f;
+				t[1] = 0.f;
+				t[2] = 0.f;
+			}
+		}
+
+		float* const ti = job.tangent + size_t(i) * job.tangent_stride;
+
+		ti[0] = t[0];
+		ti[1] = t[1];
+		ti[2] = t[2];
+		ti[3] = w < 0.f ? -1.f : 1.f;
+	}
+}
+
+
+template < typename INDEX_T >
+static void*
+run_range(
+	void* arg)
+{
+	const TangentRange< INDEX_T >& range = *reinterpret_cast< const TangentRange< INDEX_T >* >(arg);
+
+	range.func(*range.job, range.begin, range.end);
+
+	return 0;
+}
+
+
+// split [0, count) into ranges of no less than min_count elements, and run func over them on up to
+// num_threads threads, the calling thread included; falls back to fewer threads when these fail to start
+template < typename INDEX_T >
+static void
+run_parallel(
+	const TangentJob< INDEX_T >& job,
+	void (* const func)(const TangentJob< INDEX_T >&, const unsigned, const unsigned),
+	const unsigned count,
+	const unsigned min_count,
+	const unsigned num_threads)
+{
+	unsigned num_ranges = (count + min_count - 1) / min_count;
+
+	if (num_ranges > num_threads)
+		num_ranges = num_threads;
+
+	if (num_ranges < 2)
+	{
+		func(job, 0, count);
+		return;
+	}
+
+	std::vector< TangentRange< INDEX_T > > range(num_ranges);
+	std::vector< pthread_t > thread;
+	thread.reserve(num_ranges - 1);
+
+	for (unsigned i = 0; i < num_ranges; ++i)
+	{
+		range[i].job = &job;
+		range[i].begin = unsigned(uint64_t(count) * i / num_ranges);
+		range[i].end = unsigned(uint64_t(count) * (i + 1) / num_ranges);
+		range[i].func = func;
+	}
+
+	// calling thread takes the first range, and any ranges whose threads failed to start
+	unsigned num_started = 1;
+
+	for (; num_started < num_ranges; ++num_started)
+	{
+		pthread_t t;
+
+		if (0 != pthread_create(&t, NULL, run_range< INDEX_T >, &range[num_started]))
+			break;
+
+		thread.push_back(t);
+	}
+
+	func(job, range[0].begin, range[0].end);
+
+	for (unsigned i = num_started; i < num_ranges; ++i)
+		func(job, range[i].begin, range[i].end);
+
+	for (size_t i = 0; i < thread.size(); ++i)
+		pthread_join(thread[i], NULL);
+}
+
+
+template < typename INDEX_T >
+static bool
+build_tangents_generic(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	const unsigned normal_offset,
+	const unsigned tcoord_offset,
+	const unsigned num_vertices,
+	const INDEX_T* const index,
+	const unsigned num_faces,
+	float* const tangent,
+	const unsigned tangent_stride,
+	const unsigned num_threads)
+{
+	assert(0 != vertex);
+	assert(0 != index);
+	assert(0 != tangent);
+
+	if (0 == num_vertices ||
+		0 == num_faces ||
+		normal_offset + 3 > vertex_stride ||
+		tcoord_offset + 2 > vertex_stride ||
+		4 > tangent_stride)
+	{
+		std::cerr << __FUNCTION__ << " got invalid arguments" << std::endl;
+		return false;
+	}
+
+	for (unsigned i = 0; i < num_faces * 3; ++i)
+		if (index[i] >= num_vertices)
+		{
+			std::cerr << __FUNCTION__ << " encountered an out-of-range index" << std::endl;
+			return false;
+		}
+
+	long count = num_threads;
+
+	if (0 == count)
+		count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (0 >= count)
+		count = 1;
+
+	// vertex-to-corner adjacency, so that per-vertex sums can be done by disjoint vertex ranges
+	std::vector< unsigned > vertex_corner_start(num_vertices + 1, 0);
+	std::vector< unsigned > vertex_corner(num_faces * 3);
+
+	for (unsigned i = 0; i < num_faces * 3; ++i)
+		++vertex_corner_start[index[i] + 1];
+
+	for (unsigned i = 0; i < num_vertices; ++i)
+		vertex_corner_start[i + 1] += vertex_corner_start[i];
+
+	{
+		std::vector< unsigned > fill(vertex_corner_start.begin(), vertex_corner_start.end() - 1);
+
+		for (unsigned i = 0; i < num_faces * 3; ++i)
+			vertex_corner[fill[index[i]]++] = i;
+	}
+
+	std::vector< Corner > corner(num_faces * 3);
+
+	TangentJob< INDEX_T > job;
+
+	job.vertex = vertex;
+	job.vertex_stride = vertex_stride;
+	job.normal_offset = normal_offset;
+	job.tcoord_offset = tcoord_offset;
+	job.index = index;
+	job.tangent = tangent;
+	job.tangent_stride = tangent_stride;
+	job.corner = &corner.front();
+	job.vertex_corner_start = &vertex_corner_start.front();
+	job.vertex_corner = &vertex_corner.front();
+
+	run_parallel(job, build_corners< INDEX_T >, num_faces,
+		TANGENT_MIN_FACES_PER_THREAD, unsigned(count));
+
+	run_parallel(job, build_vertex_tangents< INDEX_T >, num_vertices,
+		TANGENT_MIN_FACES_PER_THREAD, unsigned(count));
+
+	return true;
+}
+
+} // namespace
+
+
+bool
+build_tangents(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	const unsigned normal_offset,
+	const unsigned tcoord_offset,
+	const unsigned num_vertices,
+	const uint16_t* const index,
+	const unsigned num_faces,
+	float* const tangent,
+	const unsigned tangent_stride,
+	const unsigned num_threads)
+{
+	return build_tangents_generic(vertex, vertex_stride, normal_offset, tcoord_offset,
+		num_vertices, index, num_faces, tangent, tangent_stride, num_threads);
+}
+
+
+bool
+build_tangents(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	const unsigned normal_offset,
+	const unsigned tcoord_offset,
+	const unsigned num_vertices,
+	const uint32_t* const index,
+	const unsigned num_faces,
+	float* const tangent,
+	const unsigned tangent_stride,
+	const unsigned num_threads)
+{
+	return build_tangents_generic(vertex, vertex_stride, normal_offset, tcoord_offset,
+		num_vertices, index, num_faces, tangent, tangent_stride, num_threads);
+}
+
+} // namespace rend
@@ -0,0 +1,64 @@
+#ifndef rend_tangent_H__
+#define rend_tangent_H__
+
+#include <stdint.h>
+
+namespace rend
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// tangent frames follow the MikkTSpace conventions: per face corner, the texcoord-derived tangent is
+// projected onto the plane of the vertex normal, normalized and weighted by the corner angle; per
+// vertex, the weighted corner tangents are summed and re-normalized; the bitangent is not stored but
+// reconstructed in the shader as sign * cross(normal, tangent), the sign being the uv handedness
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum {
+	TANGENT_MIN_FACES_PER_THREAD	= 4096
+};
+
+
+// build_tangents()	: build per-vertex tangent frames over a trilist, in parallel over face ranges,
+//					  and then over vertex ranges; threads accumulate into disjoint ranges, so no locks
+//		- vertex,		const float*	: vertex buffer with the position at the start of each vertex,	input
+//		- vertex_stride,const unsigned	: vertex stride, in floats,										input
+//		- normal_offset,const unsigned	: offset of the normal in the vertex, in floats,				input
+//		- tcoord_offset,const unsigned	: offset of the texcoord in the vertex, in floats,				input
+//		- num_vertices,	const unsigned	: number of vertices in the vertex buffer,						input
+//		- index,		const uintN_t*	: index buffer,													input
+//		- num_faces,	const unsigned	: number of faces in the index buffer,							input
+//		- tangent,		float*			: tangent xyz and handedness w of each vertex,					output
+//		- tangent_stride,const unsigned	: tangent stride, in floats,									input
+//		- num_threads,	const unsigned	: upper limit of threads; zero means one per online CPU,		input
+// returns
+//		bool			: success
+
+bool
+build_tangents(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	const unsigned normal_offset,
+	const unsigned tcoord_offset,
+	const unsigned num_vertices,
+	const uint16_t* const index,
+	const unsigned num_faces,
+	float* const tangent,
+	const unsigned tangent_stride,
+	const unsigned num_threads = 0);
+
+bool
+build_tangents(
+	const float* const vertex,
+	const unsigned vertex_stride,
+	const unsigned normal_offset,
+	const unsigned tcoord_offset,
+	const unsigned num_vertices,
+	const uint32_t* const index,
+	const unsigned num_faces,
+	float* const tangent,
+	const unsigned tangent_stride,
+	const unsigned num_threads = 0);
+
+} // namespace rend
+
+#endif // rend_tangent_H__
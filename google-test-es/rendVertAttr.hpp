@@ -26,6 +26,7 @@ struct ActiveAttrSemantics
 	int semantics_blendw;
 	int semantics_tcoord;
 	int semantics_index;
+	int semantics_tangent;
 
 	ActiveAttrSemantics()
 	: num_active_attr(0)
@@ -34,6 +35,7 @@ struct ActiveAttrSemantics
 	, semantics_blendw(-1)
 	, semantics_tcoord(-1)
 	, semantics_index(-1)
+	, semantics_tangent(-1)
 	{}
 
 	int registerAttr(
@@ -54,11 +56,15 @@ struct ActiveAttrSemantics
 	bool registerIndexAttr(
 		const GLint attr);
 
+	bool registerTangentAttr(
+		const GLint attr);
+
 	GLint getVertexAttr() const;
 	GLint getNormalAttr() const;
 	GLint getBlendWAttr() const;
 	GLint getTCoordAttr() const;
 	GLint getIndexAttr() const;
+	GLint getTangentAttr() const;
 };
 
 
@@ -145,6 +151,19 @@ ActiveAttrSemantics::registerIndexAttr(
 }
 
 
+inline bool
+ActiveAttrSemantics::registerTangentAttr(
+	const GLint attr)
+{
+	assert(-1 == semantics_tangent);
+
+	if (-1 == semantics_tangent)
+		return -1 != (semantics_tangent = registerAttr(attr));
+
+	return false;
+}
+
+
 inline GLint
 ActiveAttrSemantics::getVertexAttr() const
 {
@@ -204,6 +223,18 @@ ActiveAttrSemantics::getIndexAttr() const
 	return -1;
 }
 
+
+inline GLint
+ActiveAttrSemantics::getTangentAttr() const
+{
+	assert(unsigned(semantics_tangent) < num_active_attr);
+
+	if (unsigned(semantics_tangent) < num_active_attr)
+		return active_attr[semantics_tangent];
+
+	return -1;
+}
+
 } // namespace rend
 
 #endif // rend_vert_attr_H__
@@ -10,6 +10,7 @@
 #define SETUP_VERTEX_ATTR_POINTERS_MASK_tcoord		0x00000008
 #define SETUP_VERTEX_ATTR_POINTERS_MASK_index		0x00000010
 #define SETUP_VERTEX_ATTR_POINTERS_MASK_vert2d		0x00000020
+#define SETUP_VERTEX_ATTR_POINTERS_MASK_tangent		0x00000040
 
 #if SETUP_VERTEX_ATTR_POINTERS_MASK == 0
 #error SETUP_VERTEX_ATTR_POINTERS_MASK missing or nil
@@ -130,6 +131,23 @@ setupVertexAttrPointers(
 #else
 	assert(active_attr_semantics.semantics_index == -1);
 
+#endif
+
+#if SETUP_VERTEX_ATTR_POINTERS_MASK & SETUP_VERTEX_ATTR_POINTERS_MASK_tangent
+
+	if (active_attr_semantics.semantics_tangent != -1)
+	{
+		const float (VERTEX_T::* const offs)[4] = &VERTEX_T::tan;
+
+		glVertexAttribPointer(active_attr_semantics.getTangentAttr(), 4, GL_FLOAT, GL_FALSE, sizeof(VERTEX_T),
+			*reinterpret_cast< const int8_t* const* >(&offs) + va);
+
+		DEBUG_GL_ERR()
+	}
+
+#else
+	assert(active_attr_semantics.semantics_tangent == -1);
+
 #endif
 
 	return true;
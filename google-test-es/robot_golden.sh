@@ -0,0 +1,129 @@
+#!/bin/bash
+
+# golden-image regression runner: each test binary present is run over the configurations of its robot
+# script, grabbing the frame its *_ref.raw was taken at, which golden_diff then checks against the reference;
+# where a test_headless_* build of the same app is present, it runs in place of the X11 build, sans display;
+# the runner exits with the number of regressions, or with a robot error code on failure to run
+#
+# environment:
+#	GOLDEN_LAUNCH	: command prefixed to each run of an X11 build, eg. "xvfb-run -a" on a machine sans display
+#	GOLDEN_DIFF		: options to golden_diff, eg. '-tolerance 2 -min_ssim .99'; default is exact match
+#	GOLDEN_OUT		: directory for grabs and diff images; default is golden_out
+
+if [ ! -x ./golden_diff ]; then
+
+	echo "robot error: golden_diff not found; build it with build_golden_diff.sh"
+	exit 255
+fi
+
+GOLDEN_OUT=${GOLDEN_OUT:-golden_out}
+
+mkdir -p $GOLDEN_OUT
+
+if (( 0 != $? )); then
+
+	echo "robot error: cannot create output directory "$GOLDEN_OUT
+	exit 254
+fi
+
+# test binary, index of the grabbed frame, and the configuration of each of its references, in order
+GOLDEN_TEST=(
+	test_imx5_sphere	7	'-bitness "5 6 5 0" -app "tile 4"'
+	test_imx5_sphere	7	'-bitness "5 6 5 0" -app "tile 4" -app "albedo_map foo 16 16"'
+	test_imx5_sphere	7	'-bitness "8 8 8 0" -app "tile 4"'
+	test_imx5_sphere	7	'-bitness "8 8 8 0" -app "tile 4" -app "albedo_map foo 16 16"'
+	test_imx5_fbo		7	'-bitness "5 6 5 0" -app "tile 4"'
+	test_imx5_fbo		7	'-bitness "5 6 5 0" -app "tile 4" -app "albedo_map foo 16 16"'
+	test_imx5_fbo		7	'-bitness "8 8 8 0" -app "tile 4"'
+	test_imx5_fbo		7	'-bitness "8 8 8 0" -app "tile 4" -app "albedo_map foo 16 16"'
+	test_imx5_skinning	127	'-bitness "5 6 5 0" -app "albedo_map foo 32 32"'
+	test_imx5_skinning	127	'-bitness "5 6 5 0" -app "albedo_map foo 32 32" -app alt_anim'
+	test_imx5_skinning	127	'-bitness "8 8 8 0" -app "albedo_map foo 32 32"'
+	test_imx5_skinning	127	'-bitness "8 8 8 0" -app "albedo_map foo 32 32" -app alt_anim'
+	test_imx5_matmul	0	'-drawcalls 16 -bitness "8 8 8 8"'
+	test_imx5_matmul	0	'-drawcalls 16 -bitness "8 8 8 8" -app linear_map'
+	test_c60_matmul		0	'-drawcalls 16 -skip_frames 5 -bitness "8 8 8 8"'
+	test_c60_matmul		0	'-drawcalls 16 -skip_frames 5 -bitness "8 8 8 8" -app linear_map'
+	test_c60_matmul		0	'-drawcalls 16 -skip_frames 5 -bitness "8 8 8 8" -app use_attrib'
+	test_c60_matmul		0	'-drawcalls 16 -skip_frames 5 -bitness "8 8 8 8" -app use_attrib -app linear_map'
+)
+
+N_TESTS=$(( ${#GOLDEN_TEST[@]} / 3 ))
+N_RUN=0
+N_SKIPPED=0
+N_REGRESSED=0
+PREV_TEST_ES=
+
+for (( j=0; j < $N_TESTS; j++)); do
+
+	TEST_ES=${GOLDEN_TEST[$(( j * 3 ))]}
+	FRAME=${GOLDEN_TEST[$(( j * 3 + 1 ))]}
+	TEST_ES_RUN=${GOLDEN_TEST[$(( j * 3 + 2 ))]}
+
+	# reference index runs per test binary
+	if [[ $TEST_ES != $PREV_TEST_ES ]]; then
+
+		i=0
+		PREV_TEST_ES=$TEST_ES
+	else
+		(( i++ ))
+	fi
+
+	RUN_REF=$TEST_ES"_"$i"_ref.raw"
+
+	# references are named after the platform they were taken on; prefer the headless build of the app
+	RUN_ES=test_headless_${TEST_ES#test_*_}
+	RUN_LAUNCH=
+
+	if [ ! -x ./$RUN_ES ]; then
+
+		RUN_ES=$TEST_ES
+		RUN_LAUNCH=$GOLDEN_LAUNCH
+	fi
+
+	if [ ! -x ./$RUN_ES ] || [ ! -f $RUN_REF ]; then
+
+		(( N_SKIPPED++ ))
+		continue
+	fi
+
+	RUN_GRAB=$GOLDEN_OUT/$TEST_ES"_"$i".raw"
+	RUN_DIFF=$GOLDEN_OUT/$TEST_ES"_"$i"_diff.raw"
+	ERR=$GOLDEN_OUT/$TEST_ES"_"$i".err"
+
+	rm -f $RUN_GRAB $RUN_DIFF
+
+	eval $RUN_LAUNCH "./"$RUN_ES $TEST_ES_RUN -frames $(( FRAME + 1 )) -grab_frame \"$FRAME $RUN_GRAB\" > /dev/null 2> $ERR
+
+	if (( 0 != $? )) || [ ! -f $RUN_GRAB ]; then
+
+		echo "robot error: test $TEST_ES $i failed to yield conformance sample; command line:"
+		echo $RUN_LAUNCH "./"$RUN_ES $TEST_ES_RUN -frames $(( FRAME + 1 )) -grab_frame \"$FRAME $RUN_GRAB\"
+		exit 253
+	fi
+
+	(( N_RUN++ ))
+
+	echo -e "test $TEST_ES $i ($RUN_ES): \c"
+
+	RESULT=$(eval ./golden_diff $GOLDEN_DIFF -diff $RUN_DIFF $RUN_GRAB $RUN_REF 2>&1)
+
+	case $? in
+	0)
+		echo ok
+		rm -f $RUN_DIFF
+		;;
+	1)
+		echo non-conformant: $RESULT
+		(( N_REGRESSED++ ))
+		;;
+	*)
+		echo "robot error: golden_diff failed: "$RESULT
+		exit 252
+		;;
+	esac
+done
+
+echo "tests run: $N_RUN, skipped for missing binary or reference: $N_SKIPPED, regressions: $N_REGRESSED"
+
+exit $N_REGRESSED
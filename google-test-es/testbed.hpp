@@ -36,6 +36,12 @@ setupShader(
 	const GLuint shader_name,
 	const char* const filename);
 
+bool
+setupShaderFromString(
+	const GLuint shader_name,
+	const char* const source,
+	const size_t length);
+
 bool
 setupShaderWithPatch(
 	const GLuint shader_name,
@@ -102,7 +108,9 @@ unsigned
 get_num_drawcalls();
 
 bool
-requires_depth();
+requires_depth(
+	const unsigned argc,
+	const char* const * argv);
 
 } // namespace hook
 } // namespace testbed
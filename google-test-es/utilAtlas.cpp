@@ -0,0 +1,366 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "utilAtlas.hpp"
+
+namespace testbed
+{
+
+namespace util
+{
+
+namespace
+{
+
+// a segment of the skyline: the top edge of the packed area over [x, x + w)
+struct skyline_t
+{
+	unsigned x;
+	unsigned y;
+	unsigned w;
+};
+
+// member order of packing: decreasing height, then decreasing width
+struct taller_t
+{
+	const std::vector< atlas_rect_t >& rect;
+
+	taller_t(
+		const std::vector< atlas_rect_t >& rect)
+	: rect(rect)
+	{}
+
+	bool operator ()(
+		const unsigned a,
+		const unsigned b) const
+	{
+		if (rect[a].h != rect[b].h)
+			return rect[a].h > rect[b].h;
+
+		return rect[a].w > rect[b].w;
+	}
+};
+
+} // namespace
+
+
+// lowest placement of a w-by-h rectangle whose left edge is at the start of the specified skyline segment
+static bool
+fit_skyline(
+	const std::vector< skyline_t >& sky,
+	const size_t segment,
+	const unsigned w,
+	const unsigned h,
+	const unsigned dim_w,
+	const unsigned dim_h,
+	unsigned& y)
+{
+	if (sky[segment].x + w > dim_w)
+		return false;
+
+	unsigned width_left = w;
+	y = sky[segment].y;
+
+	for (size_t i = segment; 0 != width_left; ++i)
+	{
+		assert(i < sky.size());
+
+		if (y < sky[i].y)
+			y = sky[i].y;
+
+		if (y + h > dim_h)
+			return false;
+
+		width_left -= std::min(width_left, sky[i].w);
+	}
+
+	return true;
+}
+
+
+// raise the skyline over a rectangle placed at the start of the specified segment
+static void
+add_skyline(
+	std::vector< skyline_t >& sky,
+	const size_t segment,
+	const unsigned w,
+	const unsigned top)
+{
+	const skyline_t raised = { sky[segment].x, top, w };
+	sky.insert(sky.begin() + segment, raised);
+
+	const unsigned right = raised.x + raised.w;
+
+	// trim or drop the segments now under the rectangle
+	for (size_t i = segment + 1; i < sky.size();)
+	{
+		if (sky[i].x >= right)
+			break;
+
+		const unsigned shrink = std::min(right - sky[i].x, sky[i].w);
+
+		sky[i].x += shrink;
+		sky[i].w -= shrink;
+
+		if (0 != sky[i].w)
+			break;
+
+		sky.erase(sky.begin() + i);
+	}
+
+	// merge neighbours of the same height
+	for (size_t i = 0; i + 1 < sky.size();)
+	{
+		if (sky[i].y == sky[i + 1].y)
+		{
+			sky[i].w += sky[i + 1].w;
+			sky.erase(sky.begin() + i + 1);
+			continue;
+		}
+
+		++i;
+	}
+}
+
+
+// place the gutter-padded members in the specified order, in an atlas of the specified dimensions
+static bool
+pack_skyline(
+	std::vector< atlas_rect_t >& rect,
+	const std::vector< unsigned >& order,
+	const unsigned gutter,
+	const unsigned dim_w,
+	const unsigned dim_h)
+{
+	std::vector< skyline_t > sky;
+	const skyline_t ground = { 0, 0, dim_w };
+	sky.push_back(ground);
+
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		atlas_rect_t& r = rect[order[i]];
+		const unsigned w = r.w + gutter * 2;
+		const unsigned h = r.h + gutter * 2;
+
+		size_t best_segment = sky.size();
+		unsigned best_top = unsigned(-1);
+
+		for (size_t j = 0; j < sky.size(); ++j)
+		{
+			unsigned y;
+
+			if (fit_skyline(sky, j, w, h, dim_w, dim_h, y) && y + h < best_top)
+			{
+				best_segment = j;
+				best_top = y + h;
+			}
+		}
+
+		if (sky.size() == best_segment)
+			return false;
+
+		r.x = sky[best_segment].x + gutter;
+		r.y = best_top - h + gutter;
+
+		add_skyline(sky, best_segment, w, best_top);
+	}
+
+	return true;
+}
+
+
+bool
+pack_atlas(
+	atlas_t& atlas,
+	const unsigned gutter,
+	const unsigned max_dim)
+{
+	if (atlas.rect.empty())
+	{
+		std::cerr << __FUNCTION__ << " got no members" << std::endl;
+		return false;
+	}
+
+	uint64_t area = 0;
+	unsigned max_w = 0;
+	unsigned max_h = 0;
+
+	for (size_t i = 0; i < atlas.rect.size(); ++i)
+	{
+		const atlas_rect_t& r = atlas.rect[i];
+
+		if (0 == r.w || 0 == r.h)
+		{
+			std::cerr << __FUNCTION__ << " got an empty member" << std::endl;
+			return false;
+		}
+
+		area += uint64_t(r.w + gutter * 2) * (r.h + gutter * 2);
+		max_w = std::max(max_w, r.w + gutter * 2);
+		max_h = std::max(max_h, r.h + gutter * 2);
+	}
+
+	std::vector< unsigned > order(atlas.rect.size());
+
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = unsigned(i);
+
+	std::stable_sort(order.begin(), order.end(), taller_t(atlas.rect));
+
+	unsigned log2_area = 0;
+
+	while ((uint64_t(1) << log2_area) < area)
+		++log2_area;
+
+	// power-of-two candidates by increasing area, each one square or twice as wide as high
+	for (;; ++log2_area)
+	{
+		const uint64_t dim_w = uint64_t(1) << (log2_area + 1) / 2;
+		const uint64_t dim_h = uint64_t(1) << log2_area / 2;
+
+		if (dim_w > max_dim)
+			break;
+
+		if (dim_w < max_w || dim_h < max_h)
+			continue;
+
+		if (pack_skyline(atlas.rect, order, gutter, unsigned(dim_w), unsigned(dim_h)))
+		{
+			atlas.w = unsigned(dim_w);
+			atlas.h = unsigned(dim_h);
+			atlas.gutter = gutter;
+			return true;
+		}
+	}
+
+	std::cerr << __FUNCTION__ << " failed to fit " << atlas.rect.size() <<
+		" members in an atlas of up to " << max_dim << " by " << max_dim << std::endl;
+
+	return false;
+}
+
+
+float
+atlas_t::get_fill_ratio() const
+{
+	if (0 == w || 0 == h)
+		return 0.f;
+
+	uint64_t area = 0;
+
+	for (size_t i = 0; i < rect.size(); ++i)
+		area += uint64_t(rect[i].w) * rect[i].h;
+
+	return float(double(area) / (uint64_t(w) * h));
+}
+
+
+void
+atlas_t::get_uv_transform(
+	const unsigned member,
+	float (&uv_transform)[4]) const
+{
+	assert(member < rect.size());
+	assert(0 != w && 0 != h);
+
+	const atlas_rect_t& r = rect[member];
+
+	uv_transform[0] = float(r.w) / w;
+	uv_transform[1] = float(r.h) / h;
+	uv_transform[2] = float(r.x) / w;
+	uv_transform[3] = float(r.y) / h;
+}
+
+
+bool
+fill_atlas(
+	const atlas_t& atlas,
+	const texture_bitmap_t* const* const member,
+	texture_bitmap_t& bitmap,
+	const char* const name)
+{
+	assert(0 != member);
+
+	if (0 == atlas.w || 0 == atlas.h)
+	{
+		std::cerr << __FUNCTION__ << " got an unpacked atlas" << std::endl;
+		return false;
+	}
+
+	for (size_t i = 0; i < atlas.rect.size(); ++i)
+	{
+		if (0 == member[i] ||
+			0 == member[i]->bitmap ||
+			member[i]->w != atlas.rect[i].w ||
+			member[i]->h != atlas.rect[i].h)
+		{
+			std::cerr << __FUNCTION__ << " got a member bitmap not matching its rect" << std::endl;
+			return false;
+		}
+	}
+
+	pix* const dst = reinterpret_cast< pix* >(calloc(size_t(atlas.w) * atlas.h, sizeof(pix)));
+
+	if (0 == dst)
+	{
+		std::cerr << __FUNCTION__ << " failed to allocate the atlas bitmap" << std::endl;
+		return false;
+	}
+
+	const unsigned gutter = atlas.gutter;
+
+	for (size_t i = 0; i < atlas.rect.size(); ++i)
+	{
+		const atlas_rect_t& r = atlas.rect[i];
+		const pix* const src = member[i]->bitmap;
+
+		// each row with its edge texels replicated into the side gutters
+		for (unsigned y = 0; y < r.h; ++y)
+		{
+			pix* const row = dst + size_t(r.y + y) * atlas.w + r.x;
+			const pix* const src_row = src + size_t(y) * r.w;
+
+			memcpy(row, src_row, sizeof(pix) * r.w);
+
+			for (unsigned g = 1; g <= gutter; ++g)
+			{
+				row[-int(g)] = src_row[0];
+				row[r.w - 1 + g] = src_row[r.w - 1];
+			}
+		}
+
+		// top and bottom gutters replicate the edge rows, side gutters included
+		const pix* const row_first = dst + size_t(r.y) * atlas.w + r.x - gutter;
+		const pix* const row_last = dst + size_t(r.y + r.h - 1) * atlas.w + r.x - gutter;
+
+		for (unsigned g = 1; g <= gutter; ++g)
+		{
+			memcpy(dst + size_t(r.y - g) * atlas.w + r.x - gutter, row_first, sizeof(pix) * (r.w + gutter * 2));
+			memcpy(dst + size_t(r.y + r.h - 1 + g) * atlas.w + r.x - gutter, row_last, sizeof(pix) * (r.w + gutter * 2));
+		}
+	}
+
+	// the atlas is of file origin as long as all its members are; the output bitmap may be a member
+	bool from_file = true;
+
+	for (size_t i = 0; i < atlas.rect.size(); ++i)
+		from_file = from_file && member[i]->from_file;
+
+	free(bitmap.bitmap);
+
+	bitmap.filename = name;
+	bitmap.bitmap = dst;
+	bitmap.w = atlas.w;
+	bitmap.h = atlas.h;
+	bitmap.from_file = from_file;
+
+	return true;
+}
+
+} // namespace util
+} // namespace testbed
@@ -0,0 +1,89 @@
+#ifndef util_atlas_H__
+#define util_atlas_H__
+
+#include <vector>
+#include "utilTex.hpp"
+
+namespace testbed
+{
+
+namespace util
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// texture atlases pack many small bitmaps into a single power-of-two bitmap, so that objects using
+// different bitmaps can be drawn with a single texture bind, and batched; each member gets a gutter
+// of its own edge texels replicated around it, which keeps bilinear filtering, and the mip levels up
+// to log2(gutter), from bleeding across members; texcoords outside [0, 1], ie. wrapped ones, cannot
+// be remapped into an atlas and need their bitmap standalone
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum {
+	ATLAS_DEFAULT_GUTTER	= 4,
+	ATLAS_DEFAULT_MAX_DIM	= 2048
+};
+
+struct atlas_rect_t
+{
+	unsigned x;		// placement of the member in the atlas, gutter excluded
+	unsigned y;
+	unsigned w;		// dimensions of the member
+	unsigned h;
+};
+
+struct atlas_t
+{
+	unsigned w;
+	unsigned h;
+	unsigned gutter;
+	std::vector< atlas_rect_t > rect;
+
+	atlas_t()
+	: w(0)
+	, h(0)
+	, gutter(0)
+	{}
+
+	// fraction of the atlas texels occupied by members, gutters excluded
+	float get_fill_ratio() const;
+
+	// texcoord transform of a member, as expected by the mesh loaders: scale_u, scale_v, offset_u, offset_v
+	void get_uv_transform(
+		const unsigned member,
+		float (&uv_transform)[4]) const;
+};
+
+// pack_atlas()	: lay out members in the smallest power-of-two atlas that fits them, using a skyline
+//				  bottom-left packer over the members sorted by decreasing height
+//		- atlas,		atlas_t&		: atlas whose rects carry the member dimensions,				input/output
+//		- gutter,		const unsigned	: texels of gutter around each member,							input
+//		- max_dim,		const unsigned	: upper limit of either atlas dimension,						input
+// returns
+//		bool			: success; members not fitting the maximal atlas fail it
+
+bool
+pack_atlas(
+	atlas_t& atlas,
+	const unsigned gutter = ATLAS_DEFAULT_GUTTER,
+	const unsigned max_dim = ATLAS_DEFAULT_MAX_DIM);
+
+// fill_atlas()	: compose the bitmap of a packed atlas from member bitmaps of the packed dimensions;
+//				  texels neither of a member nor of its gutter are left black
+//		- atlas,		const atlas_t&	: packed atlas,													input
+//		- member,		const texture_bitmap_t* const*	: bitmap of each member, in the atlas order,	input
+//		- bitmap,		texture_bitmap_t&	: bitmap of the atlas,										output
+//		- name,			const char*		: name of the atlas bitmap, in place of a filename; of static storage,	input
+// returns
+//		bool			: success
+
+bool
+fill_atlas(
+	const atlas_t& atlas,
+	const texture_bitmap_t* const* const member,
+	texture_bitmap_t& bitmap,
+	const char* const name = "atlas");
+
+} // namespace util
+} // namespace testbed
+
+#endif // util_atlas_H__
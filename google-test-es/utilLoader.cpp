@@ -0,0 +1,193 @@
+#include <unistd.h>
+#include <assert.h>
+#include <iostream>
+
+#include "get_file_size.hpp"
+#include "utilTex.hpp"
+#include "utilLoader.hpp"
+
+namespace testbed
+{
+
+namespace util
+{
+
+void*
+loader_t::work(
+	void* arg)
+{
+	loader_t& loader = *reinterpret_cast< loader_t* >(arg);
+
+	pthread_mutex_lock(&loader.mutex);
+
+	while (true)
+	{
+		while (!loader.quit && loader.next == loader.record.size())
+			pthread_cond_wait(&loader.cond_submit, &loader.mutex);
+
+		if (loader.quit)
+			break;
+
+		const size_t ticket = loader.next++;
+		job_t* const job = loader.record[ticket].job;
+		void* const job_arg = loader.record[ticket].arg;
+
+		loader.record[ticket].status = JOB_RUNNING;
+
+		pthread_mutex_unlock(&loader.mutex);
+
+		const bool success = job(job_arg);
+
+		pthread_mutex_lock(&loader.mutex);
+
+		loader.record[ticket].status = success ? JOB_SUCCEEDED : JOB_FAILED;
+		pthread_cond_broadcast(&loader.cond_finish);
+	}
+
+	pthread_mutex_unlock(&loader.mutex);
+
+	return 0;
+}
+
+
+loader_t::loader_t(
+	const unsigned num_workers)
+: next(0)
+, quit(false)
+{
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond_submit, NULL);
+	pthread_cond_init(&cond_finish, NULL);
+
+	long count = num_workers;
+
+	if (0 == count)
+		count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (0 >= count)
+		count = 1;
+
+	worker.reserve(count);
+
+	for (long i = 0; i < count; ++i)
+	{
+		pthread_t thread;
+		const int r = pthread_create(&thread, NULL, work, this);
+
+		if (0 != r)
+		{
+			std::cerr << __FUNCTION__ << " failed to start worker " << i << ", err: " << r << std::endl;
+			break;
+		}
+
+		worker.push_back(thread);
+	}
+}
+
+
+loader_t::~loader_t()
+{
+	pthread_mutex_lock(&mutex);
+
+	quit = true;
+	pthread_cond_broadcast(&cond_submit);
+
+	pthread_mutex_unlock(&mutex);
+
+	for (size_t i = 0; i < worker.size(); ++i)
+	{
+		const int r = pthread_join(worker[i], NULL);
+
+		if (0 != r)
+			std::cerr << __FUNCTION__ << " failed to join worker " << i << ", err: " << r << std::endl;
+	}
+
+	pthread_cond_destroy(&cond_finish);
+	pthread_cond_destroy(&cond_submit);
+	pthread_mutex_destroy(&mutex);
+}
+
+
+unsigned
+loader_t::submit(
+	job_t* const job,
+	void* const arg)
+{
+	assert(0 != job);
+
+	pthread_mutex_lock(&mutex);
+
+	const unsigned ticket = unsigned(record.size());
+	record.push_back(record_t(job, arg));
+
+	if (worker.empty())
+	{
+		next = record.size();
+		pthread_mutex_unlock(&mutex);
+
+		record[ticket].status = job(arg) ? JOB_SUCCEEDED : JOB_FAILED;
+		return ticket;
+	}
+
+	pthread_cond_signal(&cond_submit);
+	pthread_mutex_unlock(&mutex);
+
+	return ticket;
+}
+
+
+bool
+loader_t::wait(
+	const unsigned ticket)
+{
+	pthread_mutex_lock(&mutex);
+
+	assert(ticket < record.size());
+
+	while (JOB_PENDING == record[ticket].status ||
+		   JOB_RUNNING == record[ticket].status)
+	{
+		pthread_cond_wait(&cond_finish, &mutex);
+	}
+
+	const bool success = JOB_SUCCEEDED == record[ticket].status;
+
+	pthread_mutex_unlock(&mutex);
+
+	return success;
+}
+
+
+bool
+loadShaderSourceJob(
+	void* arg)
+{
+	shader_source_t& shader = *reinterpret_cast< shader_source_t* >(arg);
+
+	assert(0 != shader.filename);
+
+	free(shader.source);
+	shader.source = get_buffer_from_file(shader.filename, shader.length);
+
+	if (0 == shader.source)
+	{
+		std::cerr << __FUNCTION__ <<
+			" failed to read shader file '" << shader.filename << "'" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+bool
+loadTextureBitmapJob(
+	void* arg)
+{
+	texture_bitmap_job_t& job = *reinterpret_cast< texture_bitmap_job_t* >(arg);
+
+	return loadTextureBitmap(job.bitmap, job.filename, job.w, job.h);
+}
+
+} // namespace util
+} // namespace testbed
@@ -0,0 +1,138 @@
+#ifndef util_loader_H__
+#define util_loader_H__
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <vector>
+
+namespace testbed
+{
+
+namespace util
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// loader_t is a pool of worker threads which read and decode resources off the GL thread; the GL
+// thread submits all jobs up-front, then waits on each job right before uploading its product,
+// so uploads happen in the order the app consumes them, while file I/O and parsing overlap
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class loader_t
+{
+public:
+	typedef bool (job_t)(void* arg);
+
+private:
+	enum {
+		JOB_PENDING,
+		JOB_RUNNING,
+		JOB_SUCCEEDED,
+		JOB_FAILED
+	};
+
+	struct record_t
+	{
+		job_t* job;
+		void* arg;
+		unsigned status;
+
+		record_t(
+			job_t* const job,
+			void* const arg)
+		: job(job)
+		, arg(arg)
+		, status(JOB_PENDING)
+		{}
+	};
+
+	std::vector< pthread_t > worker;
+	std::vector< record_t > record;
+	size_t next;
+	bool quit;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond_submit;
+	pthread_cond_t cond_finish;
+
+	static void* work(void* arg);
+
+	loader_t(const loader_t&);
+	loader_t& operator =(const loader_t&);
+
+public:
+	// num_workers of zero means one worker per online CPU; should workers fail to start, jobs get
+	// executed synchronously at submission
+	loader_t(const unsigned num_workers = 0);
+
+	// drop jobs not started yet and join the workers; a loader must outlive its jobs' arguments
+	~loader_t();
+
+	unsigned submit(
+		job_t* const job,
+		void* const arg);
+
+	// block until the specified job is done; returns job's success
+	bool wait(
+		const unsigned ticket);
+};
+
+
+// shader source read off the GL thread, to be fed to setupShaderFromString
+struct shader_source_t
+{
+	const char* filename;
+	char* source;
+	size_t length;
+
+	shader_source_t(
+		const char* const filename)
+	: filename(filename)
+	, source(0)
+	, length(0)
+	{}
+
+	~shader_source_t()
+	{
+		free(source);
+	}
+
+private:
+	shader_source_t(const shader_source_t&);
+	shader_source_t& operator =(const shader_source_t&);
+};
+
+// loader_t job: arg is shader_source_t*
+bool
+loadShaderSourceJob(
+	void* arg);
+
+// loader_t job: arg is texture_bitmap_job_t*
+bool
+loadTextureBitmapJob(
+	void* arg);
+
+struct texture_bitmap_t;
+
+struct texture_bitmap_job_t
+{
+	texture_bitmap_t& bitmap;
+	const char* filename;
+	unsigned w;
+	unsigned h;
+
+	texture_bitmap_job_t(
+		texture_bitmap_t& bitmap,
+		const char* const filename,
+		const unsigned w,
+		const unsigned h)
+	: bitmap(bitmap)
+	, filename(filename)
+	, w(w)
+	, h(h)
+	{}
+};
+
+} // namespace util
+} // namespace testbed
+
+#endif // util_loader_H__
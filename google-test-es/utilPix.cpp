@@ -1,10 +1,17 @@
+#include <unistd.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
 
 #include "get_file_size.hpp"
 #include "testbed.hpp"
 #include "utilPix.hpp"
+#include "utilPix_simd.hpp"
 
 namespace testbed
 {
@@ -104,14 +111,14 @@ fill_from_file(
 
 	if (row_size != stride)
 	{
-		scoped_ptr< pix, generic_free > tmp(
-			reinterpret_cast< pix* >(malloc(img_size)));
+		// read rows in place, rather than through a staging copy of the image
+		unsigned i = 0;
 
-		read = fread(tmp(), img_size, 1, file());
+		for (; i < dim_y; ++i)
+			if (1 != fread(reinterpret_cast< uint8_t* >(buffer) + i * stride, row_size, 1, file()))
+				break;
 
-		for (unsigned i = 0; i < dim_y; ++i)
-			memcpy(reinterpret_cast< uint8_t* >(buffer) + i * stride,
-				tmp() + i * dim_x, row_size);
+		read = dim_y == i;
 	}
 	else
 		read = fread(buffer, img_size, 1, file());
@@ -126,125 +133,910 @@ fill_from_file(
 }
 
 
+unsigned
+select_simd_kernel()
+{
+#if PIX_SIMD_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return SIMD_KERNEL_AVX2;
+
+	if (__builtin_cpu_supports("sse4.1"))
+		return SIMD_KERNEL_SSE41;
+
+#elif PIX_SIMD_NEON
+	return SIMD_KERNEL_NEON;
+
+#endif
+	return SIMD_KERNEL_SCALAR;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// RGB to packed formats
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+enum {
+	PACKED_MIN_ROWS_PER_THREAD = 64
+};
+
+struct packed_from_rgb_job_t
+{
+	unsigned kernel;
+	packed_format_t format;
+	uint16_t bias[4][4];	// quantization bias by row and column, modulo 4, in 1/255 of a quantization step
+	const uint8_t* rgb_buffer;
+	unsigned rgb_stride;
+	uint8_t* packed_buffer;
+	unsigned packed_stride;
+	unsigned dim_x;
+
+	unsigned row_begin;
+	unsigned row_end;
+};
+
+} // namespace
+
+// 4x4 Bayer matrix of thresholds, in 1/16
+static const uint8_t bayer4[4][4] =
+{
+	{  0,  8,  2, 10 },
+	{ 12,  4, 14,  6 },
+	{  3, 11,  1,  9 },
+	{ 15,  7, 13,  5 }
+};
+
+
+// quantize a channel to [0, max], as floor((c * max + bias) / 255); the division is exact for dividends below 65535
+static inline unsigned
+quantize_channel(
+	const unsigned c,
+	const unsigned max,
+	const unsigned bias)
+{
+	const unsigned x = c * max + bias;
+
+	return (x + 1 + (x >> 8)) >> 8;
+}
+
+
+static void
+packed_from_rgb_scalar(
+	const packed_format_t format,
+	const uint16_t (&bias)[4],
+	const uint8_t* const rgb,
+	uint8_t* const packed,
+	const unsigned begin,
+	const unsigned n)
+{
+	for (unsigned i = begin; i < n; ++i)
+	{
+		const unsigned r = rgb[i * 3 + 0];
+		const unsigned g = rgb[i * 3 + 1];
+		const unsigned b = rgb[i * 3 + 2];
+		const unsigned d = bias[i & 3];
+
+		switch (format)
+		{
+		case PACKED_FORMAT_RGBA8888:
+			packed[i * 4 + 0] = uint8_t(r);
+			packed[i * 4 + 1] = uint8_t(g);
+			packed[i * 4 + 2] = uint8_t(b);
+			packed[i * 4 + 3] = 255;
+			break;
+
+		case PACKED_FORMAT_RGB565:
+			reinterpret_cast< uint16_t* >(packed)[i] = uint16_t(
+				quantize_channel(r, 31, d) << 11 |
+				quantize_channel(g, 63, d) << 5 |
+				quantize_channel(b, 31, d));
+			break;
+
+		case PACKED_FORMAT_RGBA4444:
+			reinterpret_cast< uint16_t* >(packed)[i] = uint16_t(
+				quantize_channel(r, 15, d) << 12 |
+				quantize_channel(g, 15, d) << 8 |
+				quantize_channel(b, 15, d) << 4 | 0xf);
+			break;
+		}
+	}
+}
+
+#if PIX_SIMD_X86
+
+__attribute__ ((target ("sse4.1")))
+static inline __m128i
+quantize_channel_sse41(
+	const __m128i c,
+	const __m128i max,
+	const __m128i bias)
+{
+	const __m128i x = _mm_add_epi16(_mm_mullo_epi16(c, max), bias);
+
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+}
+
+
+// 8 pixels of 16-bit channels, packed as per format
+__attribute__ ((target ("sse4.1")))
+static inline __m128i
+pack_16bpp_sse41(
+	const packed_format_t format,
+	const __m128i r,
+	const __m128i g,
+	const __m128i b,
+	const __m128i bias)
+{
+	if (PACKED_FORMAT_RGB565 == format)
+	{
+		const __m128i max5 = _mm_set1_epi16(31);
+
+		return _mm_or_si128(_mm_or_si128(
+			_mm_slli_epi16(quantize_channel_sse41(r, max5, bias), 11),
+			_mm_slli_epi16(quantize_channel_sse41(g, _mm_set1_epi16(63), bias), 5)),
+			quantize_channel_sse41(b, max5, bias));
+	}
+
+	const __m128i max4 = _mm_set1_epi16(15);
+
+	return _mm_or_si128(_mm_or_si128(
+		_mm_slli_epi16(quantize_channel_sse41(r, max4, bias), 12),
+		_mm_slli_epi16(quantize_channel_sse41(g, max4, bias), 8)), _mm_or_si128(
+		_mm_slli_epi16(quantize_channel_sse41(b, max4, bias), 4), _mm_set1_epi16(0xf)));
+}
+
+
+__attribute__ ((target ("sse4.1")))
+static unsigned
+packed_from_rgb_sse41(
+	const packed_format_t format,
+	const uint16_t (&bias)[4],
+	const uint8_t* const rgb,
+	uint8_t* const packed,
+	const unsigned n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i opaque = _mm_set1_epi8(-1);
+	const __m128i bias8 = _mm_setr_epi16(
+		bias[0], bias[1], bias[2], bias[3],
+		bias[0], bias[1], bias[2], bias[3]);
+
+	unsigned i = 0;
+
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i r, g, b;
+		deinterleave_rgb_sse41(rgb + i * 3, r, g, b);
+
+		if (PACKED_FORMAT_RGBA8888 == format)
+		{
+			const __m128i rg_lo = _mm_unpacklo_epi8(r, g);
+			const __m128i rg_hi = _mm_unpackhi_epi8(r, g);
+			const __m128i ba_lo = _mm_unpacklo_epi8(b, opaque);
+			const __m128i ba_hi = _mm_unpackhi_epi8(b, opaque);
+
+			__m128i* const dst = reinterpret_cast< __m128i* >(packed + i * 4);
+
+			_mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(rg_lo, ba_lo));
+			_mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(rg_lo, ba_lo));
+			_mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(rg_hi, ba_hi));
+			_mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(rg_hi, ba_hi));
+			continue;
+		}
+
+		__m128i* const dst = reinterpret_cast< __m128i* >(packed + i * 2);
+
+		_mm_storeu_si128(dst + 0, pack_16bpp_sse41(format,
+			_mm_cvtepu8_epi16(r), _mm_cvtepu8_epi16(g), _mm_cvtepu8_epi16(b), bias8));
+		_mm_storeu_si128(dst + 1, pack_16bpp_sse41(format,
+			_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(b, zero), bias8));
+	}
+
+	return i;
+}
+
+#elif PIX_SIMD_NEON
+
+static inline uint16x8_t
+quantize_channel_neon(
+	const uint16x8_t c,
+	const uint16_t max,
+	const uint16x8_t bias)
+{
+	const uint16x8_t x = vmlaq_n_u16(bias, c, max);
+
+	return vshrq_n_u16(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16(x, 8)), 8);
+}
+
+
+static inline uint16x8_t
+pack_16bpp_neon(
+	const packed_format_t format,
+	const uint8x8_t r,
+	const uint8x8_t g,
+	const uint8x8_t b,
+	const uint16x8_t bias)
+{
+	if (PACKED_FORMAT_RGB565 == format)
+		return vorrq_u16(vorrq_u16(
+			vshlq_n_u16(quantize_channel_neon(vmovl_u8(r), 31, bias), 11),
+			vshlq_n_u16(quantize_channel_neon(vmovl_u8(g), 63, bias), 5)),
+			quantize_channel_neon(vmovl_u8(b), 31, bias));
+
+	return vorrq_u16(vorrq_u16(
+		vshlq_n_u16(quantize_channel_neon(vmovl_u8(r), 15, bias), 12),
+		vshlq_n_u16(quantize_channel_neon(vmovl_u8(g), 15, bias), 8)), vorrq_u16(
+		vshlq_n_u16(quantize_channel_neon(vmovl_u8(b), 15, bias), 4), vdupq_n_u16(0xf)));
+}
+
+
+static unsigned
+packed_from_rgb_neon(
+	const packed_format_t format,
+	const uint16_t (&bias)[4],
+	const uint8_t* const rgb,
+	uint8_t* const packed,
+	const unsigned n)
+{
+	const uint16x4_t bias4 = vld1_u16(bias);
+	const uint16x8_t bias8 = vcombine_u16(bias4, bias4);
+
+	unsigned i = 0;
+
+	for (; i + 16 <= n; i += 16)
+	{
+		const uint8x16x3_t src = vld3q_u8(rgb + i * 3);
+
+		if (PACKED_FORMAT_RGBA8888 == format)
+		{
+			uint8x16x4_t dst;
+
+			dst.val[0] = src.val[0];
+			dst.val[1] = src.val[1];
+			dst.val[2] = src.val[2];
+			dst.val[3] = vdupq_n_u8(255);
+
+			vst4q_u8(packed + i * 4, dst);
+			continue;
+		}
+
+		uint16_t* const dst = reinterpret_cast< uint16_t* >(packed) + i;
+
+		vst1q_u16(dst + 0, pack_16bpp_neon(format,
+			vget_low_u8(src.val[0]), vget_low_u8(src.val[1]), vget_low_u8(src.val[2]), bias8));
+		vst1q_u16(dst + 8, pack_16bpp_neon(format,
+			vget_high_u8(src.val[0]), vget_high_u8(src.val[1]), vget_high_u8(src.val[2]), bias8));
+	}
+
+	return i;
+}
+
+#endif
+
+static void*
+packed_from_rgb_rows(
+	void* arg)
+{
+	const packed_from_rgb_job_t& job = *reinterpret_cast< const packed_from_rgb_job_t* >(arg);
+
+	for (unsigned i = job.row_begin; i < job.row_end; ++i)
+	{
+		const uint8_t* const rgb = job.rgb_buffer + size_t(i) * job.rgb_stride;
+		uint8_t* const packed = job.packed_buffer + size_t(i) * job.packed_stride;
+		const uint16_t (&bias)[4] = job.bias[i & 3];
+
+		unsigned done = 0;
+
+		switch (job.kernel)
+		{
+#if PIX_SIMD_X86
+		case SIMD_KERNEL_AVX2:
+		case SIMD_KERNEL_SSE41:
+			done = packed_from_rgb_sse41(job.format, bias, rgb, packed, job.dim_x);
+			break;
+
+#elif PIX_SIMD_NEON
+		case SIMD_KERNEL_NEON:
+			done = packed_from_rgb_neon(job.format, bias, rgb, packed, job.dim_x);
+			break;
+
+#endif
+		}
+
+		packed_from_rgb_scalar(job.format, bias, rgb, packed, done, job.dim_x);
+	}
+
+	return 0;
+}
+
+
+unsigned
+get_packed_size(
+	const packed_format_t format)
+{
+	return PACKED_FORMAT_RGBA8888 == format ? 4 : 2;
+}
+
+
 void
-fill_YUV420_from_RGB(
-	uint8_t* const y_buffer,
-	uint8_t* const u_buffer,
-	uint8_t* const v_buffer,
-	const unsigned y_stride,
-	const unsigned u_stride,
-	const unsigned v_stride,
-	pix* const rgb_buffer,
+fill_packed_from_RGB(
+	void* const packed_buffer,
+	const unsigned packed_stride,
+	const packed_format_t format,
+	const pix* const rgb_buffer,
 	const unsigned rgb_stride,
 	const unsigned dim_x,
-	const unsigned dim_y)
+	const unsigned dim_y,
+	const bool dither,
+	const unsigned num_threads)
 {
-	const pix* rgb_src[2] =
+	assert(0 != packed_buffer);
+	assert(0 != rgb_buffer);
+
+	packed_from_rgb_job_t job;
+
+	job.kernel = select_simd_kernel();
+	job.format = format;
+	job.rgb_buffer = reinterpret_cast< const uint8_t* >(rgb_buffer);
+	job.rgb_stride = rgb_stride;
+	job.packed_buffer = reinterpret_cast< uint8_t* >(packed_buffer);
+	job.packed_stride = packed_stride;
+	job.dim_x = dim_x;
+
+	// thresholds at the centres of the Bayer intervals when dithering, at one half for rounding to nearest otherwise
+	for (unsigned y = 0; y < 4; ++y)
+		for (unsigned x = 0; x < 4; ++x)
+			job.bias[y][x] = dither ? (bayer4[y][x] * 2 + 1) * 255 / 32 : 127;
+
+	run_rows_parallel(job, packed_from_rgb_rows, dim_y, PACKED_MIN_ROWS_PER_THREAD, num_threads);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// RGB channel remapping
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+enum {
+	REMAP_MIN_ROWS_PER_THREAD = 64
+};
+
+struct remap_job_t
+{
+	unsigned kernel;
+	uint8_t source[3];
+	uint8_t mask[3];		// xor mask applied after swizzling
+	uint8_t* buffer;
+	unsigned stride;
+	unsigned dim_x;
+
+	unsigned row_begin;
+	unsigned row_end;
+};
+
+} // namespace
+
+static void
+remap_scalar(
+	const remap_job_t& job,
+	uint8_t* const rgb,
+	const unsigned begin,
+	const unsigned end)
+{
+	for (unsigned i = begin; i < end; ++i)
 	{
-		rgb_buffer,
-		reinterpret_cast< pix* >(
-			reinterpret_cast< uint8_t* >(rgb_buffer) + rgb_stride)
-	};
+		uint8_t* const p = rgb + i * 3;
+		const uint8_t c[3] = { p[0], p[1], p[2] };
 
-	uint8_t* y_dst[2] =
+		p[0] = c[job.source[0]] ^ job.mask[0];
+		p[1] = c[job.source[1]] ^ job.mask[1];
+		p[2] = c[job.source[2]] ^ job.mask[2];
+	}
+}
+
+#if PIX_SIMD_X86
+
+// 5 pixels per 16-byte load, the 16th byte passing through unchanged, so that in-place stores are safe
+__attribute__ ((target ("sse4.1"))) static unsigned
+remap_sse41(
+	const remap_job_t& job,
+	uint8_t* const rgb,
+	const unsigned n)
+{
+	uint8_t shuffle[16];
+	uint8_t mask[16];
+
+	for (unsigned j = 0; j < 15; ++j)
+	{
+		shuffle[j] = uint8_t(j - j % 3 + job.source[j % 3]);
+		mask[j] = job.mask[j % 3];
+	}
+
+	shuffle[15] = 15;
+	mask[15] = 0;
+
+	const __m128i shuf = _mm_loadu_si128(reinterpret_cast< const __m128i* >(shuffle));
+	const __m128i xor_mask = _mm_loadu_si128(reinterpret_cast< const __m128i* >(mask));
+
+	unsigned i = 0;
+
+	for (; i + 6 <= n; i += 5)
 	{
-		y_buffer,
-		y_buffer + y_stride
+		__m128i* const p = reinterpret_cast< __m128i* >(rgb + i * 3);
+
+		_mm_storeu_si128(p, _mm_xor_si128(_mm_shuffle_epi8(_mm_loadu_si128(p), shuf), xor_mask));
+	}
+
+	return i;
+}
+
+#elif PIX_SIMD_NEON
+
+static unsigned
+remap_neon(
+	const remap_job_t& job,
+	uint8_t* const rgb,
+	const unsigned n)
+{
+	const uint8x16_t mask[3] =
+	{
+		vdupq_n_u8(job.mask[0]),
+		vdupq_n_u8(job.mask[1]),
+		vdupq_n_u8(job.mask[2])
 	};
 
-	uint8_t* u_dst = u_buffer;
-	uint8_t* v_dst = v_buffer;
+	unsigned i = 0;
+
+	for (; i + 16 <= n; i += 16)
+	{
+		const uint8x16x3_t src = vld3q_u8(rgb + i * 3);
+		uint8x16x3_t dst;
+
+		dst.val[0] = veorq_u8(src.val[job.source[0]], mask[0]);
+		dst.val[1] = veorq_u8(src.val[job.source[1]], mask[1]);
+		dst.val[2] = veorq_u8(src.val[job.source[2]], mask[2]);
+
+		vst3q_u8(rgb + i * 3, dst);
+	}
+
+	return i;
+}
 
-	const unsigned rgb_pad = rgb_stride - dim_x * sizeof(pix);
-	const unsigned y_pad = y_stride - dim_x;
-	const unsigned u_pad = u_stride - dim_x / 2;
-	const unsigned v_pad = v_stride - dim_x / 2;
+#endif
+
+static void*
+remap_rows(
+	void* arg)
+{
+	const remap_job_t& job = *reinterpret_cast< const remap_job_t* >(arg);
 
-	for (unsigned i = 0; i < dim_y / 2; ++i)
+	for (unsigned i = job.row_begin; i < job.row_end; ++i)
 	{
-		for (unsigned j = 0; j < dim_x / 2; ++j)
+		uint8_t* const rgb = job.buffer + size_t(i) * job.stride;
+
+		unsigned done = 0;
+
+		switch (job.kernel)
 		{
-			const float rgb[4][3] =
-			{
-				{
-					rgb_src[0][0].c[0] / 255.f,
-					rgb_src[0][0].c[1] / 255.f,
-					rgb_src[0][0].c[2] / 255.f
-				},
-				{
-					rgb_src[0][1].c[0] / 255.f,
-					rgb_src[0][1].c[1] / 255.f,
-					rgb_src[0][1].c[2] / 255.f
-				},
-				{
-					rgb_src[1][0].c[0] / 255.f,
-					rgb_src[1][0].c[1] / 255.f,
-					rgb_src[1][0].c[2] / 255.f
-				},
-				{
-					rgb_src[1][1].c[0] / 255.f,
-					rgb_src[1][1].c[1] / 255.f,
-					rgb_src[1][1].c[2] / 255.f
-				}
-			};
-
-			const float rgb_filt[3] =
-			{
-				(rgb[0][0] + rgb[1][0] + rgb[2][0] + rgb[3][0]) * .25f,
-				(rgb[0][1] + rgb[1][1] + rgb[2][1] + rgb[3][1]) * .25f,
-				(rgb[0][2] + rgb[1][2] + rgb[2][2] + rgb[3][2]) * .25f
-			};
-
-			// ITU-R BT.601 standard RGB-to-YPbPr
-			const float f[3][4] =
-			{
-				{  .299f,  .587f,  .114f,   0.f  },
-				{ -.169f, -.331f,  .499f,   .5f  },
-				{  .499f, -.418f, -.0813f,  .5f  }
-			};
-
-			const float y[4] =
-			{
-				f[0][0] * rgb[0][0] + f[0][1] * rgb[0][1] + f[0][2] * rgb[0][2],
-				f[0][0] * rgb[1][0] + f[0][1] * rgb[1][1] + f[0][2] * rgb[1][2],
-				f[0][0] * rgb[2][0] + f[0][1] * rgb[2][1] + f[0][2] * rgb[2][2],
-				f[0][0] * rgb[3][0] + f[0][1] * rgb[3][1] + f[0][2] * rgb[3][2]
-			};
-
-			const float u =
-				f[1][0] * rgb_filt[0] + f[1][1] * rgb_filt[1] + f[1][2] * rgb_filt[2] + f[1][3];
-
-			const float v =
-				f[2][0] * rgb_filt[0] + f[2][1] * rgb_filt[1] + f[2][2] * rgb_filt[2] + f[2][3];
-
-			y_dst[0][0] = uint8_t(y[0] * 255.f);
-			y_dst[0][1] = uint8_t(y[1] * 255.f);
-			y_dst[1][0] = uint8_t(y[2] * 255.f);
-			y_dst[1][1] = uint8_t(y[3] * 255.f);
-
-			u_dst[0] = uint8_t(u * 255.f);
-			v_dst[0] = uint8_t(v * 255.f);
-
-			rgb_src[0] += 2;
-			rgb_src[1] += 2;
-
-			y_dst[0] += 2;
-			y_dst[1] += 2;
-			u_dst += 1;
-			v_dst += 1;
+#if PIX_SIMD_X86
+		case SIMD_KERNEL_AVX2:
+		case SIMD_KERNEL_SSE41:
+			done = remap_sse41(job, rgb, job.dim_x);
+			break;
+
+#elif PIX_SIMD_NEON
+		case SIMD_KERNEL_NEON:
+			done = remap_neon(job, rgb, job.dim_x);
+			break;
+
+#endif
 		}
 
-		rgb_src[0] = reinterpret_cast< const pix* >(
-			reinterpret_cast< const uint8_t* >(rgb_src[1]) + rgb_pad);
-		rgb_src[1] = reinterpret_cast< const pix* >(
-			reinterpret_cast< const uint8_t* >(rgb_src[0]) + rgb_stride);
+		remap_scalar(job, rgb, done, job.dim_x);
+	}
+
+	return 0;
+}
+
+
+void
+remap_RGB_channels(
+	pix* const buffer,
+	const unsigned stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const unsigned (&source)[3],
+	const bool (&invert)[3],
+	const unsigned num_threads)
+{
+	assert(0 != buffer);
+	assert(source[0] < 3 && source[1] < 3 && source[2] < 3);
+
+	remap_job_t job;
 
-		y_dst[0] = y_dst[1] + y_pad;
-		y_dst[1] = y_dst[0] + y_stride;
+	job.kernel = select_simd_kernel();
+	job.buffer = reinterpret_cast< uint8_t* >(buffer);
+	job.stride = stride;
+	job.dim_x = dim_x;
 
-		u_dst += u_pad;
-		v_dst += v_pad;
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		job.source[i] = uint8_t(source[i]);
+		job.mask[i] = invert[i] ? 0xff : 0;
 	}
+
+	run_rows_parallel(job, remap_rows, dim_y, REMAP_MIN_ROWS_PER_THREAD, num_threads);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// normal maps from height maps
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+enum {
+	NORMAL_MIN_ROWS_PER_THREAD = 32,
+	NORMAL_ROW_GUARDBAND = 16		// bytes past the padded rows, for 8-sample loads
+};
+
+struct normal_job_t
+{
+	unsigned kernel;
+	int16_t weight_side;		// filter weights across the gradient: side, centre, side
+	int16_t weight_centre;
+	float scale;				// from filter response to height units per texel, negated
+	normal_wrap_t wrap;
+	const uint8_t* height_buffer;
+	unsigned height_stride;
+	uint8_t* normal_buffer;
+	unsigned normal_stride;
+	unsigned dim_x;
+	unsigned dim_y;
+
+	unsigned row_begin;
+	unsigned row_end;
+};
+
+} // namespace
+
+static inline unsigned
+address_normal_sample(
+	const int i,
+	const unsigned dim,
+	const normal_wrap_t wrap)
+{
+	if (0 <= i && unsigned(i) < dim)
+		return unsigned(i);
+
+	if (NORMAL_WRAP_CLAMP == wrap)
+		return 0 > i ? 0 : dim - 1;
+
+	return 0 > i ? dim - 1 : 0;
+}
+
+
+static inline void
+encode_normal(
+	uint8_t* const p,
+	const float nx,
+	const float ny)
+{
+	const float rcp_len = 1.f / sqrtf(nx * nx + ny * ny + 1.f);
+
+	p[0] = uint8_t(int(nx * rcp_len * 127.5f + 128.f));
+	p[1] = uint8_t(int(ny * rcp_len * 127.5f + 128.f));
+	p[2] = uint8_t(int(rcp_len * 127.5f + 128.f));
+}
+
+
+// rows above, at and below, each padded by a sample on either side; sample x is at index x + 1
+static void
+normal_scalar(
+	const normal_job_t& job,
+	const uint8_t* const (&row)[3],
+	uint8_t* const normal,
+	const unsigned begin,
+	const unsigned end)
+{
+	const int ws = job.weight_side;
+	const int wc = job.weight_centre;
+
+	for (unsigned i = begin; i < end; ++i)
+	{
+		const int gx =
+			ws * (row[0][i + 2] - row[0][i]) +
+			wc * (row[1][i + 2] - row[1][i]) +
+			ws * (row[2][i + 2] - row[2][i]);
+		const int gy =
+			ws * (row[2][i] - row[0][i]) +
+			wc * (row[2][i + 1] - row[0][i + 1]) +
+			ws * (row[2][i + 2] - row[0][i + 2]);
+
+		encode_normal(normal + i * 3, float(gx) * job.scale, float(gy) * job.scale);
+	}
+}
+
+#if PIX_SIMD_X86
+
+// encode 8 samples of gradients to normals, as 16-bit channels
+__attribute__ ((target ("sse4.1")))
+static inline void
+encode_normal_sse41(
+	const __m128i gx,
+	const __m128i gy,
+	const __m128 scale,
+	__m128i& x16,
+	__m128i& y16,
+	__m128i& z16)
+{
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 half_range = _mm_set1_ps(127.5f);
+	const __m128 bias = _mm_set1_ps(128.f);
+
+	__m128i c[3][2];
+
+	for (unsigned j = 0; j < 2; ++j)
+	{
+		const __m128 nx = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(0 == j ? gx : _mm_srli_si128(gx, 8))), scale);
+		const __m128 ny = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(0 == j ? gy : _mm_srli_si128(gy, 8))), scale);
+		const __m128 rcp_len = _mm_div_ps(one,
+			_mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), one)));
+
+		c[0][j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(nx, rcp_len), half_range), bias));
+		c[1][j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(ny, rcp_len), half_range), bias));
+		c[2][j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(rcp_len, half_range), bias));
+	}
+
+	x16 = _mm_packs_epi32(c[0][0], c[0][1]);
+	y16 = _mm_packs_epi32(c[1][0], c[1][1]);
+	z16 = _mm_packs_epi32(c[2][0], c[2][1]);
+}
+
+
+// gradients of 8 samples, in 16-bit lanes
+__attribute__ ((target ("sse4.1")))
+static inline void
+gradient_sse41(
+	const uint8_t* const (&row)[3],
+	const unsigned i,
+	const __m128i ws,
+	const __m128i wc,
+	__m128i& gx,
+	__m128i& gy)
+{
+	__m128i s[3][3];
+
+	for (unsigned r = 0; r < 3; ++r)
+		for (unsigned c = 0; c < 3; ++c)
+			s[r][c] = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast< const __m128i* >(row[r] + i + c)));
+
+	gx = _mm_add_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(ws, _mm_sub_epi16(s[0][2], s[0][0])),
+		_mm_mullo_epi16(wc, _mm_sub_epi16(s[1][2], s[1][0]))),
+		_mm_mullo_epi16(ws, _mm_sub_epi16(s[2][2], s[2][0])));
+	gy = _mm_add_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(ws, _mm_sub_epi16(s[2][0], s[0][0])),
+		_mm_mullo_epi16(wc, _mm_sub_epi16(s[2][1], s[0][1]))),
+		_mm_mullo_epi16(ws, _mm_sub_epi16(s[2][2], s[0][2])));
+}
+
+
+// returns the number of samples done; the rest are left to the scalar kernel
+__attribute__ ((target ("sse4.1")))
+static unsigned
+normal_sse41(
+	const normal_job_t& job,
+	const uint8_t* const (&row)[3],
+	uint8_t* const normal,
+	const unsigned n)
+{
+	const __m128i ws = _mm_set1_epi16(job.weight_side);
+	const __m128i wc = _mm_set1_epi16(job.weight_centre);
+	const __m128 scale = _mm_set1_ps(job.scale);
+
+	unsigned i = 0;
+
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i c[2][3];
+
+		for (unsigned j = 0; j < 2; ++j)
+		{
+			__m128i gx, gy;
+			gradient_sse41(row, i + j * 8, ws, wc, gx, gy);
+			encode_normal_sse41(gx, gy, scale, c[j][0], c[j][1], c[j][2]);
+		}
+
+		store_rgb_sse41(normal + i * 3, 3,
+			_mm_packus_epi16(c[0][0], c[1][0]),
+			_mm_packus_epi16(c[0][1], c[1][1]),
+			_mm_packus_epi16(c[0][2], c[1][2]));
+	}
+
+	return i;
+}
+
+#elif PIX_SIMD_NEON
+
+static inline uint8x8_t
+encode_normal_channel_neon(
+	const float32x4_t lo,
+	const float32x4_t hi)
+{
+	const float32x4_t half_range = vdupq_n_f32(127.5f);
+	const float32x4_t bias = vdupq_n_f32(128.f);
+
+	return vqmovn_u16(vcombine_u16(
+		vqmovn_u32(vcvtq_u32_f32(vmlaq_f32(bias, lo, half_range))),
+		vqmovn_u32(vcvtq_u32_f32(vmlaq_f32(bias, hi, half_range)))));
+}
+
+
+// 1 / sqrt by estimate and two Newton-Raphson steps, in lieu of a divide and a square root
+static inline float32x4_t
+rcp_len_neon(
+	const float32x4_t nx,
+	const float32x4_t ny)
+{
+	const float32x4_t len2 = vmlaq_f32(vmlaq_f32(vdupq_n_f32(1.f), nx, nx), ny, ny);
+
+	float32x4_t r = vrsqrteq_f32(len2);
+	r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(len2, r), r));
+	r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(len2, r), r));
+
+	return r;
+}
+
+
+static unsigned
+normal_neon(
+	const normal_job_t& job,
+	const uint8_t* const (&row)[3],
+	uint8_t* const normal,
+	const unsigned n)
+{
+	const int16x8_t ws = vdupq_n_s16(job.weight_side);
+	const int16x8_t wc = vdupq_n_s16(job.weight_centre);
+
+	unsigned i = 0;
+
+	for (; i + 8 <= n; i += 8)
+	{
+		int16x8_t s[3][3];
+
+		for (unsigned r = 0; r < 3; ++r)
+			for (unsigned c = 0; c < 3; ++c)
+				s[r][c] = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(row[r] + i + c)));
+
+		const int16x8_t gx = vmlaq_s16(vmlaq_s16(
+			vmulq_s16(ws, vsubq_s16(s[0][2], s[0][0])),
+			wc, vsubq_s16(s[1][2], s[1][0])),
+			ws, vsubq_s16(s[2][2], s[2][0]));
+		const int16x8_t gy = vmlaq_s16(vmlaq_s16(
+			vmulq_s16(ws, vsubq_s16(s[2][0], s[0][0])),
+			wc, vsubq_s16(s[2][1], s[0][1])),
+			ws, vsubq_s16(s[2][2], s[0][2]));
+
+		float32x4_t nx[2], ny[2], rcp_len[2];
+
+		for (unsigned j = 0; j < 2; ++j)
+		{
+			const int16x4_t gx4 = 0 == j ? vget_low_s16(gx) : vget_high_s16(gx);
+			const int16x4_t gy4 = 0 == j ? vget_low_s16(gy) : vget_high_s16(gy);
+
+			nx[j] = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(gx4)), job.scale);
+			ny[j] = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(gy4)), job.scale);
+			rcp_len[j] = rcp_len_neon(nx[j], ny[j]);
+		}
+
+		uint8x8x3_t dst;
+
+		dst.val[0] = encode_normal_channel_neon(vmulq_f32(nx[0], rcp_len[0]), vmulq_f32(nx[1], rcp_len[1]));
+		dst.val[1] = encode_normal_channel_neon(vmulq_f32(ny[0], rcp_len[0]), vmulq_f32(ny[1], rcp_len[1]));
+		dst.val[2] = encode_normal_channel_neon(rcp_len[0], rcp_len[1]);
+
+		vst3_u8(normal + i * 3, dst);
+	}
+
+	return i;
+}
+
+#endif
+
+static void*
+normal_rows(
+	void* arg)
+{
+	const normal_job_t& job = *reinterpret_cast< const normal_job_t* >(arg);
+	const unsigned padded_size = job.dim_x + 2 + NORMAL_ROW_GUARDBAND;
+
+	std::vector< uint8_t > padded(padded_size * 3);
+
+	for (unsigned i = job.row_begin; i < job.row_end; ++i)
+	{
+		const uint8_t* row[3];
+
+		for (unsigned r = 0; r < 3; ++r)
+		{
+			const unsigned y = address_normal_sample(int(i + r) - 1, job.dim_y, job.wrap);
+			const uint8_t* const src = job.height_buffer + size_t(y) * job.height_stride;
+			uint8_t* const dst = &padded[padded_size * r];
+
+			memcpy(dst + 1, src, job.dim_x);
+			dst[0] = src[address_normal_sample(-1, job.dim_x, job.wrap)];
+			dst[job.dim_x + 1] = src[address_normal_sample(int(job.dim_x), job.dim_x, job.wrap)];
+
+			row[r] = dst;
+		}
+
+		uint8_t* const normal = job.normal_buffer + size_t(i) * job.normal_stride;
+
+		unsigned done = 0;
+
+		switch (job.kernel)
+		{
+#if PIX_SIMD_X86
+		case SIMD_KERNEL_AVX2:
+		case SIMD_KERNEL_SSE41:
+			done = normal_sse41(job, row, normal, job.dim_x);
+			break;
+
+#elif PIX_SIMD_NEON
+		case SIMD_KERNEL_NEON:
+			done = normal_neon(job, row, normal, job.dim_x);
+			break;
+
+#endif
+		}
+
+		normal_scalar(job, row, normal, done, job.dim_x);
+	}
+
+	return 0;
+}
+
+
+void
+fill_normal_from_height(
+	pix* const normal_buffer,
+	const unsigned normal_stride,
+	const uint8_t* const height_buffer,
+	const unsigned height_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const float strength,
+	const normal_filter_t filter,
+	const normal_wrap_t wrap,
+	const unsigned num_threads)
+{
+	assert(0 != normal_buffer);
+	assert(0 != height_buffer);
+
+	if (0 == dim_x || 0 == dim_y)
+		return;
+
+	normal_job_t job;
+
+	job.kernel = select_simd_kernel();
+	job.weight_side = NORMAL_FILTER_SCHARR == filter ? 3 : 1;
+	job.weight_centre = NORMAL_FILTER_SCHARR == filter ? 10 : 2;
+	job.wrap = wrap;
+	job.height_buffer = height_buffer;
+	job.height_stride = height_stride;
+	job.normal_buffer = reinterpret_cast< uint8_t* >(normal_buffer);
+	job.normal_stride = normal_stride;
+	job.dim_x = dim_x;
+	job.dim_y = dim_y;
+
+	// the filter responds to a unit slope with twice the sum of its weights across the gradient
+	job.scale = -strength / (255.f * 2 * (job.weight_side * 2 + job.weight_centre));
+
+	run_rows_parallel(job, normal_rows, dim_y, NORMAL_MIN_ROWS_PER_THREAD, num_threads);
 }
 
 } // namespace util
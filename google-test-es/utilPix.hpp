@@ -1,8 +1,15 @@
 #ifndef util_pix_H__
 #define util_pix_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// the image kernels below taking a num_threads share a convention: their work, rows unless noted
+// otherwise, is done by SSE4.1, AVX2 or NEON kernels, as available at build time and at run time, and
+// is split across up to num_threads threads; a num_threads of zero means one thread per online CPU
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 namespace testbed
 {
 
@@ -61,6 +68,22 @@ fill_from_file(
 	const unsigned dim_y,
 	const char* const filename);
 
+// colour-space conversion standards and quantization ranges of YUV, aka YCbCr
+enum yuv_matrix_t
+{
+	YUV_MATRIX_BT601,		// ITU-R BT.601, SD video
+	YUV_MATRIX_BT709		// ITU-R BT.709, HD video
+};
+
+enum yuv_range_t
+{
+	YUV_RANGE_FULL,			// Y and CbCr in [0, 255]
+	YUV_RANGE_LIMITED		// Y in [16, 235], CbCr in [16, 240]
+};
+
+// fill_YUV420_from_RGB()	: convert RGB to planar YUV420 in fixed point, taking chroma as the average of each
+//							  2x2 block; work is split by row pairs; odd trailing rows and columns are not
+//							  converted
 void
 fill_YUV420_from_RGB(
 	uint8_t* const y_buffer,
@@ -71,9 +94,315 @@ fill_YUV420_from_RGB(
 	const unsigned v_stride,
 	pix* const rgb_buffer,
 	const unsigned rgb_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix = YUV_MATRIX_BT601,
+	const yuv_range_t range = YUV_RANGE_FULL,
+	const unsigned num_threads = 0);
+
+// fill_YUV420_from_RGBA()	: as fill_YUV420_from_RGB, from RGBA, as read back by glReadPixels; alpha is ignored
+void
+fill_YUV420_from_RGBA(
+	uint8_t* const y_buffer,
+	uint8_t* const u_buffer,
+	uint8_t* const v_buffer,
+	const unsigned y_stride,
+	const unsigned u_stride,
+	const unsigned v_stride,
+	const uint8_t* const rgba_buffer,
+	const unsigned rgba_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix = YUV_MATRIX_BT601,
+	const yuv_range_t range = YUV_RANGE_FULL,
+	const unsigned num_threads = 0);
+
+// fill_RGB_from_YUV420()	: convert planar YUV420 to RGB or RGBA in fixed point, the counterpart of
+//							  fill_YUV420_from_RGB, for checking GPU-side CSC or doing CSC on the CPU instead; chroma is
+//							  point-sampled
+//		- rgb_buffer,	uint8_t*		: RGB or RGBA destination,										output
+//		- rgb_stride,	const unsigned	: destination stride, in bytes,									input
+//		- rgb_channels,	const unsigned	: 3 for RGB, 4 for RGBA with an opaque alpha,					input
+//		- y_buffer,		const uint8_t*	: Y plane,														input
+//		- u_buffer,		const uint8_t*	: Cb plane, of (dim_x + 1) / 2 by (dim_y + 1) / 2 samples,		input
+//		- v_buffer,		const uint8_t*	: Cr plane, of (dim_x + 1) / 2 by (dim_y + 1) / 2 samples,		input
+//		- *_stride,		const unsigned	: plane strides, in bytes,										input
+//		- dim_x,		const unsigned	: image width,													input
+//		- dim_y,		const unsigned	: image height,													input
+
+void
+fill_RGB_from_YUV420(
+	uint8_t* const rgb_buffer,
+	const unsigned rgb_stride,
+	const unsigned rgb_channels,
+	const uint8_t* const y_buffer,
+	const uint8_t* const u_buffer,
+	const uint8_t* const v_buffer,
+	const unsigned y_stride,
+	const unsigned u_stride,
+	const unsigned v_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix = YUV_MATRIX_BT601,
+	const yuv_range_t range = YUV_RANGE_FULL,
+	const unsigned num_threads = 0);
+
+// fill_RGB_from_YV12()	: as fill_RGB_from_YUV420, from a contiguous YV12 buffer: the Y plane is followed by
+//							  the Cr plane and then by the Cb plane, the latter two of c_stride
+void
+fill_RGB_from_YV12(
+	uint8_t* const rgb_buffer,
+	const unsigned rgb_stride,
+	const unsigned rgb_channels,
+	const uint8_t* const yv12_buffer,
+	const unsigned y_stride,
+	const unsigned c_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix = YUV_MATRIX_BT601,
+	const yuv_range_t range = YUV_RANGE_FULL,
+	const unsigned num_threads = 0);
+
+// fill_RGB_from_NV12()	: as fill_RGB_from_YUV420, from a Y plane and a plane of interleaved CbCr pairs
+void
+fill_RGB_from_NV12(
+	uint8_t* const rgb_buffer,
+	const unsigned rgb_stride,
+	const unsigned rgb_channels,
+	const uint8_t* const y_buffer,
+	const uint8_t* const uv_buffer,
+	const unsigned y_stride,
+	const unsigned uv_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix = YUV_MATRIX_BT601,
+	const yuv_range_t range = YUV_RANGE_FULL,
+	const unsigned num_threads = 0);
+
+// mipmap reduction filters
+enum mip_filter_t
+{
+	MIP_FILTER_BOX,			// 2x2 average
+	MIP_FILTER_KAISER		// 8x8 Kaiser-windowed sinc: sharper, at the cost of slight ringing
+};
+
+// get_mip_count()	: number of levels in the full mipmap chain of an image, the image included
+unsigned
+get_mip_count(
+	const unsigned dim_x,
+	const unsigned dim_y);
+
+// get_mip_size()	: number of pixels in the levels of the full mipmap chain of an image, past the image
+size_t
+get_mip_size(
+	const unsigned dim_x,
+	const unsigned dim_y);
+
+// fill_mipmap()	: build the full mipmap chain of an image; each level halves the dimensions of the
+//					  previous one, rounding down, until 1x1; levels are filtered in float from their
+//					  predecessor rather than from the re-quantized pixels, and wrap around at the edges;
+//					  levels are built in turn, the rows of each split across threads
+//		- mip_buffer,	pix*			: levels 1 and onwards, packed, of get_mip_size pixels,		output
+//		- src_buffer,	const pix*		: level 0,													input
+//		- src_stride,	const unsigned	: level 0 stride, in bytes,									input
+//		- dim_x,		const unsigned	: level 0 width,											input
+//		- dim_y,		const unsigned	: level 0 height,											input
+//		- filter,		mip_filter_t	: reduction filter,											input
+//		- srgb,			const bool		: filter in linear light, treating pixels as sRGB-encoded,	input
+//		- num_threads,	const unsigned	: upper limit of threads,									input
+// returns
+//		bool			: success
+
+bool
+fill_mipmap(
+	pix* const mip_buffer,
+	const pix* const src_buffer,
+	const unsigned src_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const mip_filter_t filter = MIP_FILTER_BOX,
+	const bool srgb = false,
+	const unsigned num_threads = 0);
+
+// packed pixel formats, as GL's RGBA/UNSIGNED_BYTE, RGB/UNSIGNED_SHORT_5_6_5 and RGBA/UNSIGNED_SHORT_4_4_4_4;
+// the 16-bit ones are in native byte order
+enum packed_format_t
+{
+	PACKED_FORMAT_RGBA8888,
+	PACKED_FORMAT_RGB565,
+	PACKED_FORMAT_RGBA4444
+};
+
+// get_packed_size()	: size of a pixel of a packed format, in bytes
+unsigned
+get_packed_size(
+	const packed_format_t format);
+
+// fill_packed_from_RGB()	: convert RGB to a packed format of opaque alpha; channels are quantized to nearest, or,
+//							  when dithering, by the thresholds of a 4x4 Bayer matrix; there is no AVX2 kernel
+//		- packed_buffer,void*			: destination, 2-byte aligned for 16-bit formats,				output
+//		- packed_stride,const unsigned	: destination stride, in bytes,									input
+//		- format,		packed_format_t	: destination format,											input
+//		- rgb_buffer,	const pix*		: source,														input
+//		- rgb_stride,	const unsigned	: source stride, in bytes,										input
+//		- dim_x,		const unsigned	: image width,													input
+//		- dim_y,		const unsigned	: image height,													input
+//		- dither,		const bool		: dither 16-bit formats; 32-bit ones are exact either way,		input
+//		- num_threads,	const unsigned	: upper limit of threads,										input
+
+void
+fill_packed_from_RGB(
+	void* const packed_buffer,
+	const unsigned packed_stride,
+	const packed_format_t format,
+	const pix* const rgb_buffer,
+	const unsigned rgb_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const bool dither = false,
+	const unsigned num_threads = 0);
+
+// ETC block-compression formats; 4x4 pixel blocks of 64 bits each
+enum etc_format_t
+{
+	ETC_FORMAT_ETC1,		// ETC1 RGB, which ETC2 RGB decoders accept as well
+	ETC_FORMAT_ETC2			// ETC2 RGB, adding the planar mode for smooth gradients
+};
+
+// get_etc_size()	: size of the ETC-compressed image, in bytes; partial blocks at the edges count as whole
+size_t
+get_etc_size(
 	const unsigned dim_x,
 	const unsigned dim_y);
 
+// fill_ETC_from_RGB()	: compress an image to ETC1 or ETC2 RGB; each half-block gets the base colour of its
+//						  average, in both individual and differential modes and in both orientations, and the
+//						  codeword table of least squared error; the table search is what the SIMD kernels
+//						  take, sans AVX2, and work is split by block rows; partial blocks at the edges
+//						  replicate the last row or column
+//		- etc_buffer,	uint8_t*		: compressed blocks, in rows, of get_etc_size bytes,			output
+//		- src_buffer,	const pix*		: source image,													input
+//		- src_stride,	const unsigned	: source stride, in bytes,										input
+//		- dim_x,		const unsigned	: image width,													input
+//		- dim_y,		const unsigned	: image height,													input
+//		- format,		etc_format_t	: compressed format,											input
+//		- num_threads,	const unsigned	: upper limit of threads,										input
+
+void
+fill_ETC_from_RGB(
+	uint8_t* const etc_buffer,
+	const pix* const src_buffer,
+	const unsigned src_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const etc_format_t format = ETC_FORMAT_ETC1,
+	const unsigned num_threads = 0);
+
+// remap_RGB_channels()	: swizzle and optionally invert the channels of an image, in place, eg. flipping the
+//						  green channel of a normal map between the GL and D3D conventions; there is no AVX2
+//						  kernel
+//		- buffer,		pix*			: image,														input/output
+//		- stride,		const unsigned	: image stride, in bytes,										input
+//		- dim_x,		const unsigned	: image width,													input
+//		- dim_y,		const unsigned	: image height,													input
+//		- source,		const unsigned (&)[3]	: source channel of each channel, 0 to 2 for R, G, B,	input
+//		- invert,		const bool (&)[3]		: invert each channel after swizzling,					input
+//		- num_threads,	const unsigned	: upper limit of threads,										input
+
+void
+remap_RGB_channels(
+	pix* const buffer,
+	const unsigned stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const unsigned (&source)[3],
+	const bool (&invert)[3],
+	const unsigned num_threads = 0);
+
+// gradient filters of normal-map generation, both 3x3
+enum normal_filter_t
+{
+	NORMAL_FILTER_SOBEL,	// 1-2-1 smoothing across the gradient
+	NORMAL_FILTER_SCHARR	// 3-10-3 smoothing across the gradient, of better rotational symmetry
+};
+
+// addressing of height samples past the edges of the height map
+enum normal_wrap_t
+{
+	NORMAL_WRAP_REPEAT,		// for tiling textures
+	NORMAL_WRAP_CLAMP
+};
+
+// fill_normal_from_height()	: derive a tangent-space normal map from a height map; the gradient of each
+//								  sample is taken by a 3x3 filter, normalized to height units per texel, and
+//								  scaled by strength, giving the normal (-dh/dx, -dh/dy, 1), normalized and
+//								  biased into RGB; +Y runs along increasing rows, ie. up for the bottom-up rows
+//								  of raw files, as of GL, and remap_RGB_channels inverting green gives the D3D
+//								  convention; there is no AVX2 kernel
+//		- normal_buffer,	pix*			: normal map,												output
+//		- normal_stride,	const unsigned	: normal map stride, in bytes,								input
+//		- height_buffer,	const uint8_t*	: height map, one byte per sample,							input
+//		- height_stride,	const unsigned	: height map stride, in bytes,								input
+//		- dim_x,			const unsigned	: map width,												input
+//		- dim_y,			const unsigned	: map height,												input
+//		- strength,			const float		: height of full-scale samples, in texels,					input
+//		- filter,			normal_filter_t	: gradient filter,											input
+//		- wrap,				normal_wrap_t	: addressing past the edges,								input
+//		- num_threads,		const unsigned	: upper limit of threads,									input
+
+void
+fill_normal_from_height(
+	pix* const normal_buffer,
+	const unsigned normal_stride,
+	const uint8_t* const height_buffer,
+	const unsigned height_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const float strength = 1.f,
+	const normal_filter_t filter = NORMAL_FILTER_SOBEL,
+	const normal_wrap_t wrap = NORMAL_WRAP_REPEAT,
+	const unsigned num_threads = 0);
+
+// outcome of comparing an RGBA image to its reference
+struct image_diff_t
+{
+	unsigned max_abs[4];		// largest absolute difference, per channel
+	double psnr[4];				// per channel, in dB; HUGE_VAL for identical channels
+	double psnr_rgb;			// over the colour channels together, in dB; HUGE_VAL for identical colours
+	double ssim;				// mean SSIM of luma over 8x8 windows of stride 4; 1 for identical luma
+	uint64_t num_over;			// pixels of any channel differing by more than its tolerance
+};
+
+// diff_RGBA()	: compare an RGBA image to its reference, as of golden-image regression testing; the SIMD
+//				  kernels take the absolute differences, their extrema, squared sums and tolerance checks,
+//				  and the SSIM windows are split across threads along with the rows; masks affect the
+//				  tolerance checks only, PSNR and SSIM are always of the whole image
+//		- result,			const uint8_t*	: image under test,											input
+//		- reference,		const uint8_t*	: reference image,											input
+//		- stride,			const unsigned	: stride of both images, and of the mask and the diff image,	input
+//		- dim_x,			const unsigned	: image width,												input
+//		- dim_y,			const unsigned	: image height,												input
+//		- tolerance,		const uint8_t (&)[4]	: largest acceptable difference per channel, sans mask,	input
+//		- mask,				const uint8_t*	: per-pixel RGBA tolerances, overriding tolerance; may be null,	input
+//		- diff,				image_diff_t&	: outcome of the comparison,								output
+//		- diff_image,		uint8_t*		: absolute differences times diff_gain, opaque; may be null,	output
+//		- diff_gain,		const unsigned	: amplification of the diff image, 1 to 255,				input
+//		- num_threads,		const unsigned	: upper limit of threads,									input
+
+void
+diff_RGBA(
+	const uint8_t* const result,
+	const uint8_t* const reference,
+	const unsigned stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const uint8_t (&tolerance)[4],
+	const uint8_t* const mask,
+	image_diff_t& diff,
+	uint8_t* const diff_image = 0,
+	const unsigned diff_gain = 8,
+	const unsigned num_threads = 0);
+
 } // namespace hook
 } // namespace testbed
 
@@ -0,0 +1,571 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "utilPix.hpp"
+#include "utilPix_simd.hpp"
+
+namespace testbed
+{
+
+namespace util
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// comparison of RGBA images
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+enum {
+	DIFF_MIN_ROWS_PER_THREAD = 32,
+	DIFF_CHUNK_PIXELS = 16384,		// keeps the 32-bit squared sums of the SIMD kernels from overflowing
+	SSIM_WINDOW = 8,
+	SSIM_WINDOW_STRIDE = 4,
+	SSIM_MIN_WINDOW_ROWS_PER_THREAD = 8
+};
+
+struct diff_stat_t
+{
+	uint64_t sum_sq[4];
+	unsigned max_abs[4];
+	unsigned num_over;
+};
+
+struct diff_job_t
+{
+	unsigned kernel;
+	const uint8_t* result;
+	const uint8_t* reference;
+	const uint8_t* mask;
+	uint8_t* diff_image;
+	unsigned stride;
+	unsigned dim_x;
+	uint8_t tolerance[4];
+	uint8_t diff_gain;
+	diff_stat_t* row_stat;		// one per row
+
+	unsigned row_begin;
+	unsigned row_end;
+};
+
+struct ssim_job_t
+{
+	const uint8_t* result;
+	const uint8_t* reference;
+	unsigned stride;
+	unsigned window_x;			// window dimensions, clamped to those of the image
+	unsigned window_y;
+	unsigned num_windows_x;
+	double* row_ssim;			// sum of the SSIM of each row of windows
+
+	unsigned row_begin;			// in rows of windows
+	unsigned row_end;
+};
+
+} // namespace
+
+// compare pixels [begin, end) of a row
+static void
+diff_scalar(
+	const diff_job_t& job,
+	const uint8_t* const a,
+	const uint8_t* const b,
+	const uint8_t* const mask,
+	uint8_t* const diff_image,
+	const unsigned begin,
+	const unsigned end,
+	diff_stat_t& stat)
+{
+	for (unsigned i = begin; i < end; ++i)
+	{
+		bool over = false;
+
+		for (unsigned c = 0; c < 4; ++c)
+		{
+			const unsigned d = abs(int(a[i * 4 + c]) - int(b[i * 4 + c]));
+			const unsigned tolerance = 0 != mask ? mask[i * 4 + c] : job.tolerance[c];
+
+			stat.sum_sq[c] += d * d;
+			stat.max_abs[c] = std::max(stat.max_abs[c], d);
+			over = over || d > tolerance;
+
+			if (0 != diff_image)
+				diff_image[i * 4 + c] = 3 == c ? 255 : uint8_t(std::min(d * job.diff_gain, 255U));
+		}
+
+		stat.num_over += over ? 1 : 0;
+	}
+}
+
+#if PIX_SIMD_X86
+
+// returns the number of pixels compared; the rest are left to the scalar kernel
+__attribute__ ((target ("sse4.1")))
+static unsigned
+diff_sse41(
+	const diff_job_t& job,
+	const uint8_t* const a,
+	const uint8_t* const b,
+	const uint8_t* const mask,
+	uint8_t* const diff_image,
+	const unsigned num_pixels,
+	diff_stat_t& stat)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i tolerance = _mm_set1_epi32(
+		job.tolerance[0] | job.tolerance[1] << 8 | job.tolerance[2] << 16 | uint32_t(job.tolerance[3]) << 24);
+	const __m128i gain = _mm_set1_epi16(job.diff_gain);
+	const __m128i cap = _mm_set1_epi16(255);
+	const __m128i alpha = _mm_set1_epi32(int32_t(0xff000000));
+
+	__m128i max_abs = zero;
+	__m128i sum_sq = zero;		// a channel per lane
+	__m128i num_ok = zero;
+
+	unsigned i = 0;
+
+	for (; i + 4 <= num_pixels; i += 4)
+	{
+		const __m128i va = _mm_loadu_si128(reinterpret_cast< const __m128i* >(a + i * 4));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast< const __m128i* >(b + i * 4));
+		const __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+
+		max_abs = _mm_max_epu8(max_abs, d);
+
+		// pixel pairs of 16-bit channels; squares of bytes fit the unsigned words
+		const __m128i d_lo = _mm_unpacklo_epi8(d, zero);
+		const __m128i d_hi = _mm_unpackhi_epi8(d, zero);
+		const __m128i sq_lo = _mm_mullo_epi16(d_lo, d_lo);
+		const __m128i sq_hi = _mm_mullo_epi16(d_hi, d_hi);
+
+		sum_sq = _mm_add_epi32(sum_sq, _mm_add_epi32(
+			_mm_add_epi32(_mm_unpacklo_epi16(sq_lo, zero), _mm_unpackhi_epi16(sq_lo, zero)),
+			_mm_add_epi32(_mm_unpacklo_epi16(sq_hi, zero), _mm_unpackhi_epi16(sq_hi, zero))));
+
+		const __m128i t = 0 != mask
+			? _mm_loadu_si128(reinterpret_cast< const __m128i* >(mask + i * 4))
+			: tolerance;
+
+		// pixels of no channel over its tolerance count as -1 each
+		num_ok = _mm_add_epi32(num_ok, _mm_cmpeq_epi32(_mm_subs_epu8(d, t), zero));
+
+		if (0 != diff_image)
+		{
+			const __m128i g_lo = _mm_min_epu16(_mm_mullo_epi16(d_lo, gain), cap);
+			const __m128i g_hi = _mm_min_epu16(_mm_mullo_epi16(d_hi, gain), cap);
+
+			_mm_storeu_si128(reinterpret_cast< __m128i* >(diff_image + i * 4),
+				_mm_or_si128(_mm_packus_epi16(g_lo, g_hi), alpha));
+		}
+	}
+
+	uint8_t max_lane[16];
+	uint32_t sum_lane[4];
+	int32_t ok_lane[4];
+
+	_mm_storeu_si128(reinterpret_cast< __m128i* >(max_lane), max_abs);
+	_mm_storeu_si128(reinterpret_cast< __m128i* >(sum_lane), sum_sq);
+	_mm_storeu_si128(reinterpret_cast< __m128i* >(ok_lane), num_ok);
+
+	for (unsigned c = 0; c < 4; ++c)
+	{
+		stat.sum_sq[c] += sum_lane[c];
+
+		for (unsigned j = c; j < 16; j += 4)
+			stat.max_abs[c] = std::max(stat.max_abs[c], unsigned(max_lane[j]));
+	}
+
+	stat.num_over += i + ok_lane[0] + ok_lane[1] + ok_lane[2] + ok_lane[3];
+
+	return i;
+}
+
+
+// as diff_sse41, of 8 pixels per iteration; unpacking and packing are both within 128-bit lanes, which
+// keeps both the channel order of the sums and the pixel order of the diff image
+__attribute__ ((target ("avx2")))
+static unsigned
+diff_avx2(
+	const diff_job_t& job,
+	const uint8_t* const a,
+	const uint8_t* const b,
+	const uint8_t* const mask,
+	uint8_t* const diff_image,
+	const unsigned num_pixels,
+	diff_stat_t& stat)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i tolerance = _mm256_set1_epi32(
+		job.tolerance[0] | job.tolerance[1] << 8 | job.tolerance[2] << 16 | uint32_t(job.tolerance[3]) << 24);
+	const __m256i gain = _mm256_set1_epi16(job.diff_gain);
+	const __m256i cap = _mm256_set1_epi16(255);
+	const __m256i alpha = _mm256_set1_epi32(int32_t(0xff000000));
+
+	__m256i max_abs = zero;
+	__m256i sum_sq = zero;
+	__m256i num_ok = zero;
+
+	unsigned i = 0;
+
+	for (; i + 8 <= num_pixels; i += 8)
+	{
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast< const __m256i* >(a + i * 4));
+		const __m256i vb = _mm256_loadu_si256(reinterpret_cast< const __m256i* >(b + i * 4));
+		const __m256i d = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+
+		max_abs = _mm256_max_epu8(max_abs, d);
+
+		const __m256i d_lo = _mm256_unpacklo_epi8(d, zero);
+		const __m256i d_hi = _mm256_unpackhi_epi8(d, zero);
+		const __m256i sq_lo = _mm256_mullo_epi16(d_lo, d_lo);
+		const __m256i sq_hi = _mm256_mullo_epi16(d_hi, d_hi);
+
+		sum_sq = _mm256_add_epi32(sum_sq, _mm256_add_epi32(
+			_mm256_add_epi32(_mm256_unpacklo_epi16(sq_lo, zero), _mm256_unpackhi_epi16(sq_lo, zero)),
+			_mm256_add_epi32(_mm256_unpacklo_epi16(sq_hi, zero), _mm256_unpackhi_epi16(sq_hi, zero))));
+
+		const __m256i t = 0 != mask
+			? _mm256_loadu_si256(reinterpret_cast< const __m256i* >(mask + i * 4))
+			: tolerance;
+
+		num_ok = _mm256_add_epi32(num_ok, _mm256_cmpeq_epi32(_mm256_subs_epu8(d, t), zero));
+
+		if (0 != diff_image)
+		{
+			const __m256i g_lo = _mm256_min_epu16(_mm256_mullo_epi16(d_lo, gain), cap);
+			const __m256i g_hi = _mm256_min_epu16(_mm256_mullo_epi16(d_hi, gain), cap);
+
+			_mm256_storeu_si256(reinterpret_cast< __m256i* >(diff_image + i * 4),
+				_mm256_or_si256(_mm256_packus_epi16(g_lo, g_hi), alpha));
+		}
+	}
+
+	uint8_t max_lane[32];
+	uint32_t sum_lane[8];
+	int32_t ok_lane[8];
+
+	_mm256_storeu_si256(reinterpret_cast< __m256i* >(max_lane), max_abs);
+	_mm256_storeu_si256(reinterpret_cast< __m256i* >(sum_lane), sum_sq);
+	_mm256_storeu_si256(reinterpret_cast< __m256i* >(ok_lane), num_ok);
+
+	for (unsigned c = 0; c < 4; ++c)
+	{
+		stat.sum_sq[c] += uint64_t(sum_lane[c]) + sum_lane[c + 4];
+
+		for (unsigned j = c; j < 32; j += 4)
+			stat.max_abs[c] = std::max(stat.max_abs[c], unsigned(max_lane[j]));
+	}
+
+	int32_t ok = 0;
+
+	for (unsigned j = 0; j < 8; ++j)
+		ok += ok_lane[j];
+
+	stat.num_over += i + ok;
+
+	return i;
+}
+
+#elif PIX_SIMD_NEON
+
+static unsigned
+diff_neon(
+	const diff_job_t& job,
+	const uint8_t* const a,
+	const uint8_t* const b,
+	const uint8_t* const mask,
+	uint8_t* const diff_image,
+	const unsigned num_pixels,
+	diff_stat_t& stat)
+{
+	const uint8x16_t tolerance = vreinterpretq_u8_u32(vdupq_n_u32(
+		job.tolerance[0] | job.tolerance[1] << 8 | job.tolerance[2] << 16 | uint32_t(job.tolerance[3]) << 24));
+	const uint8x8_t gain = vdup_n_u8(job.diff_gain);
+	const uint16x8_t cap = vdupq_n_u16(255);
+	const uint8x16_t alpha = vreinterpretq_u8_u32(vdupq_n_u32(0xff000000));
+
+	uint8x16_t max_abs = vdupq_n_u8(0);
+	uint32x4_t sum_sq = vdupq_n_u32(0);		// a channel per lane
+	uint32x4_t num_ok = vdupq_n_u32(0);
+
+	unsigned i = 0;
+
+	for (; i + 4 <= num_pixels; i += 4)
+	{
+		const uint8x16_t d = vabdq_u8(vld1q_u8(a + i * 4), vld1q_u8(b + i * 4));
+
+		max_abs = vmaxq_u8(max_abs, d);
+
+		const uint16x8_t sq_lo = vmull_u8(vget_low_u8(d), vget_low_u8(d));
+		const uint16x8_t sq_hi = vmull_u8(vget_high_u8(d), vget_high_u8(d));
+
+		sum_sq = vaddw_u16(sum_sq, vget_low_u16(sq_lo));
+		sum_sq = vaddw_u16(sum_sq, vget_high_u16(sq_lo));
+		sum_sq = vaddw_u16(sum_sq, vget_low_u16(sq_hi));
+		sum_sq = vaddw_u16(sum_sq, vget_high_u16(sq_hi));
+
+		const uint8x16_t t = 0 != mask ? vld1q_u8(mask + i * 4) : tolerance;
+
+		// pixels of no channel over its tolerance give all-ones, ie. subtract as -1
+		num_ok = vsubq_u32(num_ok, vceqq_u32(vreinterpretq_u32_u8(vqsubq_u8(d, t)), vdupq_n_u32(0)));
+
+		if (0 != diff_image)
+		{
+			const uint8x8_t g_lo = vmovn_u16(vminq_u16(vmull_u8(vget_low_u8(d), gain), cap));
+			const uint8x8_t g_hi = vmovn_u16(vminq_u16(vmull_u8(vget_high_u8(d), gain), cap));
+
+			vst1q_u8(diff_image + i * 4, vorrq_u8(vcombine_u8(g_lo, g_hi), alpha));
+		}
+	}
+
+	uint8_t max_lane[16];
+	uint32_t sum_lane[4];
+	uint32_t ok_lane[4];
+
+	vst1q_u8(max_lane, max_abs);
+	vst1q_u32(sum_lane, sum_sq);
+	vst1q_u32(ok_lane, num_ok);
+
+	for (unsigned c = 0; c < 4; ++c)
+	{
+		stat.sum_sq[c] += sum_lane[c];
+
+		for (unsigned j = c; j < 16; j += 4)
+			stat.max_abs[c] = std::max(stat.max_abs[c], unsigned(max_lane[j]));
+	}
+
+	stat.num_over += i - (ok_lane[0] + ok_lane[1] + ok_lane[2] + ok_lane[3]);
+
+	return i;
+}
+
+#endif
+
+static void*
+diff_rows(
+	void* arg)
+{
+	const diff_job_t& job = *reinterpret_cast< const diff_job_t* >(arg);
+
+	for (unsigned i = job.row_begin; i < job.row_end; ++i)
+	{
+		const size_t offset = size_t(i) * job.stride;
+		diff_stat_t& stat = job.row_stat[i];
+
+		memset(&stat, 0, sizeof(stat));
+
+		for (unsigned x = 0; x < job.dim_x; x += DIFF_CHUNK_PIXELS)
+		{
+			const size_t chunk = offset + size_t(x) * 4;
+			const uint8_t* const a = job.result + chunk;
+			const uint8_t* const b = job.reference + chunk;
+			const uint8_t* const mask = 0 != job.mask ? job.mask + chunk : 0;
+			uint8_t* const diff_image = 0 != job.diff_image ? job.diff_image + chunk : 0;
+			const unsigned num_pixels = std::min(job.dim_x - x, unsigned(DIFF_CHUNK_PIXELS));
+
+			unsigned done = 0;
+
+			switch (job.kernel)
+			{
+#if PIX_SIMD_X86
+			case SIMD_KERNEL_AVX2:
+				done = diff_avx2(job, a, b, mask, diff_image, num_pixels, stat);
+				break;
+
+			case SIMD_KERNEL_SSE41:
+				done = diff_sse41(job, a, b, mask, diff_image, num_pixels, stat);
+				break;
+
+#elif PIX_SIMD_NEON
+			case SIMD_KERNEL_NEON:
+				done = diff_neon(job, a, b, mask, diff_image, num_pixels, stat);
+				break;
+
+#endif
+			}
+
+			diff_scalar(job, a, b, mask, diff_image, done, num_pixels, stat);
+		}
+	}
+
+	return 0;
+}
+
+
+static inline unsigned
+luma_of_RGBA(
+	const uint8_t* const p)
+{
+	return (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+}
+
+
+static void*
+ssim_rows(
+	void* arg)
+{
+	const ssim_job_t& job = *reinterpret_cast< const ssim_job_t* >(arg);
+
+	// stabilizing constants of Wang et al., over 8-bit dynamic range
+	const double c1 = (.01 * 255) * (.01 * 255);
+	const double c2 = (.03 * 255) * (.03 * 255);
+	const double n = double(job.window_x) * job.window_y;
+
+	for (unsigned i = job.row_begin; i < job.row_end; ++i)
+	{
+		double row_ssim = 0;
+
+		for (unsigned j = 0; j < job.num_windows_x; ++j)
+		{
+			uint64_t sum_a = 0, sum_b = 0, sum_aa = 0, sum_bb = 0, sum_ab = 0;
+
+			for (unsigned y = 0; y < job.window_y; ++y)
+			{
+				const size_t offset = size_t(i * SSIM_WINDOW_STRIDE + y) * job.stride + size_t(j) * SSIM_WINDOW_STRIDE * 4;
+				const uint8_t* const a = job.result + offset;
+				const uint8_t* const b = job.reference + offset;
+
+				for (unsigned x = 0; x < job.window_x; ++x)
+				{
+					const unsigned la = luma_of_RGBA(a + x * 4);
+					const unsigned lb = luma_of_RGBA(b + x * 4);
+
+					sum_a += la;
+					sum_b += lb;
+					sum_aa += la * la;
+					sum_bb += lb * lb;
+					sum_ab += la * lb;
+				}
+			}
+
+			const double mean_a = sum_a / n;
+			const double mean_b = sum_b / n;
+			const double var_a = sum_aa / n - mean_a * mean_a;
+			const double var_b = sum_bb / n - mean_b * mean_b;
+			const double cov = sum_ab / n - mean_a * mean_b;
+
+			row_ssim +=
+				(2 * mean_a * mean_b + c1) * (2 * cov + c2) /
+				((mean_a * mean_a + mean_b * mean_b + c1) * (var_a + var_b + c2));
+		}
+
+		job.row_ssim[i] = row_ssim;
+	}
+
+	return 0;
+}
+
+
+static double
+psnr_of_sum_sq(
+	const uint64_t sum_sq,
+	const uint64_t num_samples)
+{
+	if (0 == sum_sq)
+		return HUGE_VAL;
+
+	return 10 * log10(255. * 255. * double(num_samples) / double(sum_sq));
+}
+
+
+void
+diff_RGBA(
+	const uint8_t* const result,
+	const uint8_t* const reference,
+	const unsigned stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const uint8_t (&tolerance)[4],
+	const uint8_t* const mask,
+	image_diff_t& diff,
+	uint8_t* const diff_image,
+	const unsigned diff_gain,
+	const unsigned num_threads)
+{
+	assert(0 != result);
+	assert(0 != reference);
+	assert(0 < diff_gain && 256 > diff_gain);
+
+	memset(&diff, 0, sizeof(diff));
+
+	if (0 == dim_x || 0 == dim_y)
+	{
+		for (unsigned c = 0; c < 4; ++c)
+			diff.psnr[c] = HUGE_VAL;
+
+		diff.psnr_rgb = HUGE_VAL;
+		diff.ssim = 1;
+		return;
+	}
+
+	std::vector< diff_stat_t > row_stat(dim_y);
+
+	diff_job_t job;
+
+	job.kernel = select_simd_kernel();
+	job.result = result;
+	job.reference = reference;
+	job.mask = mask;
+	job.diff_image = diff_image;
+	job.stride = stride;
+	job.dim_x = dim_x;
+	job.diff_gain = uint8_t(diff_gain);
+	job.row_stat = &row_stat.front();
+
+	for (unsigned c = 0; c < 4; ++c)
+		job.tolerance[c] = tolerance[c];
+
+	run_rows_parallel(job, diff_rows, dim_y, DIFF_MIN_ROWS_PER_THREAD, num_threads);
+
+	uint64_t sum_sq[4] = { 0 };
+
+	for (unsigned i = 0; i < dim_y; ++i)
+	{
+		for (unsigned c = 0; c < 4; ++c)
+		{
+			sum_sq[c] += row_stat[i].sum_sq[c];
+			diff.max_abs[c] = std::max(diff.max_abs[c], row_stat[i].max_abs[c]);
+		}
+
+		diff.num_over += row_stat[i].num_over;
+	}
+
+	const uint64_t num_pixels = uint64_t(dim_x) * dim_y;
+
+	for (unsigned c = 0; c < 4; ++c)
+		diff.psnr[c] = psnr_of_sum_sq(sum_sq[c], num_pixels);
+
+	diff.psnr_rgb = psnr_of_sum_sq(sum_sq[0] + sum_sq[1] + sum_sq[2], num_pixels * 3);
+
+	// images smaller than a window are taken as a single window
+	ssim_job_t ssim_job;
+
+	ssim_job.result = result;
+	ssim_job.reference = reference;
+	ssim_job.stride = stride;
+	ssim_job.window_x = std::min(dim_x, unsigned(SSIM_WINDOW));
+	ssim_job.window_y = std::min(dim_y, unsigned(SSIM_WINDOW));
+	ssim_job.num_windows_x = (dim_x - ssim_job.window_x) / SSIM_WINDOW_STRIDE + 1;
+
+	const unsigned num_windows_y = (dim_y - ssim_job.window_y) / SSIM_WINDOW_STRIDE + 1;
+	std::vector< double > row_ssim(num_windows_y);
+
+	ssim_job.row_ssim = &row_ssim.front();
+
+	run_rows_parallel(ssim_job, ssim_rows, num_windows_y, SSIM_MIN_WINDOW_ROWS_PER_THREAD, num_threads);
+
+	double ssim = 0;
+
+	for (unsigned i = 0; i < num_windows_y; ++i)
+		ssim += row_ssim[i];
+
+	diff.ssim = ssim / (double(num_windows_y) * ssim_job.num_windows_x);
+}
+
+} // namespace util
+} // namespace testbed
@@ -0,0 +1,572 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+
+#include "utilPix.hpp"
+#include "utilPix_simd.hpp"
+
+namespace testbed
+{
+
+namespace util
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// ETC compression
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+enum {
+	ETC_BLOCK_SIZE					= 8,	// bytes per 4x4 block
+	ETC_MIN_BLOCK_ROWS_PER_THREAD	= 4
+};
+
+// a half-block of 2x4 or 4x2 pixels, planar; pos is the bit of each pixel in the index word, ie. x * 4 + y
+struct etc_subblock_t
+{
+	int16_t c[3][8] __attribute__ ((aligned (16)));
+	unsigned pos[8];
+};
+
+struct etc_job_t
+{
+	unsigned kernel;
+	etc_format_t format;
+	uint8_t* dst;
+	const pix* src;
+	unsigned src_stride;
+	unsigned dim_x;
+	unsigned dim_y;
+
+	unsigned row_begin;		// in block rows
+	unsigned row_end;
+};
+
+} // namespace
+
+// intensity modifiers a and b of the codeword tables; pixel indices 0 and 1 select +a and +b, 2 and 3 select -a and -b
+static const int etc_modifier[8][2] =
+{
+	{  2,   8 },
+	{  5,  17 },
+	{  9,  29 },
+	{ 13,  42 },
+	{ 18,  60 },
+	{ 24,  80 },
+	{ 33, 106 },
+	{ 47, 183 }
+};
+
+
+static inline int
+clamp_255(
+	const int c)
+{
+	return c < 0 ? 0 : (c > 255 ? 255 : c);
+}
+
+
+// the four colours a half-block of the given base colour and codeword table can take, by pixel index
+static inline void
+etc_candidates(
+	int (&cand)[4][3],
+	const int (&base)[3],
+	const unsigned table)
+{
+	for (unsigned k = 0; k < 4; ++k)
+	{
+		const int m = k & 2 ? -etc_modifier[table][k & 1] : etc_modifier[table][k & 1];
+
+		cand[k][0] = clamp_255(base[0] + m);
+		cand[k][1] = clamp_255(base[1] + m);
+		cand[k][2] = clamp_255(base[2] + m);
+	}
+}
+
+
+static unsigned
+etc_subblock_error_scalar(
+	const etc_subblock_t& sub,
+	const int (&cand)[4][3])
+{
+	unsigned err = 0;
+
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		unsigned best = -1U;
+
+		for (unsigned k = 0; k < 4; ++k)
+		{
+			const int d0 = sub.c[0][i] - cand[k][0];
+			const int d1 = sub.c[1][i] - cand[k][1];
+			const int d2 = sub.c[2][i] - cand[k][2];
+
+			best = std::min(best, unsigned(d0 * d0 + d1 * d1 + d2 * d2));
+		}
+
+		err += best;
+	}
+
+	return err;
+}
+
+#if PIX_SIMD_X86
+
+// all 8 pixels of the half-block at once, in 16-bit lanes; squared distances get summed in 32-bit lanes by pmaddwd
+__attribute__ ((target ("sse4.1")))
+static unsigned
+etc_subblock_error_sse41(
+	const etc_subblock_t& sub,
+	const int (&cand)[4][3])
+{
+	const __m128i c0 = _mm_load_si128(reinterpret_cast< const __m128i* >(sub.c[0]));
+	const __m128i c1 = _mm_load_si128(reinterpret_cast< const __m128i* >(sub.c[1]));
+	const __m128i c2 = _mm_load_si128(reinterpret_cast< const __m128i* >(sub.c[2]));
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i best_lo = _mm_set1_epi32(0x7fffffff);
+	__m128i best_hi = best_lo;
+
+	for (unsigned k = 0; k < 4; ++k)
+	{
+		const __m128i d0 = _mm_sub_epi16(c0, _mm_set1_epi16(int16_t(cand[k][0])));
+		const __m128i d1 = _mm_sub_epi16(c1, _mm_set1_epi16(int16_t(cand[k][1])));
+		const __m128i d2 = _mm_sub_epi16(c2, _mm_set1_epi16(int16_t(cand[k][2])));
+
+		const __m128i d01_lo = _mm_unpacklo_epi16(d0, d1);
+		const __m128i d01_hi = _mm_unpackhi_epi16(d0, d1);
+		const __m128i d2_lo = _mm_unpacklo_epi16(d2, zero);
+		const __m128i d2_hi = _mm_unpackhi_epi16(d2, zero);
+
+		best_lo = _mm_min_epi32(best_lo, _mm_add_epi32(_mm_madd_epi16(d01_lo, d01_lo), _mm_madd_epi16(d2_lo, d2_lo)));
+		best_hi = _mm_min_epi32(best_hi, _mm_add_epi32(_mm_madd_epi16(d01_hi, d01_hi), _mm_madd_epi16(d2_hi, d2_hi)));
+	}
+
+	__m128i sum = _mm_add_epi32(best_lo, best_hi);
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return unsigned(_mm_cvtsi128_si32(sum));
+}
+
+#elif PIX_SIMD_NEON
+
+static unsigned
+etc_subblock_error_neon(
+	const etc_subblock_t& sub,
+	const int (&cand)[4][3])
+{
+	const int16x8_t c0 = vld1q_s16(sub.c[0]);
+	const int16x8_t c1 = vld1q_s16(sub.c[1]);
+	const int16x8_t c2 = vld1q_s16(sub.c[2]);
+
+	int32x4_t best_lo = vdupq_n_s32(0x7fffffff);
+	int32x4_t best_hi = best_lo;
+
+	for (unsigned k = 0; k < 4; ++k)
+	{
+		const int16x8_t d0 = vsubq_s16(c0, vdupq_n_s16(int16_t(cand[k][0])));
+		const int16x8_t d1 = vsubq_s16(c1, vdupq_n_s16(int16_t(cand[k][1])));
+		const int16x8_t d2 = vsubq_s16(c2, vdupq_n_s16(int16_t(cand[k][2])));
+
+		int32x4_t e_lo = vmull_s16(vget_low_s16(d0), vget_low_s16(d0));
+		int32x4_t e_hi = vmull_s16(vget_high_s16(d0), vget_high_s16(d0));
+		e_lo = vmlal_s16(e_lo, vget_low_s16(d1), vget_low_s16(d1));
+		e_hi = vmlal_s16(e_hi, vget_high_s16(d1), vget_high_s16(d1));
+		e_lo = vmlal_s16(e_lo, vget_low_s16(d2), vget_low_s16(d2));
+		e_hi = vmlal_s16(e_hi, vget_high_s16(d2), vget_high_s16(d2));
+
+		best_lo = vminq_s32(best_lo, e_lo);
+		best_hi = vminq_s32(best_hi, e_hi);
+	}
+
+	const int32x4_t sum = vaddq_s32(best_lo, best_hi);
+	const int32x2_t sum2 = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+
+	return unsigned(vget_lane_s32(vpadd_s32(sum2, sum2), 0));
+}
+
+#endif
+
+// search the codeword tables for the one of least error over the half-block, given its base colour
+static unsigned
+etc_best_table(
+	const unsigned kernel,
+	const etc_subblock_t& sub,
+	const int (&base)[3],
+	unsigned& table)
+{
+	unsigned best = -1U;
+
+	for (unsigned t = 0; t < sizeof(etc_modifier) / sizeof(etc_modifier[0]); ++t)
+	{
+		int cand[4][3];
+		etc_candidates(cand, base, t);
+
+		unsigned err;
+
+		switch (kernel)
+		{
+#if PIX_SIMD_X86
+		case SIMD_KERNEL_AVX2:
+		case SIMD_KERNEL_SSE41:
+			err = etc_subblock_error_sse41(sub, cand);
+			break;
+
+#elif PIX_SIMD_NEON
+		case SIMD_KERNEL_NEON:
+			err = etc_subblock_error_neon(sub, cand);
+			break;
+
+#endif
+		default:
+			err = etc_subblock_error_scalar(sub, cand);
+			break;
+		}
+
+		if (err < best)
+		{
+			best = err;
+			table = t;
+		}
+	}
+
+	return best;
+}
+
+
+// pixel indices of the half-block, as msb and lsb planes in the upper and lower halves of the index word
+static uint32_t
+etc_subblock_indices(
+	const etc_subblock_t& sub,
+	const int (&base)[3],
+	const unsigned table)
+{
+	int cand[4][3];
+	etc_candidates(cand, base, table);
+
+	uint32_t bits = 0;
+
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		unsigned best = -1U;
+		unsigned best_k = 0;
+
+		for (unsigned k = 0; k < 4; ++k)
+		{
+			const int d0 = sub.c[0][i] - cand[k][0];
+			const int d1 = sub.c[1][i] - cand[k][1];
+			const int d2 = sub.c[2][i] - cand[k][2];
+			const unsigned err = unsigned(d0 * d0 + d1 * d1 + d2 * d2);
+
+			if (err < best)
+			{
+				best = err;
+				best_k = k;
+			}
+		}
+
+		bits |= uint32_t(best_k >> 1) << (sub.pos[i] + 16) | uint32_t(best_k & 1) << sub.pos[i];
+	}
+
+	return bits;
+}
+
+
+// quantize the sum of 8 channel values to their average at the specified bit depth, rounding to nearest
+static inline int
+etc_quantize_sum8(
+	const int sum,
+	const unsigned bits)
+{
+	return (sum * ((1 << bits) - 1) + 1020) / 2040;
+}
+
+
+// ETC2 planar mode: a least-squares fit of a plane per channel, through the colours at the origin, at x = 4
+// and at y = 4, in RGB676; the mode is signalled by the blue channel overflowing in differential mode, so the
+// bits not taken by the plane are set to make red and green not overflow, and blue overflow
+static unsigned
+encode_etc2_planar(
+	const int16_t (&block)[3][16],
+	uint32_t& hi,
+	uint32_t& lo)
+{
+	static const unsigned bits[3] = { 6, 7, 6 };
+
+	int o[3], h[3], v[3];
+	unsigned err = 0;
+
+	for (unsigned c = 0; c < 3; ++c)
+	{
+		float sum = 0.f;
+		float sum_x = 0.f;
+		float sum_y = 0.f;
+
+		for (unsigned x = 0; x < 4; ++x)
+			for (unsigned y = 0; y < 4; ++y)
+			{
+				const float val = block[c][x * 4 + y];
+
+				sum += val;
+				sum_x += (x - 1.5f) * val;
+				sum_y += (y - 1.5f) * val;
+			}
+
+		// sum of (x - 1.5)^2 over the block is 20
+		const float dx = sum_x / 20.f;
+		const float dy = sum_y / 20.f;
+		const float origin = sum / 16.f - 1.5f * dx - 1.5f * dy;
+		const float scale = ((1 << bits[c]) - 1) / 255.f;
+		const int max = (1 << bits[c]) - 1;
+
+		o[c] = std::min(std::max(int(floorf(origin * scale + .5f)), 0), max);
+		h[c] = std::min(std::max(int(floorf((origin + 4.f * dx) * scale + .5f)), 0), max);
+		v[c] = std::min(std::max(int(floorf((origin + 4.f * dy) * scale + .5f)), 0), max);
+
+		const unsigned lshift = 8 - bits[c];
+		const unsigned rshift = 2 * bits[c] - 8;
+		const int eo = o[c] << lshift | o[c] >> rshift;
+		const int eh = h[c] << lshift | h[c] >> rshift;
+		const int ev = v[c] << lshift | v[c] >> rshift;
+
+		for (int x = 0; x < 4; ++x)
+			for (int y = 0; y < 4; ++y)
+			{
+				const int d = clamp_255((x * (eh - eo) + y * (ev - eo) + 4 * eo + 2) >> 2) - block[c][x * 4 + y];
+				err += unsigned(d * d);
+			}
+	}
+
+	hi = uint32_t(o[0]) << 25 |
+		uint32_t(o[1] >> 6) << 24 | uint32_t(o[1] & 0x3f) << 17 |
+		uint32_t(o[2] >> 5) << 16 | uint32_t(o[2] >> 3 & 3) << 11 | uint32_t(o[2] & 7) << 7 |
+		uint32_t(h[0] >> 1) << 2 | 1U << 1 | uint32_t(h[0] & 1);
+
+	lo = uint32_t(h[1]) << 25 | uint32_t(h[2]) << 19 |
+		uint32_t(v[0]) << 13 | uint32_t(v[1]) << 6 | uint32_t(v[2]);
+
+	// red: 5-bit base in bits 31..27 of hi, 3-bit signed delta in bits 26..24; bit 31 is free
+	const int r = int(hi >> 27 & 0x1f) + (int(hi >> 24 & 7) ^ 4) - 4;
+
+	if (0 > r || 31 < r)
+		hi |= 1U << 31;
+
+	// green: base in bits 23..19, delta in bits 18..16; bit 23 is free
+	const int g = int(hi >> 19 & 0x1f) + (int(hi >> 16 & 7) ^ 4) - 4;
+
+	if (0 > g || 31 < g)
+		hi |= 1U << 23;
+
+	// blue: base in bits 15..11, delta in bits 10..8; bits 15..13 and the delta sign in bit 10 are free
+	if ((hi >> 11 & 3) + (hi >> 8 & 3) < 4)
+		hi |= 1U << 10;
+	else
+		hi |= 7U << 13;
+
+	return err;
+}
+
+
+// block pixels are planar, and in column-major order, as their index bits
+static void
+encode_etc_block(
+	const unsigned kernel,
+	const etc_format_t format,
+	const int16_t (&block)[3][16],
+	uint8_t* const dst)
+{
+	unsigned best_err = -1U;
+	uint32_t best_hi = 0;
+	uint32_t best_lo = 0;
+
+	for (unsigned flip = 0; flip < 2 && 0 != best_err; ++flip)
+	{
+		etc_subblock_t sub[2];
+		int sum[2][3];
+
+		for (unsigned s = 0; s < 2; ++s)
+		{
+			sum[s][0] = sum[s][1] = sum[s][2] = 0;
+
+			for (unsigned i = 0; i < 8; ++i)
+			{
+				// unflipped half-blocks are the left and right 2x4 columns, flipped ones the top and bottom 4x2 rows
+				const unsigned pos = flip ? (i >> 1) * 4 + s * 2 + (i & 1) : s * 8 + i;
+
+				sub[s].pos[i] = pos;
+
+				for (unsigned c = 0; c < 3; ++c)
+				{
+					sub[s].c[c][i] = block[c][pos];
+					sum[s][c] += block[c][pos];
+				}
+			}
+		}
+
+		// individual mode: RGB444 base colours
+		int base4[2][3];
+		int expanded[2][3];
+		unsigned table[2];
+
+		for (unsigned s = 0; s < 2; ++s)
+			for (unsigned c = 0; c < 3; ++c)
+			{
+				base4[s][c] = etc_quantize_sum8(sum[s][c], 4);
+				expanded[s][c] = base4[s][c] * 17;
+			}
+
+		unsigned err =
+			etc_best_table(kernel, sub[0], expanded[0], table[0]) +
+			etc_best_table(kernel, sub[1], expanded[1], table[1]);
+
+		if (err < best_err)
+		{
+			best_err = err;
+			best_hi =
+				uint32_t(base4[0][0]) << 28 | uint32_t(base4[1][0]) << 24 |
+				uint32_t(base4[0][1]) << 20 | uint32_t(base4[1][1]) << 16 |
+				uint32_t(base4[0][2]) << 12 | uint32_t(base4[1][2]) << 8 |
+				table[0] << 5 | table[1] << 2 | flip;
+			best_lo =
+				etc_subblock_indices(sub[0], expanded[0], table[0]) |
+				etc_subblock_indices(sub[1], expanded[1], table[1]);
+		}
+
+		// differential mode: RGB555 base colour and RGB333 signed delta to the second one, when that fits
+		int base5[2][3];
+		int delta[3];
+		bool fits = true;
+
+		for (unsigned c = 0; c < 3; ++c)
+		{
+			for (unsigned s = 0; s < 2; ++s)
+			{
+				base5[s][c] = etc_quantize_sum8(sum[s][c], 5);
+				expanded[s][c] = base5[s][c] << 3 | base5[s][c] >> 2;
+			}
+
+			delta[c] = base5[1][c] - base5[0][c];
+			fits = fits && -4 <= delta[c] && 3 >= delta[c];
+		}
+
+		if (!fits)
+			continue;
+
+		err =
+			etc_best_table(kernel, sub[0], expanded[0], table[0]) +
+			etc_best_table(kernel, sub[1], expanded[1], table[1]);
+
+		if (err < best_err)
+		{
+			best_err = err;
+			best_hi =
+				uint32_t(base5[0][0]) << 27 | uint32_t(delta[0] & 7) << 24 |
+				uint32_t(base5[0][1]) << 19 | uint32_t(delta[1] & 7) << 16 |
+				uint32_t(base5[0][2]) << 11 | uint32_t(delta[2] & 7) << 8 |
+				table[0] << 5 | table[1] << 2 | 1U << 1 | flip;
+			best_lo =
+				etc_subblock_indices(sub[0], expanded[0], table[0]) |
+				etc_subblock_indices(sub[1], expanded[1], table[1]);
+		}
+	}
+
+	if (ETC_FORMAT_ETC2 == format && 0 != best_err)
+	{
+		uint32_t hi, lo;
+
+		if (encode_etc2_planar(block, hi, lo) < best_err)
+		{
+			best_hi = hi;
+			best_lo = lo;
+		}
+	}
+
+	// blocks are stored big-endian
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		dst[i] = uint8_t(best_hi >> (24 - i * 8));
+		dst[i + 4] = uint8_t(best_lo >> (24 - i * 8));
+	}
+}
+
+
+static void*
+etc_rows(
+	void* arg)
+{
+	const etc_job_t& job = *reinterpret_cast< const etc_job_t* >(arg);
+	const unsigned blocks_x = (job.dim_x + 3) / 4;
+
+	for (unsigned by = job.row_begin; by < job.row_end; ++by)
+		for (unsigned bx = 0; bx < blocks_x; ++bx)
+		{
+			int16_t block[3][16];
+
+			for (unsigned y = 0; y < 4; ++y)
+			{
+				const unsigned sy = std::min(by * 4 + y, job.dim_y - 1);
+				const pix* const row = reinterpret_cast< const pix* >(
+					reinterpret_cast< const uint8_t* >(job.src) + size_t(sy) * job.src_stride);
+
+				for (unsigned x = 0; x < 4; ++x)
+				{
+					const pix& p = row[std::min(bx * 4 + x, job.dim_x - 1)];
+
+					block[0][x * 4 + y] = p.c[0];
+					block[1][x * 4 + y] = p.c[1];
+					block[2][x * 4 + y] = p.c[2];
+				}
+			}
+
+			encode_etc_block(job.kernel, job.format, block, job.dst + (size_t(by) * blocks_x + bx) * ETC_BLOCK_SIZE);
+		}
+
+	return 0;
+}
+
+
+size_t
+get_etc_size(
+	const unsigned dim_x,
+	const unsigned dim_y)
+{
+	return size_t((dim_x + 3) / 4) * ((dim_y + 3) / 4) * ETC_BLOCK_SIZE;
+}
+
+
+void
+fill_ETC_from_RGB(
+	uint8_t* const etc_buffer,
+	const pix* const src_buffer,
+	const unsigned src_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const etc_format_t format,
+	const unsigned num_threads)
+{
+	assert(0 != etc_buffer);
+	assert(0 != src_buffer);
+
+	if (0 == dim_x || 0 == dim_y)
+		return;
+
+	etc_job_t job;
+
+	job.kernel = select_simd_kernel();
+	job.format = format;
+	job.dst = etc_buffer;
+	job.src = src_buffer;
+	job.src_stride = src_stride;
+	job.dim_x = dim_x;
+	job.dim_y = dim_y;
+
+	run_rows_parallel(job, etc_rows, (dim_y + 3) / 4, ETC_MIN_BLOCK_ROWS_PER_THREAD, num_threads);
+}
+
+} // namespace util
+} // namespace testbed
@@ -0,0 +1,513 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <vector>
+#include <iostream>
+
+#include "utilPix.hpp"
+#include "utilPix_simd.hpp"
+
+namespace testbed
+{
+
+namespace util
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// mipmaps
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+enum {
+	MIP_MAX_TAPS				= 8,
+	MIP_MARGIN					= 2,	// wrap-around padding of half-rows either side, as needed by the widest filter
+	MIP_MIN_ROWS_PER_THREAD		= 16,
+	SRGB_ENCODE_BITS			= 14	// linear-to-sRGB table resolution; finer than a code at the steepest point
+};
+
+struct mip_taps_t
+{
+	unsigned count;
+	float weight[MIP_MAX_TAPS];
+};
+
+struct mip_job_t
+{
+	unsigned kernel;
+	const mip_taps_t* taps;
+	const uint8_t* srgb_encode;
+
+	const float* src;		// planar RGB of the source level, unless that is level 0
+	const pix* src_pix;		// level 0 pixels, decoded on the fly
+	unsigned src_stride;
+	const float* decode;
+	unsigned src_w;
+	unsigned src_h;
+	float* dst;				// planar RGB of the destination level
+	pix* dst_pix;
+	unsigned dst_w;
+	unsigned dst_h;
+
+	unsigned row_begin;
+	unsigned row_end;
+};
+
+} // namespace
+
+static float srgb_decode[256];
+static uint8_t srgb_encode[1 << SRGB_ENCODE_BITS];
+static pthread_once_t srgb_once = PTHREAD_ONCE_INIT;
+
+
+static void
+init_srgb_tables()
+{
+	for (unsigned i = 0; i < sizeof(srgb_decode) / sizeof(srgb_decode[0]); ++i)
+	{
+		const float v = i / 255.f;
+		srgb_decode[i] = v <= .04045f ? v / 12.92f : powf((v + .055f) / 1.055f, 2.4f);
+	}
+
+	const unsigned max_index = sizeof(srgb_encode) / sizeof(srgb_encode[0]) - 1;
+
+	for (unsigned i = 0; i <= max_index; ++i)
+	{
+		const float v = float(i) / max_index;
+		const float e = v <= .0031308f ? v * 12.92f : 1.055f * powf(v, 1.f / 2.4f) - .055f;
+		srgb_encode[i] = uint8_t(e * 255.f + .5f);
+	}
+}
+
+
+static float
+bessel_i0(
+	const float x)
+{
+	float sum = 1.f;
+	float term = 1.f;
+
+	for (unsigned k = 1; k < 32; ++k)
+	{
+		const float t = x * .5f / k;
+		term *= t * t;
+		sum += term;
+	}
+
+	return sum;
+}
+
+
+static void
+init_mip_taps(
+	mip_taps_t& taps,
+	const mip_filter_t filter)
+{
+	if (MIP_FILTER_BOX == filter)
+	{
+		taps.count = 2;
+		taps.weight[0] = .5f;
+		taps.weight[1] = .5f;
+		return;
+	}
+
+	// sinc windowed by a Kaiser of alpha 4, over two destination texels either side
+	const float pi = 3.14159265f;
+	const float alpha = 4.f;
+	const float radius = 2.f;
+
+	taps.count = MIP_MAX_TAPS;
+	float sum = 0.f;
+
+	for (unsigned i = 0; i < taps.count; ++i)
+	{
+		// distance from the destination texel's centre, in destination texels
+		const float x = (i + .5f - taps.count * .5f) * .5f;
+		const float r = x / radius;
+		const float sinc = sinf(pi * x) / (pi * x);
+		const float window = bessel_i0(alpha * sqrtf(1.f - r * r)) / bessel_i0(alpha);
+
+		taps.weight[i] = sinc * window;
+		sum += taps.weight[i];
+	}
+
+	for (unsigned i = 0; i < taps.count; ++i)
+		taps.weight[i] /= sum;
+}
+
+
+static inline unsigned
+wrap(
+	const int i,
+	const unsigned n)
+{
+	const int r = i % int(n);
+	return unsigned(r < 0 ? r + int(n) : r);
+}
+
+
+// accumulate a weighted row: acc[i] += w * src[i], over [begin, n)
+static void
+mad_row_scalar(
+	float* const acc,
+	const float* const src,
+	const float w,
+	const unsigned begin,
+	const unsigned n)
+{
+	for (unsigned i = begin; i < n; ++i)
+		acc[i] += w * src[i];
+}
+
+#if PIX_SIMD_X86
+
+__attribute__ ((target ("sse4.1")))
+static unsigned
+mad_row_sse41(
+	float* const acc,
+	const float* const src,
+	const float w,
+	const unsigned n)
+{
+	const __m128 w4 = _mm_set1_ps(w);
+	unsigned i = 0;
+
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(w4, _mm_loadu_ps(src + i))));
+
+	return i;
+}
+
+
+__attribute__ ((target ("avx2")))
+static unsigned
+mad_row_avx2(
+	float* const acc,
+	const float* const src,
+	const float w,
+	const unsigned n)
+{
+	const __m256 w8 = _mm256_set1_ps(w);
+	unsigned i = 0;
+
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(w8, _mm256_loadu_ps(src + i))));
+
+	return i;
+}
+
+#elif PIX_SIMD_NEON
+
+static unsigned
+mad_row_neon(
+	float* const acc,
+	const float* const src,
+	const float w,
+	const unsigned n)
+{
+	unsigned i = 0;
+
+	for (; i + 4 <= n; i += 4)
+		vst1q_f32(acc + i, vmlaq_n_f32(vld1q_f32(acc + i), vld1q_f32(src + i), w));
+
+	return i;
+}
+
+#endif
+
+static void
+mad_row(
+	const unsigned kernel,
+	float* const acc,
+	const float* const src,
+	const float w,
+	const unsigned n)
+{
+	unsigned done = 0;
+
+	switch (kernel)
+	{
+#if PIX_SIMD_X86
+	case SIMD_KERNEL_AVX2:
+		done = mad_row_avx2(acc, src, w, n);
+		break;
+
+	case SIMD_KERNEL_SSE41:
+		done = mad_row_sse41(acc, src, w, n);
+		break;
+
+#elif PIX_SIMD_NEON
+	case SIMD_KERNEL_NEON:
+		done = mad_row_neon(acc, src, w, n);
+		break;
+
+#endif
+	}
+
+	mad_row_scalar(acc, src, w, done, n);
+}
+
+
+static inline uint8_t
+encode_texel(
+	const float v,
+	const uint8_t* const srgb_encode)
+{
+	if (0 == srgb_encode)
+		return v <= 0.f ? 0 : (v >= 1.f ? 255 : uint8_t(v * 255.f + .5f));
+
+	const unsigned max_index = (1 << SRGB_ENCODE_BITS) - 1;
+
+	return srgb_encode[v <= 0.f ? 0 : (v >= 1.f ? max_index : unsigned(v * max_index + .5f))];
+}
+
+
+// get a channel's row of the source level; level 0 rows get decoded to all channels at once, into a
+// ring of rows, which spares decoding the whole level up-front as long as rows are consumed in order
+static const float*
+get_source_row(
+	const mip_job_t& job,
+	std::vector< float >& ring,
+	unsigned (&ring_row)[MIP_MAX_TAPS],
+	const unsigned src_y,
+	const unsigned c)
+{
+	if (0 == job.src_pix)
+		return job.src + size_t(job.src_w) * job.src_h * c + size_t(src_y) * job.src_w;
+
+	const unsigned slot = src_y % MIP_MAX_TAPS;
+	float* const row = &ring[size_t(job.src_w) * 3 * slot];
+
+	if (src_y != ring_row[slot])
+	{
+		const pix* const src = reinterpret_cast< const pix* >(
+			reinterpret_cast< const uint8_t* >(job.src_pix) + size_t(src_y) * job.src_stride);
+
+		for (unsigned x = 0; x < job.src_w; ++x)
+		{
+			row[job.src_w * 0 + x] = job.decode[src[x].c[0]];
+			row[job.src_w * 1 + x] = job.decode[src[x].c[1]];
+			row[job.src_w * 2 + x] = job.decode[src[x].c[2]];
+		}
+
+		ring_row[slot] = src_y;
+	}
+
+	return row + job.src_w * c;
+}
+
+
+// filter rows [row_begin, row_end) of a destination level: vertically into a source-wide row, then
+// horizontally from the even and odd halves of that row, so taps become contiguous loads
+static void*
+mip_rows(
+	void* arg)
+{
+	const mip_job_t& job = *reinterpret_cast< const mip_job_t* >(arg);
+	const mip_taps_t& taps = *job.taps;
+	const int tap_origin = int(taps.count / 2) - 1;
+	const size_t dst_plane = size_t(job.dst_w) * job.dst_h;
+	const bool reduce_x = job.src_w > 1;
+	const bool reduce_y = job.src_h > 1;
+
+	std::vector< float > row(job.src_w);
+	std::vector< float > ring(job.src_pix ? size_t(job.src_w) * 3 * MIP_MAX_TAPS : 0);
+	unsigned ring_row[MIP_MAX_TAPS];
+
+	for (unsigned i = 0; i < MIP_MAX_TAPS; ++i)
+		ring_row[i] = -1U;
+
+	std::vector< float > half[2];
+
+	half[0].resize(job.dst_w + MIP_MARGIN * 2);
+	half[1].resize(job.dst_w + MIP_MARGIN * 2);
+
+	for (unsigned y = job.row_begin; y < job.row_end; ++y)
+	{
+		for (unsigned c = 0; c < 3; ++c)
+		{
+			float* const dst = job.dst + c * dst_plane + size_t(y) * job.dst_w;
+
+			if (reduce_y)
+			{
+				std::fill(row.begin(), row.end(), 0.f);
+
+				for (unsigned i = 0; i < taps.count; ++i)
+				{
+					const unsigned src_y = wrap(int(y * 2 + i) - tap_origin, job.src_h);
+					mad_row(job.kernel, &row.front(), get_source_row(job, ring, ring_row, src_y, c), taps.weight[i], job.src_w);
+				}
+			}
+			else
+			{
+				const float* const src = get_source_row(job, ring, ring_row, y, c);
+				std::copy(src, src + job.src_w, row.begin());
+			}
+
+			if (!reduce_x)
+			{
+				dst[0] = row[0];
+				continue;
+			}
+
+			for (unsigned x = 0; x < job.dst_w; ++x)
+			{
+				half[0][x + MIP_MARGIN] = row[x * 2 + 0];
+				half[1][x + MIP_MARGIN] = row[x * 2 + 1];
+			}
+
+			for (int x = 0; x < MIP_MARGIN; ++x)
+			{
+				const int x_lo = x - MIP_MARGIN;
+				const int x_hi = int(job.dst_w) + x;
+
+				half[0][x_lo + MIP_MARGIN] = row[wrap(x_lo * 2 + 0, job.src_w)];
+				half[1][x_lo + MIP_MARGIN] = row[wrap(x_lo * 2 + 1, job.src_w)];
+				half[0][x_hi + MIP_MARGIN] = row[wrap(x_hi * 2 + 0, job.src_w)];
+				half[1][x_hi + MIP_MARGIN] = row[wrap(x_hi * 2 + 1, job.src_w)];
+			}
+
+			std::fill(dst, dst + job.dst_w, 0.f);
+
+			for (unsigned i = 0; i < taps.count; ++i)
+			{
+				const int d = int(i) - tap_origin;
+				const int odd = d & 1;
+
+				mad_row(job.kernel, dst, &half[odd][MIP_MARGIN + (d - odd) / 2], taps.weight[i], job.dst_w);
+			}
+		}
+
+		pix* const out = job.dst_pix + size_t(y) * job.dst_w;
+		const float* const dst = job.dst + size_t(y) * job.dst_w;
+
+		for (unsigned x = 0; x < job.dst_w; ++x)
+		{
+			out[x].c[0] = encode_texel(dst[x + dst_plane * 0], job.srgb_encode);
+			out[x].c[1] = encode_texel(dst[x + dst_plane * 1], job.srgb_encode);
+			out[x].c[2] = encode_texel(dst[x + dst_plane * 2], job.srgb_encode);
+		}
+	}
+
+	return 0;
+}
+
+
+unsigned
+get_mip_count(
+	const unsigned dim_x,
+	const unsigned dim_y)
+{
+	unsigned count = 1;
+
+	for (unsigned w = dim_x, h = dim_y; w > 1 || h > 1; ++count)
+	{
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+
+	return count;
+}
+
+
+size_t
+get_mip_size(
+	const unsigned dim_x,
+	const unsigned dim_y)
+{
+	size_t size = 0;
+
+	for (unsigned w = dim_x, h = dim_y; w > 1 || h > 1;)
+	{
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+		size += size_t(w) * h;
+	}
+
+	return size;
+}
+
+
+bool
+fill_mipmap(
+	pix* const mip_buffer,
+	const pix* const src_buffer,
+	const unsigned src_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const mip_filter_t filter,
+	const bool srgb,
+	const unsigned num_threads)
+{
+	assert(0 != mip_buffer);
+	assert(0 != src_buffer);
+
+	if (2 > get_mip_count(dim_x, dim_y))
+		return true;
+
+	pthread_once(&srgb_once, init_srgb_tables);
+
+	// planar float levels past level 0, ping-ponged between the areas of level 1 and level 2
+	const unsigned w1 = dim_x > 1 ? dim_x / 2 : 1;
+	const unsigned h1 = dim_y > 1 ? dim_y / 2 : 1;
+	const size_t size1 = size_t(w1) * h1;
+	const size_t size2 = size_t(w1 > 1 ? w1 / 2 : 1) * (h1 > 1 ? h1 / 2 : 1);
+
+	float* const level = reinterpret_cast< float* >(malloc((size1 + size2) * 3 * sizeof(float)));
+
+	if (0 == level)
+	{
+		std::cerr << __FUNCTION__ << " failed to allocate memory for the filtering" << std::endl;
+		return false;
+	}
+
+	mip_taps_t taps;
+	init_mip_taps(taps, filter);
+
+	float linear_decode[256];
+
+	for (unsigned i = 0; i < sizeof(linear_decode) / sizeof(linear_decode[0]); ++i)
+		linear_decode[i] = i / 255.f;
+
+	mip_job_t job;
+
+	job.kernel = select_simd_kernel();
+	job.taps = &taps;
+	job.srgb_encode = srgb ? srgb_encode : 0;
+	job.src = 0;
+	job.src_pix = src_buffer;
+	job.src_stride = src_stride;
+	job.decode = srgb ? srgb_decode : linear_decode;
+	job.src_w = dim_x;
+	job.src_h = dim_y;
+	job.dst = level;
+	job.dst_pix = mip_buffer;
+
+	float* spare = level + size1 * 3;
+
+	while (job.src_w > 1 || job.src_h > 1)
+	{
+		job.dst_w = job.src_w > 1 ? job.src_w / 2 : 1;
+		job.dst_h = job.src_h > 1 ? job.src_h / 2 : 1;
+
+		run_rows_parallel(job, mip_rows, job.dst_h, MIP_MIN_ROWS_PER_THREAD, num_threads);
+
+		job.src = job.dst;
+		job.src_pix = 0;
+		job.src_w = job.dst_w;
+		job.src_h = job.dst_h;
+		job.dst_pix += size_t(job.dst_w) * job.dst_h;
+
+		float* const next = spare;
+		spare = job.dst;
+		job.dst = next;
+	}
+
+	free(level);
+
+	return true;
+}
+
+} // namespace util
+} // namespace testbed
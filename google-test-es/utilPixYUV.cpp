@@ -0,0 +1,1108 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+
+#include "utilPix.hpp"
+#include "utilPix_simd.hpp"
+
+namespace testbed
+{
+
+namespace util
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// RGB to YUV420
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+// Q14 fixed-point coefficients of RGB-to-YUV conversion
+struct yuv_coeff_t
+{
+	int16_t y[3];
+	int16_t u[3];
+	int16_t v[3];
+	int32_t y_add;	// Y bias and rounding, in Q14
+	int32_t c_add;	// CbCr bias and rounding, in Q16, as chroma is computed from the sum of a 2x2 block
+};
+
+enum {
+	CSC_MIN_ROW_PAIRS_PER_THREAD = 32
+};
+
+} // namespace
+
+static void
+init_yuv_coeff(
+	yuv_coeff_t& k,
+	const yuv_matrix_t matrix,
+	const yuv_range_t range)
+{
+	const float kr = YUV_MATRIX_BT709 == matrix ? .2126f : .299f;
+	const float kb = YUV_MATRIX_BT709 == matrix ? .0722f : .114f;
+	const float scale_y = YUV_RANGE_LIMITED == range ? 219.f / 255.f : 1.f;
+	const float scale_c = YUV_RANGE_LIMITED == range ? 224.f / 255.f : 1.f;
+	const float q = float(1 << 14);
+
+	// quantize so that rows sum up exactly to the scale of Y and to zero for CbCr, keeping greys grey
+	k.y[0] = int16_t(floorf(kr * scale_y * q + .5f));
+	k.y[2] = int16_t(floorf(kb * scale_y * q + .5f));
+	k.y[1] = int16_t(floorf(scale_y * q + .5f)) - k.y[0] - k.y[2];
+
+	k.u[0] = int16_t(floorf(-kr / (2.f - 2.f * kb) * scale_c * q + .5f));
+	k.u[2] = int16_t(floorf(.5f * scale_c * q + .5f));
+	k.u[1] = -k.u[0] - k.u[2];
+
+	k.v[0] = int16_t(floorf(.5f * scale_c * q + .5f));
+	k.v[2] = int16_t(floorf(-kb / (2.f - 2.f * kr) * scale_c * q + .5f));
+	k.v[1] = -k.v[0] - k.v[2];
+
+	k.y_add = ((YUV_RANGE_LIMITED == range ? 16 : 0) << 14) + (1 << 13);
+	k.c_add = (128 << 16) + (1 << 15);
+}
+
+
+static inline uint8_t
+clamp_u8(
+	const int32_t x)
+{
+	return x < 0 ? 0 : (x > 255 ? 255 : uint8_t(x));
+}
+
+
+// convert columns [begin, end) of a row pair, in units of chroma samples, from pixels of CHANNELS
+// bytes, RGB or RGBA
+template < unsigned CHANNELS >
+static void
+yuv420_from_rgb_scalar(
+	const yuv_coeff_t& k,
+	const uint8_t* const (&rgb)[2],
+	uint8_t* const (&y)[2],
+	uint8_t* const u,
+	uint8_t* const v,
+	const unsigned begin,
+	const unsigned end)
+{
+	for (unsigned j = begin; j < end; ++j)
+	{
+		const uint8_t* const p[2] =
+		{
+			rgb[0] + j * 2 * CHANNELS,
+			rgb[1] + j * 2 * CHANNELS
+		};
+
+		for (unsigned i = 0; i < 2; ++i)
+			for (unsigned h = 0; h < 2; ++h)
+			{
+				const uint8_t* const c = p[i] + h * CHANNELS;
+				y[i][j * 2 + h] = clamp_u8((k.y[0] * c[0] + k.y[1] * c[1] + k.y[2] * c[2] + k.y_add) >> 14);
+			}
+
+		const int32_t r = p[0][0] + p[0][CHANNELS + 0] + p[1][0] + p[1][CHANNELS + 0];
+		const int32_t g = p[0][1] + p[0][CHANNELS + 1] + p[1][1] + p[1][CHANNELS + 1];
+		const int32_t b = p[0][2] + p[0][CHANNELS + 2] + p[1][2] + p[1][CHANNELS + 2];
+
+		u[j] = clamp_u8((k.u[0] * r + k.u[1] * g + k.u[2] * b + k.c_add) >> 16);
+		v[j] = clamp_u8((k.v[0] * r + k.v[1] * g + k.v[2] * b + k.c_add) >> 16);
+	}
+}
+
+#if PIX_SIMD_X86
+
+// split 16 RGBA pixels into RGB planes: gather the channels of each 4 pixels, then transpose the 4x4 dwords
+__attribute__ ((target ("sse4.1")))
+static inline void
+deinterleave_rgba_sse41(
+	const uint8_t* const src,
+	__m128i& r,
+	__m128i& g,
+	__m128i& b)
+{
+	const __m128i gather = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+
+	const __m128i a0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast< const __m128i* >(src +  0)), gather);
+	const __m128i a1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast< const __m128i* >(src + 16)), gather);
+	const __m128i a2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast< const __m128i* >(src + 32)), gather);
+	const __m128i a3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast< const __m128i* >(src + 48)), gather);
+
+	const __m128i rg01 = _mm_unpacklo_epi32(a0, a1);
+	const __m128i rg23 = _mm_unpacklo_epi32(a2, a3);
+	const __m128i ba01 = _mm_unpackhi_epi32(a0, a1);
+	const __m128i ba23 = _mm_unpackhi_epi32(a2, a3);
+
+	r = _mm_unpacklo_epi64(rg01, rg23);
+	g = _mm_unpackhi_epi64(rg01, rg23);
+	b = _mm_unpacklo_epi64(ba01, ba23);
+}
+
+
+template < unsigned CHANNELS >
+__attribute__ ((target ("sse4.1")))
+static inline void
+deinterleave_sse41(
+	const uint8_t* const src,
+	__m128i& r,
+	__m128i& g,
+	__m128i& b)
+{
+	if (4 == CHANNELS)
+		deinterleave_rgba_sse41(src, r, g, b);
+	else
+		deinterleave_rgb_sse41(src, r, g, b);
+}
+
+
+// weighted sum of 8 16-bit RGB triplets, biased and shifted down
+template < int SHIFT >
+__attribute__ ((target ("sse4.1")))
+static inline __m128i
+csc_sse41(
+	const __m128i r,
+	const __m128i g,
+	const __m128i b,
+	const __m128i k_rg,
+	const __m128i k_b,
+	const __m128i add)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	const __m128i lo = _mm_add_epi32(
+		_mm_madd_epi16(_mm_unpacklo_epi16(r, g), k_rg),
+		_mm_madd_epi16(_mm_unpacklo_epi16(b, zero), k_b));
+	const __m128i hi = _mm_add_epi32(
+		_mm_madd_epi16(_mm_unpackhi_epi16(r, g), k_rg),
+		_mm_madd_epi16(_mm_unpackhi_epi16(b, zero), k_b));
+
+	return _mm_packs_epi32(
+		_mm_srai_epi32(_mm_add_epi32(lo, add), SHIFT),
+		_mm_srai_epi32(_mm_add_epi32(hi, add), SHIFT));
+}
+
+
+// returns the number of chroma columns converted; the rest are left to the scalar kernel
+template < unsigned CHANNELS >
+__attribute__ ((target ("sse4.1")))
+static unsigned
+yuv420_from_rgb_sse41(
+	const yuv_coeff_t& k,
+	const uint8_t* const (&rgb)[2],
+	uint8_t* const (&y)[2],
+	uint8_t* const u,
+	uint8_t* const v,
+	const unsigned num_chroma)
+{
+	const __m128i ky_rg = _mm_set1_epi32(uint16_t(k.y[0]) | uint32_t(uint16_t(k.y[1])) << 16);
+	const __m128i ky_b  = _mm_set1_epi32(uint16_t(k.y[2]));
+	const __m128i ku_rg = _mm_set1_epi32(uint16_t(k.u[0]) | uint32_t(uint16_t(k.u[1])) << 16);
+	const __m128i ku_b  = _mm_set1_epi32(uint16_t(k.u[2]));
+	const __m128i kv_rg = _mm_set1_epi32(uint16_t(k.v[0]) | uint32_t(uint16_t(k.v[1])) << 16);
+	const __m128i kv_b  = _mm_set1_epi32(uint16_t(k.v[2]));
+	const __m128i y_add = _mm_set1_epi32(k.y_add);
+	const __m128i c_add = _mm_set1_epi32(k.c_add);
+	const __m128i ones = _mm_set1_epi8(1);
+	const __m128i zero = _mm_setzero_si128();
+
+	unsigned j = 0;
+
+	for (; j + 8 <= num_chroma; j += 8)
+	{
+		__m128i r[2], g[2], b[2];
+
+		for (unsigned i = 0; i < 2; ++i)
+		{
+			deinterleave_sse41< CHANNELS >(rgb[i] + j * 2 * CHANNELS, r[i], g[i], b[i]);
+
+			const __m128i y_lo = csc_sse41< 14 >(
+				_mm_cvtepu8_epi16(r[i]),
+				_mm_cvtepu8_epi16(g[i]),
+				_mm_cvtepu8_epi16(b[i]), ky_rg, ky_b, y_add);
+			const __m128i y_hi = csc_sse41< 14 >(
+				_mm_unpackhi_epi8(r[i], zero),
+				_mm_unpackhi_epi8(g[i], zero),
+				_mm_unpackhi_epi8(b[i], zero), ky_rg, ky_b, y_add);
+
+			_mm_storeu_si128(reinterpret_cast< __m128i* >(y[i] + j * 2), _mm_packus_epi16(y_lo, y_hi));
+		}
+
+		// sums of 2x2 blocks
+		const __m128i r_sum = _mm_add_epi16(_mm_maddubs_epi16(r[0], ones), _mm_maddubs_epi16(r[1], ones));
+		const __m128i g_sum = _mm_add_epi16(_mm_maddubs_epi16(g[0], ones), _mm_maddubs_epi16(g[1], ones));
+		const __m128i b_sum = _mm_add_epi16(_mm_maddubs_epi16(b[0], ones), _mm_maddubs_epi16(b[1], ones));
+
+		const __m128i u8 = csc_sse41< 16 >(r_sum, g_sum, b_sum, ku_rg, ku_b, c_add);
+		const __m128i v8 = csc_sse41< 16 >(r_sum, g_sum, b_sum, kv_rg, kv_b, c_add);
+
+		_mm_storel_epi64(reinterpret_cast< __m128i* >(u + j), _mm_packus_epi16(u8, u8));
+		_mm_storel_epi64(reinterpret_cast< __m128i* >(v + j), _mm_packus_epi16(v8, v8));
+	}
+
+	return j;
+}
+
+
+// weighted sum of 16 16-bit RGB triplets, biased and shifted down; lanes keep their order
+template < int SHIFT >
+__attribute__ ((target ("avx2")))
+static inline __m256i
+csc_avx2(
+	const __m256i r,
+	const __m256i g,
+	const __m256i b,
+	const __m256i k_rg,
+	const __m256i k_b,
+	const __m256i add)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	const __m256i lo = _mm256_add_epi32(
+		_mm256_madd_epi16(_mm256_unpacklo_epi16(r, g), k_rg),
+		_mm256_madd_epi16(_mm256_unpacklo_epi16(b, zero), k_b));
+	const __m256i hi = _mm256_add_epi32(
+		_mm256_madd_epi16(_mm256_unpackhi_epi16(r, g), k_rg),
+		_mm256_madd_epi16(_mm256_unpackhi_epi16(b, zero), k_b));
+
+	return _mm256_packs_epi32(
+		_mm256_srai_epi32(_mm256_add_epi32(lo, add), SHIFT),
+		_mm256_srai_epi32(_mm256_add_epi32(hi, add), SHIFT));
+}
+
+
+__attribute__ ((target ("avx2")))
+static inline __m256i
+combine_avx2(
+	const __m128i lo,
+	const __m128i hi)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+
+template < unsigned CHANNELS >
+__attribute__ ((target ("avx2")))
+static unsigned
+yuv420_from_rgb_avx2(
+	const yuv_coeff_t& k,
+	const uint8_t* const (&rgb)[2],
+	uint8_t* const (&y)[2],
+	uint8_t* const u,
+	uint8_t* const v,
+	const unsigned num_chroma)
+{
+	const __m256i ky_rg = _mm256_set1_epi32(uint16_t(k.y[0]) | uint32_t(uint16_t(k.y[1])) << 16);
+	const __m256i ky_b  = _mm256_set1_epi32(uint16_t(k.y[2]));
+	const __m256i ku_rg = _mm256_set1_epi32(uint16_t(k.u[0]) | uint32_t(uint16_t(k.u[1])) << 16);
+	const __m256i ku_b  = _mm256_set1_epi32(uint16_t(k.u[2]));
+	const __m256i kv_rg = _mm256_set1_epi32(uint16_t(k.v[0]) | uint32_t(uint16_t(k.v[1])) << 16);
+	const __m256i kv_b  = _mm256_set1_epi32(uint16_t(k.v[2]));
+	const __m256i y_add = _mm256_set1_epi32(k.y_add);
+	const __m256i c_add = _mm256_set1_epi32(k.c_add);
+	const __m128i ones = _mm_set1_epi8(1);
+
+	unsigned j = 0;
+
+	for (; j + 16 <= num_chroma; j += 16)
+	{
+		__m128i r[2][2], g[2][2], b[2][2];
+
+		for (unsigned i = 0; i < 2; ++i)
+		{
+			deinterleave_sse41< CHANNELS >(rgb[i] + j * 2 * CHANNELS,                 r[i][0], g[i][0], b[i][0]);
+			deinterleave_sse41< CHANNELS >(rgb[i] + j * 2 * CHANNELS + 16 * CHANNELS, r[i][1], g[i][1], b[i][1]);
+
+			const __m256i y_lo = csc_avx2< 14 >(
+				_mm256_cvtepu8_epi16(r[i][0]),
+				_mm256_cvtepu8_epi16(g[i][0]),
+				_mm256_cvtepu8_epi16(b[i][0]), ky_rg, ky_b, y_add);
+			const __m256i y_hi = csc_avx2< 14 >(
+				_mm256_cvtepu8_epi16(r[i][1]),
+				_mm256_cvtepu8_epi16(g[i][1]),
+				_mm256_cvtepu8_epi16(b[i][1]), ky_rg, ky_b, y_add);
+
+			// packing interleaves the 128-bit lanes of its operands; restore the order of the quadwords
+			_mm256_storeu_si256(reinterpret_cast< __m256i* >(y[i] + j * 2),
+				_mm256_permute4x64_epi64(_mm256_packus_epi16(y_lo, y_hi), 0xd8));
+		}
+
+		// sums of 2x2 blocks
+		const __m256i r_sum = combine_avx2(
+			_mm_add_epi16(_mm_maddubs_epi16(r[0][0], ones), _mm_maddubs_epi16(r[1][0], ones)),
+			_mm_add_epi16(_mm_maddubs_epi16(r[0][1], ones), _mm_maddubs_epi16(r[1][1], ones)));
+		const __m256i g_sum = combine_avx2(
+			_mm_add_epi16(_mm_maddubs_epi16(g[0][0], ones), _mm_maddubs_epi16(g[1][0], ones)),
+			_mm_add_epi16(_mm_maddubs_epi16(g[0][1], ones), _mm_maddubs_epi16(g[1][1], ones)));
+		const __m256i b_sum = combine_avx2(
+			_mm_add_epi16(_mm_maddubs_epi16(b[0][0], ones), _mm_maddubs_epi16(b[1][0], ones)),
+			_mm_add_epi16(_mm_maddubs_epi16(b[0][1], ones), _mm_maddubs_epi16(b[1][1], ones)));
+
+		const __m256i u16 = csc_avx2< 16 >(r_sum, g_sum, b_sum, ku_rg, ku_b, c_add);
+		const __m256i v16 = csc_avx2< 16 >(r_sum, g_sum, b_sum, kv_rg, kv_b, c_add);
+
+		_mm_storeu_si128(reinterpret_cast< __m128i* >(u + j), _mm256_castsi256_si128(
+			_mm256_permute4x64_epi64(_mm256_packus_epi16(u16, u16), 0xd8)));
+		_mm_storeu_si128(reinterpret_cast< __m128i* >(v + j), _mm256_castsi256_si128(
+			_mm256_permute4x64_epi64(_mm256_packus_epi16(v16, v16), 0xd8)));
+	}
+
+	return j;
+}
+
+#elif PIX_SIMD_NEON
+
+// weighted sum of 8 16-bit RGB triplets, biased and shifted down
+template < int SHIFT >
+static inline int16x8_t
+csc_neon(
+	const int16x8_t r,
+	const int16x8_t g,
+	const int16x8_t b,
+	const int16_t (&k)[3],
+	const int32_t add)
+{
+	int32x4_t lo = vdupq_n_s32(add);
+	int32x4_t hi = vdupq_n_s32(add);
+
+	lo = vmlal_n_s16(lo, vget_low_s16(r), k[0]);
+	lo = vmlal_n_s16(lo, vget_low_s16(g), k[1]);
+	lo = vmlal_n_s16(lo, vget_low_s16(b), k[2]);
+
+	hi = vmlal_n_s16(hi, vget_high_s16(r), k[0]);
+	hi = vmlal_n_s16(hi, vget_high_s16(g), k[1]);
+	hi = vmlal_n_s16(hi, vget_high_s16(b), k[2]);
+
+	return vcombine_s16(vshrn_n_s32(lo, SHIFT), vshrn_n_s32(hi, SHIFT));
+}
+
+
+static inline int16x8_t
+widen_lo(
+	const uint8x16_t a)
+{
+	return vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(a)));
+}
+
+
+static inline int16x8_t
+widen_hi(
+	const uint8x16_t a)
+{
+	return vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(a)));
+}
+
+
+// load 16 RGB or RGBA pixels as RGB planes
+template < unsigned CHANNELS >
+static inline uint8x16x3_t
+load_rgb_neon(
+	const uint8_t* const src)
+{
+	if (3 == CHANNELS)
+		return vld3q_u8(src);
+
+	const uint8x16x4_t p = vld4q_u8(src);
+	const uint8x16x3_t rgb = { { p.val[0], p.val[1], p.val[2] } };
+
+	return rgb;
+}
+
+
+template < unsigned CHANNELS >
+static unsigned
+yuv420_from_rgb_neon(
+	const yuv_coeff_t& k,
+	const uint8_t* const (&rgb)[2],
+	uint8_t* const (&y)[2],
+	uint8_t* const u,
+	uint8_t* const v,
+	const unsigned num_chroma)
+{
+	unsigned j = 0;
+
+	for (; j + 8 <= num_chroma; j += 8)
+	{
+		const uint8x16x3_t p[2] =
+		{
+			load_rgb_neon< CHANNELS >(rgb[0] + j * 2 * CHANNELS),
+			load_rgb_neon< CHANNELS >(rgb[1] + j * 2 * CHANNELS)
+		};
+
+		for (unsigned i = 0; i < 2; ++i)
+		{
+			const int16x8_t y_lo = csc_neon< 14 >(
+				widen_lo(p[i].val[0]), widen_lo(p[i].val[1]), widen_lo(p[i].val[2]), k.y, k.y_add);
+			const int16x8_t y_hi = csc_neon< 14 >(
+				widen_hi(p[i].val[0]), widen_hi(p[i].val[1]), widen_hi(p[i].val[2]), k.y, k.y_add);
+
+			vst1q_u8(y[i] + j * 2, vcombine_u8(vqmovun_s16(y_lo), vqmovun_s16(y_hi)));
+		}
+
+		// sums of 2x2 blocks
+		const int16x8_t r_sum = vreinterpretq_s16_u16(vpadalq_u8(vpaddlq_u8(p[0].val[0]), p[1].val[0]));
+		const int16x8_t g_sum = vreinterpretq_s16_u16(vpadalq_u8(vpaddlq_u8(p[0].val[1]), p[1].val[1]));
+		const int16x8_t b_sum = vreinterpretq_s16_u16(vpadalq_u8(vpaddlq_u8(p[0].val[2]), p[1].val[2]));
+
+		vst1_u8(u + j, vqmovun_s16(csc_neon< 16 >(r_sum, g_sum, b_sum, k.u, k.c_add)));
+		vst1_u8(v + j, vqmovun_s16(csc_neon< 16 >(r_sum, g_sum, b_sum, k.v, k.c_add)));
+	}
+
+	return j;
+}
+
+#endif
+
+namespace
+{
+
+struct yuv420_from_rgb_job_t
+{
+	const yuv_coeff_t* k;
+	unsigned kernel;
+
+	uint8_t* y_buffer;
+	uint8_t* u_buffer;
+	uint8_t* v_buffer;
+	unsigned y_stride;
+	unsigned u_stride;
+	unsigned v_stride;
+	const uint8_t* rgb_buffer;
+	unsigned rgb_stride;
+	unsigned dim_x;
+
+	unsigned row_begin;		// in row pairs
+	unsigned row_end;
+};
+
+} // namespace
+
+template < unsigned CHANNELS >
+static void*
+yuv420_from_rgb_rows(
+	void* arg)
+{
+	const yuv420_from_rgb_job_t& job = *reinterpret_cast< const yuv420_from_rgb_job_t* >(arg);
+	const unsigned num_chroma = job.dim_x / 2;
+
+	for (unsigned i = job.row_begin; i < job.row_end; ++i)
+	{
+		const uint8_t* const rgb[2] =
+		{
+			job.rgb_buffer + size_t(i * 2 + 0) * job.rgb_stride,
+			job.rgb_buffer + size_t(i * 2 + 1) * job.rgb_stride
+		};
+
+		uint8_t* const y[2] =
+		{
+			job.y_buffer + size_t(i * 2 + 0) * job.y_stride,
+			job.y_buffer + size_t(i * 2 + 1) * job.y_stride
+		};
+
+		uint8_t* const u = job.u_buffer + size_t(i) * job.u_stride;
+		uint8_t* const v = job.v_buffer + size_t(i) * job.v_stride;
+
+		unsigned done = 0;
+
+		switch (job.kernel)
+		{
+#if PIX_SIMD_X86
+		case SIMD_KERNEL_AVX2:
+			done = yuv420_from_rgb_avx2< CHANNELS >(*job.k, rgb, y, u, v, num_chroma);
+			break;
+
+		case SIMD_KERNEL_SSE41:
+			done = yuv420_from_rgb_sse41< CHANNELS >(*job.k, rgb, y, u, v, num_chroma);
+			break;
+
+#elif PIX_SIMD_NEON
+		case SIMD_KERNEL_NEON:
+			done = yuv420_from_rgb_neon< CHANNELS >(*job.k, rgb, y, u, v, num_chroma);
+			break;
+
+#endif
+		}
+
+		yuv420_from_rgb_scalar< CHANNELS >(*job.k, rgb, y, u, v, done, num_chroma);
+	}
+
+	return 0;
+}
+
+
+void
+fill_YUV420_from_RGB(
+	uint8_t* const y_buffer,
+	uint8_t* const u_buffer,
+	uint8_t* const v_buffer,
+	const unsigned y_stride,
+	const unsigned u_stride,
+	const unsigned v_stride,
+	pix* const rgb_buffer,
+	const unsigned rgb_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix,
+	const yuv_range_t range,
+	const unsigned num_threads)
+{
+	yuv_coeff_t k;
+	init_yuv_coeff(k, matrix, range);
+
+	yuv420_from_rgb_job_t job;
+
+	job.k = &k;
+	job.kernel = select_simd_kernel();
+	job.y_buffer = y_buffer;
+	job.u_buffer = u_buffer;
+	job.v_buffer = v_buffer;
+	job.y_stride = y_stride;
+	job.u_stride = u_stride;
+	job.v_stride = v_stride;
+	job.rgb_buffer = reinterpret_cast< const uint8_t* >(rgb_buffer);
+	job.rgb_stride = rgb_stride;
+	job.dim_x = dim_x;
+
+	run_rows_parallel(job, yuv420_from_rgb_rows< 3 >, dim_y / 2, CSC_MIN_ROW_PAIRS_PER_THREAD, num_threads);
+}
+
+
+void
+fill_YUV420_from_RGBA(
+	uint8_t* const y_buffer,
+	uint8_t* const u_buffer,
+	uint8_t* const v_buffer,
+	const unsigned y_stride,
+	const unsigned u_stride,
+	const unsigned v_stride,
+	const uint8_t* const rgba_buffer,
+	const unsigned rgba_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix,
+	const yuv_range_t range,
+	const unsigned num_threads)
+{
+	yuv_coeff_t k;
+	init_yuv_coeff(k, matrix, range);
+
+	yuv420_from_rgb_job_t job;
+
+	job.k = &k;
+	job.kernel = select_simd_kernel();
+	job.y_buffer = y_buffer;
+	job.u_buffer = u_buffer;
+	job.v_buffer = v_buffer;
+	job.y_stride = y_stride;
+	job.u_stride = u_stride;
+	job.v_stride = v_stride;
+	job.rgb_buffer = rgba_buffer;
+	job.rgb_stride = rgba_stride;
+	job.dim_x = dim_x;
+
+	run_rows_parallel(job, yuv420_from_rgb_rows< 4 >, dim_y / 2, CSC_MIN_ROW_PAIRS_PER_THREAD, num_threads);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// YUV420 to RGB
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+// Q13 fixed-point coefficients of YUV-to-RGB conversion, over luma less its offset, and chroma less 128
+struct rgb_coeff_t
+{
+	int16_t r[3];
+	int16_t g[3];
+	int16_t b[3];
+	int16_t y_sub;
+	int32_t add;
+};
+
+enum {
+	CSC_MIN_ROWS_PER_THREAD = 64
+};
+
+} // namespace
+
+static void
+init_rgb_coeff(
+	rgb_coeff_t& k,
+	const yuv_matrix_t matrix,
+	const yuv_range_t range)
+{
+	const float kr = YUV_MATRIX_BT709 == matrix ? .2126f : .299f;
+	const float kb = YUV_MATRIX_BT709 == matrix ? .0722f : .114f;
+	const float kg = 1.f - kr - kb;
+	const float scale_y = YUV_RANGE_LIMITED == range ? 255.f / 219.f : 1.f;
+	const float scale_c = YUV_RANGE_LIMITED == range ? 255.f / 224.f : 1.f;
+	const float q = float(1 << 13);
+
+	const int16_t y = int16_t(floorf(scale_y * q + .5f));
+
+	k.r[0] = y;
+	k.r[1] = 0;
+	k.r[2] = int16_t(floorf((2.f - 2.f * kr) * scale_c * q + .5f));
+
+	k.g[0] = y;
+	k.g[1] = int16_t(floorf(-(2.f - 2.f * kb) * kb / kg * scale_c * q + .5f));
+	k.g[2] = int16_t(floorf(-(2.f - 2.f * kr) * kr / kg * scale_c * q + .5f));
+
+	k.b[0] = y;
+	k.b[1] = int16_t(floorf((2.f - 2.f * kb) * scale_c * q + .5f));
+	k.b[2] = 0;
+
+	k.y_sub = YUV_RANGE_LIMITED == range ? 16 : 0;
+	k.add = 1 << 12;
+}
+
+
+// convert pixels [begin, end) of a row; chroma samples are c_step bytes apart, a c_step of 2 denoting
+// interleaved CbCr pairs
+static void
+rgb_from_yuv_scalar(
+	const rgb_coeff_t& k,
+	const uint8_t* const y,
+	const uint8_t* const u,
+	const uint8_t* const v,
+	const unsigned c_step,
+	uint8_t* const rgb,
+	const unsigned channels,
+	const unsigned begin,
+	const unsigned end)
+{
+	for (unsigned j = begin; j < end; ++j)
+	{
+		const int32_t yi = y[j] - k.y_sub;
+		const int32_t ui = u[j / 2 * c_step] - 128;
+		const int32_t vi = v[j / 2 * c_step] - 128;
+
+		uint8_t* const p = rgb + j * channels;
+
+		p[0] = clamp_u8((k.r[0] * yi + k.r[1] * ui + k.r[2] * vi + k.add) >> 13);
+		p[1] = clamp_u8((k.g[0] * yi + k.g[1] * ui + k.g[2] * vi + k.add) >> 13);
+		p[2] = clamp_u8((k.b[0] * yi + k.b[1] * ui + k.b[2] * vi + k.add) >> 13);
+
+		if (4 == channels)
+			p[3] = 255;
+	}
+}
+
+#if PIX_SIMD_X86
+
+// load 8 chroma samples of either plane, as 16-bit values less 128
+__attribute__ ((target ("sse4.1")))
+static inline void
+load_chroma_sse41(
+	const uint8_t* const u,
+	const uint8_t* const v,
+	const unsigned c_step,
+	__m128i& u16,
+	__m128i& v16)
+{
+	__m128i u8, v8;
+
+	if (1 == c_step)
+	{
+		u8 = _mm_loadl_epi64(reinterpret_cast< const __m128i* >(u));
+		v8 = _mm_loadl_epi64(reinterpret_cast< const __m128i* >(v));
+	}
+	else
+	{
+		const __m128i uv = _mm_loadu_si128(reinterpret_cast< const __m128i* >(u));
+
+		u8 = _mm_shuffle_epi8(uv, _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1));
+		v8 = _mm_shuffle_epi8(uv, _mm_setr_epi8(1, 3, 5, 7, 9, 11, 13, 15, -1, -1, -1, -1, -1, -1, -1, -1));
+	}
+
+	const __m128i c_sub = _mm_set1_epi16(128);
+
+	u16 = _mm_sub_epi16(_mm_cvtepu8_epi16(u8), c_sub);
+	v16 = _mm_sub_epi16(_mm_cvtepu8_epi16(v8), c_sub);
+}
+
+
+// returns the number of pixels converted; the rest are left to the scalar kernel
+__attribute__ ((target ("sse4.1")))
+static unsigned
+rgb_from_yuv_sse41(
+	const rgb_coeff_t& k,
+	const uint8_t* const y,
+	const uint8_t* const u,
+	const uint8_t* const v,
+	const unsigned c_step,
+	uint8_t* const rgb,
+	const unsigned channels,
+	const unsigned num_pixels)
+{
+	const __m128i kr_yu = _mm_set1_epi32(uint16_t(k.r[0]) | uint32_t(uint16_t(k.r[1])) << 16);
+	const __m128i kr_v  = _mm_set1_epi32(uint16_t(k.r[2]));
+	const __m128i kg_yu = _mm_set1_epi32(uint16_t(k.g[0]) | uint32_t(uint16_t(k.g[1])) << 16);
+	const __m128i kg_v  = _mm_set1_epi32(uint16_t(k.g[2]));
+	const __m128i kb_yu = _mm_set1_epi32(uint16_t(k.b[0]) | uint32_t(uint16_t(k.b[1])) << 16);
+	const __m128i kb_v  = _mm_set1_epi32(uint16_t(k.b[2]));
+	const __m128i y_sub = _mm_set1_epi16(k.y_sub);
+	const __m128i add = _mm_set1_epi32(k.add);
+	const __m128i zero = _mm_setzero_si128();
+
+	unsigned j = 0;
+
+	for (; j + 16 <= num_pixels; j += 16)
+	{
+		const __m128i y8 = _mm_loadu_si128(reinterpret_cast< const __m128i* >(y + j));
+		const __m128i y_lo = _mm_sub_epi16(_mm_cvtepu8_epi16(y8), y_sub);
+		const __m128i y_hi = _mm_sub_epi16(_mm_unpackhi_epi8(y8, zero), y_sub);
+
+		__m128i u16, v16;
+		load_chroma_sse41(u + j / 2 * c_step, v + j / 2 * c_step, c_step, u16, v16);
+
+		// each chroma sample covers two pixels
+		const __m128i u_lo = _mm_unpacklo_epi16(u16, u16);
+		const __m128i u_hi = _mm_unpackhi_epi16(u16, u16);
+		const __m128i v_lo = _mm_unpacklo_epi16(v16, v16);
+		const __m128i v_hi = _mm_unpackhi_epi16(v16, v16);
+
+		const __m128i r = _mm_packus_epi16(
+			csc_sse41< 13 >(y_lo, u_lo, v_lo, kr_yu, kr_v, add),
+			csc_sse41< 13 >(y_hi, u_hi, v_hi, kr_yu, kr_v, add));
+		const __m128i g = _mm_packus_epi16(
+			csc_sse41< 13 >(y_lo, u_lo, v_lo, kg_yu, kg_v, add),
+			csc_sse41< 13 >(y_hi, u_hi, v_hi, kg_yu, kg_v, add));
+		const __m128i b = _mm_packus_epi16(
+			csc_sse41< 13 >(y_lo, u_lo, v_lo, kb_yu, kb_v, add),
+			csc_sse41< 13 >(y_hi, u_hi, v_hi, kb_yu, kb_v, add));
+
+		store_rgb_sse41(rgb + j * channels, channels, r, g, b);
+	}
+
+	return j;
+}
+
+
+__attribute__ ((target ("avx2")))
+static unsigned
+rgb_from_yuv_avx2(
+	const rgb_coeff_t& k,
+	const uint8_t* const y,
+	const uint8_t* const u,
+	const uint8_t* const v,
+	const unsigned c_step,
+	uint8_t* const rgb,
+	const unsigned channels,
+	const unsigned num_pixels)
+{
+	const __m256i kr_yu = _mm256_set1_epi32(uint16_t(k.r[0]) | uint32_t(uint16_t(k.r[1])) << 16);
+	const __m256i kr_v  = _mm256_set1_epi32(uint16_t(k.r[2]));
+	const __m256i kg_yu = _mm256_set1_epi32(uint16_t(k.g[0]) | uint32_t(uint16_t(k.g[1])) << 16);
+	const __m256i kg_v  = _mm256_set1_epi32(uint16_t(k.g[2]));
+	const __m256i kb_yu = _mm256_set1_epi32(uint16_t(k.b[0]) | uint32_t(uint16_t(k.b[1])) << 16);
+	const __m256i kb_v  = _mm256_set1_epi32(uint16_t(k.b[2]));
+	const __m256i y_sub = _mm256_set1_epi16(k.y_sub);
+	const __m256i add = _mm256_set1_epi32(k.add);
+
+	unsigned j = 0;
+
+	for (; j + 32 <= num_pixels; j += 32)
+	{
+		const __m128i y8_lo = _mm_loadu_si128(reinterpret_cast< const __m128i* >(y + j));
+		const __m128i y8_hi = _mm_loadu_si128(reinterpret_cast< const __m128i* >(y + j + 16));
+		const __m256i y_lo = _mm256_sub_epi16(_mm256_cvtepu8_epi16(y8_lo), y_sub);
+		const __m256i y_hi = _mm256_sub_epi16(_mm256_cvtepu8_epi16(y8_hi), y_sub);
+
+		__m128i u16[2], v16[2];
+		load_chroma_sse41(u + j / 2 * c_step,       v + j / 2 * c_step,       c_step, u16[0], v16[0]);
+		load_chroma_sse41(u + (j / 2 + 8) * c_step, v + (j / 2 + 8) * c_step, c_step, u16[1], v16[1]);
+
+		// each chroma sample covers two pixels; unpacking works within 128-bit lanes, so pre-arrange the
+		// quadwords for the low lane to get samples 0-3 and the high lane samples 4-7, etc.
+		const __m256i u_lh = _mm256_permute4x64_epi64(combine_avx2(u16[0], u16[1]), 0xd8);
+		const __m256i v_lh = _mm256_permute4x64_epi64(combine_avx2(v16[0], v16[1]), 0xd8);
+		const __m256i u_lo = _mm256_unpacklo_epi16(u_lh, u_lh);
+		const __m256i u_hi = _mm256_unpackhi_epi16(u_lh, u_lh);
+		const __m256i v_lo = _mm256_unpacklo_epi16(v_lh, v_lh);
+		const __m256i v_hi = _mm256_unpackhi_epi16(v_lh, v_lh);
+
+		// packing interleaves the 128-bit lanes of its operands; restore the order of the quadwords
+		const __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(
+			csc_avx2< 13 >(y_lo, u_lo, v_lo, kr_yu, kr_v, add),
+			csc_avx2< 13 >(y_hi, u_hi, v_hi, kr_yu, kr_v, add)), 0xd8);
+		const __m256i g = _mm256_permute4x64_epi64(_mm256_packus_epi16(
+			csc_avx2< 13 >(y_lo, u_lo, v_lo, kg_yu, kg_v, add),
+			csc_avx2< 13 >(y_hi, u_hi, v_hi, kg_yu, kg_v, add)), 0xd8);
+		const __m256i b = _mm256_permute4x64_epi64(_mm256_packus_epi16(
+			csc_avx2< 13 >(y_lo, u_lo, v_lo, kb_yu, kb_v, add),
+			csc_avx2< 13 >(y_hi, u_hi, v_hi, kb_yu, kb_v, add)), 0xd8);
+
+		store_rgb_sse41(rgb + j * channels, channels,
+			_mm256_castsi256_si128(r),
+			_mm256_castsi256_si128(g),
+			_mm256_castsi256_si128(b));
+		store_rgb_sse41(rgb + (j + 16) * channels, channels,
+			_mm256_extracti128_si256(r, 1),
+			_mm256_extracti128_si256(g, 1),
+			_mm256_extracti128_si256(b, 1));
+	}
+
+	return j;
+}
+
+#elif PIX_SIMD_NEON
+
+static unsigned
+rgb_from_yuv_neon(
+	const rgb_coeff_t& k,
+	const uint8_t* const y,
+	const uint8_t* const u,
+	const uint8_t* const v,
+	const unsigned c_step,
+	uint8_t* const rgb,
+	const unsigned channels,
+	const unsigned num_pixels)
+{
+	const int16x8_t y_sub = vdupq_n_s16(k.y_sub);
+	const int16x8_t c_sub = vdupq_n_s16(128);
+
+	unsigned j = 0;
+
+	for (; j + 16 <= num_pixels; j += 16)
+	{
+		const uint8x16_t y8 = vld1q_u8(y + j);
+		const int16x8_t y_lo = vsubq_s16(widen_lo(y8), y_sub);
+		const int16x8_t y_hi = vsubq_s16(widen_hi(y8), y_sub);
+
+		uint8x8_t u8, v8;
+
+		if (1 == c_step)
+		{
+			u8 = vld1_u8(u + j / 2);
+			v8 = vld1_u8(v + j / 2);
+		}
+		else
+		{
+			const uint8x8x2_t uv = vld2_u8(u + j);
+
+			u8 = uv.val[0];
+			v8 = uv.val[1];
+		}
+
+		// each chroma sample covers two pixels
+		const int16x8_t u16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), c_sub);
+		const int16x8_t v16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), c_sub);
+		const int16x8x2_t u2 = vzipq_s16(u16, u16);
+		const int16x8x2_t v2 = vzipq_s16(v16, v16);
+
+		const uint8x16_t r = vcombine_u8(
+			vqmovun_s16(csc_neon< 13 >(y_lo, u2.val[0], v2.val[0], k.r, k.add)),
+			vqmovun_s16(csc_neon< 13 >(y_hi, u2.val[1], v2.val[1], k.r, k.add)));
+		const uint8x16_t g = vcombine_u8(
+			vqmovun_s16(csc_neon< 13 >(y_lo, u2.val[0], v2.val[0], k.g, k.add)),
+			vqmovun_s16(csc_neon< 13 >(y_hi, u2.val[1], v2.val[1], k.g, k.add)));
+		const uint8x16_t b = vcombine_u8(
+			vqmovun_s16(csc_neon< 13 >(y_lo, u2.val[0], v2.val[0], k.b, k.add)),
+			vqmovun_s16(csc_neon< 13 >(y_hi, u2.val[1], v2.val[1], k.b, k.add)));
+
+		if (4 == channels)
+		{
+			uint8x16x4_t p;
+
+			p.val[0] = r;
+			p.val[1] = g;
+			p.val[2] = b;
+			p.val[3] = vdupq_n_u8(255);
+
+			vst4q_u8(rgb + j * 4, p);
+		}
+		else
+		{
+			uint8x16x3_t p;
+
+			p.val[0] = r;
+			p.val[1] = g;
+			p.val[2] = b;
+
+			vst3q_u8(rgb + j * 3, p);
+		}
+	}
+
+	return j;
+}
+
+#endif
+
+namespace
+{
+
+struct rgb_from_yuv_job_t
+{
+	const rgb_coeff_t* k;
+	unsigned kernel;
+
+	uint8_t* rgb_buffer;
+	unsigned rgb_stride;
+	unsigned rgb_channels;
+	const uint8_t* y_buffer;
+	const uint8_t* u_buffer;
+	const uint8_t* v_buffer;
+	unsigned y_stride;
+	unsigned u_stride;
+	unsigned v_stride;
+	unsigned c_step;
+	unsigned dim_x;
+
+	unsigned row_begin;
+	unsigned row_end;
+};
+
+} // namespace
+
+static void*
+rgb_from_yuv_rows(
+	void* arg)
+{
+	const rgb_from_yuv_job_t& job = *reinterpret_cast< const rgb_from_yuv_job_t* >(arg);
+
+	for (unsigned i = job.row_begin; i < job.row_end; ++i)
+	{
+		uint8_t* const rgb = job.rgb_buffer + size_t(i) * job.rgb_stride;
+		const uint8_t* const y = job.y_buffer + size_t(i) * job.y_stride;
+		const uint8_t* const u = job.u_buffer + size_t(i / 2) * job.u_stride;
+		const uint8_t* const v = job.v_buffer + size_t(i / 2) * job.v_stride;
+
+		unsigned done = 0;
+
+		switch (job.kernel)
+		{
+#if PIX_SIMD_X86
+		case SIMD_KERNEL_AVX2:
+			done = rgb_from_yuv_avx2(*job.k, y, u, v, job.c_step, rgb, job.rgb_channels, job.dim_x);
+			break;
+
+		case SIMD_KERNEL_SSE41:
+			done = rgb_from_yuv_sse41(*job.k, y, u, v, job.c_step, rgb, job.rgb_channels, job.dim_x);
+			break;
+
+#elif PIX_SIMD_NEON
+		case SIMD_KERNEL_NEON:
+			done = rgb_from_yuv_neon(*job.k, y, u, v, job.c_step, rgb, job.rgb_channels, job.dim_x);
+			break;
+
+#endif
+		}
+
+		rgb_from_yuv_scalar(*job.k, y, u, v, job.c_step, rgb, job.rgb_channels, done, job.dim_x);
+	}
+
+	return 0;
+}
+
+
+static void
+fill_RGB_from_YUV420_generic(
+	uint8_t* const rgb_buffer,
+	const unsigned rgb_stride,
+	const unsigned rgb_channels,
+	const uint8_t* const y_buffer,
+	const uint8_t* const u_buffer,
+	const uint8_t* const v_buffer,
+	const unsigned y_stride,
+	const unsigned u_stride,
+	const unsigned v_stride,
+	const unsigned c_step,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix,
+	const yuv_range_t range,
+	const unsigned num_threads)
+{
+	assert(3 == rgb_channels || 4 == rgb_channels);
+
+	rgb_coeff_t k;
+	init_rgb_coeff(k, matrix, range);
+
+	rgb_from_yuv_job_t job;
+
+	job.k = &k;
+	job.kernel = select_simd_kernel();
+	job.rgb_buffer = rgb_buffer;
+	job.rgb_stride = rgb_stride;
+	job.rgb_channels = rgb_channels;
+	job.y_buffer = y_buffer;
+	job.u_buffer = u_buffer;
+	job.v_buffer = v_buffer;
+	job.y_stride = y_stride;
+	job.u_stride = u_stride;
+	job.v_stride = v_stride;
+	job.c_step = c_step;
+	job.dim_x = dim_x;
+
+	run_rows_parallel(job, rgb_from_yuv_rows, dim_y, CSC_MIN_ROWS_PER_THREAD, num_threads);
+}
+
+
+void
+fill_RGB_from_YUV420(
+	uint8_t* const rgb_buffer,
+	const unsigned rgb_stride,
+	const unsigned rgb_channels,
+	const uint8_t* const y_buffer,
+	const uint8_t* const u_buffer,
+	const uint8_t* const v_buffer,
+	const unsigned y_stride,
+	const unsigned u_stride,
+	const unsigned v_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix,
+	const yuv_range_t range,
+	const unsigned num_threads)
+{
+	fill_RGB_from_YUV420_generic(rgb_buffer, rgb_stride, rgb_channels,
+		y_buffer, u_buffer, v_buffer, y_stride, u_stride, v_stride, 1,
+		dim_x, dim_y, matrix, range, num_threads);
+}
+
+
+void
+fill_RGB_from_YV12(
+	uint8_t* const rgb_buffer,
+	const unsigned rgb_stride,
+	const unsigned rgb_channels,
+	const uint8_t* const yv12_buffer,
+	const unsigned y_stride,
+	const unsigned c_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix,
+	const yuv_range_t range,
+	const unsigned num_threads)
+{
+	const uint8_t* const v_buffer = yv12_buffer + size_t(y_stride) * dim_y;
+	const uint8_t* const u_buffer = v_buffer + size_t(c_stride) * ((dim_y + 1) / 2);
+
+	fill_RGB_from_YUV420_generic(rgb_buffer, rgb_stride, rgb_channels,
+		yv12_buffer, u_buffer, v_buffer, y_stride, c_stride, c_stride, 1,
+		dim_x, dim_y, matrix, range, num_threads);
+}
+
+
+void
+fill_RGB_from_NV12(
+	uint8_t* const rgb_buffer,
+	const unsigned rgb_stride,
+	const unsigned rgb_channels,
+	const uint8_t* const y_buffer,
+	const uint8_t* const uv_buffer,
+	const unsigned y_stride,
+	const unsigned uv_stride,
+	const unsigned dim_x,
+	const unsigned dim_y,
+	const yuv_matrix_t matrix,
+	const yuv_range_t range,
+	const unsigned num_threads)
+{
+	fill_RGB_from_YUV420_generic(rgb_buffer, rgb_stride, rgb_channels,
+		y_buffer, uv_buffer, uv_buffer + 1, y_stride, uv_stride, uv_stride, 2,
+		dim_x, dim_y, matrix, range, num_threads);
+}
+
+} // namespace util
+} // namespace testbed
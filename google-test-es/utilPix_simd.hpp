@@ -0,0 +1,170 @@
+#ifndef util_pix_simd_H__
+#define util_pix_simd_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// internal to the utilPix*.cpp translation units: SIMD kernel selection and the threading of row ranges
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define PIX_SIMD_X86	1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PIX_SIMD_NEON	1
+#endif
+
+namespace testbed
+{
+
+namespace util
+{
+
+enum {
+	SIMD_KERNEL_SCALAR,
+	SIMD_KERNEL_SSE41,
+	SIMD_KERNEL_AVX2,
+	SIMD_KERNEL_NEON
+};
+
+// select_simd_kernel()	: best kernel the CPU supports, of those built for the target
+unsigned
+select_simd_kernel();
+
+#if PIX_SIMD_X86
+
+// split 16 RGB pixels into planes
+__attribute__ ((target ("sse4.1")))
+static inline void
+deinterleave_rgb_sse41(
+	const uint8_t* const src,
+	__m128i& r,
+	__m128i& g,
+	__m128i& b)
+{
+	const __m128i a0 = _mm_loadu_si128(reinterpret_cast< const __m128i* >(src + 0));
+	const __m128i a1 = _mm_loadu_si128(reinterpret_cast< const __m128i* >(src + 16));
+	const __m128i a2 = _mm_loadu_si128(reinterpret_cast< const __m128i* >(src + 32));
+
+	r = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(a0, _mm_setr_epi8( 0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+		_mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14, -1, -1, -1, -1, -1))),
+		_mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  1,  4,  7, 10, 13)));
+
+	g = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(a0, _mm_setr_epi8( 1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+		_mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1))),
+		_mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14)));
+
+	b = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(a0, _mm_setr_epi8( 2,  5,  8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+		_mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1,  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1))),
+		_mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15)));
+}
+
+
+// interleave 16 pixels of planar RGB into RGB or RGBA
+__attribute__ ((target ("sse4.1")))
+static inline void
+store_rgb_sse41(
+	uint8_t* const dst,
+	const unsigned channels,
+	const __m128i r,
+	const __m128i g,
+	const __m128i b)
+{
+	if (4 == channels)
+	{
+		const __m128i a = _mm_set1_epi8(-1);
+		const __m128i rg_lo = _mm_unpacklo_epi8(r, g);
+		const __m128i rg_hi = _mm_unpackhi_epi8(r, g);
+		const __m128i ba_lo = _mm_unpacklo_epi8(b, a);
+		const __m128i ba_hi = _mm_unpackhi_epi8(b, a);
+
+		_mm_storeu_si128(reinterpret_cast< __m128i* >(dst +  0), _mm_unpacklo_epi16(rg_lo, ba_lo));
+		_mm_storeu_si128(reinterpret_cast< __m128i* >(dst + 16), _mm_unpackhi_epi16(rg_lo, ba_lo));
+		_mm_storeu_si128(reinterpret_cast< __m128i* >(dst + 32), _mm_unpacklo_epi16(rg_hi, ba_hi));
+		_mm_storeu_si128(reinterpret_cast< __m128i* >(dst + 48), _mm_unpackhi_epi16(rg_hi, ba_hi));
+		return;
+	}
+
+	_mm_storeu_si128(reinterpret_cast< __m128i* >(dst + 0), _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(r, _mm_setr_epi8( 0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1,  5)),
+		_mm_shuffle_epi8(g, _mm_setr_epi8(-1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1))),
+		_mm_shuffle_epi8(b, _mm_setr_epi8(-1, -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1))));
+
+	_mm_storeu_si128(reinterpret_cast< __m128i* >(dst + 16), _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(r, _mm_setr_epi8(-1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10, -1)),
+		_mm_shuffle_epi8(g, _mm_setr_epi8( 5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10))),
+		_mm_shuffle_epi8(b, _mm_setr_epi8(-1,  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1))));
+
+	_mm_storeu_si128(reinterpret_cast< __m128i* >(dst + 32), _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(r, _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1)),
+		_mm_shuffle_epi8(g, _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1))),
+		_mm_shuffle_epi8(b, _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15))));
+}
+
+#endif
+
+// split rows [0, count) of a job into ranges of no less than min_count rows, and run func over them on up
+// to num_threads threads, the calling thread included; zero num_threads means one thread per online CPU
+template < typename JOB_T >
+void
+run_rows_parallel(
+	const JOB_T& job,
+	void* (* const func)(void*),
+	const unsigned count,
+	const unsigned min_count,
+	const unsigned num_threads)
+{
+	long num_ranges = num_threads;
+
+	if (0 == num_ranges)
+		num_ranges = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (num_ranges > long(count / min_count))
+		num_ranges = count / min_count;
+
+	if (2 > num_ranges)
+		num_ranges = 1;
+
+	std::vector< JOB_T > range(num_ranges, job);
+	std::vector< pthread_t > thread;
+	thread.reserve(num_ranges - 1);
+
+	for (long i = 0; i < num_ranges; ++i)
+	{
+		range[i].row_begin = unsigned(uint64_t(count) * i / num_ranges);
+		range[i].row_end = unsigned(uint64_t(count) * (i + 1) / num_ranges);
+	}
+
+	// calling thread takes the first range, and any ranges whose threads failed to start
+	long num_started = 1;
+
+	for (; num_started < num_ranges; ++num_started)
+	{
+		pthread_t t;
+
+		if (0 != pthread_create(&t, NULL, func, &range[num_started]))
+			break;
+
+		thread.push_back(t);
+	}
+
+	func(&range[0]);
+
+	for (long i = num_started; i < num_ranges; ++i)
+		func(&range[i]);
+
+	for (size_t i = 0; i < thread.size(); ++i)
+		pthread_join(thread[i], NULL);
+}
+
+} // namespace util
+} // namespace testbed
+
+#endif // util_pix_simd_H__
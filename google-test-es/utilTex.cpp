@@ -1,5 +1,13 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#include <vector>
 #include <iostream>
 
 #include "testbed.hpp"
@@ -13,6 +21,14 @@
 #define GL_LUMINANCE GL_RED
 #endif
 
+#if !defined(GL_ETC1_RGB8_OES)
+#define GL_ETC1_RGB8_OES			0x8D64
+#endif
+
+#if !defined(GL_COMPRESSED_RGB8_ETC2)
+#define GL_COMPRESSED_RGB8_ETC2		0x9274
+#endif
+
 namespace testbed
 {
 
@@ -27,17 +43,710 @@ public:
 	}
 };
 
+
+template <>
+class scoped_functor< FILE >
+{
+public:
+
+	void operator()(FILE* arg)
+	{
+		fclose(arg);
+	}
+};
+
 namespace util
 {
 
+static void
+getMipFilter(
+	const tex_mip_t mip,
+	mip_filter_t& filter,
+	bool& srgb)
+{
+	filter = TEX_MIP_KAISER == mip || TEX_MIP_KAISER_SRGB == mip
+		? MIP_FILTER_KAISER
+		: MIP_FILTER_BOX;
+	srgb = TEX_MIP_BOX_SRGB == mip || TEX_MIP_KAISER_SRGB == mip;
+}
+
+
+// GL format and type, and packed format of the uncompressed storage formats other than RGB888
+static void
+getPackedFormat(
+	const tex_format_t format,
+	GLenum& gl_format,
+	GLenum& gl_type,
+	packed_format_t& packed,
+	bool& dither)
+{
+	gl_format = TEX_FORMAT_RGB565 == format || TEX_FORMAT_RGB565_DITHER == format ? GL_RGB : GL_RGBA;
+	dither = TEX_FORMAT_RGB565_DITHER == format || TEX_FORMAT_RGBA4444_DITHER == format;
+
+	switch (format)
+	{
+	case TEX_FORMAT_RGB565:
+	case TEX_FORMAT_RGB565_DITHER:
+		gl_type = GL_UNSIGNED_SHORT_5_6_5;
+		packed = PACKED_FORMAT_RGB565;
+		break;
+
+	case TEX_FORMAT_RGBA4444:
+	case TEX_FORMAT_RGBA4444_DITHER:
+		gl_type = GL_UNSIGNED_SHORT_4_4_4_4;
+		packed = PACKED_FORMAT_RGBA4444;
+		break;
+
+	default:
+		gl_type = GL_UNSIGNED_BYTE;
+		packed = PACKED_FORMAT_RGBA8888;
+		break;
+	}
+}
+
+
+static GLint
+getUnpackAlignment(
+	const unsigned row_size)
+{
+	return row_size & 3 ? (row_size & 1 ? 1 : 2) : 4;
+}
+
+
+// upload a level of the texture bound to GL_TEXTURE_2D, converting it to the storage format unless that is RGB888;
+// the conversion goes to scratch, which is large enough for level 0 in any format
+static void
+specifyLevel(
+	const unsigned level,
+	const pix* const src,
+	const unsigned w,
+	const unsigned h,
+	const tex_format_t format,
+	void* const scratch)
+{
+	// rows are tightly packed, so let GL know their actual alignment rather than repack them
+	if (TEX_FORMAT_RGB888 == format)
+	{
+		glPixelStorei(GL_UNPACK_ALIGNMENT, getUnpackAlignment(w * sizeof(pix)));
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, src);
+	}
+	else
+	{
+		GLenum gl_format;
+		GLenum gl_type;
+		packed_format_t packed;
+		bool dither;
+		getPackedFormat(format, gl_format, gl_type, packed, dither);
+
+		const unsigned row_size = w * get_packed_size(packed);
+
+		fill_packed_from_RGB(scratch, row_size, packed, src, w * sizeof(pix), w, h, dither);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, getUnpackAlignment(row_size));
+		glTexImage2D(GL_TEXTURE_2D, level, gl_format, w, h, 0, gl_format, gl_type, scratch);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+
+// generate and upload the mipmap of the texture bound to GL_TEXTURE_2D, level 0 being uploaded already
+static bool
+generateMipmap(
+	const pix* const tex_src,
+	const unsigned tex_w,
+	const unsigned tex_h,
+	const tex_mip_t mip,
+	const tex_format_t format,
+	void* const scratch)
+{
+	if (TEX_MIP_GL == mip)
+	{
+		std::cout << "expanded into a mipmap" << std::endl;
+
+		glGenerateMipmap(GL_TEXTURE_2D);
+		return true;
+	}
+
+	scoped_ptr< pix, generic_free > mip_src(
+		reinterpret_cast< pix* >(malloc(next_multiple_of_pix_integral(get_mip_size(tex_w, tex_h) * sizeof(pix)))));
+
+	if (0 == mip_src())
+	{
+		std::cerr << __FUNCTION__ << " failed to allocate memory for mipmap" << std::endl;
+		return false;
+	}
+
+	mip_filter_t filter;
+	bool srgb;
+	getMipFilter(mip, filter, srgb);
+
+	if (!fill_mipmap(mip_src(), tex_src, tex_w * sizeof(pix), tex_w, tex_h, filter, srgb))
+		return false;
+
+	const unsigned mip_count = get_mip_count(tex_w, tex_h);
+	const pix* level_src = mip_src();
+
+	for (unsigned i = 1, w = tex_w, h = tex_h; i < mip_count; ++i)
+	{
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+
+		specifyLevel(i, level_src, w, h, format, scratch);
+		level_src += w * h;
+	}
+
+	std::cout << "expanded into a mipmap of " << mip_count << " levels, " <<
+		(MIP_FILTER_KAISER == filter ? "kaiser" : "box") << "-filtered" <<
+		(srgb ? " in linear light" : "") << std::endl;
+
+	return true;
+}
+
+
+// compressed textures are cached in this directory, relative to the working one
+static const char etc_cache_dir[] = "etc_cache";
+
+enum {
+	ETC_CACHE_VERSION = 1	// bump on any change to the encoder, the mipmap filters or the file layout
+};
+
+// cache file header, followed by the compressed levels, packed
+struct etc_cache_header_t
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t gl_format;
+	uint32_t w;
+	uint32_t h;
+	uint32_t level_count;
+	uint64_t key;
+};
+
+
+static uint64_t
+hashFNV1a(
+	const void* const data,
+	const size_t size,
+	uint64_t hash = 14695981039346656037ULL)
+{
+	const uint8_t* const byte = reinterpret_cast< const uint8_t* >(data);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= byte[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+// pick the GL format of the requested ETC flavour, falling back from ETC2 to ETC1; false if neither is supported
+static bool
+getETCFormat(
+	const tex_format_t format,
+	etc_format_t& etc_format,
+	GLenum& gl_format)
+{
+	GLint num_formats = 0;
+	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &num_formats);
+
+	std::vector< GLint > formats(0 < num_formats ? num_formats : 1, 0);
+
+	if (0 < num_formats)
+		glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, &formats.front());
+
+	bool has_etc1 = false;
+	bool has_etc2 = false;
+
+	for (size_t i = 0; i < formats.size(); ++i)
+	{
+		has_etc1 = has_etc1 || GL_ETC1_RGB8_OES == formats[i];
+		has_etc2 = has_etc2 || GL_COMPRESSED_RGB8_ETC2 == formats[i];
+	}
+
+	// some drivers expose the extension without listing the format
+	const char* const extensions = reinterpret_cast< const char* >(glGetString(GL_EXTENSIONS));
+
+	if (0 != extensions && 0 != strstr(extensions, "GL_OES_compressed_ETC1_RGB8_texture"))
+		has_etc1 = true;
+
+	if (TEX_FORMAT_ETC2 == format && has_etc2)
+	{
+		etc_format = ETC_FORMAT_ETC2;
+		gl_format = GL_COMPRESSED_RGB8_ETC2;
+		return true;
+	}
+
+	etc_format = ETC_FORMAT_ETC1;
+
+	if (has_etc1)
+	{
+		gl_format = GL_ETC1_RGB8_OES;
+		return true;
+	}
+
+	// ETC1 blocks are valid ETC2 blocks
+	if (has_etc2)
+	{
+		gl_format = GL_COMPRESSED_RGB8_ETC2;
+		return true;
+	}
+
+	return false;
+}
+
+
+static bool
+readETCCache(
+	const char* const cache_name,
+	const etc_cache_header_t& header,
+	uint8_t* const etc,
+	const size_t etc_size)
+{
+	scoped_ptr< FILE, scoped_functor > file(fopen(cache_name, "rb"));
+
+	if (0 == file())
+		return false;
+
+	etc_cache_header_t file_header;
+
+	return 1 == fread(&file_header, sizeof(file_header), 1, file()) &&
+		0 == memcmp(&file_header, &header, sizeof(header)) &&
+		1 == fread(etc, etc_size, 1, file()) &&
+		EOF == fgetc(file());
+}
+
+
+// write to a temporary file first, so that a concurrent or interrupted writer never leaves a partial cache file
+static bool
+writeETCCache(
+	const char* const cache_name,
+	const etc_cache_header_t& header,
+	const uint8_t* const etc,
+	const size_t etc_size)
+{
+	mkdir(etc_cache_dir, 0755);
+
+	char tmp_name[FILENAME_MAX + 1];
+
+	if (sizeof(tmp_name) <= size_t(snprintf(tmp_name, sizeof(tmp_name), "%s.%u.tmp", cache_name, unsigned(getpid()))))
+		return false;
+
+	FILE* const file = fopen(tmp_name, "wb");
+
+	if (0 == file)
+		return false;
+
+	const bool success =
+		1 == fwrite(&header, sizeof(header), 1, file) &&
+		1 == fwrite(etc, etc_size, 1, file);
+
+	if (0 == fclose(file) && success && 0 == rename(tmp_name, cache_name))
+		return true;
+
+	remove(tmp_name);
+	return false;
+}
+
+
+// compress, or fetch from the cache, and upload all levels of the texture bound to GL_TEXTURE_2D
+static bool
+specifyETCTexture2D(
+	const pix* const tex_src,
+	const unsigned tex_w,
+	const unsigned tex_h,
+	const bool pot,
+	const tex_mip_t mip,
+	const etc_format_t etc_format,
+	const GLenum gl_format)
+{
+	const unsigned level_count = pot ? get_mip_count(tex_w, tex_h) : 1;
+	size_t etc_size = 0;
+
+	for (unsigned i = 0, w = tex_w, h = tex_h; i < level_count; ++i)
+	{
+		etc_size += get_etc_size(w, h);
+
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+
+	mip_filter_t filter;
+	bool srgb;
+	getMipFilter(mip, filter, srgb);
+
+	const uint32_t settings[] = { tex_w, tex_h, level_count, etc_format, filter, srgb };
+
+	etc_cache_header_t header;
+
+	memcpy(header.magic, "ETCC", sizeof(header.magic));
+	header.version = ETC_CACHE_VERSION;
+	header.gl_format = gl_format;
+	header.w = tex_w;
+	header.h = tex_h;
+	header.level_count = level_count;
+	header.key = hashFNV1a(settings, sizeof(settings), hashFNV1a(tex_src, size_t(tex_w) * tex_h * sizeof(pix)));
+
+	char cache_name[FILENAME_MAX + 1];
+	snprintf(cache_name, sizeof(cache_name), "%s/%016llx.etc", etc_cache_dir, (unsigned long long) header.key);
+
+	scoped_ptr< uint8_t, generic_free > etc(reinterpret_cast< uint8_t* >(malloc(etc_size)));
+
+	if (0 == etc())
+	{
+		std::cerr << __FUNCTION__ << " failed to allocate memory for compressed texture" << std::endl;
+		return false;
+	}
+
+	const char* const format_name = ETC_FORMAT_ETC2 == etc_format ? "ETC2" : "ETC1";
+
+	if (readETCCache(cache_name, header, etc(), etc_size))
+	{
+		std::cout << "read " << format_name << " texture of " << level_count << " levels, " <<
+			etc_size << " bytes, from cache '" << cache_name << "'" << std::endl;
+	}
+	else
+	{
+		scoped_ptr< pix, generic_free > mip_src(1 < level_count
+			? reinterpret_cast< pix* >(malloc(next_multiple_of_pix_integral(get_mip_size(tex_w, tex_h) * sizeof(pix))))
+			: 0);
+
+		if (1 < level_count && (0 == mip_src() ||
+			!fill_mipmap(mip_src(), tex_src, tex_w * sizeof(pix), tex_w, tex_h, filter, srgb)))
+		{
+			std::cerr << __FUNCTION__ << " failed to build mipmap" << std::endl;
+			return false;
+		}
+
+		const pix* level_src = tex_src;
+		uint8_t* level_etc = etc();
+
+		for (unsigned i = 0, w = tex_w, h = tex_h; i < level_count; ++i)
+		{
+			fill_ETC_from_RGB(level_etc, level_src, w * sizeof(pix), w, h, etc_format);
+
+			level_src = 0 == i ? mip_src() : level_src + w * h;
+			level_etc += get_etc_size(w, h);
+
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
+
+		std::cout << "compressed into " << format_name << " texture of " << level_count << " levels, " <<
+			etc_size << " bytes" << std::endl;
+
+		if (!writeETCCache(cache_name, header, etc(), etc_size))
+			std::cerr << __FUNCTION__ << " failed to write cache '" << cache_name << "'" << std::endl;
+	}
+
+	const uint8_t* level_etc = etc();
+
+	for (unsigned i = 0, w = tex_w, h = tex_h; i < level_count; ++i)
+	{
+		const size_t level_size = get_etc_size(w, h);
+
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, gl_format, w, h, 0, level_size, level_etc);
+		level_etc += level_size;
+
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+
+	return true;
+}
+
+
+// specify all levels of the texture bound to GL_TEXTURE_2D
+static bool
+specifyTexture2D(
+	const pix* const tex_src,
+	const unsigned tex_w,
+	const unsigned tex_h,
+	const bool pot,
+	const tex_mip_t mip,
+	const tex_format_t format)
+{
+	if (TEX_FORMAT_ETC1 == format || TEX_FORMAT_ETC2 == format)
+	{
+		etc_format_t etc_format;
+		GLenum gl_format;
+
+		if (getETCFormat(format, etc_format, gl_format))
+			return specifyETCTexture2D(tex_src, tex_w, tex_h, pot, mip, etc_format, gl_format);
+
+		std::cout << "ETC textures unsupported; falling back to RGB888" << std::endl;
+
+		return specifyTexture2D(tex_src, tex_w, tex_h, pot, mip, TEX_FORMAT_RGB888);
+	}
+
+	scoped_ptr< void, generic_free > scratch(TEX_FORMAT_RGB888 != format
+		? malloc(size_t(tex_w) * tex_h * get_packed_size(PACKED_FORMAT_RGBA8888))
+		: 0);
+
+	if (TEX_FORMAT_RGB888 != format && 0 == scratch())
+	{
+		std::cerr << __FUNCTION__ << " failed to allocate memory for format conversion" << std::endl;
+		return false;
+	}
+
+	specifyLevel(0, tex_src, tex_w, tex_h, format, scratch());
+
+	return !pot || generateMipmap(tex_src, tex_w, tex_h, mip, format, scratch());
+}
+
+
+namespace
+{
+
+// read-only mapping of a whole file
+class mapped_file_t
+{
+	void* addr;
+	size_t size;
+
+	mapped_file_t(const mapped_file_t&);
+	mapped_file_t& operator =(const mapped_file_t&);
+
+public:
+	mapped_file_t()
+	: addr(MAP_FAILED)
+	, size(0)
+	{}
+
+	~mapped_file_t()
+	{
+		if (MAP_FAILED != addr)
+			munmap(addr, size);
+	}
+
+	bool map(
+		const char* const filename)
+	{
+		assert(MAP_FAILED == addr);
+
+		const int fd = open(filename, O_RDONLY);
+
+		if (-1 == fd)
+			return false;
+
+		struct stat filestat;
+
+		if (0 == fstat(fd, &filestat) && 0 < filestat.st_size)
+		{
+			size = size_t(filestat.st_size);
+			addr = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (MAP_FAILED != addr)
+				madvise(addr, size, MADV_SEQUENTIAL);
+		}
+
+		// the mapping outlives the descriptor
+		close(fd);
+
+		return MAP_FAILED != addr;
+	}
+
+	const uint8_t* data() const
+	{
+		return reinterpret_cast< const uint8_t* >(addr);
+	}
+
+	size_t length() const
+	{
+		return size;
+	}
+};
+
+// KTX v1 header; key/value data follow, then the image size and data of each level, 4-byte aligned
+struct ktx_header_t
+{
+	uint8_t identifier[12];
+	uint32_t endianness;
+	uint32_t gl_type;
+	uint32_t gl_type_size;
+	uint32_t gl_format;
+	uint32_t gl_internal_format;
+	uint32_t gl_base_internal_format;
+	uint32_t pixel_width;
+	uint32_t pixel_height;
+	uint32_t pixel_depth;
+	uint32_t number_of_array_elements;
+	uint32_t number_of_faces;
+	uint32_t number_of_mipmap_levels;
+	uint32_t bytes_of_key_value_data;
+};
+
+} // namespace
+
+static const uint8_t ktx_identifier[12] =
+{
+	0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+
+static bool
+isKTXFile(
+	const mapped_file_t& file)
+{
+	return sizeof(ktx_header_t) <= file.length() &&
+		0 == memcmp(file.data(), ktx_identifier, sizeof(ktx_identifier));
+}
+
+
+static bool
+setupTextureKTX(
+	const GLuint tex_name,
+	const char* const filename,
+	const mapped_file_t& file)
+{
+	if (!isKTXFile(file))
+	{
+		std::cerr << __FUNCTION__ << " got a non-KTX file '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	ktx_header_t header;
+	memcpy(&header, file.data(), sizeof(header));
+
+	// levels are handed to GL in place, so there is no byte-swapping of foreign-endian files
+	if (0x04030201 != header.endianness)
+	{
+		std::cerr << __FUNCTION__ << " got a KTX file '" << filename << "' of foreign endianness" << std::endl;
+		return false;
+	}
+
+	if (0 == header.pixel_width ||
+		0 == header.pixel_height ||
+		0 != header.pixel_depth ||
+		0 != header.number_of_array_elements ||
+		1 != header.number_of_faces)
+	{
+		std::cerr << __FUNCTION__ << " got a KTX file '" << filename << "' of other than a 2D texture" << std::endl;
+		return false;
+	}
+
+	const bool compressed = 0 == header.gl_type;
+	const unsigned tex_w = header.pixel_width;
+	const unsigned tex_h = header.pixel_height;
+	const unsigned level_count = 0 != header.number_of_mipmap_levels ? header.number_of_mipmap_levels : 1;
+	const bool pot = !(tex_w & tex_w - 1) && !(tex_h & tex_h - 1);
+	const bool generate_mipmap = 0 == header.number_of_mipmap_levels && !compressed && pot;
+
+	if (level_count > get_mip_count(tex_w, tex_h))
+	{
+		std::cerr << __FUNCTION__ << " got a KTX file '" << filename << "' of excess mip levels" << std::endl;
+		return false;
+	}
+
+	// ES2 has no GL_TEXTURE_MAX_LEVEL, so a mipmap must be a full chain of POT levels to be complete
+	const bool mipmap = pot && get_mip_count(tex_w, tex_h) == level_count;
+	const unsigned upload_count = mipmap ? level_count : 1;
+
+	std::cout << "KTX texture '" << filename << "' " << tex_w << " x " << tex_h << ", " <<
+		(compressed ? "compressed " : "") << "format 0x" << std::hex << header.gl_internal_format << std::dec <<
+		", " << level_count << " levels, " << file.length() << " bytes" << std::endl;
+
+	if (1 < level_count && !mipmap)
+		std::cout << "mip levels of a partial or NPOT chain are ignored; sampling the base level only" << std::endl;
+
+	// the header fits the file, so sizes are checked against what remains of it; a sum of sizes could wrap a 32-bit size_t
+	if (header.bytes_of_key_value_data > file.length() - sizeof(header))
+	{
+		std::cerr << __FUNCTION__ << " got a truncated KTX file '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	size_t offset = sizeof(header) + size_t(header.bytes_of_key_value_data);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, tex_name);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+		1 < upload_count || generate_mipmap ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	// rows of uncompressed levels are 4-byte aligned in the file
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	for (unsigned i = 0, w = tex_w, h = tex_h; i < upload_count; ++i)
+	{
+		uint32_t image_size;
+
+		// the padding of the previous level may have taken offset past the end
+		if (offset > file.length() || file.length() - offset < sizeof(image_size) ||
+			(memcpy(&image_size, file.data() + offset, sizeof(image_size)),
+			 image_size > file.length() - offset - sizeof(image_size)))
+		{
+			std::cerr << __FUNCTION__ << " got a truncated KTX file '" << filename << "'" << std::endl;
+			glBindTexture(GL_TEXTURE_2D, 0);
+			return false;
+		}
+
+		const uint8_t* const image = file.data() + offset + sizeof(image_size);
+
+		// ES2 takes unsized internal formats only
+		if (compressed)
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, header.gl_internal_format, w, h, 0, image_size, image);
+		else
+			glTexImage2D(GL_TEXTURE_2D, i, header.gl_base_internal_format, w, h, 0,
+				header.gl_format, header.gl_type, image);
+
+		offset += sizeof(image_size) + ((size_t(image_size) + 3) & ~size_t(3));
+
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+
+	if (generate_mipmap)
+	{
+		std::cout << "expanded into a mipmap" << std::endl;
+
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	const bool success = !reportGLError();
+
+	if (!success)
+		std::cerr << __FUNCTION__ << " failed to setup a texture" << std::endl;
+
+	return success;
+}
+
+
+
 bool
-setupTexture2D(
+setupTextureKTX(
 	const GLuint tex_name,
+	const char* filename)
+{
+	assert(0 != tex_name);
+	assert(0 != filename);
+
+	mapped_file_t file;
+
+	if (!file.map(filename))
+	{
+		std::cerr << __FUNCTION__ << " failed to map file '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	return setupTextureKTX(tex_name, filename, file);
+}
+
+
+bool
+loadTextureBitmap(
+	texture_bitmap_t& bitmap,
 	const char* filename,
 	const unsigned tex_w,
 	const unsigned tex_h)
 {
-	assert(0 != tex_name);
 	assert(0 != filename);
 
 	const unsigned pix_size = sizeof(pix);
@@ -54,16 +763,42 @@ setupTexture2D(
 		return false;
 	}
 
-	if (fill_from_file(tex_src(), tex_w * pix_size, tex_w, tex_h, filename))
-	{
-		std::cout << "texture bitmap '" << filename << "' ";
-	}
-	else
-	{
+	bitmap.from_file = fill_from_file(tex_src(), tex_w * pix_size, tex_w, tex_h, filename);
+
+	if (!bitmap.from_file)
 		fill_with_checker(tex_src(), tex_w * pix_size, tex_w, tex_h);
 
+	free(bitmap.bitmap);
+
+	bitmap.filename = filename;
+	bitmap.bitmap = tex_src();
+	bitmap.w = tex_w;
+	bitmap.h = tex_h;
+
+	tex_src.reset();
+
+	return true;
+}
+
+
+// set up a texture from a bitmap of the specified file, or from a checker bitmap, for a nil filename
+static bool
+setupBitmapTexture2D(
+	const GLuint tex_name,
+	const pix* const bitmap,
+	const char* const filename,
+	const unsigned tex_w,
+	const unsigned tex_h,
+	const tex_mip_t mip,
+	const tex_format_t format)
+{
+	const unsigned pix_size = sizeof(pix);
+	const unsigned tex_size = tex_h * tex_w * pix_size;
+
+	if (0 != filename)
+		std::cout << "texture bitmap '" << filename << "' ";
+	else
 		std::cout << "checker texture ";
-	}
 
 	std::cout << tex_w << " x " << tex_h << " x " << (pix_size * 8) << " bpp, " <<
 		tex_size << " bytes" << std::endl;
@@ -78,14 +813,10 @@ setupTexture2D(
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex_w, tex_h, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex_w, tex_h, GL_RGB, GL_UNSIGNED_BYTE, tex_src());
-
-	if (pot)
+	if (!specifyTexture2D(bitmap, tex_w, tex_h, pot, mip, format))
 	{
-		std::cout << "expanded into a mipmap" << std::endl;
-
-		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return false;
 	}
 
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -99,6 +830,60 @@ setupTexture2D(
 }
 
 
+bool
+setupTexture2D(
+	const GLuint tex_name,
+	const texture_bitmap_t& bitmap,
+	const tex_mip_t mip,
+	const tex_format_t format)
+{
+	assert(0 != tex_name);
+	assert(0 != bitmap.bitmap);
+
+	return setupBitmapTexture2D(tex_name, bitmap.bitmap, bitmap.from_file ? bitmap.filename : 0,
+		bitmap.w, bitmap.h, mip, format);
+}
+
+
+bool
+setupTexture2D(
+	const GLuint tex_name,
+	const char* filename,
+	const unsigned tex_w,
+	const unsigned tex_h,
+	const tex_mip_t mip,
+	const tex_format_t format)
+{
+	assert(0 != tex_name);
+	assert(0 != filename);
+
+	mapped_file_t file;
+
+	if (file.map(filename))
+	{
+		// KTX files carry their own dimensions, format and levels
+		if (isKTXFile(file))
+			return setupTextureKTX(tex_name, filename, file);
+
+		// raw files of the expected size get uploaded straight from their mapping, sparing a staging copy
+		const size_t img_size = size_t(tex_w) * tex_h * sizeof(pix);
+		const size_t optional_header_size = 8;
+
+		if (file.length() == img_size || file.length() == img_size + optional_header_size)
+			return setupBitmapTexture2D(tex_name, reinterpret_cast< const pix* >(file.data() + file.length() - img_size),
+				filename, tex_w, tex_h, mip, format);
+	}
+
+	// anything else goes the way of fill_from_file, falling back to a checker texture
+	texture_bitmap_t bitmap;
+
+	if (!loadTextureBitmap(bitmap, filename, tex_w, tex_h))
+		return false;
+
+	return setupTexture2D(tex_name, bitmap, mip, format);
+}
+
+
 bool
 setupTextureYUV420(
 	const GLuint (&tex_name)[3],
@@ -232,7 +1017,9 @@ setupTexture2D(
 	const GLuint tex_name,
 	const pix* tex_src,
 	const unsigned tex_w,
-	const unsigned tex_h)
+	const unsigned tex_h,
+	const tex_mip_t mip,
+	const tex_format_t format)
 {
 	assert(0 != tex_name);
 	assert(0 != tex_src);
@@ -253,14 +1040,10 @@ setupTexture2D(
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex_w, tex_h, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex_w, tex_h, GL_RGB, GL_UNSIGNED_BYTE, tex_src);
-
-	if (pot)
+	if (!specifyTexture2D(tex_src, tex_w, tex_h, pot, mip, format))
 	{
-		std::cout << "expanded into a mipmap" << std::endl;
-
-		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return false;
 	}
 
 	glBindTexture(GL_TEXTURE_2D, 0);
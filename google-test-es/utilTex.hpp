@@ -11,6 +11,7 @@
 
 #endif
 
+#include <stdlib.h>
 #include "utilPix.hpp"
 
 namespace testbed
@@ -19,12 +20,91 @@ namespace testbed
 namespace util
 {
 
+// client-side texture bitmap, as produced by loadTextureBitmap which doesn't touch GL and can run
+// off the GL thread; unusable files result in a checker bitmap, same as with setupTexture2D
+struct texture_bitmap_t
+{
+	const char* filename;
+	pix* bitmap;
+	unsigned w;
+	unsigned h;
+	bool from_file;
+
+	texture_bitmap_t()
+	: filename(0)
+	, bitmap(0)
+	, w(0)
+	, h(0)
+	, from_file(false)
+	{}
+
+	~texture_bitmap_t()
+	{
+		free(bitmap);
+	}
+
+private:
+	texture_bitmap_t(const texture_bitmap_t&);
+	texture_bitmap_t& operator =(const texture_bitmap_t&);
+};
+
+// mipmap generation by setupTexture2D, for power-of-two textures: by the GL via glGenerateMipmap, or on
+// the CPU via fill_mipmap, uploading all levels, optionally filtering in linear light
+enum tex_mip_t
+{
+	TEX_MIP_GL,
+	TEX_MIP_BOX,
+	TEX_MIP_BOX_SRGB,
+	TEX_MIP_KAISER,
+	TEX_MIP_KAISER_SRGB
+};
+
+// storage format of textures set up by setupTexture2D; 32- and 16-bit formats are converted on the CPU, the
+// latter optionally with ordered dithering; ETC formats are compressed at load time, all levels on the CPU,
+// TEX_MIP_GL meaning TEX_MIP_BOX then, and the result is cached on disk, keyed by a hash of the source and
+// the settings; ETC2 falls back to ETC1 where unsupported, and ETC1 to RGB888
+enum tex_format_t
+{
+	TEX_FORMAT_RGB888,
+	TEX_FORMAT_RGBA8888,
+	TEX_FORMAT_RGB565,
+	TEX_FORMAT_RGB565_DITHER,
+	TEX_FORMAT_RGBA4444,
+	TEX_FORMAT_RGBA4444_DITHER,
+	TEX_FORMAT_ETC1,
+	TEX_FORMAT_ETC2
+};
+
+bool
+loadTextureBitmap(
+	texture_bitmap_t& bitmap,
+	const char* filename,
+	const unsigned tex_w,
+	const unsigned tex_h);
+
+bool
+setupTexture2D(
+	const GLuint tex_name,
+	const texture_bitmap_t& bitmap,
+	const tex_mip_t mip = TEX_MIP_GL,
+	const tex_format_t format = TEX_FORMAT_RGB888);
+
 bool
 setupTexture2D(
 	const GLuint tex_name,
 	const char* filename,
 	const unsigned tex_w,
-	const unsigned tex_h);
+	const unsigned tex_h,
+	const tex_mip_t mip = TEX_MIP_GL,
+	const tex_format_t format = TEX_FORMAT_RGB888);
+
+// setupTextureKTX()	: set up a 2D texture from a KTX v1 file, compressed or not, mapping the file and handing
+//						  its levels to GL in place; uncompressed power-of-two files void of levels get a mipmap
+//						  by glGenerateMipmap; setupTexture2D from a file defers here when that is a KTX file
+bool
+setupTextureKTX(
+	const GLuint tex_name,
+	const char* filename);
 
 bool
 setupTextureYUV420(
@@ -38,7 +118,9 @@ setupTexture2D(
 	const GLuint tex_name,
 	const pix* tex_src,
 	const unsigned tex_w,
-	const unsigned tex_h);
+	const unsigned tex_h,
+	const tex_mip_t mip = TEX_MIP_GL,
+	const tex_format_t format = TEX_FORMAT_RGB888);
 
 } // namespace util
 } // namespace testbed
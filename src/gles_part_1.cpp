@@ -1,7 +1,14 @@
 module;
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <vector>
 
 #define EGL_EGL_PROTOTYPES 1 // #define EGL_EGLEXT_PROTOTYPES
@@ -10,6 +17,13 @@ module;
 #define GL_GLES_PROTOTYPES 1 // #define GL_GLEXT_PROTOTYPES
 #include <GLES3/gl3.h>
 
+/// @see https://learn.microsoft.com/en-us/cpp/preprocessor/predefined-macros
+#if defined(_WIN32)
+#define _INTERFACE_ __declspec(dllexport)
+#else
+#define _INTERFACE_
+#endif
+
 module gles;
 
 class tex2d_owner_t final {
@@ -35,37 +49,81 @@ class fbo_owner_t final {
 
 using reader_callback_t = void (*)(void* user_data, const void* mapping, size_t length);
 
+/// @brief Counters of a fence-synchronized PBO ring, to size rings per device
+/// @note  A slot is "ready" when its fence has signaled by the time the slot is needed;
+///        every ready slot is a stall avoided. Otherwise the caller blocks in glClientWaitSync.
+struct pbo_ring_stats_t final {
+    uint64_t acquired = 0; // slots handed out: packed for reader, mapped for writer
+    uint64_t ready = 0;    // stalls avoided
+    uint64_t stalled = 0;  // waits on a fence that had not signaled yet
+    uint64_t timeouts = 0; // waits which gave up
+    std::chrono::nanoseconds wait_time{};
+    std::chrono::nanoseconds max_wait{};
+};
+
+/// @brief Ring of pixel-pack buffers. Each `pack` fills the next free slot and fences it,
+///        and `map_and_invoke` maps the oldest packed slot once its fence has signaled.
+///        The ring is full when all slots are packed and none is mapped yet.
 class pbo_reader_t final {
-    static constexpr uint16_t capacity = 2;
+  public:
+    static constexpr uint16_t default_capacity = 2;
+    static constexpr uint16_t max_capacity = 16;
+    static constexpr GLuint64 default_timeout = 1'000'000'000; // nanoseconds
 
   private:
-    GLuint pbos[capacity];
+    std::vector<GLuint> pbos;
+    std::vector<GLsync> fences;
     uint32_t length; // byte length of the buffer modification
     GLintptr offset;
     GLint version;
+    uint16_t head = 0;  // next slot to pack
+    uint16_t count = 0; // packed slots, not mapped yet
+    pbo_ring_stats_t stats{};
 
   public:
-    explicit pbo_reader_t(GLuint length) noexcept(false);
+    explicit pbo_reader_t(GLuint length, uint16_t capacity = default_capacity) noexcept(false);
     ~pbo_reader_t() noexcept;
+    pbo_reader_t(pbo_reader_t const&) = delete;
+    pbo_reader_t& operator=(pbo_reader_t const&) = delete;
+    pbo_reader_t(pbo_reader_t&&) = delete;
+    pbo_reader_t& operator=(pbo_reader_t&&) = delete;
 
     uint32_t get_length() const noexcept;
-    GLenum pack(uint16_t idx, GLuint fbo, const GLint frame[4], //
+    uint16_t get_capacity() const noexcept;
+    uint16_t get_pending() const noexcept;
+    const pbo_ring_stats_t& get_stats() const noexcept;
+
+    /// @return GL_OUT_OF_MEMORY if the ring is full. Map the oldest slot first
+    GLenum pack(GLuint fbo, const GLint frame[4], //
                 GLenum format = GL_RGBA, GLenum type = GL_UNSIGNED_BYTE) noexcept;
-    GLenum map_and_invoke(uint16_t idx, reader_callback_t callback, void* user_data) noexcept;
+    /// @return GL_INVALID_OPERATION if nothing is packed, GL_TIMEOUT_EXPIRED if the GPU is not done in time.
+    ///         A zero timeout polls, never blocking
+    GLenum map_and_invoke(reader_callback_t callback, void* user_data, GLuint64 timeout = default_timeout) noexcept;
 };
 
 using writer_callback_t = void (*)(void* user_data, void* mapping, size_t length);
 
+/// @brief Ring of pixel-unpack buffers. Each `map` maps the next free slot, to be filled by any thread,
+///        and `commit` unmaps the oldest mapped slot as filled. `unpack` copies the oldest filled slot
+///        into a texture and fences it. A slot is mapped again only after that fence has signaled.
 class pbo_writer_t final {
-    static constexpr uint16_t capacity = 2;
+  public:
+    static constexpr uint16_t default_capacity = 2;
+    static constexpr uint16_t max_capacity = 16;
+    static constexpr GLuint64 default_timeout = 1'000'000'000; // nanoseconds
 
   private:
-    GLuint pbos[capacity];
+    std::vector<GLuint> pbos;
+    std::vector<GLsync> fences;
     uint32_t length;
     GLint version;
+    uint16_t head = 0;   // next slot to map
+    uint16_t mapped = 0; // mapped slots, not committed yet
+    uint16_t count = 0;  // filled slots, not unpacked yet
+    pbo_ring_stats_t stats{};
 
   public:
-    explicit pbo_writer_t(GLuint length) noexcept(false);
+    explicit pbo_writer_t(GLuint length, uint16_t capacity = default_capacity) noexcept(false);
     ~pbo_writer_t() noexcept;
     pbo_writer_t(pbo_writer_t const&) = delete;
     pbo_writer_t& operator=(pbo_writer_t const&) = delete;
@@ -73,9 +131,174 @@ class pbo_writer_t final {
     pbo_writer_t& operator=(pbo_writer_t&&) = delete;
 
     uint32_t get_length() const noexcept;
-    GLenum unpack(uint16_t idx, GLuint tex2d, const GLint frame[4], //
+    uint16_t get_capacity() const noexcept;
+    uint16_t get_mapped() const noexcept;
+    uint16_t get_pending() const noexcept;
+    const pbo_ring_stats_t& get_stats() const noexcept;
+
+    /// @return GL_INVALID_OPERATION if nothing is filled
+    GLenum unpack(GLuint tex2d, const GLint frame[4], //
                   GLenum format = GL_RGBA, GLenum type = GL_UNSIGNED_BYTE) noexcept;
-    GLenum map_and_invoke(uint16_t idx, writer_callback_t callback, void* user_data) noexcept;
+    /// @return GL_OUT_OF_MEMORY if the ring is full, GL_TIMEOUT_EXPIRED if the GPU still reads the slot.
+    ///         A zero timeout polls, never blocking
+    GLenum map(void*& mapping, GLuint64 timeout = default_timeout) noexcept;
+    /// @return GL_INVALID_OPERATION if nothing is mapped, or if the slot's contents got lost in unmapping
+    GLenum commit() noexcept;
+    /// @brief Drop the oldest filled slot without unpacking it, as after a failed `commit`
+    /// @return GL_INVALID_OPERATION if nothing is filled
+    GLenum discard() noexcept;
+    /// @brief `map`, fill in the callback, and `commit`. Not to be mixed with outstanding `map`s
+    GLenum map_and_invoke(writer_callback_t callback, void* user_data, GLuint64 timeout = default_timeout) noexcept;
+};
+
+/// @brief A tile of the framebuffer in a `tile_reader_t` mapping
+struct tile_t final {
+    uint16_t column, row;
+    GLint frame[4];  // x, y, w, h in pixels
+    uint32_t offset; // of its w * h RGBA pixels in the mapping, rows packed bottom-up
+};
+
+using tile_callback_t = void (*)(void* user_data, const tile_t* tiles, size_t count, //
+                                 const void* mapping, size_t length);
+
+/// @brief Readback of the changed tiles of a framebuffer through a fence-synchronized PBO ring.
+///        Tiles are marked dirty by damage rectangles, or by comparing GPU-side checksums of each tile
+///        against those of the last comparison. `pack` reads only the dirty tiles, back to back,
+///        into the next slot, so readback bandwidth follows the area that changed.
+class tile_reader_t final {
+  public:
+    static constexpr GLsizei default_tile_size = 64;
+    static constexpr uint16_t default_capacity = 2;
+    static constexpr uint16_t max_capacity = 16;
+    static constexpr GLuint64 default_timeout = 1'000'000'000; // nanoseconds
+
+    struct stats_t final {
+        uint64_t packs = 0;       // non-empty packs
+        uint64_t tiles_read = 0;  // of tiles_total, ie. tiles of the framebuffer over all packs
+        uint64_t tiles_total = 0; // tiles_read / tiles_total is the fraction of full-frame bandwidth spent
+        uint64_t bytes_read = 0;
+    };
+
+  private:
+    GLsizei width, height, tile_size;
+    uint16_t columns, rows;
+    std::vector<uint8_t> dirty; // per tile
+    std::vector<GLuint> pbos;
+    std::vector<GLsync> fences;
+    std::vector<std::vector<tile_t>> slot_tiles;
+    uint16_t head = 0;  // next slot to pack
+    uint16_t count = 0; // packed slots, not mapped yet
+    pbo_ring_stats_t ring_stats{};
+    stats_t stats{};
+    // checksum pass, built on first use
+    GLuint program = 0, vao = 0, checksum_tex = 0, checksum_fbo = 0;
+    std::vector<GLuint> checksums; // RGBA32UI per tile, of the last `detect_changes`
+
+    GLenum make_checksum_pass() noexcept;
+    void delete_checksum_pass() noexcept;
+
+  public:
+    tile_reader_t(GLsizei width, GLsizei height, GLsizei tile_size = default_tile_size,
+                  uint16_t capacity = default_capacity) noexcept(false);
+    ~tile_reader_t() noexcept;
+    tile_reader_t(tile_reader_t const&) = delete;
+    tile_reader_t& operator=(tile_reader_t const&) = delete;
+    tile_reader_t(tile_reader_t&&) = delete;
+    tile_reader_t& operator=(tile_reader_t&&) = delete;
+
+    uint16_t get_pending() const noexcept;
+    uint32_t get_dirty_count() const noexcept;
+    const pbo_ring_stats_t& get_ring_stats() const noexcept;
+    const stats_t& get_stats() const noexcept;
+
+    /// @param rect x, y, w, h in pixels. Clipped to the framebuffer
+    void mark_dirty(const GLint rect[4]) noexcept;
+    void mark_all() noexcept;
+    /// @brief Hash each tile of `tex2d` on the GPU, and mark dirty the tiles whose hash changed.
+    ///        Reading back the hashes waits for the frame to render, which `pack` would anyway.
+    ///        Restores the bindings, viewport and scissor test it changes
+    GLenum detect_changes(GLuint tex2d) noexcept;
+    /// @brief Read the dirty tiles of `fbo` into the next slot, and clear them. Takes no slot if none is dirty
+    /// @return GL_OUT_OF_MEMORY if the ring is full. Map the oldest slot first
+    GLenum pack(GLuint fbo) noexcept;
+    /// @return GL_INVALID_OPERATION if nothing is packed, GL_TIMEOUT_EXPIRED if the GPU is not done in time
+    GLenum map_and_invoke(tile_callback_t callback, void* user_data, GLuint64 timeout = default_timeout) noexcept;
+};
+
+/// @brief Fill one frame of a `texture_stream_t`, on its producer thread
+/// @return false to end the stream. The mapping is then left unused
+using stream_producer_t = bool (*)(void* user_data, void* mapping, size_t length, uint64_t frame);
+
+/// @brief Streaming texture upload. A producer thread fills frames into the mapped slots of a `pbo_writer_t`,
+///        and `update`, on the GL thread, keeps slots mapped for it, then unpacks the oldest filled slot into
+///        the next of a rotating set of textures. The current texture is fenced anew by each `update`, as the
+///        frames sampling it have been issued by then, and is reused only after its last fence has signaled.
+///        Upload-to-display latency spans the producer finishing a frame to its first fence signaling.
+class texture_stream_t final {
+  public:
+    using clock_type = std::chrono::steady_clock;
+    static constexpr uint16_t default_slots = 3;
+    static constexpr uint16_t default_textures = 3;
+
+  private:
+    struct slot_t final {
+        void* mapping;
+        uint64_t frame;
+        clock_type::time_point filled_at;
+        bool filled;
+    };
+    struct texture_t final {
+        std::unique_ptr<tex2d_owner_t> owner;
+        GLsync fence = nullptr; // after the last frame sampling it
+        uint64_t frame = 0;
+        clock_type::time_point filled_at{};
+        bool measured = true; // latency of its frame is recorded
+    };
+
+    GLsizei width, height;
+    pbo_writer_t writer;
+    std::vector<texture_t> textures;
+    uint16_t next_texture = 0;
+    int32_t current = -1; // the texture of the newest frame, fenced by the next `update`
+    pbo_ring_stats_t texture_stats{};
+    std::vector<std::chrono::nanoseconds> latencies{};
+    uint64_t frames_unpacked = 0;
+
+    stream_producer_t producer;
+    void* user_data;
+    std::mutex mtx{};
+    std::condition_variable cv{};
+    std::deque<slot_t> empty_slots{}; // mapped, for the producer
+    std::deque<slot_t> full_slots{};  // filled in the order of mapping, for `update`
+    bool stopping = false;
+    bool finished = false; // the producer ended the stream
+    std::thread worker{};
+
+    void produce() noexcept;
+    void measure(texture_t& texture, GLuint64 timeout, pbo_ring_stats_t& stats) noexcept;
+
+  public:
+    texture_stream_t(GLsizei width, GLsizei height, stream_producer_t producer, void* user_data,
+                     uint16_t slots = default_slots, uint16_t num_textures = default_textures) noexcept(false);
+    ~texture_stream_t() noexcept;
+    texture_stream_t(texture_stream_t const&) = delete;
+    texture_stream_t& operator=(texture_stream_t const&) = delete;
+    texture_stream_t(texture_stream_t&&) = delete;
+    texture_stream_t& operator=(texture_stream_t&&) = delete;
+
+    /// @brief Once per frame, before drawing with `get_texture`
+    /// @return GL_NO_ERROR also when no new frame was ready
+    GLenum update() noexcept;
+    /// @return 0 before the first frame arrives
+    GLuint get_texture(uint64_t* frame = nullptr) const noexcept;
+    /// @return true once the producer ended the stream and all its frames are unpacked
+    bool is_finished() noexcept;
+
+    uint64_t get_frames_unpacked() const noexcept;
+    const pbo_ring_stats_t& get_upload_stats() const noexcept;
+    const pbo_ring_stats_t& get_texture_stats() const noexcept;
+    /// @brief Move out the upload-to-display latencies recorded so far, a frame each
+    void take_latencies(std::vector<std::chrono::nanoseconds>& output) noexcept;
 };
 
 EGLint get_configs(EGLDisplay display, EGLConfig* configs, EGLint& count, const EGLint* attrs) noexcept {
@@ -326,24 +549,70 @@ GLuint fbo_owner_t::handle() const noexcept {
     return fbo;
 }
 
-pbo_reader_t::pbo_reader_t(GLuint length) noexcept(false) : pbos{}, length{length}, offset{} {
-    GLint minor = 0;
-    if (get_opengl_version(version, minor) == false)
-        throw std::runtime_error{"Failed to query OpenGL version"};
-    glGenBuffers(capacity, pbos);
+/// @brief Wait for the fence of a ring slot, and release it once signaled
+/// @return GL_TIMEOUT_EXPIRED if the timeout elapsed first
+GLenum wait_slot(GLsync& fence, GLuint64 timeout, pbo_ring_stats_t& stats) noexcept {
+    if (fence == nullptr) // never fenced, or no sync objects before ES 3.0
+        return GL_NO_ERROR;
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+        ++stats.ready;
+    } else if (status == GL_TIMEOUT_EXPIRED) {
+        if (timeout == 0)
+            return GL_TIMEOUT_EXPIRED; // polling: the caller comes back later, no stall taken
+        ++stats.stalled;
+        const auto t0 = std::chrono::steady_clock::now();
+        status = glClientWaitSync(fence, 0, timeout);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0);
+        stats.wait_time += elapsed;
+        stats.max_wait = std::max(stats.max_wait, elapsed);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            ++stats.timeouts;
+            return GL_TIMEOUT_EXPIRED;
+        }
+    }
+    if (status == GL_WAIT_FAILED)
+        return glGetError();
+    glDeleteSync(fence);
+    fence = nullptr;
+    return GL_NO_ERROR;
+}
+
+/// @brief Create `capacity` buffers of `length` bytes, bound to `target` with `usage`
+void make_ring(std::vector<GLuint>& pbos, std::vector<GLsync>& fences, uint16_t capacity, uint16_t max_capacity,
+               GLenum target, GLuint length, GLenum usage) noexcept(false) {
+    if (capacity == 0 || capacity > max_capacity)
+        throw std::invalid_argument{"requested ring capacity is out of range"};
+    pbos.resize(capacity);
+    fences.resize(capacity);
+    glGenBuffers(capacity, pbos.data());
     if (GLint ec = glGetError(); ec != GL_NO_ERROR)
         throw std::system_error{ec, get_opengl_category(), "glGenBuffers"};
-    for (auto i = 0u; i < capacity; ++i) {
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
-        glBufferData(GL_PIXEL_PACK_BUFFER, length, nullptr, GL_STREAM_READ);
-        // glBufferData(GL_PIXEL_PACK_BUFFER, length, nullptr, GL_DYNAMIC_READ);
+    for (auto pbo : pbos) {
+        glBindBuffer(target, pbo);
+        glBufferData(target, length, nullptr, usage);
     }
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindBuffer(target, 0);
+}
+
+void delete_ring(std::vector<GLuint>& pbos, std::vector<GLsync>& fences) noexcept {
+    for (auto fence : fences)
+        if (fence)
+            glDeleteSync(fence);
+    glDeleteBuffers(static_cast<GLsizei>(pbos.size()), pbos.data());
+}
+
+pbo_reader_t::pbo_reader_t(GLuint length, uint16_t capacity) noexcept(false) : pbos{}, length{length}, offset{} {
+    GLint minor = 0;
+    if (get_opengl_version(version, minor) == false)
+        throw std::runtime_error{"Failed to query OpenGL version"};
+    make_ring(pbos, fences, capacity, max_capacity, GL_PIXEL_PACK_BUFFER, length, GL_STREAM_READ);
+    // GL_DYNAMIC_READ ...
 }
 
 pbo_reader_t::~pbo_reader_t() noexcept {
     // delete and report if error generated
-    glDeleteBuffers(capacity, pbos);
+    delete_ring(pbos, fences);
     if (auto ec = glGetError())
         spdlog::error("{} {}", __FUNCTION__, get_opengl_category().message(ec));
 }
@@ -352,22 +621,44 @@ uint32_t pbo_reader_t::get_length() const noexcept {
     return length;
 }
 
-GLenum pbo_reader_t::pack(uint16_t idx, GLuint, const GLint frame[4], GLenum format, GLenum type) noexcept {
-    if (idx >= capacity)
-        return GL_INVALID_VALUE;
+uint16_t pbo_reader_t::get_capacity() const noexcept {
+    return static_cast<uint16_t>(pbos.size());
+}
+
+uint16_t pbo_reader_t::get_pending() const noexcept {
+    return count;
+}
+
+const pbo_ring_stats_t& pbo_reader_t::get_stats() const noexcept {
+    return stats;
+}
+
+GLenum pbo_reader_t::pack(GLuint, const GLint frame[4], GLenum format, GLenum type) noexcept {
+    if (count == pbos.size())
+        return GL_OUT_OF_MEMORY;
     //if (length < (frame[2] - frame[0]) * (frame[3] - frame[1]) * 4)
     //    return GL_OUT_OF_MEMORY;
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[idx]);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[head]);
     glReadPixels(frame[0], frame[1], frame[2], frame[3], format, type, reinterpret_cast<void*>(offset));
     if (auto ec = glGetError())
         return ec; // probably GL_OUT_OF_MEMORY?
     glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-    return glGetError();
+    if (version > 2)
+        fences[head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (auto ec = glGetError())
+        return ec;
+    head = (head + 1) % pbos.size();
+    ++count;
+    ++stats.acquired;
+    return GL_NO_ERROR;
 }
 
-GLenum pbo_reader_t::map_and_invoke(uint16_t idx, reader_callback_t callback, void* user_data) noexcept {
-    if (idx >= capacity)
-        return GL_INVALID_VALUE;
+GLenum pbo_reader_t::map_and_invoke(reader_callback_t callback, void* user_data, GLuint64 timeout) noexcept {
+    if (count == 0)
+        return GL_INVALID_OPERATION;
+    const auto idx = (head + pbos.size() - count) % pbos.size();
+    if (auto ec = wait_slot(fences[idx], timeout, stats))
+        return ec;
     glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[idx]);
     if (version > 2) {
         if (const void* ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, offset, length, GL_MAP_READ_BIT)) {
@@ -381,26 +672,21 @@ GLenum pbo_reader_t::map_and_invoke(uint16_t idx, reader_callback_t callback, vo
     //         glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
     //     }
     // }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    --count; // the slot is free again even if mapping failed, so the ring can't get stuck
     return glGetError();
 }
 
-pbo_writer_t::pbo_writer_t(GLuint length) noexcept(false) : pbos{}, length{length} {
+pbo_writer_t::pbo_writer_t(GLuint length, uint16_t capacity) noexcept(false) : pbos{}, length{length} {
     GLint minor = 0;
     if (get_opengl_version(version, minor) == false)
         throw std::runtime_error{"Failed to query OpenGL version"};
-    glGenBuffers(capacity, pbos);
-    if (GLint ec = glGetError(); ec != GL_NO_ERROR)
-        throw std::system_error{ec, get_opengl_category(), "glGenBuffers"};
-    for (auto i = 0u; i < capacity; ++i) {
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
-        glBufferData(GL_PIXEL_UNPACK_BUFFER, length, nullptr, GL_STREAM_DRAW);
-    }
-    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    make_ring(pbos, fences, capacity, max_capacity, GL_PIXEL_UNPACK_BUFFER, length, GL_STREAM_DRAW);
 }
 
 pbo_writer_t::~pbo_writer_t() noexcept {
     // delete and report if error generated
-    glDeleteBuffers(capacity, pbos);
+    delete_ring(pbos, fences);
     if (auto ec = glGetError())
         spdlog::error("{} {}", __FUNCTION__, get_opengl_category().message(ec));
 }
@@ -409,34 +695,87 @@ uint32_t pbo_writer_t::get_length() const noexcept {
     return length;
 }
 
-/// @todo GL_MAP_UNSYNCHRONIZED_BIT?
-GLenum pbo_writer_t::map_and_invoke(uint16_t idx, writer_callback_t callback, void* user_data) noexcept {
-    if (idx >= capacity)
-        return GL_INVALID_VALUE;
+uint16_t pbo_writer_t::get_capacity() const noexcept {
+    return static_cast<uint16_t>(pbos.size());
+}
+
+uint16_t pbo_writer_t::get_mapped() const noexcept {
+    return mapped;
+}
+
+uint16_t pbo_writer_t::get_pending() const noexcept {
+    return count;
+}
+
+const pbo_ring_stats_t& pbo_writer_t::get_stats() const noexcept {
+    return stats;
+}
+
+GLenum pbo_writer_t::map(void*& mapping, GLuint64 timeout) noexcept {
+    mapping = nullptr;
+    if (mapped + count == pbos.size())
+        return GL_OUT_OF_MEMORY;
+    if (version < 3)
+        return GL_INVALID_OPERATION;
+    // the fence of the slot's last unpack tells the GPU is done reading it
+    if (auto ec = wait_slot(fences[head], timeout, stats))
+        return ec;
     // 1 is for write (upload)
-    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[idx]);
-    if (version > 2) {
-        if (void* ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, length, GL_MAP_READ_BIT | GL_MAP_WRITE_BIT)) {
-            // ...
-            callback(user_data, ptr, length);
-        }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[head]);
+    // the fence already synchronized, so the driver needn't
+    constexpr GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, length, access);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (auto ec = glGetError(); ec != GL_NO_ERROR || mapping == nullptr) {
+        mapping = nullptr;
+        return ec ? ec : GL_INVALID_OPERATION;
     }
-    // else {
-    //     if (void* ptr = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY)) {
-    //         // ...
-    //         callback(user_data, ptr, length);
-    //     }
-    // }
-    if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == false)
-        spdlog::warn("unmap buffer failed: {}", pbos[idx]);
+    head = static_cast<uint16_t>((head + 1) % pbos.size());
+    ++mapped;
+    ++stats.acquired;
+    return GL_NO_ERROR;
+}
+
+GLenum pbo_writer_t::commit() noexcept {
+    if (mapped == 0)
+        return GL_INVALID_OPERATION;
+    const auto idx = (head + pbos.size() - mapped) % pbos.size();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[idx]);
+    const bool intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    // the slot moves on regardless, to keep the ring in order
+    --mapped;
+    ++count;
+    if (intact == false) {
+        spdlog::warn("unmap buffer failed: {}", pbos[idx]);
+        return GL_INVALID_OPERATION; // contents are undefined
+    }
     return glGetError();
 }
 
-GLenum pbo_writer_t::unpack(uint16_t idx, GLuint tex2d, const GLint frame[4], //
+GLenum pbo_writer_t::discard() noexcept {
+    if (count == 0)
+        return GL_INVALID_OPERATION;
+    // the slot keeps the fence of its last unpack, so `map` still waits on the GPU reading it
+    --count;
+    return GL_NO_ERROR;
+}
+
+GLenum pbo_writer_t::map_and_invoke(writer_callback_t callback, void* user_data, GLuint64 timeout) noexcept {
+    if (mapped != 0)
+        return GL_INVALID_OPERATION;
+    void* ptr = nullptr;
+    if (auto ec = map(ptr, timeout))
+        return ec;
+    callback(user_data, ptr, length);
+    return commit();
+}
+
+GLenum pbo_writer_t::unpack(GLuint tex2d, const GLint frame[4], //
                             GLenum format, GLenum type) noexcept {
-    if (idx >= capacity)
-        return GL_INVALID_VALUE;
+    if (count == 0)
+        return GL_INVALID_OPERATION;
+    const auto idx = (head + pbos.size() - mapped - count) % pbos.size();
     GLenum ec = GL_NO_ERROR;
     glBindTexture(GL_TEXTURE_2D, tex2d);
     if (ec = glGetError(); ec != GL_NO_ERROR)
@@ -446,5 +785,587 @@ GLenum pbo_writer_t::unpack(uint16_t idx, GLuint tex2d, const GLint frame[4], //
     if (ec = glGetError(); ec != GL_NO_ERROR)
         spdlog::warn("tex sub image failed: {}", pbos[idx]);
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (ec == GL_NO_ERROR && version > 2)
+        fences[idx] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    --count;
     return ec ? ec : glGetError();
 }
+
+tile_reader_t::tile_reader_t(GLsizei width, GLsizei height, GLsizei tile_size, uint16_t capacity) noexcept(false)
+    : width{width}, height{height}, tile_size{tile_size} {
+    if (width <= 0 || height <= 0 || tile_size <= 0)
+        throw std::invalid_argument{"requested tile grid is empty"};
+    if ((width + tile_size - 1) / tile_size > UINT16_MAX || (height + tile_size - 1) / tile_size > UINT16_MAX)
+        throw std::invalid_argument{"requested tile size is too small"};
+    GLint version = 0, minor = 0;
+    if (get_opengl_version(version, minor) == false)
+        throw std::runtime_error{"Failed to query OpenGL version"};
+    if (version < 3) // packing to buffer offsets, fences and integer render targets
+        throw std::runtime_error{"tile readback requires OpenGL ES 3.0"};
+    columns = static_cast<uint16_t>((width + tile_size - 1) / tile_size);
+    rows = static_cast<uint16_t>((height + tile_size - 1) / tile_size);
+    dirty.assign(size_t{columns} * rows, 1); // nothing was read yet
+    const auto length = static_cast<GLuint>(width) * static_cast<GLuint>(height) * 4;
+    make_ring(pbos, fences, capacity, max_capacity, GL_PIXEL_PACK_BUFFER, length, GL_STREAM_READ);
+    slot_tiles.resize(capacity);
+    for (auto& tiles : slot_tiles)
+        tiles.reserve(dirty.size());
+}
+
+tile_reader_t::~tile_reader_t() noexcept {
+    delete_ring(pbos, fences);
+    delete_checksum_pass();
+    if (auto ec = glGetError())
+        spdlog::error("{} {}", __FUNCTION__, get_opengl_category().message(ec));
+}
+
+uint16_t tile_reader_t::get_pending() const noexcept {
+    return count;
+}
+
+uint32_t tile_reader_t::get_dirty_count() const noexcept {
+    return static_cast<uint32_t>(std::count(dirty.begin(), dirty.end(), 1));
+}
+
+const pbo_ring_stats_t& tile_reader_t::get_ring_stats() const noexcept {
+    return ring_stats;
+}
+
+const tile_reader_t::stats_t& tile_reader_t::get_stats() const noexcept {
+    return stats;
+}
+
+void tile_reader_t::mark_dirty(const GLint rect[4]) noexcept {
+    const GLint x0 = std::max(rect[0], 0), y0 = std::max(rect[1], 0);
+    const GLint x1 = std::min(rect[0] + rect[2], width), y1 = std::min(rect[1] + rect[3], height);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+    for (auto row = y0 / tile_size; row <= (y1 - 1) / tile_size; ++row)
+        for (auto column = x0 / tile_size; column <= (x1 - 1) / tile_size; ++column)
+            dirty[row * columns + column] = 1;
+}
+
+void tile_reader_t::mark_all() noexcept {
+    std::fill(dirty.begin(), dirty.end(), 1);
+}
+
+/// @brief One fragment per tile, looping over its texels. Besides FNV-1a, a Fletcher-style pair of sums
+///        guards against the rare FNV collision
+constexpr auto checksum_vs = R"(#version 300 es
+void main() {
+    // a single triangle covering the viewport
+    vec2 p = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+    gl_Position = vec4(p, 0.0, 1.0);
+}
+)";
+
+constexpr auto checksum_fs = R"(#version 300 es
+precision highp float;
+precision highp int;
+uniform highp sampler2D tex;
+uniform ivec2 tile_size;
+out highp uvec4 checksum;
+void main() {
+    ivec2 origin = ivec2(gl_FragCoord.xy) * tile_size;
+    ivec2 end = min(origin + tile_size, textureSize(tex, 0));
+    uint h = 2166136261u, s1 = 0u, s2 = 0u;
+    for (int y = origin.y; y < end.y; ++y) {
+        for (int x = origin.x; x < end.x; ++x) {
+            uvec4 c = uvec4(texelFetch(tex, ivec2(x, y), 0) * 255.0 + 0.5);
+            uint p = c.r | c.g << 8 | c.b << 16 | c.a << 24;
+            h = (h ^ p) * 16777619u;
+            s1 += p;
+            s2 += s1;
+        }
+    }
+    checksum = uvec4(h, s1, s2, 0u);
+}
+)";
+
+GLuint compile_shader(GLenum type, const char* source) noexcept {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (ok)
+        return shader;
+    char log[512]{};
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    spdlog::error("{}: {}", "glCompileShader", log);
+    glDeleteShader(shader);
+    return 0;
+}
+
+GLenum tile_reader_t::make_checksum_pass() noexcept {
+    const GLuint vs = compile_shader(GL_VERTEX_SHADER, checksum_vs);
+    const GLuint fs = compile_shader(GL_FRAGMENT_SHADER, checksum_fs);
+    if (vs == 0 || fs == 0) {
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+        return GL_INVALID_OPERATION;
+    }
+    program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glDeleteShader(vs); // flagged, deleted along with the program
+    glDeleteShader(fs);
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (ok == GL_FALSE) {
+        char log[512]{};
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        spdlog::error("{}: {}", "glLinkProgram", log);
+        glDeleteProgram(program);
+        program = 0;
+        return GL_INVALID_OPERATION;
+    }
+    glGenVertexArrays(1, &vao); // attribute-less
+    glGenTextures(1, &checksum_tex);
+    glBindTexture(GL_TEXTURE_2D, checksum_tex);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32UI, columns, rows);
+    glGenFramebuffers(1, &checksum_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, checksum_fbo);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, checksum_tex, 0);
+    GLenum ec = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE
+                    ? glGetError()
+                    : GL_INVALID_FRAMEBUFFER_OPERATION;
+    if (ec != GL_NO_ERROR) {
+        delete_checksum_pass(); // `program` is the mark of a usable pass, so the next use tries anew
+        return ec;
+    }
+    checksums.assign(size_t{columns} * rows * 4, 0);
+    return GL_NO_ERROR;
+}
+
+void tile_reader_t::delete_checksum_pass() noexcept {
+    glDeleteFramebuffers(1, &checksum_fbo);
+    glDeleteTextures(1, &checksum_tex);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+    checksum_fbo = checksum_tex = vao = program = 0;
+}
+
+GLenum tile_reader_t::detect_changes(GLuint tex2d) noexcept {
+    GLint viewport[4]{}, last_program = 0, last_vao = 0, last_unit = 0, last_tex = 0, last_draw = 0, last_read = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &last_unit);
+    glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &last_vao);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_tex);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &last_draw);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &last_read);
+    const GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+
+    GLenum ec = program ? GL_NO_ERROR : make_checksum_pass();
+    if (ec == GL_NO_ERROR) {
+        glBindFramebuffer(GL_FRAMEBUFFER, checksum_fbo);
+        glViewport(0, 0, columns, rows);
+        glDisable(GL_SCISSOR_TEST);
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "tex"), 0);
+        glUniform2i(glGetUniformLocation(program, "tile_size"), tile_size, tile_size);
+        glBindVertexArray(vao);
+        glBindTexture(GL_TEXTURE_2D, tex2d);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        // a grid of tiles is small enough to read straight into client memory
+        std::vector<GLuint> latest(checksums.size());
+        glReadPixels(0, 0, columns, rows, GL_RGBA_INTEGER, GL_UNSIGNED_INT, latest.data());
+        if (ec = glGetError(); ec == GL_NO_ERROR) {
+            for (size_t i = 0; i < dirty.size(); ++i)
+                if (std::equal(latest.begin() + i * 4, latest.begin() + i * 4 + 4, checksums.begin() + i * 4) == false)
+                    dirty[i] = 1;
+            checksums.swap(latest);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, last_tex);
+    glActiveTexture(last_unit);
+    glBindVertexArray(last_vao);
+    glUseProgram(last_program);
+    if (scissor)
+        glEnable(GL_SCISSOR_TEST);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, last_draw);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, last_read);
+    return ec;
+}
+
+GLenum tile_reader_t::pack(GLuint fbo) noexcept {
+    if (std::find(dirty.begin(), dirty.end(), 1) == dirty.end())
+        return GL_NO_ERROR;
+    if (count == pbos.size())
+        return GL_OUT_OF_MEMORY;
+    auto& tiles = slot_tiles[head];
+    tiles.clear();
+    GLint last_read = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &last_read);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[head]);
+    uint32_t offset = 0;
+    for (uint16_t row = 0; row < rows; ++row) {
+        for (uint16_t column = 0; column < columns; ++column) {
+            if (dirty[row * columns + column] == 0)
+                continue;
+            tile_t tile{column, row, {column * tile_size, row * tile_size, 0, 0}, offset};
+            tile.frame[2] = std::min(tile_size, width - tile.frame[0]);
+            tile.frame[3] = std::min(tile_size, height - tile.frame[1]);
+            // GL_PACK_ROW_LENGTH of 0 packs the rows of each tile back to back
+            glReadPixels(tile.frame[0], tile.frame[1], tile.frame[2], tile.frame[3], GL_RGBA, GL_UNSIGNED_BYTE,
+                         reinterpret_cast<void*>(static_cast<GLintptr>(offset)));
+            offset += static_cast<uint32_t>(tile.frame[2] * tile.frame[3] * 4);
+            tiles.push_back(tile);
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, last_read);
+    if (auto ec = glGetError()) {
+        tiles.clear(); // tiles stay dirty for the next try
+        return ec;
+    }
+    fences[head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    std::fill(dirty.begin(), dirty.end(), 0);
+    head = static_cast<uint16_t>((head + 1) % pbos.size());
+    ++count;
+    ++ring_stats.acquired;
+    ++stats.packs;
+    stats.tiles_read += tiles.size();
+    stats.tiles_total += size_t{columns} * rows;
+    stats.bytes_read += offset;
+    return glGetError();
+}
+
+GLenum tile_reader_t::map_and_invoke(tile_callback_t callback, void* user_data, GLuint64 timeout) noexcept {
+    if (count == 0)
+        return GL_INVALID_OPERATION;
+    const auto idx = (head + pbos.size() - count) % pbos.size();
+    if (auto ec = wait_slot(fences[idx], timeout, ring_stats))
+        return ec;
+    const auto& tiles = slot_tiles[idx];
+    const auto& last = tiles.back();
+    const auto length = last.offset + static_cast<uint32_t>(last.frame[2] * last.frame[3] * 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[idx]);
+    if (const void* ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, length, GL_MAP_READ_BIT)) {
+        callback(user_data, tiles.data(), tiles.size(), ptr, length);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    --count; // the slot is free again even if mapping failed, so the ring can't get stuck
+    return glGetError();
+}
+
+texture_stream_t::texture_stream_t(GLsizei width, GLsizei height, stream_producer_t producer, void* user_data,
+                                   uint16_t slots, uint16_t num_textures) noexcept(false)
+    : width{width}, height{height}, writer{static_cast<GLuint>(width) * static_cast<GLuint>(height) * 4, slots},
+      producer{producer}, user_data{user_data} {
+    if (num_textures < 2) // one to show while the next one is written
+        throw std::invalid_argument{"requested texture count is too small"};
+    textures.resize(num_textures);
+    for (auto& texture : textures)
+        texture.owner = std::make_unique<tex2d_owner_t>(width, height);
+    worker = std::thread{&texture_stream_t::produce, this};
+}
+
+texture_stream_t::~texture_stream_t() noexcept {
+    {
+        std::lock_guard lck{mtx};
+        stopping = true;
+    }
+    cv.notify_all();
+    // the producer may still write a mapping, which must outlive it
+    if (worker.joinable())
+        worker.join();
+    for (auto& texture : textures)
+        if (texture.fence)
+            glDeleteSync(texture.fence);
+    // mapped slots get unmapped along with the writer's buffers
+}
+
+void texture_stream_t::produce() noexcept {
+    for (uint64_t frame = 0;; ++frame) {
+        slot_t slot{};
+        {
+            std::unique_lock lck{mtx};
+            cv.wait(lck, [this] { return stopping || empty_slots.empty() == false; });
+            if (stopping)
+                return;
+            slot = empty_slots.front();
+            empty_slots.pop_front();
+        }
+        slot.frame = frame;
+        slot.filled = producer(user_data, slot.mapping, writer.get_length(), frame);
+        slot.filled_at = clock_type::now();
+        {
+            std::lock_guard lck{mtx};
+            if (slot.filled == false) {
+                finished = true;
+                return;
+            }
+            full_slots.push_back(slot);
+        }
+    }
+}
+
+void texture_stream_t::measure(texture_t& texture, GLuint64 timeout, pbo_ring_stats_t& stats) noexcept {
+    if (wait_slot(texture.fence, timeout, stats) != GL_NO_ERROR)
+        return;
+    if (texture.measured)
+        return;
+    // the fence is released, so the frames sampling the texture are done
+    latencies.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - texture.filled_at));
+    texture.measured = true;
+}
+
+GLenum texture_stream_t::update() noexcept {
+    pbo_ring_stats_t polls{}; // polling takes no stall, so it stays out of the stats
+    for (auto& texture : textures)
+        if (texture.fence)
+            measure(texture, 0, polls);
+    // the frames which sampled the current texture have been issued. A later fence covers the earlier ones
+    if (current >= 0) {
+        texture_t& texture = textures[current];
+        if (texture.fence)
+            glDeleteSync(texture.fence);
+        texture.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // take at most one frame per update, the oldest, so frames show in order and none is skipped
+    texture_t& texture = textures[next_texture];
+    bool take = false;
+    slot_t slot{};
+    {
+        std::lock_guard lck{mtx};
+        take = full_slots.empty() == false;
+    }
+    if (take) {
+        measure(texture, pbo_writer_t::default_timeout, texture_stats); // rather wait than overwrite a texture in use
+        if (texture.fence)
+            return GL_TIMEOUT_EXPIRED;
+        {
+            std::lock_guard lck{mtx};
+            slot = full_slots.front();
+            full_slots.pop_front();
+        }
+        // a failed commit still counts the slot as filled; drop it, or it would be unpacked as the next frame
+        if (auto ec = writer.commit()) {
+            writer.discard();
+            return ec;
+        }
+        const GLint frame[4]{0, 0, width, height};
+        if (auto ec = writer.unpack(texture.owner->handle(), frame))
+            return ec;
+        texture.frame = slot.frame;
+        texture.filled_at = slot.filled_at;
+        texture.measured = false;
+        current = next_texture;
+        next_texture = static_cast<uint16_t>((next_texture + 1) % textures.size());
+        ++frames_unpacked;
+    }
+
+    // keep the producer supplied, without waiting on the GPU
+    {
+        std::lock_guard lck{mtx};
+        if (finished)
+            return GL_NO_ERROR;
+    }
+    void* mapping = nullptr;
+    while (writer.map(mapping, 0) == GL_NO_ERROR) {
+        {
+            std::lock_guard lck{mtx};
+            empty_slots.push_back(slot_t{mapping, 0, {}, false});
+        }
+        cv.notify_one();
+    }
+    return GL_NO_ERROR;
+}
+
+GLuint texture_stream_t::get_texture(uint64_t* frame) const noexcept {
+    if (current < 0)
+        return 0;
+    if (frame)
+        *frame = textures[current].frame;
+    return textures[current].owner->handle();
+}
+
+bool texture_stream_t::is_finished() noexcept {
+    std::lock_guard lck{mtx};
+    return finished && full_slots.empty();
+}
+
+uint64_t texture_stream_t::get_frames_unpacked() const noexcept {
+    return frames_unpacked;
+}
+
+const pbo_ring_stats_t& texture_stream_t::get_upload_stats() const noexcept {
+    return writer.get_stats();
+}
+
+const pbo_ring_stats_t& texture_stream_t::get_texture_stats() const noexcept {
+    return texture_stats;
+}
+
+void texture_stream_t::take_latencies(std::vector<std::chrono::nanoseconds>& output) noexcept {
+    output.clear();
+    std::swap(output, latencies);
+}
+
+struct bench_video_t final {
+    uint64_t num_frames;
+};
+
+/// @brief A moving gradient, cheap enough not to bound the upload rate
+bool fill_bench_frame(void* user_data, void* mapping, size_t length, uint64_t frame) {
+    const auto& video = *reinterpret_cast<const bench_video_t*>(user_data);
+    if (frame >= video.num_frames)
+        return false;
+    auto* pixels = reinterpret_cast<uint32_t*>(mapping);
+    const auto count = length / 4;
+    const auto shift = static_cast<uint32_t>(frame * 4);
+    for (size_t i = 0; i < count; ++i)
+        pixels[i] = 0xff000000u | ((static_cast<uint32_t>(i) + shift) & 0xffu) * 0x010101u;
+    return true;
+}
+
+_INTERFACE_ bool bench_texture_stream(EGLDisplay es_display, EGLint width, EGLint height, uint32_t num_frames) noexcept {
+    try {
+        egl_context_t context{es_display, EGL_NO_CONTEXT};
+        EGLint attrs[]{EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+        egl_surface_owner_t surface{es_display, context.config(),
+                                    eglCreatePbufferSurface(es_display, context.config(), attrs)};
+        egl_context_guard guard{context, surface.handle()};
+
+        bench_video_t video{num_frames};
+        texture_stream_t stream{width, height, fill_bench_frame, &video};
+        GLuint fbo = 0;
+        glGenFramebuffers(1, &fbo);
+
+        const auto t0 = texture_stream_t::clock_type::now();
+        while (stream.is_finished() == false) {
+            if (auto ec = stream.update()) {
+                spdlog::error("{}: {}", "texture_stream_t::update", get_opengl_category().message(ec));
+                break;
+            }
+            // display: blit the newest frame to the surface
+            if (GLuint tex = stream.get_texture()) {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+                glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            }
+            if (auto ec = context.swap(); ec != EGL_SUCCESS) {
+                spdlog::error("{}: {:#x}", "eglSwapBuffers", ec);
+                break;
+            }
+        }
+        stream.update(); // fence the last frame shown, and collect its latency once done
+        glFinish();
+        stream.update();
+        const auto elapsed = std::chrono::duration<double>(texture_stream_t::clock_type::now() - t0).count();
+        glDeleteFramebuffers(1, &fbo);
+
+        const auto frames = stream.get_frames_unpacked();
+        const double megabytes = static_cast<double>(frames) * width * height * 4 / (1024.0 * 1024.0);
+        spdlog::info("{}: {} frames of {}x{} in {:.3f} s, {:.1f} MB/s", __func__, frames, width, height, elapsed,
+                     megabytes / elapsed);
+
+        std::vector<std::chrono::nanoseconds> latencies{};
+        stream.take_latencies(latencies);
+        if (latencies.empty() == false) {
+            std::sort(latencies.begin(), latencies.end());
+            const auto at = [&latencies](double p) {
+                return std::chrono::duration<double, std::milli>(latencies[static_cast<size_t>(p * (latencies.size() - 1))])
+                    .count();
+            };
+            spdlog::info("{}: upload-to-display latency ms: min {:.3f}, p50 {:.3f}, p99 {:.3f}, max {:.3f}", __func__,
+                         at(0), at(0.5), at(0.99), at(1));
+        }
+        const auto& upload = stream.get_upload_stats();
+        spdlog::info("{}: upload slots: ready {}, stalled {}, wait {:.3f} ms", __func__, upload.ready, upload.stalled,
+                     std::chrono::duration<double, std::milli>(upload.wait_time).count());
+        return frames == num_frames;
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        return false;
+    }
+}
+
+struct bench_tiles_t final {
+    uint64_t tiles = 0;
+    uint64_t bytes = 0;
+};
+
+void count_bench_tiles(void* user_data, const tile_t*, size_t count, const void*, size_t length) {
+    auto& result = *reinterpret_cast<bench_tiles_t*>(user_data);
+    result.tiles += count;
+    result.bytes += length;
+}
+
+/// @brief Each frame repaints one tile-sized square, sweeping the diagonal off the tile grid, so it damages
+///        up to 4 tiles; the checksum pass is to find just those, and the readback to cost just their area
+_INTERFACE_ bool bench_tile_reader(EGLDisplay es_display, EGLint width, EGLint height, uint32_t num_frames) noexcept {
+    try {
+        egl_context_t context{es_display, EGL_NO_CONTEXT};
+        EGLint attrs[]{EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+        egl_surface_owner_t surface{es_display, context.config(),
+                                    eglCreatePbufferSurface(es_display, context.config(), attrs)};
+        egl_context_guard guard{context, surface.handle()};
+
+        tex2d_owner_t target{width, height};
+        GLuint fbo = 0;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.handle(), 0);
+        glClearColor(0, 0, 0, 1);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        const GLsizei size = tile_reader_t::default_tile_size;
+        tile_reader_t reader{width, height, size};
+        bench_tiles_t result{};
+        GLenum ec = GL_NO_ERROR;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < num_frames && ec == GL_NO_ERROR; ++frame) {
+            const GLint offset = static_cast<GLint>(frame) * size / 2 + size / 2;
+            const GLint rect[4]{offset % (width - size), offset % (height - size), size, size};
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(rect[0], rect[1], rect[2], rect[3]);
+            glClearColor(frame & 1 ? 1.0f : 0.5f, 0.25f, 0, 1);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glDisable(GL_SCISSOR_TEST);
+            if (ec = reader.detect_changes(target.handle()); ec != GL_NO_ERROR)
+                break;
+            // keep a slot free, mapping the oldest one
+            if (reader.get_pending() == tile_reader_t::default_capacity)
+                ec = reader.map_and_invoke(count_bench_tiles, &result);
+            if (ec == GL_NO_ERROR)
+                ec = reader.pack(fbo);
+        }
+        while (ec == GL_NO_ERROR && reader.get_pending() != 0)
+            ec = reader.map_and_invoke(count_bench_tiles, &result);
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo);
+        if (ec != GL_NO_ERROR) {
+            spdlog::error("{}: {}", __func__, get_opengl_category().message(ec));
+            return false;
+        }
+
+        const auto& stats = reader.get_stats();
+        spdlog::info("{}: {} frames of {}x{} in {:.3f} s, {} of {} tiles read ({:.2f}% of full-frame bandwidth), "
+                     "{:.1f} MB/s",
+                     __func__, num_frames, width, height, elapsed, stats.tiles_read, stats.tiles_total,
+                     stats.tiles_total ? 100.0 * stats.tiles_read / stats.tiles_total : 0.0,
+                     static_cast<double>(result.bytes) / (1024.0 * 1024.0) / elapsed);
+        const auto& ring = reader.get_ring_stats();
+        spdlog::info("{}: readback slots: ready {}, stalled {}, wait {:.3f} ms", __func__, ring.ready, ring.stalled,
+                     std::chrono::duration<double, std::milli>(ring.wait_time).count());
+        // past the first frame, at most the 4 tiles under the square may differ
+        return stats.packs == num_frames && result.tiles == stats.tiles_read &&
+               stats.tiles_read <= stats.tiles_total / num_frames + 4 * (num_frames - 1);
+    } catch (const std::exception& ex) {
+        spdlog::error("{}: {}", __func__, ex.what());
+        return false;
+    }
+}
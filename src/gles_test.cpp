@@ -7,6 +7,8 @@
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 
 //import std.filesystem;
@@ -17,11 +19,18 @@ import gles;
 namespace fs = std::filesystem;
 
 bool test_egl_resume(EGLDisplay es_display) noexcept;
+bool bench_texture_stream(EGLDisplay es_display, EGLint width, EGLint height, uint32_t num_frames) noexcept;
+bool bench_tile_reader(EGLDisplay es_display, EGLint width, EGLint height, uint32_t num_frames) noexcept;
 
 int main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[]) {
     try {
         EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
         test_egl_resume(display);
+        // benchmarks take a while, so they run on request only
+        if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+            if (bench_texture_stream(display, 1920, 1080, 600) == false ||
+                bench_tile_reader(display, 1920, 1080, 600) == false)
+                return 1;
         eglTerminate(display);
     } catch (...) {
         return 1;